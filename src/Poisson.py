@@ -37,3 +37,26 @@ for degree in range(1, 4):
     del u, v, f, g, un
 
     forms += [ns[aname], ns[Lname], ns[Mname]]
+
+# Hexahedral forms for the matrix-free solver (cgpoisson), which only
+# needs the linear forms
+for degree in range(1, 7):
+    element = basix.ufl.element("Lagrange", "hexahedron", degree)
+    domain = Mesh(basix.ufl.element("Lagrange", "hexahedron", 1, shape=(3,)))
+    space = FunctionSpace(domain, element)
+
+    u = TrialFunction(space)
+    v = TestFunction(space)
+    f = Coefficient(space)
+    g = Coefficient(space)
+    un = Coefficient(space)
+
+    Lname = 'L_hex' + str(degree)
+    Mname = 'M_hex' + str(degree)
+
+    ns[Lname] = f*v*dx + g*v*ds
+    ns[Mname] = action(inner(grad(u), grad(v))*dx, un)
+
+    del u, v, f, g, un
+
+    forms += [ns[Lname], ns[Mname]]
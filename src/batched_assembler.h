@@ -0,0 +1,380 @@
+// Copyright (C) 2026 The FEniCS Project
+//
+// This file is part of FEniCS-miniapp (https://www.fenicsproject.org)
+//
+// SPDX-License-Identifier:    MIT
+
+#pragma once
+
+#include "threaded_assembler.h"
+#include <algorithm>
+#include <array>
+#include <basix/finite-element.h>
+#include <basix/quadrature.h>
+#include <cmath>
+#include <cstdint>
+#include <dolfinx/fem/DirichletBC.h>
+#include <dolfinx/fem/DofMap.h>
+#include <dolfinx/fem/Form.h>
+#include <dolfinx/fem/FunctionSpace.h>
+#include <dolfinx/mesh/Geometry.h>
+#include <dolfinx/mesh/Mesh.h>
+#include <functional>
+#include <map>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+/// Cross-cell batched assembly of the Poisson forms on affine
+/// tetrahedra. On an affine cell the element matrix of (grad u, grad v)
+/// is a contraction of the geometric factor G = |det J| K K^T with six
+/// reference tensors, and the element vector of (f, v) is |det J| times
+/// the reference mass matrix applied to the cell values of f. Cells are
+/// processed W at a time with cell data in structure-of-arrays layout
+/// ([component][W]), so that the geometry and the contraction are
+/// vectorised across cells. Element matrices are then inserted in bulk
+/// per colour, and element vectors added one cell at a time, with the
+/// same boundary condition handling as `threaded::assemble_matrix`.
+namespace batched
+{
+/// Reference tensors of a Lagrange element on the reference tetrahedron
+template <typename T>
+struct ReferenceTensors
+{
+  /// Number of dofs per cell
+  int ndofs;
+
+  /// Stiffness tensors S_k, [6][ndofs][ndofs], such that the element
+  /// matrix is sum_k G_k S_k for the upper triangle G_k (00, 01, 02,
+  /// 11, 12, 22) of the geometric factor
+  std::vector<T> S;
+
+  /// Mass matrix, [ndofs][ndofs]
+  std::vector<T> M;
+};
+
+/// Compute the reference tensors of an element, with quadrature that
+/// integrates the stiffness and mass matrices exactly
+/// @param[in] element Lagrange element on a tetrahedron
+/// @param[in] order Polynomial order of `element`
+/// @return Reference tensors
+template <typename T>
+ReferenceTensors<T>
+reference_tensors(const basix::FiniteElement<double>& element, int order)
+{
+  auto [pts, wts] = basix::quadrature::make_quadrature<double>(
+      basix::quadrature::type::Default, basix::cell::type::tetrahedron,
+      basix::polyset::type::standard, 2 * order);
+  const std::size_t nq = wts.size();
+  auto [phi, shape] = element.tabulate(1, pts, {nq, 3});
+  const int nd = shape[2];
+
+  // phi(d, q, i) with d = 0 for values and d = 1 + a for derivatives
+  auto tab = [&phi, nq, nd](int d, std::size_t q, int i)
+  { return phi[(d * nq + q) * nd + i]; };
+
+  ReferenceTensors<T> ref{nd, std::vector<T>(6 * nd * nd, 0),
+                          std::vector<T>(nd * nd, 0)};
+  constexpr std::array<std::array<int, 2>, 6> ab
+      = {{{0, 0}, {0, 1}, {0, 2}, {1, 1}, {1, 2}, {2, 2}}};
+  for (std::size_t q = 0; q < nq; ++q)
+  {
+    for (int i = 0; i < nd; ++i)
+    {
+      for (int j = 0; j < nd; ++j)
+      {
+        for (int k = 0; k < 6; ++k)
+        {
+          auto [a, b] = ab[k];
+          double s = tab(1 + a, q, i) * tab(1 + b, q, j);
+          if (a != b)
+            s += tab(1 + b, q, i) * tab(1 + a, q, j);
+          ref.S[(k * nd + i) * nd + j] += wts[q] * s;
+        }
+        ref.M[i * nd + j] += wts[q] * tab(0, q, i) * tab(0, q, j);
+      }
+    }
+  }
+  return ref;
+}
+
+/// Compute the geometric factors and Jacobian determinants of a batch
+/// of W affine cells. A batch with fewer than W cells is padded by
+/// repeating its last cell.
+/// @param[in] x Geometry coordinates
+/// @param[in] x_dofmap Geometry dofmap, flattened with 4 nodes per cell
+/// @param[in] cells Cells of the batch (1 to W)
+/// @param[out] G Upper triangle of |det J| K K^T, [6][W]
+/// @param[out] detJ Absolute value of the Jacobian determinant, [W]
+template <int W, typename T>
+void geometry_factors(std::span<const double> x,
+                      std::span<const std::int32_t> x_dofmap,
+                      std::span<const std::int32_t> cells,
+                      std::array<T, 6 * W>& G, std::array<T, W>& detJ)
+{
+  // Gather the Jacobians J_ia = x_{a+1, i} - x_{0, i}, [9][W]
+  alignas(64) std::array<T, 9 * W> J;
+  for (int w = 0; w < W; ++w)
+  {
+    const std::int32_t c = cells[std::min<int>(w, cells.size() - 1)];
+    const std::int32_t* nodes = x_dofmap.data() + 4 * c;
+    const double* x0 = x.data() + 3 * nodes[0];
+    for (int a = 0; a < 3; ++a)
+    {
+      const double* xa = x.data() + 3 * nodes[a + 1];
+      for (int i = 0; i < 3; ++i)
+        J[(3 * i + a) * W + w] = xa[i] - x0[i];
+    }
+  }
+
+  // G = |det J| (J^T J)^{-1} = adj(J^T J) / |det J|
+#pragma omp simd
+  for (int w = 0; w < W; ++w)
+  {
+    auto j = [&J, w](int i, int a) { return J[(3 * i + a) * W + w]; };
+    T C[3][3];
+    for (int a = 0; a < 3; ++a)
+      for (int b = 0; b < 3; ++b)
+        C[a][b] = j(0, a) * j(0, b) + j(1, a) * j(1, b) + j(2, a) * j(2, b);
+    const T det = j(0, 0) * (j(1, 1) * j(2, 2) - j(1, 2) * j(2, 1))
+                  - j(0, 1) * (j(1, 0) * j(2, 2) - j(1, 2) * j(2, 0))
+                  + j(0, 2) * (j(1, 0) * j(2, 1) - j(1, 1) * j(2, 0));
+    const T adet = std::abs(det);
+    detJ[w] = adet;
+    G[0 * W + w] = (C[1][1] * C[2][2] - C[1][2] * C[2][1]) / adet;
+    G[1 * W + w] = (C[0][2] * C[2][1] - C[0][1] * C[2][2]) / adet;
+    G[2 * W + w] = (C[0][1] * C[1][2] - C[0][2] * C[1][1]) / adet;
+    G[3 * W + w] = (C[0][0] * C[2][2] - C[0][2] * C[2][0]) / adet;
+    G[4 * W + w] = (C[0][2] * C[1][0] - C[0][0] * C[1][2]) / adet;
+    G[5 * W + w] = (C[0][0] * C[1][1] - C[0][1] * C[1][0]) / adet;
+  }
+}
+
+/// Call `fn(batch)` for consecutive batches of at most W cells of each
+/// colour, with the cells of a colour divided between the OpenMP
+/// threads
+/// @return Time (seconds) spent by each thread
+template <int W, typename Fn>
+std::vector<double>
+for_each_batch(const std::vector<std::vector<std::int32_t>>& colours,
+               Fn&& fn)
+{
+  return threaded::for_each_colour(
+      colours,
+      [&fn](std::span<const std::int32_t> cells)
+      {
+        for (std::size_t c0 = 0; c0 < cells.size(); c0 += W)
+        {
+          fn(cells.subspan(c0, std::min<std::size_t>(W, cells.size() - c0)));
+        }
+      });
+}
+
+/// Assemble the Laplace matrix (grad u, grad v) over the owned cells
+/// in batches of W cells. Rows and columns constrained by a Dirichlet
+/// condition are zeroed. Element matrices are computed concurrently and
+/// inserted in bulk after each colour (see
+/// `threaded::assemble_colours`).
+/// @param[in] mat_add Function that adds an element matrix
+/// @param[in] V Scalar Lagrange space on an affine tetrahedral mesh
+/// @param[in] ref Reference tensors of the element of `V`
+/// @param[in] bcs Dirichlet boundary conditions
+/// @param[in] colours Colouring of the owned cells, from
+/// `threaded::colour_cells`
+/// @return Times of the element matrix computation and of insertion
+template <int W, typename T, typename MatAdd>
+threaded::MatrixTimes assemble_matrix(
+    MatAdd&& mat_add, const dolfinx::fem::FunctionSpace<double>& V,
+    const ReferenceTensors<T>& ref,
+    const std::vector<
+        std::reference_wrapper<const dolfinx::fem::DirichletBC<T>>>& bcs,
+    const std::vector<std::vector<std::int32_t>>& colours)
+{
+  if (V.element()->needs_dof_transformations())
+    throw std::runtime_error("Batched assembly requires an element "
+                             "without dof transformations");
+  auto mesh = V.mesh();
+  auto x_dofmap = mesh->geometry().dofmap();
+  if (x_dofmap.extent(1) != 4)
+    throw std::runtime_error("Batched assembly requires affine cells");
+  std::span<const double> x = mesh->geometry().x();
+  std::span<const std::int32_t> x_dofs(x_dofmap.data_handle(),
+                                       x_dofmap.size());
+
+  auto dofmap = V.dofmap()->map();
+  const int nd = ref.ndofs;
+  if (static_cast<int>(dofmap.extent(1)) != nd or V.dofmap()->bs() != 1)
+    throw std::runtime_error("Dofmap and reference tensors do not match");
+
+  const std::vector<std::int8_t> markers = threaded::bc_markers(V, bcs);
+
+  return threaded::assemble_colours<T>(
+      mat_add, colours, std::span(dofmap.data_handle(), dofmap.size()), nd,
+      nd * nd,
+      [&](std::span<const std::int32_t> block, std::span<T> Ab)
+      {
+        // Element matrices of a batch, [nd][nd][W]
+        std::vector<T> A(nd * nd * W);
+        for (std::size_t c0 = 0; c0 < block.size(); c0 += W)
+        {
+          std::span<const std::int32_t> cells = block.subspan(
+              c0, std::min<std::size_t>(W, block.size() - c0));
+          alignas(64) std::array<T, 6 * W> G;
+          alignas(64) std::array<T, W> detJ;
+          geometry_factors<W>(x, x_dofs, cells, G, detJ);
+
+          std::fill(A.begin(), A.end(), 0);
+          for (int k = 0; k < 6; ++k)
+          {
+            const T* Sk = ref.S.data() + k * nd * nd;
+            const T* Gk = G.data() + k * W;
+            for (int ij = 0; ij < nd * nd; ++ij)
+            {
+              T* Aij = A.data() + ij * W;
+              const T s = Sk[ij];
+#pragma omp simd
+              for (int w = 0; w < W; ++w)
+                Aij[w] += s * Gk[w];
+            }
+          }
+
+          // Copy to the buffer, zeroing rows and columns of constrained
+          // dofs
+          for (std::size_t w = 0; w < cells.size(); ++w)
+          {
+            std::span<T> Ae = Ab.subspan((c0 + w) * nd * nd, nd * nd);
+            for (int ij = 0; ij < nd * nd; ++ij)
+              Ae[ij] = A[ij * W + w];
+            std::span<const std::int32_t> dofs(
+                dofmap.data_handle() + cells[w] * nd, nd);
+            for (int i = 0; i < nd; ++i)
+            {
+              if (markers[dofs[i]])
+              {
+                std::fill_n(std::next(Ae.begin(), i * nd), nd, 0);
+                for (int j = 0; j < nd; ++j)
+                  Ae[j * nd + i] = 0;
+              }
+            }
+          }
+        }
+      });
+}
+
+/// Assemble the Poisson linear form f v dx + g v ds into a vector. The
+/// cell integral is computed in batches of W cells from the cell values
+/// of f; the exterior facet integrals use the FFCx kernels of `L`.
+/// @param[in,out] b Array to add to (including ghost entries)
+/// @param[in] L Linear form, whose cell integral must be (f, v)
+/// @param[in] constants Packed constants of `L`
+/// @param[in] coeffs Packed coefficients of `L`
+/// @param[in] ref Reference tensors of the element of the test space
+/// @param[in] f Values (including ghosts) of the cell integral
+/// coefficient, in the test space
+/// @param[in] colours Colouring of the owned cells
+/// @return Time (seconds) spent by each thread on the cell integral
+template <int W, typename T>
+std::vector<double> assemble_vector(
+    std::span<T> b, const dolfinx::fem::Form<T, double>& L,
+    std::span<const T> constants,
+    const std::map<std::pair<dolfinx::fem::IntegralType, int>,
+                   std::pair<std::span<const T>, int>>& coeffs,
+    const ReferenceTensors<T>& ref, std::span<const T> f,
+    const std::vector<std::vector<std::int32_t>>& colours)
+{
+  using dolfinx::fem::IntegralType;
+
+  auto V = L.function_spaces()[0];
+  if (V->element()->needs_dof_transformations())
+    throw std::runtime_error("Batched assembly requires an element "
+                             "without dof transformations");
+  auto mesh = L.mesh();
+  auto x_dofmap = mesh->geometry().dofmap();
+  if (x_dofmap.extent(1) != 4)
+    throw std::runtime_error("Batched assembly requires affine cells");
+  std::span<const double> x = mesh->geometry().x();
+  std::span<const std::int32_t> x_dofs(x_dofmap.data_handle(),
+                                       x_dofmap.size());
+  if (!L.integral_ids(IntegralType::interior_facet).empty()
+      or (!L.integral_ids(IntegralType::exterior_facet).empty()
+          and L.needs_facet_permutations()))
+  {
+    throw std::runtime_error("Unsupported integral in batched vector "
+                             "assembly");
+  }
+
+  auto dofmap = V->dofmap()->map();
+  const int nd = ref.ndofs;
+  if (static_cast<int>(dofmap.extent(1)) != nd or V->dofmap()->bs() != 1)
+    throw std::runtime_error("Dofmap and reference tensors do not match");
+
+  std::vector<double> times = for_each_batch<W>(
+      colours,
+      [&](std::span<const std::int32_t> cells)
+      {
+        alignas(64) std::array<T, 6 * W> G;
+        alignas(64) std::array<T, W> detJ;
+        geometry_factors<W>(x, x_dofs, cells, G, detJ);
+
+        // Gather f, [nd][W]
+        std::vector<T> fe(nd * W), be(nd * W, 0);
+        for (int w = 0; w < W; ++w)
+        {
+          const std::int32_t c = cells[std::min<int>(w, cells.size() - 1)];
+          for (int j = 0; j < nd; ++j)
+            fe[j * W + w] = f[dofmap(c, j)];
+        }
+
+        // be = |det J| M fe
+        for (int i = 0; i < nd; ++i)
+        {
+          T* bi = be.data() + i * W;
+          for (int j = 0; j < nd; ++j)
+          {
+            const T m = ref.M[i * nd + j];
+            const T* fj = fe.data() + j * W;
+#pragma omp simd
+            for (int w = 0; w < W; ++w)
+              bi[w] += m * fj[w];
+          }
+#pragma omp simd
+          for (int w = 0; w < W; ++w)
+            bi[w] *= detJ[w];
+        }
+
+        for (std::size_t w = 0; w < cells.size(); ++w)
+          for (int i = 0; i < nd; ++i)
+            b[dofmap(cells[w], i)] += be[i * W + w];
+      });
+
+  // Exterior facets, stored as (cell, local facet) pairs
+  std::vector<double> coordinate_dofs(3 * 4);
+  std::vector<T> be(nd);
+  for (int id : L.integral_ids(IntegralType::exterior_facet))
+  {
+    auto kernel = L.kernel(IntegralType::exterior_facet, id);
+    std::span<const std::int32_t> facets
+        = L.domain(IntegralType::exterior_facet, id);
+    auto& [coeffs_f, cstride]
+        = coeffs.at({IntegralType::exterior_facet, id});
+    for (std::size_t e = 0; e < facets.size(); e += 2)
+    {
+      const std::int32_t c = facets[e];
+      for (int i = 0; i < 4; ++i)
+      {
+        std::copy_n(std::next(x.begin(), 3 * x_dofmap(c, i)), 3,
+                    std::next(coordinate_dofs.begin(), 3 * i));
+      }
+      std::fill(be.begin(), be.end(), 0);
+      kernel(be.data(), coeffs_f.data() + (e / 2) * cstride,
+             constants.data(), coordinate_dofs.data(), &facets[e + 1],
+             nullptr);
+      for (int i = 0; i < nd; ++i)
+        b[dofmap(c, i)] += be[i];
+    }
+  }
+
+  return times;
+}
+} // namespace batched
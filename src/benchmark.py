@@ -0,0 +1,205 @@
+# Copyright (C) 2026 The FEniCS Project
+#
+# This file is part of FEniCS-miniapp (https://www.fenicsproject.org)
+#
+# SPDX-License-Identifier:    MIT
+
+"""Benchmark suite: run a fixed matrix of test cases several times, and
+compare the per-phase times with a stored baseline.
+
+Each case is run as a separate program invocation with --metrics_file;
+the time of a phase in a run is the maximum over processes of its ZZZ
+timer. A phase regresses if its mean time grew by more than the
+threshold relative to the baseline and the 95% confidence intervals of
+the two means do not overlap. The exit status is 1 if any phase
+regressed or any run failed.
+
+    python3 benchmark.py --output results.json
+    python3 benchmark.py --baseline results.json --threshold 0.1
+"""
+
+import argparse
+import itertools
+import json
+import math
+import os
+import re
+import shlex
+import subprocess
+import sys
+import tempfile
+
+PROBLEMS = ["poisson", "cgpoisson", "elasticity"]
+ORDERS = [1, 2, 3]
+MESHES = ["cube", "unstructured"]
+
+# Degrees of freedom per process and PETSc options, as in the CI runs
+NDOFS = {"poisson": 50000, "cgpoisson": 50000, "elasticity": 100000}
+PETSC_OPTIONS = {
+    "poisson": ["-ksp_type", "cg", "-ksp_rtol", "1.0e-8", "-pc_type", "hypre",
+                "-pc_hypre_type", "boomeramg",
+                "-pc_hypre_boomeramg_strong_threshold", "0.7",
+                "-pc_hypre_boomeramg_agg_nl", "4",
+                "-pc_hypre_boomeramg_agg_num_paths", "2"],
+    "cgpoisson": [],
+    "elasticity": ["-ksp_type", "cg", "-ksp_rtol", "1.0e-8", "-pc_type", "gamg",
+                   "-pc_gamg_coarse_eq_limit", "1000",
+                   "-mg_levels_ksp_type", "chebyshev",
+                   "-mg_levels_pc_type", "jacobi",
+                   "-mg_levels_esteig_ksp_type", "cg",
+                   "-matptap_via", "scalable"],
+}
+
+# Two-sided 95% quantiles of Student's t distribution, by degrees of
+# freedom (normal quantile beyond the table)
+T95 = [12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+       2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+       2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042]
+
+
+def case_name(problem, order, mesh):
+    return f"{problem}-p{order}-{mesh}"
+
+
+def statistics(samples):
+    """Mean, sample standard deviation and half-width of the 95%
+    confidence interval of the mean (zero for a single sample, so that
+    only the threshold applies)"""
+    n = len(samples)
+    mean = sum(samples) / n
+    if n < 2:
+        return {"mean": mean, "stddev": 0.0, "ci95": 0.0, "samples": samples}
+    stddev = math.sqrt(sum((x - mean)**2 for x in samples) / (n - 1))
+    t = T95[n - 2] if n - 1 <= len(T95) else 1.960
+    return {"mean": mean, "stddev": stddev, "ci95": t * stddev / math.sqrt(n),
+            "samples": samples}
+
+
+def command(args, problem, order, mesh, metrics_file):
+    cmd = [] if args.np == 1 else shlex.split(args.mpirun) + ["-np", str(args.np)]
+    cmd += [args.executable, "--problem_type", problem, "--order", str(order),
+            "--mesh_type", mesh, "--scaling_type", "weak",
+            "--ndofs", str(int(NDOFS[problem] * args.ndofs_scale)),
+            "--metrics_file", metrics_file]
+    return cmd + PETSC_OPTIONS[problem]
+
+
+def run_case(args, problem, order, mesh):
+    """Run a case args.repeat times (after args.warmup untimed runs) and
+    return the statistics of its phase times"""
+    timers = {}
+    iterations = set()
+    with tempfile.TemporaryDirectory() as tmp:
+        metrics_file = os.path.join(tmp, "metrics.json")
+        cmd = command(args, problem, order, mesh, metrics_file)
+        for i in range(args.warmup + args.repeat):
+            result = subprocess.run(cmd, stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                                    text=True)
+            if result.returncode != 0:
+                print(result.stdout[-2000:])
+                return {"command": cmd, "error": f"exit status {result.returncode}"}
+            if i < args.warmup:
+                continue
+            if not os.path.exists(metrics_file):
+                return {"command": cmd, "error": "no metrics file written"}
+            with open(metrics_file) as f:
+                metrics = json.load(f)
+            for name, stats in metrics["timers"].items():
+                timers.setdefault(name, []).append(stats["max"])
+            iterations.add(metrics["run"].get("krylov_iterations"))
+
+    return {"command": cmd, "runs": args.repeat,
+            "krylov_iterations": sorted(i for i in iterations if i is not None),
+            "timers": {name: statistics(t) for name, t in sorted(timers.items())}}
+
+
+def compare(results, baseline, threshold, min_time):
+    """Print the phases that changed with respect to the baseline and
+    return the number of regressions"""
+    num_regressions = 0
+    print(f"{'Case':<26}{'Phase':<48}{'Baseline (s)':>14}{'Now (s)':>12}{'Change':>9}")
+    for name, case in results.items():
+        base = baseline.get(name)
+        if base is None or "timers" not in base or "timers" not in case:
+            continue
+        if base.get("krylov_iterations") != case.get("krylov_iterations"):
+            print(f"{name:<26}Krylov iterations {base.get('krylov_iterations')} -> "
+                  f"{case.get('krylov_iterations')}")
+        for phase, now in case["timers"].items():
+            before = base["timers"].get(phase)
+            if before is None or before["mean"] < min_time:
+                continue
+            change = now["mean"] / before["mean"] - 1
+            overlap = now["mean"] - now["ci95"] <= before["mean"] + before["ci95"]
+            if change > threshold and not overlap:
+                flag = "REGRESSION"
+                num_regressions += 1
+            elif change < -threshold:
+                flag = "faster"
+            else:
+                continue
+            print(f"{name:<26}{phase:<48}{before['mean']:>14.4g}{now['mean']:>12.4g}"
+                  f"{100 * change:>8.1f}% {flag}")
+    return num_regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--executable", default="dolfinx-scaling-test",
+                        help="test program")
+    parser.add_argument("--np", type=int, default=1, help="number of MPI processes")
+    parser.add_argument("--mpirun", default="mpirun", help="MPI launcher")
+    parser.add_argument("--repeat", type=int, default=5, help="timed runs per case")
+    parser.add_argument("--warmup", type=int, default=0, help="untimed runs per case")
+    parser.add_argument("--ndofs_scale", type=float, default=1.0,
+                        help="scale factor of the degrees of freedom per process")
+    parser.add_argument("--cases", default="",
+                        help="regular expression selecting cases by name, "
+                        "e.g. 'poisson-p1' (default: all)")
+    parser.add_argument("--output", default="benchmark.json",
+                        help="results file (can be used as a later baseline)")
+    parser.add_argument("--baseline", default="", help="baseline results file")
+    parser.add_argument("--threshold", type=float, default=0.1,
+                        help="relative increase of a phase time that is a regression")
+    parser.add_argument("--min_time", type=float, default=0.01,
+                        help="ignore phases with a baseline time below this (s)")
+    args = parser.parse_args()
+    if args.repeat < 1 or args.warmup < 0 or args.np < 1:
+        parser.error("invalid number of runs or processes")
+
+    results = {}
+    for problem, order, mesh in itertools.product(PROBLEMS, ORDERS, MESHES):
+        name = case_name(problem, order, mesh)
+        if not re.search(args.cases, name):
+            continue
+        print(f"Running {name} ({args.repeat} runs)", flush=True)
+        results[name] = run_case(args, problem, order, mesh)
+        if "error" in results[name]:
+            print(f"  failed: {results[name]['error']}")
+        elif "ZZZ Solve" in results[name]["timers"]:
+            solve = results[name]["timers"]["ZZZ Solve"]
+            print(f"  ZZZ Solve: {solve['mean']:.4g} +/- {solve['ci95']:.2g} s")
+
+    with open(args.output, "w") as f:
+        json.dump({"np": args.np, "repeat": args.repeat, "ndofs_scale": args.ndofs_scale,
+                   "cases": results}, f, indent=2)
+    print(f"Results written to {args.output}")
+
+    failures = [name for name, case in results.items() if "error" in case]
+    num_regressions = 0
+    if args.baseline:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+        if (baseline.get("np"), baseline.get("ndofs_scale")) != (args.np, args.ndofs_scale):
+            print("Warning: baseline was run with a different number of processes "
+                  "or problem size")
+        num_regressions = compare(results, baseline["cases"], args.threshold, args.min_time)
+        print(f"{num_regressions} phase regression(s) beyond {100 * args.threshold:g}%")
+    if failures:
+        print("Failed cases: " + ", ".join(failures))
+    return 1 if failures or num_regressions > 0 else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -1,10 +1,16 @@
 // Copyright (C) 2021 Igor A. Baratta, Chris Richardson
 // SPDX-License-Identifier:    MIT
 
+#pragma once
+
 #include <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <dolfinx/common/IndexMap.h>
 #include <dolfinx/common/MPI.h>
 #include <dolfinx/la/Vector.h>
+#include <span>
+#include <vector>
 
 using namespace dolfinx;
 
@@ -84,4 +90,357 @@ int cg(la::Vector<U>& x, const la::Vector<U>& b, ApplyFunction&& action,
 
   return k;
 }
+
+/// Compute the inner product of the owned entries of two vectors on
+/// this process (no global reduction)
+/// @param[in] a
+/// @param[in] b
+/// @return The process-local contribution to the inner product a.b
+template <typename U>
+U inner_product_local(const la::Vector<U>& a, const la::Vector<U>& b)
+{
+  const std::int32_t local_size = a.bs() * a.index_map()->size_local();
+  return std::transform_reduce(a.array().begin(),
+                               std::next(a.array().begin(), local_size),
+                               b.array().begin(), U(0));
+}
+
+/// Solve problem A.x = b using the preconditioned Conjugate Gradient
+/// method. The inner products r.r (for the convergence test) and r.z
+/// are computed with a single global reduction.
+/// @tparam U The scalar type
+/// @tparam ApplyFunction Type of the function object "action"
+/// @tparam PrecondFunction Type of the function object "precondition"
+/// @param[in, out] x Solution vector, may be set to an initial guess
+/// @param[in] b RHS Vector
+/// @param[in] action Function that provides the action of the linear operator
+/// @param[in] precondition Function that computes z = M^{-1} r, called
+/// as `precondition(r, z)`
+/// @param[in] kmax Maximum number of iterations
+/// @param[in] rtol Relative tolerances for convergence
+/// @return The number if iterations
+/// @pre It is required that the ghost values of `x` and `b` have been
+/// updated before this function is called
+template <typename U, typename ApplyFunction, typename PrecondFunction>
+int pcg(la::Vector<U>& x, const la::Vector<U>& b, ApplyFunction&& action,
+        PrecondFunction&& precondition, int kmax = 50, double rtol = 1e-8)
+{
+  MPI_Comm comm = b.index_map()->comm();
+
+  // Create working vectors
+  la::Vector<U> r(b), y(b), z(b);
+
+  // Compute initial residual r0 = b - Ax0
+  action(x, y);
+  axpy(r, U(-1), y, b);
+
+  // Apply preconditioner z = M^{-1} r0 and create p work vector
+  precondition(r, z);
+  la::Vector<U> p(z);
+
+  // Compute r.r and r.z with a single reduction
+  auto reduce = [comm, &r, &z]()
+  {
+    std::array<U, 2> dots_local
+        = {inner_product_local(r, r), inner_product_local(r, z)};
+    std::array<U, 2> dots;
+    MPI_Allreduce(dots_local.data(), dots.data(), 2,
+                  dolfinx::MPI::mpi_type<U>(), MPI_SUM, comm);
+    return dots;
+  };
+
+  // Iterations of CG
+  auto [rnorm0, rz] = reduce();
+  const auto rtol2 = rtol * rtol;
+  int k = 0;
+  while (k < kmax)
+  {
+    ++k;
+
+    // Compute y = A p
+    action(p, y);
+
+    // Compute alpha = r.z/p.y
+    const U alpha = rz / la::inner_product(p, y);
+
+    // Update x (x <- x + alpha*p)
+    axpy(x, alpha, p, x);
+
+    // Update r (r <- r - alpha*y)
+    axpy(r, -alpha, y, r);
+
+    // Apply preconditioner and update residual norm
+    precondition(r, z);
+    const auto [rnorm, rz_new] = reduce();
+    const U beta = rz_new / rz;
+    rz = rz_new;
+
+    if (rnorm / rnorm0 < rtol2)
+      break;
+
+    // Update p (p <- beta*p + z)
+    axpy(p, beta, p, z);
+  }
+
+  return k;
+}
+
+/// Solve problem A.X = B for several right-hand sides with the Conjugate
+/// Gradient method, running one CG recurrence per right-hand side in
+/// lockstep. The vectors hold the right-hand sides interleaved (block
+/// size equal to the number of right-hand sides), so that each action
+/// computes A on all of them, and the inner products of all right-hand
+/// sides are computed with a single global reduction. A right-hand side
+/// that has converged is no longer updated.
+/// @tparam U The scalar type
+/// @tparam ApplyFunction Type of the function object "action"
+/// @param[in, out] x Solution vectors, may be set to an initial guess
+/// @param[in] b RHS vectors
+/// @param[in] action Function that provides the action of the linear
+/// operator on the interleaved vectors
+/// @param[in] kmax Maximum number of iterations
+/// @param[in] rtol Relative tolerances for convergence
+/// @return The number of iterations of the slowest right-hand side
+/// @pre It is required that the ghost values of `x` and `b` have been
+/// updated before this function is called
+template <typename U, typename ApplyFunction>
+int block_cg(la::Vector<U>& x, const la::Vector<U>& b,
+             ApplyFunction&& action, int kmax = 50, double rtol = 1e-8)
+{
+  MPI_Comm comm = b.index_map()->comm();
+  const int nv = b.bs();
+  const std::int32_t local_size = b.index_map()->size_local();
+
+  // Inner products of the owned entries of each right-hand side,
+  // summed over processes
+  auto dots = [comm, nv, local_size](const la::Vector<U>& a,
+                                     const la::Vector<U>& c)
+  {
+    std::vector<U> d(nv, 0);
+    std::span<const U> _a = a.array();
+    std::span<const U> _c = c.array();
+    for (std::int32_t i = 0; i < local_size; ++i)
+      for (int j = 0; j < nv; ++j)
+        d[j] += _a[i * nv + j] * _c[i * nv + j];
+    MPI_Allreduce(MPI_IN_PLACE, d.data(), nv, dolfinx::MPI::mpi_type<U>(),
+                  MPI_SUM, comm);
+    return d;
+  };
+
+  // Create working vectors
+  la::Vector<U> r(b), y(b);
+
+  // Compute initial residual r0 = b - Ax0
+  action(x, y);
+  axpy(r, U(-1), y, b);
+
+  // Create p work vector
+  la::Vector<U> p(r);
+
+  std::span<U> _x = x.mutable_array();
+  std::span<U> _r = r.mutable_array();
+  std::span<U> _p = p.mutable_array();
+  std::span<const U> _y = y.array();
+
+  // Iterations of CG
+  const std::vector<U> rnorm0 = dots(r, r);
+  std::vector<U> rnorm = rnorm0;
+  std::vector<U> alpha(nv), beta(nv);
+  std::vector<std::int8_t> active(nv);
+  for (int j = 0; j < nv; ++j)
+    active[j] = rnorm0[j] > 0;
+  const auto rtol2 = rtol * rtol;
+  int k = 0;
+  while (k < kmax and std::ranges::any_of(active, [](auto a) { return a; }))
+  {
+    ++k;
+
+    // Compute y = A p
+    action(p, y);
+
+    // Compute alpha = r.r/p.y
+    const std::vector<U> py = dots(p, y);
+    for (int j = 0; j < nv; ++j)
+      alpha[j] = active[j] ? rnorm[j] / py[j] : 0;
+
+    // Update x (x <- x + alpha*p) and r (r <- r - alpha*y)
+    for (std::size_t i = 0; i < _x.size(); i += nv)
+    {
+      for (int j = 0; j < nv; ++j)
+      {
+        _x[i + j] += alpha[j] * _p[i + j];
+        _r[i + j] -= alpha[j] * _y[i + j];
+      }
+    }
+
+    // Update residual norms and convergence
+    const std::vector<U> rnorm_new = dots(r, r);
+    for (int j = 0; j < nv; ++j)
+    {
+      beta[j] = active[j] ? rnorm_new[j] / rnorm[j] : 0;
+      rnorm[j] = rnorm_new[j];
+      if (rnorm[j] / rnorm0[j] < rtol2)
+        active[j] = false;
+    }
+
+    // Update p (p <- beta*p + r)
+    for (std::size_t i = 0; i < _p.size(); i += nv)
+      for (int j = 0; j < nv; ++j)
+        _p[i + j] = beta[j] * _p[i + j] + _r[i + j];
+  }
+
+  return k;
+}
+
+/// Solve problem A.x = b using the pipelined Conjugate Gradient method
+/// (P. Ghysels and W. Vanroose, Parallel Computing 40(7), 2014). The
+/// two inner products of each iteration are combined into a single
+/// non-blocking global reduction which is overlapped with the action
+/// of the operator.
+/// @tparam U The scalar type
+/// @tparam ApplyFunction Type of the function object "action"
+/// @param[in, out] x Solution vector, may be set to an initial guess
+/// @param[in] b RHS Vector
+/// @param[in] action Function that provides the action of the linear operator
+/// @param[in] kmax Maximum number of iterations
+/// @param[in] rtol Relative tolerances for convergence
+/// @return The number if iterations
+/// @pre It is required that the ghost values of `x` and `b` have been
+/// updated before this function is called
+template <typename U, typename ApplyFunction>
+int pipelined_cg(la::Vector<U>& x, const la::Vector<U>& b,
+                 ApplyFunction&& action, int kmax = 50, double rtol = 1e-8)
+{
+  MPI_Comm comm = b.index_map()->comm();
+
+  // Create working vectors
+  la::Vector<U> r(b), w(b), n(b), z(b), s(b), p(b);
+  z.set(0);
+  s.set(0);
+  p.set(0);
+
+  // Compute initial residual r0 = b - Ax0
+  action(x, n);
+  axpy(r, U(-1), n, b);
+
+  // Compute w0 = A r0
+  action(r, w);
+
+  std::span<U> _x = x.mutable_array();
+  std::span<U> _r = r.mutable_array();
+  std::span<U> _w = w.mutable_array();
+  std::span<const U> _n = n.array();
+  std::span<U> _z = z.mutable_array();
+  std::span<U> _s = s.mutable_array();
+  std::span<U> _p = p.mutable_array();
+
+  const auto rtol2 = rtol * rtol;
+  U rnorm0 = 0;
+  U gamma_old = 0;
+  U alpha = 0;
+  int k = 0;
+  while (k < kmax)
+  {
+    ++k;
+
+    // Start global reduction of gamma = r.r and delta = w.r
+    std::array<U, 2> dots_local
+        = {inner_product_local(r, r), inner_product_local(w, r)};
+    std::array<U, 2> dots;
+    MPI_Request request;
+    MPI_Iallreduce(dots_local.data(), dots.data(), 2,
+                   dolfinx::MPI::mpi_type<U>(), MPI_SUM, comm, &request);
+
+    // Compute n = A w while the reduction is in flight
+    action(w, n);
+
+    MPI_Wait(&request, MPI_STATUS_IGNORE);
+    const U gamma = dots[0];
+    const U delta = dots[1];
+
+    if (k == 1)
+      rnorm0 = gamma;
+    else if (gamma / rnorm0 < rtol2)
+    {
+      // Residual of the previous update has converged
+      --k;
+      break;
+    }
+
+    U beta = 0;
+    if (k == 1)
+      alpha = gamma / delta;
+    else
+    {
+      beta = gamma / gamma_old;
+      alpha = gamma / (delta - beta * gamma / alpha);
+    }
+    gamma_old = gamma;
+
+    // Update all recurrences in a single pass over the vectors
+    for (std::size_t i = 0; i < _x.size(); ++i)
+    {
+      _z[i] = _n[i] + beta * _z[i];
+      _s[i] = _w[i] + beta * _s[i];
+      _p[i] = _r[i] + beta * _p[i];
+      _x[i] += alpha * _p[i];
+      _r[i] -= alpha * _s[i];
+      _w[i] -= alpha * _z[i];
+    }
+  }
+
+  return k;
+}
+
+/// Solve problem A.x = b by iterative refinement. The residual
+/// r = b - Ax is computed with `action` in the precision of `U`, and the
+/// correction equation A.d = r is solved approximately by `solve`, which
+/// is typically a Krylov solver that works in a lower precision.
+/// @tparam U The scalar type
+/// @tparam ApplyFunction Type of the function object "action"
+/// @tparam SolveFunction Type of the function object "solve"
+/// @param[in, out] x Solution vector, may be set to an initial guess
+/// @param[in] b RHS Vector
+/// @param[in] action Function that provides the action of the linear operator
+/// @param[in] solve Function that computes an approximate solution d
+/// of A.d = r, called as `solve(r, d, kmax, rtol)` where `kmax` is the
+/// remaining iteration budget and `rtol` is the relative residual
+/// reduction still required. It returns the number of iterations used.
+/// @param[in] kmax Maximum number of iterations of `solve`, summed over
+/// all refinement steps
+/// @param[in] rtol Relative tolerances for convergence
+/// @return The number of iterations of `solve`, summed over all
+/// refinement steps
+/// @pre It is required that the ghost values of `x` and `b` have been
+/// updated before this function is called
+template <typename U, typename ApplyFunction, typename SolveFunction>
+int refined_solve(la::Vector<U>& x, const la::Vector<U>& b,
+                  ApplyFunction&& action, SolveFunction&& solve,
+                  int kmax = 50, double rtol = 1e-8)
+{
+  // Create working vectors
+  la::Vector<U> r(b), y(b), d(b);
+
+  const auto rtol2 = rtol * rtol;
+  U rnorm0 = 0;
+  int k = 0;
+  for (int step = 0; k < kmax; ++step)
+  {
+    // Compute residual r = b - Ax
+    action(x, y);
+    axpy(r, U(-1), y, b);
+    const auto rnorm = la::squared_norm(r);
+    if (step == 0)
+      rnorm0 = rnorm;
+    if (rnorm <= rtol2 * rnorm0)
+      break;
+
+    // Solve for correction and update x (x <- x + d)
+    d.set(0);
+    k += solve(r, d, kmax - k, rtol * std::sqrt(rnorm0 / rnorm));
+    axpy(x, U(1), d, x);
+  }
+
+  return k;
+}
 } // namespace linalg
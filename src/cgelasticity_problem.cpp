@@ -0,0 +1,278 @@
+// Copyright (C) 2017-2019 Chris N. Richardson and Garth N. Wells
+//
+// This file is part of FEniCS-miniapp (https://www.fenicsproject.org)
+//
+// SPDX-License-Identifier:    MIT
+
+#include "cgelasticity_problem.h"
+#include "Elasticity.h"
+#include "cg.h"
+#include "elasticity_operator.h"
+#include "metrics.h"
+#include "mem.h"
+#include "phase.h"
+#include "reorder.h"
+#include "topology.h"
+#include <basix/mdspan.hpp>
+#include <dolfinx/common/Scatterer.h>
+#include <dolfinx/common/Timer.h>
+#include <dolfinx/fem/DirichletBC.h>
+#include <dolfinx/fem/DofMap.h>
+#include <dolfinx/fem/Form.h>
+#include <dolfinx/fem/Function.h>
+#include <dolfinx/fem/FunctionSpace.h>
+#include <dolfinx/fem/assembler.h>
+#include <dolfinx/fem/utils.h>
+#include <dolfinx/la/Vector.h>
+#include <dolfinx/mesh/Geometry.h>
+#include <dolfinx/mesh/Mesh.h>
+#include <dolfinx/mesh/utils.h>
+#include <memory>
+#include <petscsys.h>
+#include <span>
+#include <utility>
+
+using namespace dolfinx;
+using T = PetscScalar;
+
+namespace
+{
+void pack_fn(std::span<const T> in, std::span<const std::int32_t> idx,
+             std::span<T> out)
+{
+  for (std::size_t i = 0; i < idx.size(); ++i)
+    out[i] = in[idx[i]];
+}
+
+void unpack_fn(std::span<const T> in, std::span<const std::int32_t> idx,
+               std::span<T> out, std::function<T(T, T)> op)
+{
+  for (std::size_t i = 0; i < idx.size(); ++i)
+    out[idx[i]] = op(out[idx[i]], in[i]);
+}
+} // namespace
+
+std::tuple<std::shared_ptr<la::Vector<T>>, std::shared_ptr<fem::Function<T>>,
+           std::function<int(fem::Function<T>&, const la::Vector<T>&)>>
+cgelastic::problem(std::shared_ptr<mesh::Mesh<double>> mesh, int order,
+                   std::string dof_ordering, std::string scatterer)
+{
+  Phase t0("ZZZ FunctionSpace");
+
+  auto element = basix::create_element<double>(
+      basix::element::family::P, basix::cell::type::tetrahedron, order,
+      basix::element::lagrange_variant::gll_warped,
+      basix::element::dpc_variant::unset, false);
+
+  auto dolfinx_element = std::make_shared<const fem::FiniteElement<double>>(
+      element, std::vector<std::size_t>{3});
+  auto V = std::make_shared<fem::FunctionSpace<double>>(
+      reorder::create_functionspace(mesh, dolfinx_element, dof_ordering));
+
+  t0.stop();
+
+  Phase t0a("ZZZ Create boundary conditions");
+
+  // Define boundary condition
+  auto u0 = std::make_shared<fem::Function<T>>(V);
+  u0->x()->set(0);
+
+  // Find constrained dofs
+  const std::vector<std::int32_t> bdofs = topology::locate_boundary_dofs(
+      *V,
+      [](auto x)
+      {
+        constexpr double eps = 1.0e-8;
+        std::vector<std::int8_t> marker(x.extent(1), false);
+        for (std::size_t p = 0; p < x.extent(1); ++p)
+        {
+          double x1 = x(1, p);
+          if (std::abs(x1) < eps)
+            marker[p] = true;
+        }
+        return marker;
+      });
+
+  // Bottom (x[1] = 0) surface
+  auto bc = std::make_shared<const fem::DirichletBC<T>>(u0, bdofs);
+
+  t0a.stop();
+
+  Phase t0b("ZZZ Create RHS function");
+
+  // Define coefficients
+  auto f = std::make_shared<fem::Function<T>>(V);
+  f->interpolate(
+      [](auto x) -> std::pair<std::vector<T>, std::vector<std::size_t>>
+      {
+        std::vector<T> vdata(x.extent(0) * x.extent(1));
+        namespace stdex
+            = MDSPAN_IMPL_STANDARD_NAMESPACE::MDSPAN_IMPL_PROPOSED_NAMESPACE;
+        MDSPAN_IMPL_STANDARD_NAMESPACE::mdspan<
+            T,
+            MDSPAN_IMPL_STANDARD_NAMESPACE::extents<
+                std::size_t, 3, MDSPAN_IMPL_STANDARD_NAMESPACE::dynamic_extent>>
+            v(vdata.data(), x.extent(0), x.extent(1));
+        for (std::size_t p = 0; p < x.extent(1); ++p)
+        {
+          double dx = x(0, p) - 0.5;
+          double dz = x(2, p) - 0.5;
+          double r = std::sqrt(dx * dx + dz * dz);
+          v(0, p) = -dz * r * x(1, p);
+          v(1, p) = 1.0;
+          v(2, p) = dx * r * x(1, p);
+        }
+
+        return {vdata, {v.extent(0), v.extent(1)}};
+      });
+
+  t0b.stop();
+
+  Phase t0c("ZZZ Create forms");
+
+  // Define variational forms
+  std::vector form_elasticity_L
+      = {form_Elasticity_L1, form_Elasticity_L2, form_Elasticity_L3};
+  std::vector form_elasticity_a
+      = {form_Elasticity_a1, form_Elasticity_a2, form_Elasticity_a3};
+  auto L = std::make_shared<fem::Form<T, double>>(fem::create_form<T>(
+      *form_elasticity_L.at(order - 1), {V}, {{"w0", f}}, {}, {}, {}));
+  auto a = std::make_shared<const fem::Form<T, double>>(fem::create_form<T>(
+      *form_elasticity_a.at(order - 1), {V, V}, {}, {}, {}, {}));
+  t0c.stop();
+
+  // Create la::Vector
+  la::Vector<T> b(L->function_spaces()[0]->dofmap()->index_map,
+                  L->function_spaces()[0]->dofmap()->index_map_bs());
+  b.set(0);
+  Phase t3("ZZZ Assemble vector");
+  const std::vector constants_L = fem::pack_constants(*L);
+  auto coeffs_L = fem::allocate_coefficient_storage(*L);
+  fem::pack_coefficients(*L, coeffs_L);
+  fem::assemble_vector<T>(b.mutable_array(), *L, constants_L,
+                          fem::make_coefficients_span(coeffs_L));
+  fem::apply_lifting<T, double>(b.mutable_array(), {*a}, {constants_L},
+                                {fem::make_coefficients_span(coeffs_L)},
+                                {{*bc}}, {}, 1.0);
+  b.scatter_rev(std::plus<>());
+  bc->set(b.mutable_array(), std::nullopt);
+  b.scatter_fwd();
+  t3.stop();
+
+  // Create matrix-free operator, caching geometry and dofmap data. The
+  // elasticity parameters are the ones in Elasticity.py.
+  Phase t4("ZZZ Create matrix-free operator");
+  auto op = std::make_shared<const matfree::ElasticityOperator<T>>(
+      *V, element, order, 1.0e6, 0.3);
+
+  // Cell traversal order of the operator action
+  auto boundary_cells = std::make_shared<std::vector<std::int32_t>>(
+      op->boundary_cells().begin(), op->boundary_cells().end());
+  auto interior_cells = std::make_shared<std::vector<std::int32_t>>(
+      op->interior_cells().begin(), op->interior_cells().end());
+  reorder::order_cells(*boundary_cells, *V->dofmap(), dof_ordering);
+  reorder::order_cells(*interior_cells, *V->dofmap(), dof_ordering);
+  t4.stop();
+
+  // Compute the inverse of the operator diagonal (Jacobi preconditioner)
+  Phase t5("ZZZ Create Jacobi preconditioner");
+  auto diag_inv = std::make_shared<la::Vector<T>>(
+      V->dofmap()->index_map, V->dofmap()->index_map_bs());
+  diag_inv->set(0);
+  op->diagonal(diag_inv->mutable_array());
+  diag_inv->scatter_rev(std::plus<T>());
+  {
+    // Rows of BC dofs are replaced by the identity
+    auto [dofs, range] = bc->dof_indices();
+    std::span<T> d = diag_inv->mutable_array();
+    for (std::int32_t dof : dofs)
+      d[dof] = 1;
+  }
+  diag_inv->scatter_fwd();
+  std::ranges::transform(diag_inv->array(), diag_inv->mutable_array().begin(),
+                         [](auto d) { return 1.0 / d; });
+  t5.stop();
+
+  // Create Function to hold solution
+  auto u = std::make_shared<fem::Function<T>>(V);
+
+  std::function<int(fem::Function<T>&, const la::Vector<T>&)> solver_function
+      = [V, op, boundary_cells, interior_cells, diag_inv, bc,
+         scatterer](fem::Function<T>& u, const la::Vector<T>& b)
+  {
+    auto idx_map = V->dofmap()->index_map;
+    int bs = V->dofmap()->bs();
+    common::Scatterer sct(*idx_map, bs);
+
+    std::vector<T> local_buffer(sct.local_buffer_size(), 0);
+    std::vector<T> remote_buffer(sct.remote_buffer_size(), 0);
+
+    common::Scatterer<>::type type;
+    if (scatterer == "neighbor")
+      type = common::Scatterer<>::type::neighbor;
+    if (scatterer == "p2p")
+      type = common::Scatterer<>::type::p2p;
+
+    std::vector<MPI_Request> request = sct.create_request_vector(type);
+
+    // Create function for computing the action of A on x (y = Ax)
+    auto action = [&](la::Vector<T>& x, la::Vector<T>& y)
+    {
+      // Zero y
+      y.set(0.0);
+
+      const std::int32_t local_size = bs * idx_map->size_local();
+      const std::int32_t num_ghosts = bs * idx_map->num_ghosts();
+      std::span<T> remote_data(y.mutable_array().data() + local_size,
+                               num_ghosts);
+      std::span<T> local_data(y.mutable_array().data(), local_size);
+
+      // Compute action of A on x for cells that contribute to ghost
+      // dofs, and start sending the ghost contributions
+      op->apply(x.array(), y.mutable_array(), *boundary_cells);
+      sct.scatter_rev_begin<T>(remote_data, remote_buffer, local_buffer,
+                               pack_fn, request, type);
+
+      // Compute action of A on x for interior cells while the ghost
+      // contributions are in flight
+      op->apply(x.array(), y.mutable_array(), *interior_cells);
+
+      // Accumulate ghost values
+      sct.scatter_rev_end<T>(local_buffer, local_data, unpack_fn,
+                             std::plus<T>(), request);
+
+      // Set BC dofs to zero (effectively zeroes rows of A)
+      bc->set(y.mutable_array(), std::nullopt, 0.0);
+
+      // Update ghost values
+      sct.scatter_fwd_begin<T>(local_data, local_buffer, remote_buffer, pack_fn,
+                               request, type);
+      sct.scatter_fwd_end<T>(remote_buffer, remote_data, unpack_fn, request);
+    };
+
+    // Jacobi preconditioner (z = D^{-1} r)
+    auto precondition = [&diag_inv](const la::Vector<T>& r, la::Vector<T>& z)
+    {
+      std::ranges::transform(r.array(), diag_inv->array(),
+                             z.mutable_array().begin(), std::multiplies<T>());
+    };
+
+    common::Timer tcg;
+    int num_it = linalg::pcg(*u.x(), b, action, precondition, 100, 1e-6);
+    tcg.stop();
+    tcg.flush();
+    double time = std::chrono::duration<double>(tcg.elapsed()).count();
+    const std::int64_t ndofs_global = bs * idx_map->size_global();
+    double gdofs = (num_it * static_cast<double>(ndofs_global)) / time / 1e9;
+
+    std::cout << "CG matrix-free action processed: " << gdofs << " Gdof/s\n";
+    metrics::record("gdofs_per_second", gdofs);
+
+    print_memory_per_dof(V->mesh()->comm(), "Matrix-free operator memory",
+                         op->bytes(), ndofs_global);
+
+    return num_it;
+  };
+
+  return {std::make_shared<la::Vector<T>>(std::move(b)), u, solver_function};
+}
@@ -7,6 +7,19 @@
 #include "cgpoisson_problem.h"
 #include "Poisson.h"
 #include "cg.h"
+#include "counters.h"
+#include "halo.h"
+#include "hex_poisson_operator.h"
+#include "metrics.h"
+#include "multigrid.h"
+#include "multirhs.h"
+#include "phase.h"
+#include "poisson_operator.h"
+#include "reorder.h"
+#include "threaded_assembler.h"
+#include "topology.h"
+#include <algorithm>
+#include <array>
 #include <cfloat>
 #include <cmath>
 #include <dolfinx/common/Scatterer.h>
@@ -18,10 +31,13 @@
 #include <dolfinx/fem/petsc.h>
 #include <dolfinx/fem/utils.h>
 #include <dolfinx/la/MatrixCSR.h>
+#include <dolfinx/la/petsc.h>
 #include <dolfinx/mesh/Mesh.h>
 #include <dolfinx/mesh/utils.h>
 #include <memory>
+#include <optional>
 #include <petscsys.h>
+#include <stdexcept>
 #include <utility>
 
 using namespace dolfinx;
@@ -29,92 +45,202 @@ using T = PetscScalar;
 
 namespace
 {
-void pack_fn(std::span<const T> in, std::span<const std::int32_t> idx,
-             std::span<T> out)
+/// Cell colourings used for thread-parallel evaluation of the operator
+struct Colouring
 {
-  for (std::size_t i = 0; i < idx.size(); ++i)
-    out[i] = in[idx[i]];
-}
+  std::vector<std::vector<std::int32_t>> boundary, interior;
+};
+
+/// Matrix-free operator action restricted to a list of cells, y += A x
+template <typename U>
+using CellKernel = std::function<void(std::span<const U>, std::span<U>,
+                                      std::span<const std::int32_t>)>;
 
-void unpack_fn(std::span<const T> in, std::span<const std::int32_t> idx,
-               std::span<T> out, std::function<T(T, T)> op)
+/// Matrix-free operators in double and (optionally) single precision,
+/// and the owned cells they are computed over
+struct Operators
 {
-  for (std::size_t i = 0; i < idx.size(); ++i)
-    out[idx[i]] = op(out[idx[i]], in[i]);
+  CellKernel<T> kernel;
+  CellKernel<float> kernel_f;
+  std::vector<std::int32_t> cells, boundary_cells, interior_cells;
+
+  /// Action on several interleaved vectors (the last argument is the
+  /// number of vectors), if the operator provides it
+  std::function<void(std::span<const T>, std::span<T>,
+                     std::span<const std::int32_t>, int)>
+      kernel_block;
+
+  /// Adds the cell contributions to the diagonal, if the operator
+  /// provides them
+  std::function<void(std::span<T>)> diagonal;
+};
+
+/// Create the matrix-free operators of type Op (PoissonOperator or
+/// HexPoissonOperator)
+template <template <std::floating_point> class Op>
+Operators create_operators(const fem::FunctionSpace<double>& V,
+                           const basix::FiniteElement<double>& element,
+                           int order, bool mixed)
+{
+  auto op = std::make_shared<const Op<T>>(V, element, order);
+  Operators ops;
+  ops.kernel = [op](std::span<const T> x, std::span<T> y,
+                    std::span<const std::int32_t> cells)
+  { op->apply(x, y, cells); };
+  ops.cells.assign(op->cells().begin(), op->cells().end());
+  ops.boundary_cells.assign(op->boundary_cells().begin(),
+                            op->boundary_cells().end());
+  ops.interior_cells.assign(op->interior_cells().begin(),
+                            op->interior_cells().end());
+  if constexpr (requires(std::span<T> d) { op->diagonal(d); })
+    ops.diagonal = [op](std::span<T> d) { op->diagonal(d); };
+  if constexpr (requires(std::span<const T> x, std::span<T> y,
+                         std::span<const std::int32_t> c) {
+                  op->apply(x, y, c, 1);
+                })
+  {
+    ops.kernel_block = [op](std::span<const T> x, std::span<T> y,
+                            std::span<const std::int32_t> cells, int n)
+    { op->apply(x, y, cells, n); };
+  }
+  if (mixed)
+  {
+    auto op_f = std::make_shared<const Op<float>>(V, element, order);
+    ops.kernel_f = [op_f](std::span<const float> x, std::span<float> y,
+                          std::span<const std::int32_t> cells)
+    { op_f->apply(x, y, cells); };
+  }
+  return ops;
 }
-} // namespace
 
-std::tuple<std::shared_ptr<la::Vector<T>>, std::shared_ptr<fem::Function<T>>,
-           std::function<int(fem::Function<T>&, const la::Vector<T>&)>>
-cgpoisson::problem(std::shared_ptr<mesh::Mesh<double>> mesh, int order,
-                   std::string scatterer)
+/// Compute y = A x with the matrix-free operator, overlapping the
+/// reverse scatter of ghost contributions with the interior cells. The
+/// cells of each colour are computed in parallel by the OpenMP threads.
+/// The ghost exchange is a halo::ScattererExchange or a
+/// halo::PersistentScatterer.
+template <typename U, typename Exchange>
+void apply_operator(const CellKernel<U>& kernel,
+                    const Colouring& colouring,
+                    std::span<const std::int32_t> bc_dofs, Exchange& ex,
+                    const la::Vector<U>& x, la::Vector<U>& y)
 {
-  common::Timer t0("ZZZ FunctionSpace");
-
-  auto element = basix::create_element<double>(
-      basix::element::family::P, basix::cell::type::tetrahedron, order,
-      basix::element::lagrange_variant::gll_warped,
-      basix::element::dpc_variant::unset, false);
-
-  auto dolfinx_element
-      = std::make_shared<const fem::FiniteElement<double>>(element);
-
-  auto V = std::make_shared<fem::FunctionSpace<double>>(
-      fem::create_functionspace(mesh, dolfinx_element));
+  // Zero y
+  y.set(0.0);
+
+  const std::int32_t local_size = y.bs() * y.index_map()->size_local();
+  const std::int32_t num_ghosts = y.bs() * y.index_map()->num_ghosts();
+  std::span<U> remote_data(y.mutable_array().data() + local_size, num_ghosts);
+  std::span<U> local_data(y.mutable_array().data(), local_size);
+
+  auto apply = [&kernel, &x, &y](std::span<const std::int32_t> cells)
+  { kernel(x.array(), y.mutable_array(), cells); };
+
+  // Compute action of A on x for cells that contribute to ghost dofs,
+  // and start sending the ghost contributions
+  threaded::for_each_colour(colouring.boundary, apply);
+  ex.scatter_rev_begin(remote_data);
+
+  // Compute action of A on x for interior cells while the ghost
+  // contributions are in flight
+  threaded::for_each_colour(colouring.interior, apply);
+
+  // Accumulate ghost values
+  ex.scatter_rev_end(local_data);
+
+  // Set BC dofs to zero (effectively zeroes rows of A). Ghost
+  // contributions to BC dofs received above are also discarded.
+  std::span<U> _y = y.mutable_array();
+  for (std::int32_t dof : bc_dofs)
+    _y[dof] = 0;
+
+  // Update ghost values
+  ex.scatter_fwd_begin(local_data);
+  ex.scatter_fwd_end(remote_data);
+}
 
-  t0.stop();
-  t0.flush();
+/// Create the action y = A x of an operator for a multigrid level or a
+/// polynomial preconditioner. The ghost contributions are accumulated
+/// after all cells are computed (without overlap), and ghost values of
+/// y are updated.
+multigrid::VCycle<T>::Action
+level_action(std::shared_ptr<const Operators> ops,
+             std::shared_ptr<const Colouring> colouring,
+             std::vector<std::int32_t> bc_dofs)
+{
+  return [ops, colouring, bc_dofs](la::Vector<T>& x, la::Vector<T>& y)
+  {
+    y.set(0);
+    auto apply = [&ops, &x, &y](std::span<const std::int32_t> cells)
+    { ops->kernel(x.array(), y.mutable_array(), cells); };
+    threaded::for_each_colour(colouring->boundary, apply);
+    threaded::for_each_colour(colouring->interior, apply);
+    y.scatter_rev(std::plus<T>());
+    std::span<T> _y = y.mutable_array();
+    for (std::int32_t dof : bc_dofs)
+      _y[dof] = 0;
+    y.scatter_fwd();
+  };
+}
 
-  common::Timer t1("ZZZ Assemble");
+/// Compute the inverse of the diagonal of an operator, with a unit
+/// diagonal for the BC dofs
+std::shared_ptr<const la::Vector<T>>
+inverse_diagonal(const Operators& ops, const fem::FunctionSpace<double>& V,
+                 std::span<const std::int32_t> bc_dofs)
+{
+  auto diag_inv = std::make_shared<la::Vector<T>>(
+      V.dofmap()->index_map, V.dofmap()->index_map_bs());
+  diag_inv->set(0);
+  ops.diagonal(diag_inv->mutable_array());
+  diag_inv->scatter_rev(std::plus<T>());
+  std::span<T> _d = diag_inv->mutable_array();
+  for (std::int32_t dof : bc_dofs)
+    _d[dof] = 1;
+  diag_inv->scatter_fwd();
+  std::ranges::transform(diag_inv->array(), diag_inv->mutable_array().begin(),
+                         [](auto d) { return 1.0 / d; });
+  return diag_inv;
+}
+} // namespace
 
-  common::Timer t2("ZZZ Create boundary conditions");
+cgpoisson::System
+cgpoisson::create_system(std::shared_ptr<fem::FunctionSpace<double>> V,
+                         int order, int num_rhs)
+{
+  Phase t2("ZZZ Create boundary conditions");
   // Define boundary condition
   auto u0 = std::make_shared<fem::Function<T>>(V);
   u0->x()->set(0);
 
-  // Find facets with bc applied
-  const int tdim = mesh->topology()->dim();
-  const std::vector<std::int32_t> bc_facets = mesh::locate_entities(
-      *mesh, tdim - 1,
-      [](auto x)
-      {
-        constexpr double eps = 1.0e-8;
-        std::vector<std::int8_t> marker(x.extent(1), false);
-        for (std::size_t p = 0; p < x.extent(1); ++p)
-        {
-          double x0 = x(0, p);
-          if (std::abs(x0) < eps or std::abs(x0 - 1) < eps)
-            marker[p] = true;
-        }
-        return marker;
-      });
-
   // Find constrained dofs
-  const std::vector<std::int32_t> bdofs = fem::locate_dofs_topological(
-      *V->mesh()->topology_mutable(), *V->dofmap(), tdim - 1, bc_facets);
+  const std::vector<std::int32_t> bdofs
+      = topology::locate_boundary_dofs(*V, boundary);
 
-  auto bc = std::make_shared<fem::DirichletBC<T>>(u0, bdofs);
+  auto bc = std::make_shared<const fem::DirichletBC<T>>(u0, bdofs);
   t2.stop();
-  t2.flush();
 
-  // Define coefficients
-  common::Timer t3("ZZZ Create RHS function");
-  auto f = std::make_shared<fem::Function<T>>(V);
-  auto g = std::make_shared<fem::Function<T>>(V);
-  f->interpolate(
-      [](auto x) -> std::pair<std::vector<T>, std::vector<std::size_t>>
+  // Define coefficients. The source of right-hand side k is centred at
+  // multirhs::centre(k).
+  Phase t3("ZZZ Create RHS function");
+  auto source = [](std::array<double, 2> c)
+  {
+    return [c](auto x) -> std::pair<std::vector<T>, std::vector<std::size_t>>
+    {
+      std::vector<T> v(x.extent(1));
+      for (std::size_t p = 0; p < x.extent(1); ++p)
       {
-        std::vector<T> v(x.extent(1));
-        for (std::size_t p = 0; p < x.extent(1); ++p)
-        {
-          double dx = x(0, p) - 0.5;
-          double dy = x(1, p) - 0.5;
-          double dr = dx * dx + dy * dy;
-          v[p] = 10 * std::exp(-dr / 0.02);
-        }
+        double dx = x(0, p) - c[0];
+        double dy = x(1, p) - c[1];
+        double dr = dx * dx + dy * dy;
+        v[p] = 10 * std::exp(-dr / 0.02);
+      }
 
-        return {std::move(v), {v.size()}};
-      });
+      return {std::move(v), {v.size()}};
+    };
+  };
+  auto f = std::make_shared<fem::Function<T>>(V);
+  auto g = std::make_shared<fem::Function<T>>(V);
+  f->interpolate(source(multirhs::centre(0)));
   g->interpolate(
       [](auto x) -> std::pair<std::vector<T>, std::vector<std::size_t>>
       {
@@ -124,31 +250,37 @@ cgpoisson::problem(std::shared_ptr<mesh::Mesh<double>> mesh, int order,
         return {f, {f.size()}};
       });
   t3.stop();
-  t3.flush();
 
   std::vector form_poisson_L
       = {form_Poisson_L1, form_Poisson_L2, form_Poisson_L3};
-  std::vector form_poisson_a
-      = {form_Poisson_a1, form_Poisson_a2, form_Poisson_a3};
   std::vector form_poisson_M
       = {form_Poisson_M1, form_Poisson_M2, form_Poisson_M3};
+  if (V->mesh()->topology()->cell_type() == mesh::CellType::hexahedron)
+  {
+    form_poisson_L = {form_Poisson_L_hex1, form_Poisson_L_hex2,
+                      form_Poisson_L_hex3, form_Poisson_L_hex4,
+                      form_Poisson_L_hex5, form_Poisson_L_hex6};
+    form_poisson_M = {form_Poisson_M_hex1, form_Poisson_M_hex2,
+                      form_Poisson_M_hex3, form_Poisson_M_hex4,
+                      form_Poisson_M_hex5, form_Poisson_M_hex6};
+  }
+  if (order > static_cast<int>(form_poisson_L.size()))
+    throw std::runtime_error("Order not supported");
 
   // Define variational forms
   auto L = std::make_shared<fem::Form<T>>(fem::create_form<T>(
       *form_poisson_L.at(order - 1), {V}, {{"w0", f}, {"w1", g}}, {}, {}, {}));
-  // auto a = std::make_shared<fem::Form<T>>(fem::create_form<T>(
-  //     *form_poisson_a.at(order - 1), {V, V},
-  //     std::vector<std::shared_ptr<const fem::Function<T>>>{}, {}, {}));
-
   auto un = std::make_shared<fem::Function<T>>(V);
   auto M = std::make_shared<fem::Form<T>>(fem::create_form<T>(
       *form_poisson_M.at(order - 1), {V}, {{"w0", un}}, {{}}, {}, {}));
 
   // Create la::Vector
-  la::Vector<T> b(L->function_spaces()[0]->dofmap()->index_map,
-                  L->function_spaces()[0]->dofmap()->index_map_bs());
+  System system{bc, {}};
+  system.b.reserve(num_rhs);
+  la::Vector<T>& b = system.b.emplace_back(V->dofmap()->index_map,
+                                           V->dofmap()->index_map_bs());
   b.set(0);
-  common::Timer t5("ZZZ Assemble vector");
+  Phase t5("ZZZ Assemble vector");
   const std::vector constants_L = fem::pack_constants(*L);
   auto coeffs_L = fem::allocate_coefficient_storage(*L);
   fem::pack_coefficients(*L, coeffs_L);
@@ -166,75 +298,403 @@ cgpoisson::problem(std::shared_ptr<mesh::Mesh<double>> mesh, int order,
   // Set BC dofs to zero (effectively zeroes columns of A)
   bc->set(b.mutable_array(), std::nullopt, 0.0);
   b.scatter_fwd();
-
-  // Pack coefficients and constants
+  t5.stop();
 
   if (un->x()->array().size() != b.array().size())
     throw std::runtime_error("error");
+
+  // Further right-hand sides with the source moved
+  if (num_rhs > 1)
+  {
+    Phase t7("ZZZ Assemble RHS block");
+    for (int k = 1; k < num_rhs; ++k)
+    {
+      auto f_k = std::make_shared<fem::Function<T>>(V);
+      f_k->interpolate(source(multirhs::centre(k)));
+      const fem::Form<T> L_k = fem::create_form<T>(
+          *form_poisson_L.at(order - 1), {V}, {{"w0", f_k}, {"w1", g}}, {},
+          {}, {});
+      la::Vector<T>& b_k = system.b.emplace_back(b.index_map(), b.bs());
+      b_k.set(0);
+      const std::vector constants_k = fem::pack_constants(L_k);
+      auto coeffs_k = fem::allocate_coefficient_storage(L_k);
+      fem::pack_coefficients(L_k, coeffs_k);
+      fem::assemble_vector<T>(b_k.mutable_array(), L_k, constants_k,
+                              fem::make_coefficients_span(coeffs_k));
+      fem::assemble_vector(b_k.mutable_array(), *M);
+      b_k.scatter_rev(std::plus<T>());
+      bc->set(b_k.mutable_array(), std::nullopt, 0.0);
+      b_k.scatter_fwd();
+    }
+  }
+
+  return system;
+}
+
+std::tuple<std::shared_ptr<la::Vector<T>>, std::shared_ptr<fem::Function<T>>,
+           std::function<int(fem::Function<T>&, const la::Vector<T>&)>>
+cgpoisson::problem(std::shared_ptr<mesh::Mesh<double>> mesh, int order,
+                   std::string dof_ordering, std::string scatterer,
+                   std::string cg_variant, std::string precision,
+                   std::string multigrid_type,
+                   std::shared_ptr<const MeshHierarchy> hierarchy,
+                   std::string preconditioner, double rtol, int max_it,
+                   int num_rhs)
+{
+  if (multigrid_type != "none" and multigrid_type != "gmg"
+      and multigrid_type != "pmg")
+  {
+    throw std::runtime_error("Unknown multigrid type: " + multigrid_type);
+  }
+  if (multigrid_type == "gmg" and !hierarchy)
+    throw std::runtime_error("Geometric multigrid requires a mesh hierarchy");
+  if (multigrid_type == "pmg" and order < 2)
+    throw std::runtime_error("p-multigrid requires order > 1");
+  if (multigrid_type != "none"
+      and (cg_variant != "classic" or precision != "double"))
+  {
+    throw std::runtime_error(
+        "Multigrid requires the classic CG variant in double precision");
+  }
+  if (preconditioner != "none" and preconditioner != "jacobi"
+      and preconditioner != "chebyshev")
+  {
+    throw std::runtime_error("Unknown CG preconditioner: " + preconditioner);
+  }
+  if (preconditioner != "none"
+      and (multigrid_type != "none" or cg_variant != "classic"
+           or precision != "double"))
+  {
+    throw std::runtime_error("CG preconditioner requires the classic CG "
+                             "variant in double precision, without "
+                             "multigrid");
+  }
+  if (num_rhs > 1
+      and (multigrid_type != "none" or preconditioner != "none"
+           or cg_variant != "classic" or precision != "double"))
+  {
+    throw std::runtime_error("Multiple right-hand sides require the classic "
+                             "CG variant in double precision, without "
+                             "multigrid or preconditioner");
+  }
+
+  Phase t0("ZZZ FunctionSpace");
+
+  const bool hex = mesh->topology()->cell_type() == mesh::CellType::hexahedron;
+  auto element = basix::create_element<double>(
+      basix::element::family::P,
+      hex ? basix::cell::type::hexahedron : basix::cell::type::tetrahedron,
+      order,
+      basix::element::lagrange_variant::gll_warped,
+      basix::element::dpc_variant::unset, false);
+
+  auto dolfinx_element
+      = std::make_shared<const fem::FiniteElement<double>>(element);
+
+  auto V = std::make_shared<fem::FunctionSpace<double>>(
+      reorder::create_functionspace(mesh, dolfinx_element, dof_ordering));
+
+  t0.stop();
+
+  Phase t1("ZZZ Assemble");
+
+  cgpoisson::System system = cgpoisson::create_system(V, order, num_rhs);
+  std::shared_ptr<const fem::DirichletBC<T>> bc = system.bc;
+  la::Vector<T> b = system.b.front();
+
+  // Further right-hand sides with the source moved, solved together
+  // with b on the first call to the solver function
+  auto rhs = std::make_shared<std::vector<la::Vector<T>>>();
+  if (num_rhs > 1)
+    *rhs = std::move(system.b);
+
   // Create Function to hold solution
   auto u = std::make_shared<fem::Function<T>>(V);
 
-  std::function<int(fem::Function<T>&, const la::Vector<T>&)> solver_function
-      = [M, un, bc, scatterer](fem::Function<T>& u, const la::Vector<T>& b)
+  if (precision != "double" and precision != "mixed")
+    throw std::runtime_error("Unknown precision: " + precision);
+
+  // Create matrix-free operator, caching geometry and dofmap data. With
+  // mixed precision a single precision copy of the operator is used in
+  // the inner iterations, and the double precision operator only for
+  // the residual between refinement steps. Hexahedral meshes use the
+  // sum-factorised operator.
+  Phase t6("ZZZ Create matrix-free operator");
+  auto ops = std::make_shared<Operators>(
+      hex ? create_operators<matfree::HexPoissonOperator>(
+                *V, element, order, precision == "mixed")
+          : create_operators<matfree::PoissonOperator>(*V, element, order,
+                                                       precision == "mixed"));
+  t6.stop();
+
+  // Colour boundary and interior cells for threaded evaluation
+  Phase tc("ZZZ Colour cells");
+  auto dofmap = V->dofmap()->map();
+  std::span<const std::int32_t> cell_dofs(dofmap.data_handle(),
+                                          dofmap.size());
+  reorder::order_cells(ops->boundary_cells, *V->dofmap(), dof_ordering);
+  reorder::order_cells(ops->interior_cells, *V->dofmap(), dof_ordering);
+  auto colouring = std::make_shared<const Colouring>(Colouring{
+      threaded::colour_cells(ops->boundary_cells, cell_dofs,
+                             dofmap.extent(1)),
+      threaded::colour_cells(ops->interior_cells, cell_dofs,
+                             dofmap.extent(1))});
+  tc.stop();
+
+  // Multigrid V-cycle on the mesh hierarchy (gmg) or on the lower
+  // degree spaces on the same mesh (pmg). The finest level uses the
+  // operator above, and the coarse levels matrix-free operators on
+  // their own spaces. The P1 coarse level of pmg is solved by one AMG
+  // cycle on the assembled P1 matrix.
+  std::shared_ptr<multigrid::VCycle<T>> vcycle;
+  if (num_rhs > 1 and !ops->kernel_block)
   {
-    const std::vector<T> constants;
-    auto coeff = fem::allocate_coefficient_storage(*M);
+    throw std::runtime_error(
+        "Multiple right-hand sides require a tetrahedral mesh");
+  }
 
-    auto V = M->function_spaces()[0];
+  if (multigrid_type != "none")
+  {
+    Phase tmg("ZZZ Create multigrid levels");
+    if (hex)
+      throw std::runtime_error("Multigrid requires a tetrahedral mesh");
+    const bool pmg = multigrid_type == "pmg";
+    auto spaces
+        = pmg ? multigrid::create_p_spaces(V, order, {})
+              : multigrid::create_spaces(*hierarchy, dolfinx_element, V);
+    auto transfers
+        = pmg ? multigrid::create_p_transfers(spaces)
+              : multigrid::create_transfers(spaces, element, *hierarchy);
+    std::vector<multigrid::VCycle<T>::Level> levels;
+    for (std::size_t l = 0; l < spaces.size(); ++l)
+    {
+      auto Vl = spaces[l];
+      std::shared_ptr<const Operators> ops_l = ops;
+      std::shared_ptr<const Colouring> colouring_l = colouring;
+      std::vector<std::int32_t> bc_dofs_l;
+      if (l + 1 == spaces.size())
+      {
+        auto dofs = bc->dof_indices().first;
+        bc_dofs_l.assign(dofs.begin(), dofs.end());
+      }
+      else
+      {
+        const int order_l = pmg ? l + 1 : order;
+        bc_dofs_l = topology::locate_boundary_dofs(*Vl, boundary);
+        auto element_l = basix::create_element<double>(
+            basix::element::family::P, basix::cell::type::tetrahedron,
+            order_l, basix::element::lagrange_variant::gll_warped,
+            basix::element::dpc_variant::unset, false);
+        ops_l = std::make_shared<const Operators>(
+            create_operators<matfree::PoissonOperator>(*Vl, element_l, order_l,
+                                                       false));
+        auto dofmap_l = Vl->dofmap()->map();
+        std::span<const std::int32_t> cell_dofs_l(dofmap_l.data_handle(),
+                                                  dofmap_l.size());
+        colouring_l = std::make_shared<const Colouring>(Colouring{
+            threaded::colour_cells(ops_l->boundary_cells, cell_dofs_l,
+                                   dofmap_l.extent(1)),
+            threaded::colour_cells(ops_l->interior_cells, cell_dofs_l,
+                                   dofmap_l.extent(1))});
+      }
+
+      auto diag_inv = inverse_diagonal(*ops_l, *Vl, bc_dofs_l);
+      levels.push_back({level_action(ops_l, colouring_l, bc_dofs_l),
+                        diag_inv, std::move(bc_dofs_l)});
+    }
+
+    multigrid::VCycle<T>::CoarseSolve coarse_solve;
+    if (pmg)
+    {
+      auto V1 = spaces.front();
+      std::shared_ptr<la::petsc::Matrix> A1
+          = multigrid::assemble_level_operator(*form_Poisson_a1, V1,
+                                               levels.front().bc_dofs);
+
+      // Same options prefix as the PCMG coarse solver of the assembled
+      // problems, so that -mg_coarse_* options apply to both
+      auto amg = std::make_shared<la::petsc::KrylovSolver>(mesh->comm());
+      amg->set_options_prefix("mg_coarse_");
+      KSPSetType(amg->ksp(), KSPPREONLY);
+      PC pc;
+      KSPGetPC(amg->ksp(), &pc);
+#ifdef PETSC_HAVE_HYPRE
+      PCSetType(pc, PCHYPRE);
+#else
+      PCSetType(pc, PCGAMG);
+#endif
+      amg->set_from_options();
+      amg->set_operator(A1->mat());
+      coarse_solve = [A1, amg](const la::Vector<T>& b, la::Vector<T>& x)
+      {
+        la::petsc::Vector _b(la::petsc::create_vector_wrap(b), false);
+        la::petsc::Vector _x(la::petsc::create_vector_wrap(x), false);
+        amg->solve(_x.vec(), _b.vec());
+        x.scatter_fwd();
+      };
+    }
+
+    vcycle = std::make_shared<multigrid::VCycle<T>>(
+        std::move(levels), std::move(transfers), 2, std::move(coarse_solve));
+    if (dolfinx::MPI::rank(mesh->comm()) == 0)
+    {
+      std::cout << (pmg ? "p-multigrid: " : "Geometric multigrid: ")
+                << vcycle->num_levels() << " levels" << std::endl;
+    }
+  }
+
+  // Matrix-free preconditioner z = M^{-1} r from the operator diagonal
+  // D: Jacobi, or a fixed number of Jacobi-preconditioned Chebyshev
+  // iterations from z = 0. The Chebyshev interval covers the spectrum
+  // of D^{-1} A down to 1/20 of its (Lanczos) estimated largest
+  // eigenvalue.
+  std::function<void(const la::Vector<T>&, la::Vector<T>&)> precondition;
+  if (preconditioner != "none")
+  {
+    Phase tpc("ZZZ Create CG preconditioner");
+    if (!ops->diagonal)
+      throw std::runtime_error("CG preconditioner requires the operator "
+                               "diagonal");
+    std::span<const std::int32_t> dofs = bc->dof_indices().first;
+    std::vector<std::int32_t> bc_dofs(dofs.begin(), dofs.end());
+    std::shared_ptr<const la::Vector<T>> diag_inv
+        = inverse_diagonal(*ops, *V, bc_dofs);
+    if (preconditioner == "jacobi")
+    {
+      precondition = [diag_inv](const la::Vector<T>& r, la::Vector<T>& z)
+      {
+        std::ranges::transform(r.array(), diag_inv->array(),
+                               z.mutable_array().begin(),
+                               std::multiplies<T>());
+      };
+    }
+    else
+    {
+      constexpr int degree = 4;
+      auto action = level_action(ops, colouring, bc_dofs);
+      const double lmax
+          = 1.1 * multigrid::estimate_max_eigenvalue(action, *diag_inv,
+                                                     bc_dofs);
+      auto work = std::make_shared<std::array<la::Vector<T>, 3>>(
+          std::array{*diag_inv, *diag_inv, *diag_inv});
+      precondition = [action, diag_inv, lmax,
+                      work](const la::Vector<T>& r, la::Vector<T>& z)
+      {
+        auto& [w0, w1, w2] = *work;
+        z.set(0);
+        multigrid::chebyshev(z, r, action, *diag_inv, lmax / 20, lmax,
+                             degree, w0, w1, w2);
+      };
+      if (dolfinx::MPI::rank(mesh->comm()) == 0)
+      {
+        std::cout << "Chebyshev preconditioner: degree " << degree
+                  << ", interval [" << lmax / 20 << ", " << lmax << "]"
+                  << std::endl;
+      }
+    }
+  }
+
+  std::function<int(fem::Function<T>&, const la::Vector<T>&)> solver_function
+      = [V, ops, colouring, bc, scatterer, cg_variant, vcycle, precondition,
+         rtol, max_it, rhs, compared = false](fem::Function<T>& u,
+                                              const la::Vector<T>& b) mutable
+  {
     auto idx_map = V->dofmap()->index_map;
     int bs = V->dofmap()->bs();
     common::Scatterer sct(*idx_map, bs);
 
-    std::vector<T> local_buffer(sct.local_buffer_size(), 0);
-    std::vector<T> remote_buffer(sct.remote_buffer_size(), 0);
-
-    common::Scatterer<>::type type;
-    if (scatterer == "neighbor")
-      type = common::Scatterer<>::type::neighbor;
+    // With persistent requests the ghost exchange is set up once for
+    // the solve, and restarted on each operator action
+    const bool persistent = scatterer == "persistent";
+    common::Scatterer<>::type type = common::Scatterer<>::type::neighbor;
     if (scatterer == "p2p")
       type = common::Scatterer<>::type::p2p;
+    else if (scatterer != "neighbor" and !persistent)
+      throw std::runtime_error("Unknown scatterer: " + scatterer);
 
     std::vector<MPI_Request> request = sct.create_request_vector(type);
+    halo::ScattererExchange<T> ex{sct, type, request,
+                                  std::vector<T>(sct.local_buffer_size(), 0),
+                                  std::vector<T>(sct.remote_buffer_size(), 0)};
+    std::optional<halo::PersistentScatterer<T>> ex_persistent;
+    if (persistent)
+      ex_persistent.emplace(*idx_map, bs);
+
+    std::span<const std::int32_t> bc_dofs = bc->dof_indices().first;
 
     // Create function for computing the action of A on x (y = Ax)
     auto action = [&](la::Vector<T>& x, la::Vector<T>& y)
     {
-      // Zero y
-      y.set(0.0);
-
-      // Update coefficient un (just copy data from x to un)
-      std::copy(x.array().begin(), x.array().end(),
-                un->x()->mutable_array().begin());
-
-      // Compute action of A on x
-      fem::pack_coefficients(*M, coeff);
-      fem::assemble_vector(y.mutable_array(), *M, std::span<const T>(constants),
-                           fem::make_coefficients_span(coeff));
-
-      // Set BC dofs to zero (effectively zeroes rows of A)
-      bc->set(y.mutable_array(), std::nullopt, 0.0);
-
-      // Accumuate ghost values
-      // y.scatter_rev(std::plus<T>());
-
-      const std::int32_t local_size = bs * idx_map->size_local();
-      const std::int32_t num_ghosts = bs * idx_map->num_ghosts();
-      std::span<T> remote_data(y.mutable_array().data() + local_size,
-                               num_ghosts);
-      std::span<T> local_data(y.mutable_array().data(), local_size);
-      sct.scatter_rev_begin<T>(remote_data, remote_buffer, local_buffer,
-                               pack_fn, request, type);
-      sct.scatter_rev_end<T>(local_buffer, local_data, unpack_fn,
-                             std::plus<T>(), request);
-
-      // Update ghost values
-      sct.scatter_fwd_begin<T>(local_data, local_buffer, remote_buffer, pack_fn,
-                               request, type);
-      sct.scatter_fwd_end<T>(remote_buffer, remote_data, unpack_fn, request);
+      counters::Region r("Matrix-free action");
+      if (ex_persistent)
+      {
+        apply_operator<T>(ops->kernel, *colouring, bc_dofs, *ex_persistent, x,
+                          y);
+      }
+      else
+        apply_operator<T>(ops->kernel, *colouring, bc_dofs, ex, x, y);
+    };
+
+    auto krylov_solve = [&cg_variant](auto& x, const auto& b, auto&& action,
+                                      int kmax, double rtol)
+    {
+      if (cg_variant == "classic")
+        return linalg::cg(x, b, action, kmax, rtol);
+      else if (cg_variant == "pipelined")
+        return linalg::pipelined_cg(x, b, action, kmax, rtol);
+      else
+        throw std::runtime_error("Unknown CG variant: " + cg_variant);
     };
 
     common::Timer tcg;
-    int num_it = linalg::cg(*u.x(), b, action, 100, 1e-6);
+    int num_it = 0;
+    if (vcycle)
+      num_it = linalg::pcg(*u.x(), b, action, *vcycle, max_it, rtol);
+    else if (precondition)
+      num_it = linalg::pcg(*u.x(), b, action, precondition, max_it, rtol);
+    else if (!ops->kernel_f)
+      num_it = krylov_solve(*u.x(), b, action, max_it, rtol);
+    else
+    {
+      // Single precision work vectors and communication buffers for
+      // the inner solver
+      la::Vector<float> r_f(idx_map, bs), d_f(idx_map, bs);
+      halo::ScattererExchange<float> ex_f{
+          sct, type, request, std::vector<float>(sct.local_buffer_size(), 0),
+          std::vector<float>(sct.remote_buffer_size(), 0)};
+      std::optional<halo::PersistentScatterer<float>> ex_persistent_f;
+      if (persistent)
+        ex_persistent_f.emplace(*idx_map, bs);
+      auto action_f = [&](la::Vector<float>& x, la::Vector<float>& y)
+      {
+        counters::Region r("Matrix-free action (single precision)");
+        if (ex_persistent_f)
+        {
+          apply_operator<float>(ops->kernel_f, *colouring, bc_dofs,
+                                *ex_persistent_f, x, y);
+        }
+        else
+          apply_operator<float>(ops->kernel_f, *colouring, bc_dofs, ex_f, x, y);
+      };
+
+      // Solve A d = r in single precision. The residual reduction
+      // requested from each inner solve is limited to what can be
+      // reached in single precision.
+      auto solve_f = [&](const la::Vector<T>& r, la::Vector<T>& d, int kmax,
+                         double rtol)
+      {
+        std::ranges::transform(r.array(), r_f.mutable_array().begin(),
+                               [](auto v) { return static_cast<float>(v); });
+        d_f.set(0);
+        int k = krylov_solve(d_f, r_f, action_f, kmax, std::max(rtol, 1e-4));
+        std::ranges::transform(d_f.array(), d.mutable_array().begin(),
+                               [](auto v) { return static_cast<T>(v); });
+        return k;
+      };
+
+      num_it
+          = linalg::refined_solve(*u.x(), b, action, solve_f, max_it, rtol);
+    }
     tcg.stop();
     tcg.flush();
     double time = std::chrono::duration<double>(tcg.elapsed()).count();
@@ -243,6 +703,118 @@ cgpoisson::problem(std::shared_ptr<mesh::Mesh<double>> mesh, int order,
     double gdofs = (num_it * ndofs_global) / time / 1e9;
 
     std::cout << "CG matrix-free action processed: " << gdofs << " Gdof/s\n";
+    metrics::record("gdofs_per_second", gdofs);
+
+    // Relative residual of the solution, computed in double precision
+    la::Vector<T> r(b);
+    action(*u.x(), r);
+    linalg::axpy(r, T(-1), r, b);
+    const double rnorm = la::norm(r) / la::norm(b);
+    if (dolfinx::MPI::rank(V->mesh()->comm()) == 0)
+      std::cout << "CG relative residual: " << rnorm << "\n";
+    metrics::record("relative_residual", rnorm);
+
+    if (!rhs->empty() and !compared)
+    {
+      // Solve the right-hand sides together, interleaved in vectors of
+      // block size num_rhs so that one operator action sweeps the cells
+      // once for all of them, and then one at a time
+      compared = true;
+      const int nv = rhs->size();
+      la::Vector<T> B(idx_map, nv), X(idx_map, nv);
+      std::span<T> _B = B.mutable_array();
+      for (int k = 0; k < nv; ++k)
+      {
+        std::span<const T> b_k = (*rhs)[k].array();
+        for (std::size_t i = 0; i < b_k.size(); ++i)
+          _B[i * nv + k] = b_k[i];
+      }
+      X.set(0);
+
+      common::Scatterer sct_block(*idx_map, nv);
+      std::vector<MPI_Request> request_block
+          = sct_block.create_request_vector(type);
+      halo::ScattererExchange<T> ex_block{
+          sct_block, type, request_block,
+          std::vector<T>(sct_block.local_buffer_size(), 0),
+          std::vector<T>(sct_block.remote_buffer_size(), 0)};
+      std::optional<halo::PersistentScatterer<T>> ex_persistent_block;
+      if (persistent)
+        ex_persistent_block.emplace(*idx_map, nv);
+
+      std::vector<std::int32_t> bc_dofs_block;
+      for (std::int32_t dof : bc_dofs)
+        for (int k = 0; k < nv; ++k)
+          bc_dofs_block.push_back(dof * nv + k);
+      CellKernel<T> kernel_block
+          = [&ops, nv](std::span<const T> x, std::span<T> y,
+                       std::span<const std::int32_t> cells)
+      { ops->kernel_block(x, y, cells, nv); };
+      auto action_block = [&](la::Vector<T>& x, la::Vector<T>& y)
+      {
+        counters::Region r("Matrix-free action (multiple vectors)");
+        if (ex_persistent_block)
+        {
+          apply_operator<T>(kernel_block, *colouring, bc_dofs_block,
+                            *ex_persistent_block, x, y);
+        }
+        else
+        {
+          apply_operator<T>(kernel_block, *colouring, bc_dofs_block,
+                            ex_block, x, y);
+        }
+      };
+
+      MPI_Comm comm = V->mesh()->comm();
+      MPI_Barrier(comm);
+      common::Timer tblock;
+      const int block_iter = linalg::block_cg(X, B, action_block, max_it, rtol);
+      tblock.stop();
+
+      la::Vector<T> x(b);
+      int sequential_iter = 0;
+      MPI_Barrier(comm);
+      common::Timer tsequential;
+      for (const la::Vector<T>& b_k : *rhs)
+      {
+        x.set(0);
+        sequential_iter += linalg::cg(x, b_k, action, max_it, rtol);
+      }
+      tsequential.stop();
+
+      multirhs::report(
+          comm, nv, std::chrono::duration<double>(tblock.elapsed()).count(),
+          block_iter,
+          std::chrono::duration<double>(tsequential.elapsed()).count(),
+          sequential_iter);
+    }
+
+    if (ops->kernel_f)
+    {
+      // Compare throughput of the single and double precision operator
+      // (local computation only)
+      constexpr int num_apply = 10;
+      std::vector<float> x_f(b.array().begin(), b.array().end());
+      std::vector<float> y_f(x_f.size());
+      std::vector<T> y(b.array().size());
+      common::Timer top;
+      for (int i = 0; i < num_apply; ++i)
+        ops->kernel(b.array(), y, ops->cells);
+      top.stop();
+      common::Timer top_f;
+      for (int i = 0; i < num_apply; ++i)
+        ops->kernel_f(x_f, y_f, ops->cells);
+      top_f.stop();
+      const double speedup
+          = std::chrono::duration<double>(top.elapsed()).count()
+            / std::chrono::duration<double>(top_f.elapsed()).count();
+      if (dolfinx::MPI::rank(V->mesh()->comm()) == 0)
+      {
+        std::cout << "Matrix-free operator speedup (float vs double): "
+                  << speedup << "\n";
+      }
+      metrics::record("mixed_precision_speedup", speedup);
+    }
 
     return num_it;
   };
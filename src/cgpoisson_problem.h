@@ -6,20 +6,69 @@
 
 #pragma once
 
+#include "mesh.h"
+#include <cmath>
+#include <cstdint>
+#include <dolfinx/fem/DirichletBC.h>
 #include <dolfinx/fem/Function.h>
+#include <dolfinx/fem/FunctionSpace.h>
 #include <dolfinx/la/Vector.h>
 #include <dolfinx/mesh/Mesh.h>
 #include <memory>
 #include <petscsys.h>
 #include <utility>
+#include <vector>
 
 namespace cgpoisson
 {
+/// Marker of the Dirichlet boundary of the matrix-free Poisson
+/// problems, the planes x = 0 and x = 1
+inline constexpr auto boundary = [](auto x)
+{
+  constexpr double eps = 1.0e-8;
+  std::vector<std::int8_t> marker(x.extent(1), false);
+  for (std::size_t p = 0; p < x.extent(1); ++p)
+  {
+    double x0 = x(0, p);
+    if (std::abs(x0) < eps or std::abs(x0 - 1) < eps)
+      marker[p] = true;
+  }
+  return marker;
+};
+
+/// Dirichlet condition and right-hand sides of a matrix-free Poisson
+/// problem
+struct System
+{
+  /// Homogeneous Dirichlet condition on `boundary`
+  std::shared_ptr<const dolfinx::fem::DirichletBC<PetscScalar>> bc;
+
+  /// Right-hand sides, with the Dirichlet entries zeroed. Right-hand
+  /// side k has its source centred at `multirhs::centre(k)`.
+  std::vector<dolfinx::la::Vector<PetscScalar>> b;
+};
+
+/// Create the Dirichlet condition and assemble the right-hand sides of
+/// the matrix-free Poisson problems (cgpoisson and gpupoisson), in the
+/// phases `ZZZ Create boundary conditions`, `ZZZ Create RHS function`,
+/// `ZZZ Assemble vector` and, for more than one right-hand side,
+/// `ZZZ Assemble RHS block`
+/// @param[in] V Lagrange space on a tetrahedral or hexahedral mesh
+/// @param[in] order Degree of `V`
+/// @param[in] num_rhs Number of right-hand sides
+/// @return The boundary condition and the right-hand sides
+System create_system(std::shared_ptr<dolfinx::fem::FunctionSpace<double>> V,
+                     int order, int num_rhs = 1);
 
 std::tuple<std::shared_ptr<dolfinx::la::Vector<PetscScalar>>,
            std::shared_ptr<dolfinx::fem::Function<PetscScalar>>,
            std::function<int(dolfinx::fem::Function<PetscScalar>&,
                              const dolfinx::la::Vector<PetscScalar>&)>>
-  problem(std::shared_ptr<dolfinx::mesh::Mesh<double>> mesh, int order, std::string scatterer);
+problem(std::shared_ptr<dolfinx::mesh::Mesh<double>> mesh, int order,
+        std::string dof_ordering, std::string scatterer,
+        std::string cg_variant, std::string precision,
+        std::string multigrid_type,
+        std::shared_ptr<const MeshHierarchy> hierarchy,
+        std::string preconditioner, double rtol, int max_it, int num_rhs);
 
-} // namespace poisson
+} // namespace cgpoisson
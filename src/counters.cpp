@@ -0,0 +1,317 @@
+// Copyright (C) 2026 The FEniCS Project
+//
+// This file is part of FEniCS-miniapp (https://www.fenicsproject.org)
+//
+// SPDX-License-Identifier:    MIT
+
+#include "counters.h"
+#include "metrics.h"
+#include <algorithm>
+#include <array>
+#include <dolfinx/common/MPI.h>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#if defined(HAS_PAPI)
+#include <papi.h>
+#elif defined(HAS_LIKWID)
+#include <likwid-marker.h>
+#endif
+
+namespace
+{
+#if defined(HAS_PAPI)
+// Counted events: double precision operations, instructions, cycles
+// and last level cache misses. Events that the processor does not
+// provide (or that do not fit in the counters) are reported as missing.
+constexpr std::array<const char*, 4> event_names
+    = {"PAPI_DP_OPS", "PAPI_TOT_INS", "PAPI_TOT_CYC", "PAPI_L3_TCM"};
+constexpr int num_events = event_names.size();
+enum event
+{
+  flops,
+  instructions,
+  cycles,
+  cache_misses
+};
+
+// Bytes moved to or from memory per last level cache miss. This
+// ignores write-backs and hardware prefetches.
+constexpr double line_size = 64;
+
+// Wall time and event counts, at a point or accumulated over a region
+struct Sample
+{
+  double time = 0;
+  std::array<long long, num_events> values = {};
+};
+
+struct Counters
+{
+  bool running = false;
+  int event_set = PAPI_NULL;
+
+  // Position of each event in the event set, or -1 if missing
+  std::array<int, num_events> index;
+
+  // Open regions (innermost last) and their start samples
+  std::vector<std::pair<std::string, Sample>> open;
+
+  // Accumulated counts of each completed region
+  std::map<std::string, Sample> regions;
+
+  // Current wall time and counts
+  Sample read() const
+  {
+    std::array<long long, num_events> v = {};
+    PAPI_read(event_set, v.data());
+    Sample s;
+    s.time = MPI_Wtime();
+    for (int e = 0; e < num_events; ++e)
+      s.values[e] = index[e] >= 0 ? v[index[e]] : 0;
+    return s;
+  }
+
+  bool has(event e) const { return index[e] >= 0; }
+};
+
+Counters& state()
+{
+  static Counters c;
+  return c;
+}
+#elif defined(HAS_LIKWID)
+bool running = false;
+
+// LIKWID region tags may not contain white space
+std::string tag(std::string name)
+{
+  std::ranges::replace(name, ' ', '_');
+  return name;
+}
+#endif
+} // namespace
+
+const char* counters::backend()
+{
+#if defined(HAS_PAPI)
+  return "papi";
+#elif defined(HAS_LIKWID)
+  return "likwid";
+#else
+  return "none";
+#endif
+}
+
+void counters::start()
+{
+#if defined(HAS_PAPI)
+  Counters& c = state();
+  if (c.running)
+    return;
+  if (PAPI_is_initialized() == PAPI_NOT_INITED
+      and PAPI_library_init(PAPI_VER_CURRENT) != PAPI_VER_CURRENT)
+  {
+    throw std::runtime_error("PAPI initialisation failed");
+  }
+  c.event_set = PAPI_NULL;
+  if (PAPI_create_eventset(&c.event_set) != PAPI_OK)
+    throw std::runtime_error("Unable to create PAPI event set");
+  int num_added = 0;
+  for (int e = 0; e < num_events; ++e)
+  {
+    c.index[e] = PAPI_add_named_event(c.event_set, event_names[e]) == PAPI_OK
+                     ? num_added++
+                     : -1;
+  }
+  if (num_added == 0 or PAPI_start(c.event_set) != PAPI_OK)
+    throw std::runtime_error("Unable to start PAPI counters");
+  c.running = true;
+#elif defined(HAS_LIKWID)
+  if (running)
+    return;
+  LIKWID_MARKER_INIT;
+  running = true;
+#endif
+}
+
+void counters::stop()
+{
+#if defined(HAS_PAPI)
+  Counters& c = state();
+  if (!c.running)
+    return;
+  std::array<long long, num_events> v;
+  PAPI_stop(c.event_set, v.data());
+  PAPI_cleanup_eventset(c.event_set);
+  PAPI_destroy_eventset(&c.event_set);
+  c.open.clear();
+  c.running = false;
+#elif defined(HAS_LIKWID)
+  if (!running)
+    return;
+  LIKWID_MARKER_CLOSE;
+  running = false;
+#endif
+}
+
+void counters::begin_region([[maybe_unused]] const std::string& name)
+{
+#if defined(HAS_PAPI)
+  Counters& c = state();
+  if (c.running)
+    c.open.emplace_back(name, c.read());
+#elif defined(HAS_LIKWID)
+  if (running)
+    LIKWID_MARKER_START(tag(name).c_str());
+#endif
+}
+
+void counters::end_region([[maybe_unused]] const std::string& name)
+{
+#if defined(HAS_PAPI)
+  Counters& c = state();
+  if (!c.running)
+    return;
+  auto it = std::find_if(c.open.rbegin(), c.open.rend(),
+                         [&name](auto& r) { return r.first == name; });
+  if (it == c.open.rend())
+    return;
+  const Sample s1 = c.read();
+  Sample& total = c.regions[name];
+  total.time += s1.time - it->second.time;
+  for (int e = 0; e < num_events; ++e)
+    total.values[e] += s1.values[e] - it->second.values[e];
+  c.open.erase(std::next(it).base());
+#elif defined(HAS_LIKWID)
+  if (running)
+    LIKWID_MARKER_STOP(tag(name).c_str());
+#endif
+}
+
+void counters::report([[maybe_unused]] MPI_Comm comm,
+                      [[maybe_unused]] double peak_gflops,
+                      [[maybe_unused]] double bandwidth)
+{
+#if defined(HAS_PAPI)
+  Counters& c = state();
+  const int rank = dolfinx::MPI::rank(comm);
+  const int size = dolfinx::MPI::size(comm);
+
+  // Names of the regions on rank 0
+  std::string packed;
+  for (auto& [name, s] : c.regions)
+    packed += name + '\n';
+  int n = packed.size();
+  MPI_Bcast(&n, 1, MPI_INT, 0, comm);
+  packed.resize(n);
+  MPI_Bcast(packed.data(), n, MPI_CHAR, 0, comm);
+  std::vector<std::string> names;
+  std::istringstream ss(packed);
+  for (std::string name; std::getline(ss, name);)
+    names.push_back(name);
+  if (names.empty())
+    return;
+
+  // Slowest process time and event counts summed over processes
+  std::vector<double> time(names.size(), 0);
+  std::vector<double> values(names.size() * num_events, 0);
+  for (std::size_t i = 0; i < names.size(); ++i)
+  {
+    if (auto it = c.regions.find(names[i]); it != c.regions.end())
+    {
+      time[i] = it->second.time;
+      std::copy(it->second.values.begin(), it->second.values.end(),
+                values.begin() + i * num_events);
+    }
+  }
+  MPI_Allreduce(MPI_IN_PLACE, time.data(), time.size(), MPI_DOUBLE, MPI_MAX,
+                comm);
+  MPI_Allreduce(MPI_IN_PLACE, values.data(), values.size(), MPI_DOUBLE,
+                MPI_SUM, comm);
+  for (std::size_t i = 0; i < names.size(); ++i)
+  {
+    const Sample& s = c.regions[names[i]];
+    if (c.has(instructions) and c.has(cycles) and s.values[cycles] > 0)
+    {
+      metrics::record_rank("ipc " + names[i],
+                           static_cast<double>(s.values[instructions])
+                               / s.values[cycles]);
+    }
+  }
+
+  if (rank != 0)
+    return;
+
+  auto print = [](bool available, double x, int width)
+  {
+    if (available)
+      std::cout << std::setw(width) << x;
+    else
+      std::cout << std::setw(width) << "-";
+  };
+
+  std::cout << "Hardware counters (PAPI) [slowest process time, counts "
+               "summed over "
+            << size << " processes]" << std::endl;
+  for (int e = 0; e < num_events; ++e)
+  {
+    if (!c.has(static_cast<event>(e)))
+      std::cout << "  Missing event: " << event_names[e] << std::endl;
+  }
+  std::cout << "  " << std::left << std::setw(44) << "Region" << std::right
+            << std::setw(10) << "GFLOP/s" << std::setw(10) << "GB/s"
+            << std::setw(10) << "Flop/B" << std::setw(8) << "IPC"
+            << std::setw(12) << "LLC misses" << std::setw(10) << "Roofline"
+            << std::endl;
+  for (std::size_t i = 0; i < names.size(); ++i)
+  {
+    const double* v = values.data() + i * num_events;
+    const double t = time[i];
+    const double gflops = v[flops] / t / 1e9;
+    const double bytes = line_size * v[cache_misses];
+    const double gbytes = bytes / t / 1e9;
+    const double intensity = v[flops] / bytes;
+    const double ipc = v[instructions] / v[cycles];
+
+    // Attainable rate of the whole job, min(peak, AI * bandwidth)
+    const bool roofline = c.has(flops) and c.has(cache_misses) and bytes > 0
+                          and peak_gflops > 0 and bandwidth > 0;
+    const double attainable
+        = size * std::min(peak_gflops, intensity * bandwidth);
+    const double percent = 100 * gflops / attainable;
+
+    std::cout << "  " << std::left << std::setw(44) << names[i]
+              << std::right << std::setprecision(3);
+    print(c.has(flops) and t > 0, gflops, 10);
+    print(c.has(cache_misses) and t > 0, gbytes, 10);
+    print(c.has(flops) and c.has(cache_misses) and bytes > 0, intensity, 10);
+    print(c.has(instructions) and c.has(cycles) and v[cycles] > 0, ipc, 8);
+    print(c.has(cache_misses), v[cache_misses], 12);
+    print(roofline, percent, 9);
+    std::cout << (roofline ? "%" : " ") << std::defaultfloat
+              << std::setprecision(6) << std::endl;
+
+    if (c.has(flops) and t > 0)
+      metrics::record("gflops_per_second " + names[i], gflops);
+    if (c.has(cache_misses) and t > 0)
+      metrics::record("memory_gbytes_per_second " + names[i], gbytes);
+    if (c.has(flops) and c.has(cache_misses) and bytes > 0)
+      metrics::record("arithmetic_intensity " + names[i], intensity);
+    if (roofline)
+      metrics::record("roofline_percent " + names[i], percent);
+  }
+#elif defined(HAS_LIKWID)
+  if (dolfinx::MPI::rank(comm) == 0)
+  {
+    std::cout << "Hardware counters (LIKWID): regions are reported by "
+                 "likwid-perfctr -m (e.g. with the MEM_DP group)"
+              << std::endl;
+  }
+#endif
+}
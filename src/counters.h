@@ -0,0 +1,76 @@
+// Copyright (C) 2026 The FEniCS Project
+//
+// This file is part of FEniCS-miniapp (https://www.fenicsproject.org)
+//
+// SPDX-License-Identifier:    MIT
+
+#pragma once
+
+#include <mpi.h>
+#include <string>
+
+/// Hardware performance counters of the phases of the test. With PAPI
+/// (CMake option HW_COUNTERS=papi) the floating point operations,
+/// instructions, cycles and last level cache misses of each region are
+/// read on the calling thread and reported with the arithmetic
+/// intensity and the fraction of the roofline. With LIKWID
+/// (HW_COUNTERS=likwid) the regions are marked for likwid-perfctr,
+/// which measures and reports them. Otherwise the functions do nothing.
+namespace counters
+{
+/// Name of the counter library ("papi", "likwid" or "none")
+const char* backend();
+
+/// Start counting on this process. Regions opened before the start are
+/// not counted.
+void start();
+
+/// Stop counting
+void stop();
+
+/// Begin a counted region. Regions may be nested. Does nothing if
+/// counting has not been started.
+/// @param[in] name Name of the region
+void begin_region(const std::string& name);
+
+/// End a counted region. If a region runs more than once, its counts
+/// are accumulated.
+/// @param[in] name Name of the region
+void end_region(const std::string& name);
+
+/// A counted region for code that is not a Phase, e.g. an operator
+/// action inside a solve. The region begins on construction and ends
+/// on destruction.
+class Region
+{
+public:
+  /// Begin region
+  /// @param[in] name Name of the region
+  explicit Region(const std::string& name) : _name(name)
+  {
+    begin_region(_name);
+  }
+
+  Region(const Region&) = delete;
+  Region& operator=(const Region&) = delete;
+
+  /// End region
+  ~Region() { end_region(_name); }
+
+private:
+  std::string _name;
+};
+
+/// Print (on rank 0) the counts of each region summed over processes:
+/// GFLOP/s, GB/s of memory traffic (last level cache misses times the
+/// line size), arithmetic intensity, instructions per cycle and, given
+/// the machine peaks, the percentage of the roofline min(peak, AI *
+/// bandwidth). The values are also recorded in the metrics. With
+/// LIKWID only a note is printed. Collective.
+/// @param[in] comm Communicator
+/// @param[in] peak_gflops Peak floating point rate of one process
+/// (GFLOP/s), or 0 if unknown
+/// @param[in] bandwidth Memory (e.g. STREAM) bandwidth of one process
+/// (GB/s), or 0 if unknown
+void report(MPI_Comm comm, double peak_gflops, double bandwidth);
+} // namespace counters
@@ -0,0 +1,293 @@
+// Copyright (C) 2017-2019 Chris N. Richardson and Garth N. Wells
+//
+// This file is part of FEniCS-miniapp (https://www.fenicsproject.org)
+//
+// SPDX-License-Identifier:    MIT
+
+#include "csrpoisson_problem.h"
+#include "Poisson.h"
+#include "cg.h"
+#include "counters.h"
+#include "metrics.h"
+#include "phase.h"
+#include "reorder.h"
+#include "topology.h"
+#include <cfloat>
+#include <cmath>
+#include <dolfinx/common/Scatterer.h>
+#include <dolfinx/common/Timer.h>
+#include <dolfinx/fem/DirichletBC.h>
+#include <dolfinx/fem/Function.h>
+#include <dolfinx/fem/FunctionSpace.h>
+#include <dolfinx/fem/assembler.h>
+#include <dolfinx/fem/sparsitybuild.h>
+#include <dolfinx/fem/utils.h>
+#include <dolfinx/la/MatrixCSR.h>
+#include <dolfinx/la/SparsityPattern.h>
+#include <dolfinx/mesh/Mesh.h>
+#include <dolfinx/mesh/utils.h>
+#include <memory>
+#include <numeric>
+#include <petscsys.h>
+#include <utility>
+
+using namespace dolfinx;
+using T = PetscScalar;
+
+namespace
+{
+void pack_fn(std::span<const T> in, std::span<const std::int32_t> idx,
+             std::span<T> out)
+{
+  for (std::size_t i = 0; i < idx.size(); ++i)
+    out[i] = in[idx[i]];
+}
+
+void unpack_fn(std::span<const T> in, std::span<const std::int32_t> idx,
+               std::span<T> out, std::function<T(T, T)> op)
+{
+  for (std::size_t i = 0; i < idx.size(); ++i)
+    out[idx[i]] = op(out[idx[i]], in[i]);
+}
+
+/// Compute y[r] = (A x)[r] for the rows r in `rows`. The rows are
+/// handed out to the threads in fixed chunks of consecutive rows
+/// (static scheduling); there is no blocking of rows or columns to a
+/// cache size.
+void spmv(const la::MatrixCSR<T>& A, std::span<const T> x, std::span<T> y,
+          std::span<const std::int32_t> rows)
+{
+  constexpr int chunk_size = 256;
+  const auto& row_ptr = A.row_ptr();
+  const auto& cols = A.cols();
+  const auto& values = A.values();
+  const std::int64_t num_rows = rows.size();
+#pragma omp parallel for schedule(static, chunk_size)
+  for (std::int64_t i = 0; i < num_rows; ++i)
+  {
+    const std::int32_t r = rows[i];
+    T sum = 0;
+    for (auto j = row_ptr[r]; j < row_ptr[r + 1]; ++j)
+      sum += values[j] * x[cols[j]];
+    y[r] = sum;
+  }
+}
+} // namespace
+
+std::tuple<std::shared_ptr<la::Vector<T>>, std::shared_ptr<fem::Function<T>>,
+           std::function<int(fem::Function<T>&, const la::Vector<T>&)>>
+csrpoisson::problem(std::shared_ptr<mesh::Mesh<double>> mesh, int order,
+                    std::string dof_ordering, std::string scatterer,
+                    std::string cg_variant)
+{
+  Phase t0("ZZZ FunctionSpace");
+
+  auto element = basix::create_element<double>(
+      basix::element::family::P, basix::cell::type::tetrahedron, order,
+      basix::element::lagrange_variant::gll_warped,
+      basix::element::dpc_variant::unset, false);
+
+  auto dolfinx_element
+      = std::make_shared<const fem::FiniteElement<double>>(element);
+
+  auto V = std::make_shared<fem::FunctionSpace<double>>(
+      reorder::create_functionspace(mesh, dolfinx_element, dof_ordering));
+
+  t0.stop();
+
+  Phase t1("ZZZ Assemble");
+
+  Phase t2("ZZZ Create boundary conditions");
+  // Define boundary condition
+  auto u0 = std::make_shared<fem::Function<T>>(V);
+  u0->x()->set(0);
+
+  // Find constrained dofs
+  const std::vector<std::int32_t> bdofs = topology::locate_boundary_dofs(
+      *V,
+      [](auto x)
+      {
+        constexpr double eps = 1.0e-8;
+        std::vector<std::int8_t> marker(x.extent(1), false);
+        for (std::size_t p = 0; p < x.extent(1); ++p)
+        {
+          double x0 = x(0, p);
+          if (std::abs(x0) < eps or std::abs(x0 - 1) < eps)
+            marker[p] = true;
+        }
+        return marker;
+      });
+
+  auto bc = std::make_shared<fem::DirichletBC<T>>(u0, bdofs);
+  t2.stop();
+
+  // Define coefficients
+  Phase t3("ZZZ Create RHS function");
+  auto f = std::make_shared<fem::Function<T>>(V);
+  auto g = std::make_shared<fem::Function<T>>(V);
+  f->interpolate(
+      [](auto x) -> std::pair<std::vector<T>, std::vector<std::size_t>>
+      {
+        std::vector<T> v(x.extent(1));
+        for (std::size_t p = 0; p < x.extent(1); ++p)
+        {
+          double dx = x(0, p) - 0.5;
+          double dy = x(1, p) - 0.5;
+          double dr = dx * dx + dy * dy;
+          v[p] = 10 * std::exp(-dr / 0.02);
+        }
+
+        return {std::move(v), {v.size()}};
+      });
+  g->interpolate(
+      [](auto x) -> std::pair<std::vector<T>, std::vector<std::size_t>>
+      {
+        std::vector<T> f(x.extent(1));
+        for (std::size_t p = 0; p < x.extent(1); ++p)
+          f[p] = std::sin(5 * x(0, p));
+        return {f, {f.size()}};
+      });
+  t3.stop();
+
+  std::vector form_poisson_L
+      = {form_Poisson_L1, form_Poisson_L2, form_Poisson_L3};
+  std::vector form_poisson_a
+      = {form_Poisson_a1, form_Poisson_a2, form_Poisson_a3};
+
+  // Define variational forms
+  auto L = std::make_shared<fem::Form<T>>(fem::create_form<T>(
+      *form_poisson_L.at(order - 1), {V}, {{"w0", f}, {"w1", g}}, {}, {}, {}));
+  auto a = std::make_shared<fem::Form<T>>(fem::create_form<T>(
+      *form_poisson_a.at(order - 1), {V, V}, {}, {}, {}, {}));
+
+  // Create sparsity pattern and CSR matrix
+  Phase t3a("ZZZ Create sparsity pattern");
+  la::SparsityPattern sp = fem::create_sparsity_pattern(*a);
+  sp.finalize();
+  auto A = std::make_shared<la::MatrixCSR<T>>(sp);
+  t3a.stop();
+
+  Phase t4("ZZZ Assemble matrix");
+  const std::vector constants_a = fem::pack_constants(*a);
+  auto coeffs_a = fem::allocate_coefficient_storage(*a);
+  fem::pack_coefficients(*a, coeffs_a);
+  fem::assemble_matrix<T>(A->mat_add_values(), *a, constants_a,
+                          fem::make_coefficients_span(coeffs_a), {*bc});
+  A->scatter_rev();
+  fem::set_diagonal<T>(A->mat_set_values(), *V, {*bc});
+  t4.stop();
+
+  // Create la::Vector
+  la::Vector<T> b(L->function_spaces()[0]->dofmap()->index_map,
+                  L->function_spaces()[0]->dofmap()->index_map_bs());
+  b.set(0);
+  Phase t5("ZZZ Assemble vector");
+  const std::vector constants_L = fem::pack_constants(*L);
+  auto coeffs_L = fem::allocate_coefficient_storage(*L);
+  fem::pack_coefficients(*L, coeffs_L);
+  fem::assemble_vector<T>(b.mutable_array(), *L, constants_L,
+                          fem::make_coefficients_span(coeffs_L));
+  fem::apply_lifting<T, double>(b.mutable_array(), {*a}, {constants_L},
+                                {fem::make_coefficients_span(coeffs_L)},
+                                {{*bc}}, {}, 1.0);
+  b.scatter_rev(std::plus<>());
+  bc->set(b.mutable_array(), std::nullopt);
+  b.scatter_fwd();
+  t5.stop();
+
+  t1.stop();
+
+  // Create Function to hold solution
+  auto u = std::make_shared<fem::Function<T>>(V);
+  std::function<int(fem::Function<T>&, const la::Vector<T>&)> solver_function
+      = [V, A, scatterer, cg_variant](fem::Function<T>& u,
+                                      const la::Vector<T>& b)
+  {
+    auto idx_map = V->dofmap()->index_map;
+    int bs = V->dofmap()->bs();
+    common::Scatterer sct(*idx_map, bs);
+
+    std::vector<T> local_buffer(sct.local_buffer_size(), 0);
+    std::vector<T> remote_buffer(sct.remote_buffer_size(), 0);
+
+    common::Scatterer<>::type type;
+    if (scatterer == "neighbor")
+      type = common::Scatterer<>::type::neighbor;
+    if (scatterer == "p2p")
+      type = common::Scatterer<>::type::p2p;
+
+    std::vector<MPI_Request> request = sct.create_request_vector(type);
+
+    // Split owned rows into rows that are ghosted on other processes
+    // (sent by the forward scatter) and the remaining rows
+    const std::int32_t num_rows = A->num_owned_rows();
+    std::vector<std::int32_t> shared_rows(sct.local_indices().begin(),
+                                          sct.local_indices().end());
+    std::ranges::sort(shared_rows);
+    auto [unique_end, range_end] = std::ranges::unique(shared_rows);
+    shared_rows.erase(unique_end, range_end);
+    std::vector<std::int8_t> is_shared(num_rows, false);
+    for (std::int32_t r : shared_rows)
+      is_shared[r] = true;
+    std::vector<std::int32_t> interior_rows;
+    interior_rows.reserve(num_rows - shared_rows.size());
+    for (std::int32_t r = 0; r < num_rows; ++r)
+      if (!is_shared[r])
+        interior_rows.push_back(r);
+
+    // Create function for computing the action of A on x (y = Ax)
+    auto action = [&](la::Vector<T>& x, la::Vector<T>& y)
+    {
+      counters::Region r("SpMV");
+      const std::int32_t local_size = bs * idx_map->size_local();
+      const std::int32_t num_ghosts = bs * idx_map->num_ghosts();
+      std::span<T> remote_data(y.mutable_array().data() + local_size,
+                               num_ghosts);
+      std::span<T> local_data(y.mutable_array().data(), local_size);
+
+      // Compute rows needed by other processes, and start sending them
+      spmv(*A, x.array(), y.mutable_array(), shared_rows);
+      sct.scatter_fwd_begin<T>(local_data, local_buffer, remote_buffer, pack_fn,
+                               request, type);
+
+      // Compute remaining rows while ghost values are in flight
+      spmv(*A, x.array(), y.mutable_array(), interior_rows);
+
+      // Update ghost values
+      sct.scatter_fwd_end<T>(remote_buffer, remote_data, unpack_fn, request);
+    };
+
+    common::Timer tcg;
+    int num_it = 0;
+    if (cg_variant == "classic")
+      num_it = linalg::cg(*u.x(), b, action, 100, 1e-6);
+    else if (cg_variant == "pipelined")
+      num_it = linalg::pipelined_cg(*u.x(), b, action, 100, 1e-6);
+    else
+      throw std::runtime_error("Unknown CG variant: " + cg_variant);
+    tcg.stop();
+    tcg.flush();
+    double time = std::chrono::duration<double>(tcg.elapsed()).count();
+    double ndofs_global
+        = static_cast<double>(V->dofmap()->index_map->size_global());
+    double gdofs = (num_it * ndofs_global) / time / 1e9;
+
+    // Bytes moved by one SpMV: matrix values and column indices, row
+    // pointers, and one read of x and write of y per row
+    std::int64_t nnz_local = A->row_ptr()[num_rows];
+    std::int64_t nnz = 0;
+    MPI_Allreduce(&nnz_local, &nnz, 1, MPI_INT64_T, MPI_SUM, V->mesh()->comm());
+    double bytes = nnz * (sizeof(T) + sizeof(std::int32_t))
+                   + ndofs_global * (sizeof(std::int64_t) + 2 * sizeof(T));
+    double gbytes = (num_it * bytes) / time / 1e9;
+
+    std::cout << "CG CSR matrix action processed: " << gdofs << " Gdof/s, "
+              << gbytes << " GB/s\n";
+    metrics::record("gdofs_per_second", gdofs);
+    metrics::record("gbytes_per_second", gbytes);
+
+    return num_it;
+  };
+
+  return {std::make_shared<la::Vector<T>>(std::move(b)), u, solver_function};
+}
@@ -0,0 +1,273 @@
+// Copyright (C) 2026 The FEniCS Project
+//
+// This file is part of FEniCS-miniapp (https://www.fenicsproject.org)
+//
+// SPDX-License-Identifier:    MIT
+
+#pragma once
+
+#include "geometry.h"
+#include <algorithm>
+#include <array>
+#include <basix/finite-element.h>
+#include <basix/quadrature.h>
+#include <cmath>
+#include <concepts>
+#include <cstdint>
+#include <dolfinx/fem/DofMap.h>
+#include <dolfinx/fem/FunctionSpace.h>
+#include <dolfinx/mesh/Geometry.h>
+#include <dolfinx/mesh/Mesh.h>
+#include <dolfinx/mesh/Topology.h>
+#include <numeric>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace matfree
+{
+/// Matrix-free action of the linear elasticity operator
+/// (sigma(u), eps(v)), with sigma(u) = 2 mu eps(u) + lambda tr(eps(u)) I,
+/// on affine tetrahedral meshes. This is the bilinear form in
+/// Elasticity.py.
+///
+/// The inverse Jacobian and |det J| are cached per cell together with
+/// the reference basis derivatives at the quadrature points. Vectors are
+/// blocked with block size 3. Owned cells are split into boundary and
+/// interior cells in the same way as for PoissonOperator.
+/// @tparam T Scalar type of the cached data and of the kernel arithmetic
+template <std::floating_point T>
+class ElasticityOperator
+{
+public:
+  /// Create operator
+  /// @param[in] V Vector (block size 3) Lagrange function space on an
+  /// affine mesh
+  /// @param[in] element The scalar basix element used to create `V`
+  /// @param[in] order Polynomial order of `element`
+  /// @param[in] E Young's modulus
+  /// @param[in] nu Poisson ratio
+  ElasticityOperator(const dolfinx::fem::FunctionSpace<double>& V,
+                     const basix::FiniteElement<double>& element, int order,
+                     double E, double nu)
+      : _mu(E / (2.0 * (1.0 + nu))),
+        _lmbda(E * nu / ((1.0 + nu) * (1.0 - 2.0 * nu)))
+  {
+    if (V.dofmap()->bs() != 3)
+      throw std::runtime_error("Elasticity operator requires block size 3");
+
+    auto mesh = V.mesh();
+    const int tdim = mesh->topology()->dim();
+    const std::int32_t num_cells
+        = mesh->topology()->index_map(tdim)->size_local();
+
+    // Quadrature that integrates the bilinear form exactly on affine cells
+    auto [pts, wts] = basix::quadrature::make_quadrature<double>(
+        basix::quadrature::type::Default, basix::cell::type::tetrahedron,
+        basix::polyset::type::standard, std::max(2 * (order - 1), 1));
+    _nq = wts.size();
+    _weights.assign(wts.begin(), wts.end());
+
+    // Tabulate reference derivatives, stored as [3][nq][ndofs]
+    auto [table, shape] = element.tabulate(1, pts, {wts.size(), 3});
+    _ndofs = shape[2];
+    _dphi.resize(3 * _nq * _ndofs);
+    for (int a = 0; a < 3; ++a)
+      for (int q = 0; q < _nq; ++q)
+        for (int i = 0; i < _ndofs; ++i)
+          _dphi[(a * _nq + q) * _ndofs + i]
+              = table[((a + 1) * _nq + q) * _ndofs + i];
+
+    // Copy cell (block) dofs of owned cells
+    auto dofmap = V.dofmap()->map();
+    if (static_cast<int>(dofmap.extent(1)) != _ndofs)
+      throw std::runtime_error("Dofmap and element size do not match");
+    _dofs.assign(dofmap.data_handle(),
+                 dofmap.data_handle() + num_cells * _ndofs);
+
+    // Compute inverse Jacobian and scaled determinant for each cell
+    auto x_dofmap = mesh->geometry().dofmap();
+    if (x_dofmap.extent(1) != 4)
+      throw std::runtime_error("Matrix-free operator requires affine cells");
+    std::span<const double> x = mesh->geometry().x();
+    _K.resize(10 * num_cells);
+    for (std::int32_t c = 0; c < num_cells; ++c)
+    {
+      auto nodes = std::span(x_dofmap.data_handle() + 4 * c, 4);
+      auto [K, detJ] = affine_jacobian_inverse(x, nodes);
+      std::copy(K.begin(), K.end(), std::next(_K.begin(), 10 * c));
+      _K[10 * c + 9] = std::abs(detJ);
+    }
+
+    _cells.resize(num_cells);
+    std::iota(_cells.begin(), _cells.end(), 0);
+
+    // Split cells into those that touch ghost dofs and those that do not
+    const std::int32_t local_size = V.dofmap()->index_map->size_local();
+    for (std::int32_t c = 0; c < num_cells; ++c)
+    {
+      auto dofs = std::span(_dofs.data() + c * _ndofs, _ndofs);
+      if (std::ranges::any_of(dofs, [local_size](auto d)
+                              { return d >= local_size; }))
+      {
+        _boundary_cells.push_back(c);
+      }
+      else
+        _interior_cells.push_back(c);
+    }
+  }
+
+  /// Compute y += A x over all owned cells
+  /// @param[in] x Input array, including up-to-date ghost entries
+  /// @param[in,out] y Output array (contributions are added)
+  void apply(std::span<const T> x, std::span<T> y) const
+  {
+    apply(x, y, _cells);
+  }
+
+  /// Compute y += A x restricted to a list of cells
+  /// @param[in] x Input array, including up-to-date ghost entries
+  /// @param[in,out] y Output array (contributions are added)
+  /// @param[in] cells Local indices of the cells to compute
+  void apply(std::span<const T> x, std::span<T> y,
+             std::span<const std::int32_t> cells) const
+  {
+    const int nd = _ndofs;
+    const int nq = _nq;
+    const T mu = _mu;
+    const T lmbda = _lmbda;
+    std::vector<T> xe(3 * nd), ye(3 * nd);
+    for (std::int32_t c : cells)
+    {
+      const std::int32_t* dofs = _dofs.data() + c * nd;
+      for (int i = 0; i < nd; ++i)
+        for (int k = 0; k < 3; ++k)
+          xe[3 * i + k] = x[3 * dofs[i] + k];
+      std::fill(ye.begin(), ye.end(), 0);
+
+      const T* K = _K.data() + 10 * c;
+      const T detJ = K[9];
+      for (int q = 0; q < nq; ++q)
+      {
+        const T* d[3] = {_dphi.data() + (0 * nq + q) * nd,
+                         _dphi.data() + (1 * nq + q) * nd,
+                         _dphi.data() + (2 * nq + q) * nd};
+
+        // Reference gradient of each component, Gr_ka = du_k/dX_a
+        T Gr[3][3] = {};
+        for (int i = 0; i < nd; ++i)
+          for (int k = 0; k < 3; ++k)
+            for (int a = 0; a < 3; ++a)
+              Gr[k][a] += d[a][i] * xe[3 * i + k];
+
+        // Physical gradient, Gp_kj = du_k/dx_j = Gr_ka K_aj
+        T Gp[3][3];
+        for (int k = 0; k < 3; ++k)
+          for (int j = 0; j < 3; ++j)
+            Gp[k][j] = Gr[k][0] * K[j] + Gr[k][1] * K[3 + j]
+                       + Gr[k][2] * K[6 + j];
+
+        // Stress, scaled by quadrature weight and |det J|
+        const T s = _weights[q] * detJ;
+        const T tr = lmbda * (Gp[0][0] + Gp[1][1] + Gp[2][2]);
+        T sigma[3][3];
+        for (int k = 0; k < 3; ++k)
+          for (int j = 0; j < 3; ++j)
+            sigma[k][j] = s * (mu * (Gp[k][j] + Gp[j][k]) + (k == j ? tr : 0));
+
+        // Pull back to reference, S_ka = sigma_kj K_aj
+        T S[3][3];
+        for (int k = 0; k < 3; ++k)
+          for (int a = 0; a < 3; ++a)
+            S[k][a] = sigma[k][0] * K[3 * a] + sigma[k][1] * K[3 * a + 1]
+                      + sigma[k][2] * K[3 * a + 2];
+
+        for (int i = 0; i < nd; ++i)
+          for (int k = 0; k < 3; ++k)
+            ye[3 * i + k]
+                += d[0][i] * S[k][0] + d[1][i] * S[k][1] + d[2][i] * S[k][2];
+      }
+
+      for (int i = 0; i < nd; ++i)
+        for (int k = 0; k < 3; ++k)
+          y[3 * dofs[i] + k] += ye[3 * i + k];
+    }
+  }
+
+  /// Add the cell contributions to the diagonal of the operator,
+  /// computed without assembling the element matrices
+  /// @param[in,out] diag Diagonal (contributions are added)
+  void diagonal(std::span<T> diag) const
+  {
+    const int nd = _ndofs;
+    const int nq = _nq;
+    for (std::int32_t c : _cells)
+    {
+      const std::int32_t* dofs = _dofs.data() + c * nd;
+      const T* K = _K.data() + 10 * c;
+      for (int q = 0; q < nq; ++q)
+      {
+        const T s = _weights[q] * K[9];
+        for (int i = 0; i < nd; ++i)
+        {
+          // Physical gradient of basis function i
+          std::array<T, 3> g;
+          for (int j = 0; j < 3; ++j)
+          {
+            g[j] = 0;
+            for (int a = 0; a < 3; ++a)
+              g[j] += _dphi[(a * nq + q) * nd + i] * K[3 * a + j];
+          }
+          const T g2 = g[0] * g[0] + g[1] * g[1] + g[2] * g[2];
+
+          // a(phi_i e_k, phi_i e_k)
+          // = mu (|grad phi_i|^2 + (dphi_i/dx_k)^2) + lambda (dphi_i/dx_k)^2
+          for (int k = 0; k < 3; ++k)
+            diag[3 * dofs[i] + k]
+                += s * (_mu * (g2 + g[k] * g[k]) + _lmbda * g[k] * g[k]);
+        }
+      }
+    }
+  }
+
+  /// Local indices of owned cells that have at least one ghost dof
+  std::span<const std::int32_t> boundary_cells() const
+  {
+    return _boundary_cells;
+  }
+
+  /// Local indices of owned cells that have only owned dofs
+  std::span<const std::int32_t> interior_cells() const
+  {
+    return _interior_cells;
+  }
+
+  /// Bytes of cached data (geometry, dofmap and basis tables)
+  std::size_t bytes() const
+  {
+    return sizeof(T) * (_K.size() + _dphi.size() + _weights.size())
+           + sizeof(std::int32_t)
+                 * (_dofs.size() + _cells.size() + _boundary_cells.size()
+                    + _interior_cells.size());
+  }
+
+private:
+  // Lame parameters
+  T _mu, _lmbda;
+
+  // Number of (scalar) dofs per cell and number of quadrature points
+  int _ndofs, _nq;
+
+  // Reference basis derivatives [3][nq][ndofs] and quadrature weights
+  std::vector<T> _dphi, _weights;
+
+  // Inverse Jacobian (9 entries) and |det J| for each cell
+  std::vector<T> _K;
+
+  // Cell block dofs [num_cells][ndofs]
+  std::vector<std::int32_t> _dofs;
+
+  // Owned cells, and owned cells split by whether they touch ghost dofs
+  std::vector<std::int32_t> _cells, _boundary_cells, _interior_cells;
+};
+} // namespace matfree
@@ -6,8 +6,19 @@
 
 #include "elasticity_problem.h"
 #include "Elasticity.h"
+#include "matrix.h"
+#include "mem.h"
+#include "metrics.h"
+#include "multigrid.h"
+#include "multirhs.h"
+#include "phase.h"
+#include "reorder.h"
+#include "threaded_assembler.h"
+#include "topology.h"
+#include <array>
 #include <basix/mdspan.hpp>
-#include <dolfinx/common/Timer.h>
+#include <dolfinx/common/MPI.h>
+#include <dolfinx/fem/CoordinateElement.h>
 #include <dolfinx/fem/DirichletBC.h>
 #include <dolfinx/fem/DofMap.h>
 #include <dolfinx/fem/Form.h>
@@ -21,9 +32,16 @@
 #include <dolfinx/mesh/Geometry.h>
 #include <dolfinx/mesh/Mesh.h>
 #include <dolfinx/mesh/utils.h>
+#include <cmath>
+#include <functional>
+#include <iostream>
 #include <memory>
+#include <numeric>
+#include <omp.h>
 #include <petscsys.h>
+#include <petscvec.h>
 #include <span>
+#include <stdexcept>
 #include <utility>
 
 using namespace dolfinx;
@@ -32,8 +50,10 @@ using T = PetscScalar;
 namespace
 {
 // Function to compute the near nullspace for elasticity - it is made up
-// of the six rigid body modes
-MatNullSpace build_near_nullspace(const fem::FunctionSpace<double>& V)
+// of the six rigid body modes. This is the reference construction: the
+// modes are set for all cell dofs from a copy of the dof coordinates,
+// orthonormalised one vector at a time and copied into PETSc vectors.
+MatNullSpace build_near_nullspace_reference(const fem::FunctionSpace<double>& V)
 {
   // Create vectors for nullspace basis
   auto map = V.dofmap()->index_map;
@@ -92,13 +112,156 @@ MatNullSpace build_near_nullspace(const fem::FunctionSpace<double>& V)
   std::for_each(v.begin(), v.end(), [](auto v) { VecDestroy(&v); });
   return ns;
 }
+
+// Streamed construction of the six rigid body modes. The modes are
+// written directly into PETSc vectors created by VecDuplicateVecs,
+// with no intermediate copy, visiting each owned dof once with its
+// coordinates interpolated from the cell geometry. They are then
+// orthonormalised by Cholesky QR: the Gram matrix of the modes is
+// computed in one pass and one global reduction, and the modes are
+// multiplied by the inverse of its Cholesky factor in a second pass.
+MatNullSpace build_near_nullspace(const fem::FunctionSpace<double>& V)
+{
+  constexpr int num_modes = 6;
+  auto map = V.dofmap()->index_map;
+  const int bs = V.dofmap()->index_map_bs();
+  if (bs != 3)
+    throw std::runtime_error("Rigid body modes require a 3D vector space");
+  if (V.element()->needs_dof_transformations())
+    throw std::runtime_error("Element dof transformations not supported");
+  const std::int32_t num_owned = map->size_local();
+  const std::int32_t n = bs * num_owned;
+  MPI_Comm comm = V.mesh()->comm();
+
+  Vec x;
+  VecCreateMPI(comm, n, PETSC_DETERMINE, &x);
+  Vec* v;
+  VecDuplicateVecs(x, num_modes, &v);
+  VecDestroy(&x);
+  std::array<PetscScalar*, num_modes> b;
+  for (int k = 0; k < num_modes; ++k)
+    VecGetArrayWrite(v[k], &b[k]);
+
+  // Coordinate element basis at the reference points of the element
+  // dofs, [num_points][num_nodes]
+  const auto [X, Xshape] = V.element()->interpolation_points();
+  const fem::CoordinateElement<double>& cmap = V.mesh()->geometry().cmap();
+  const std::array<std::size_t, 4> phi_shape
+      = cmap.tabulate_shape(0, Xshape[0]);
+  std::vector<double> phi(std::reduce(phi_shape.begin(), phi_shape.end(), 1,
+                                      std::multiplies{}));
+  cmap.tabulate(0, X, Xshape, phi);
+  const std::size_t num_nodes = phi_shape[2];
+
+  auto dofmap = V.dofmap()->map();
+  auto x_dofmap = V.mesh()->geometry().dofmap();
+  std::span<const double> x_g = V.mesh()->geometry().x();
+  std::vector<std::int8_t> visited(num_owned, false);
+  for (std::size_t c = 0; c < dofmap.extent(0); ++c)
+  {
+    for (std::size_t i = 0; i < dofmap.extent(1); ++i)
+    {
+      const std::int32_t dof = dofmap(c, i);
+      if (dof >= num_owned or visited[dof])
+        continue;
+      visited[dof] = true;
+
+      std::array<double, 3> xd = {0, 0, 0};
+      for (std::size_t j = 0; j < num_nodes; ++j)
+      {
+        const double* xj = x_g.data() + 3 * x_dofmap(c, j);
+        for (int d = 0; d < 3; ++d)
+          xd[d] += phi[i * num_nodes + j] * xj[d];
+      }
+
+      // x0, x1, x2 translations
+      for (int k = 0; k < 3; ++k)
+        for (int d = 0; d < 3; ++d)
+          b[k][bs * dof + d] = k == d;
+
+      // Rotations
+      b[3][bs * dof + 0] = -xd[1];
+      b[3][bs * dof + 1] = xd[0];
+      b[3][bs * dof + 2] = 0;
+
+      b[4][bs * dof + 0] = xd[2];
+      b[4][bs * dof + 1] = 0;
+      b[4][bs * dof + 2] = -xd[0];
+
+      b[5][bs * dof + 0] = 0;
+      b[5][bs * dof + 1] = -xd[2];
+      b[5][bs * dof + 2] = xd[1];
+    }
+  }
+
+  // Gram matrix G = B^T B (upper triangle), summed over processes
+  std::array<double, num_modes * num_modes> G = {};
+  for (std::int32_t i = 0; i < n; ++i)
+    for (int k = 0; k < num_modes; ++k)
+      for (int l = k; l < num_modes; ++l)
+        G[num_modes * k + l] += b[k][i] * b[l][i];
+  MPI_Allreduce(MPI_IN_PLACE, G.data(), G.size(), MPI_DOUBLE, MPI_SUM, comm);
+
+  // Cholesky factor G = R^T R, R upper triangular
+  std::array<double, num_modes * num_modes> R = {};
+  for (int k = 0; k < num_modes; ++k)
+  {
+    double d = G[num_modes * k + k];
+    for (int m = 0; m < k; ++m)
+      d -= R[num_modes * m + k] * R[num_modes * m + k];
+    if (d <= 0)
+      throw std::runtime_error("Rigid body modes are linearly dependent");
+    R[num_modes * k + k] = std::sqrt(d);
+    for (int l = k + 1; l < num_modes; ++l)
+    {
+      double g = G[num_modes * k + l];
+      for (int m = 0; m < k; ++m)
+        g -= R[num_modes * m + k] * R[num_modes * m + l];
+      R[num_modes * k + l] = g / R[num_modes * k + k];
+    }
+  }
+
+  // B <- B R^{-1}, one row of B at a time
+  for (std::int32_t i = 0; i < n; ++i)
+  {
+    for (int l = 0; l < num_modes; ++l)
+    {
+      double q = b[l][i];
+      for (int m = 0; m < l; ++m)
+        q -= b[m][i] * R[num_modes * m + l];
+      b[l][i] = q / R[num_modes * l + l];
+    }
+  }
+
+  for (int k = 0; k < num_modes; ++k)
+    VecRestoreArrayWrite(v[k], &b[k]);
+  MatNullSpace ns;
+  MatNullSpaceCreate(comm, PETSC_FALSE, num_modes, v, &ns);
+  VecDestroyVecs(num_modes, &v);
+  return ns;
+}
 } // namespace
 
 std::tuple<std::shared_ptr<la::Vector<T>>, std::shared_ptr<fem::Function<T>>,
            std::function<int(fem::Function<T>&, const la::Vector<T>&)>>
-elastic::problem(std::shared_ptr<mesh::Mesh<double>> mesh, int order)
+elastic::problem(std::shared_ptr<mesh::Mesh<double>> mesh, int order,
+                 std::string dof_ordering, std::string multigrid_type,
+                 std::shared_ptr<const MeshHierarchy> hierarchy,
+                 std::string matrix_type, std::string near_nullspace,
+                 double rtol, int max_it, int num_rhs, int num_reassemble,
+                 int num_matmult)
 {
-  common::Timer t0("ZZZ FunctionSpace");
+  if (multigrid_type != "none" and multigrid_type != "gmg"
+      and multigrid_type != "pmg")
+  {
+    throw std::runtime_error("Unknown multigrid type: " + multigrid_type);
+  }
+  if (multigrid_type == "gmg" and !hierarchy)
+    throw std::runtime_error("Geometric multigrid requires a mesh hierarchy");
+  if (multigrid_type == "pmg" and order < 2)
+    throw std::runtime_error("p-multigrid requires order > 1");
+
+  Phase t0("ZZZ FunctionSpace");
 
   auto element = basix::create_element<double>(
       basix::element::family::P, basix::cell::type::tetrahedron, order,
@@ -108,12 +271,11 @@ elastic::problem(std::shared_ptr<mesh::Mesh<double>> mesh, int order)
   auto dolfinx_element = std::make_shared<const fem::FiniteElement<double>>(
       element, std::vector<std::size_t>{3});
   auto V = std::make_shared<fem::FunctionSpace<double>>(
-      fem::create_functionspace(mesh, dolfinx_element));
+      reorder::create_functionspace(mesh, dolfinx_element, dof_ordering));
 
   t0.stop();
-  t0.flush();
 
-  common::Timer t0a("ZZZ Create boundary conditions");
+  Phase t0a("ZZZ Create boundary conditions");
 
   // Define boundary condition
   auto u0 = std::make_shared<fem::Function<T>>(V);
@@ -121,64 +283,62 @@ elastic::problem(std::shared_ptr<mesh::Mesh<double>> mesh, int order)
 
   const int tdim = mesh->topology()->dim();
 
-  // Find facets with bc applied
-  const std::vector<std::int32_t> bc_facets = mesh::locate_entities(
-      *mesh, tdim - 1,
-      [](auto x)
-      {
-        constexpr double eps = 1.0e-8;
-        std::vector<std::int8_t> marker(x.extent(1), false);
-        for (std::size_t p = 0; p < x.extent(1); ++p)
-        {
-          double x1 = x(1, p);
-          if (std::abs(x1) < eps)
-            marker[p] = true;
-        }
-        return marker;
-      });
-
   // Find constrained dofs
-  const std::vector<std::int32_t> bdofs = fem::locate_dofs_topological(
-      *V->mesh()->topology_mutable(), *V->dofmap(), tdim - 1, bc_facets);
+  auto boundary = [](auto x)
+  {
+    constexpr double eps = 1.0e-8;
+    std::vector<std::int8_t> marker(x.extent(1), false);
+    for (std::size_t p = 0; p < x.extent(1); ++p)
+    {
+      double x1 = x(1, p);
+      if (std::abs(x1) < eps)
+        marker[p] = true;
+    }
+    return marker;
+  };
+  const std::vector<std::int32_t> bdofs
+      = topology::locate_boundary_dofs(*V, boundary);
 
   // Bottom (x[1] = 0) surface
   auto bc = std::make_shared<const fem::DirichletBC<T>>(u0, bdofs);
 
   t0a.stop();
-  t0a.flush();
 
-  common::Timer t0b("ZZZ Create RHS function");
+  Phase t0b("ZZZ Create RHS function");
 
-  // Define coefficients
-  auto f = std::make_shared<fem::Function<T>>(V);
-  f->interpolate(
-      [](auto x) -> std::pair<std::vector<T>, std::vector<std::size_t>>
+  // Define coefficients. The torsion of load case k is about the
+  // vertical axis through multirhs::centre(k) in the x-z plane.
+  auto load = [](std::array<double, 2> c)
+  {
+    return [c](auto x) -> std::pair<std::vector<T>, std::vector<std::size_t>>
+    {
+      std::vector<T> vdata(x.extent(0) * x.extent(1));
+      namespace stdex
+          = MDSPAN_IMPL_STANDARD_NAMESPACE::MDSPAN_IMPL_PROPOSED_NAMESPACE;
+      MDSPAN_IMPL_STANDARD_NAMESPACE::mdspan<
+          T,
+          MDSPAN_IMPL_STANDARD_NAMESPACE::extents<
+              std::size_t, 3, MDSPAN_IMPL_STANDARD_NAMESPACE::dynamic_extent>>
+          v(vdata.data(), x.extent(0), x.extent(1));
+      for (std::size_t p = 0; p < x.extent(1); ++p)
       {
-        std::vector<T> vdata(x.extent(0) * x.extent(1));
-        namespace stdex
-            = MDSPAN_IMPL_STANDARD_NAMESPACE::MDSPAN_IMPL_PROPOSED_NAMESPACE;
-        MDSPAN_IMPL_STANDARD_NAMESPACE::mdspan<
-            T,
-            MDSPAN_IMPL_STANDARD_NAMESPACE::extents<
-                std::size_t, 3, MDSPAN_IMPL_STANDARD_NAMESPACE::dynamic_extent>>
-            v(vdata.data(), x.extent(0), x.extent(1));
-        for (std::size_t p = 0; p < x.extent(1); ++p)
-        {
-          double dx = x(0, p) - 0.5;
-          double dz = x(2, p) - 0.5;
-          double r = std::sqrt(dx * dx + dz * dz);
-          v(0, p) = -dz * r * x(1, p);
-          v(1, p) = 1.0;
-          v(2, p) = dx * r * x(1, p);
-        }
-
-        return {vdata, {v.extent(0), v.extent(1)}};
-      });
+        double dx = x(0, p) - c[0];
+        double dz = x(2, p) - c[1];
+        double r = std::sqrt(dx * dx + dz * dz);
+        v(0, p) = -dz * r * x(1, p);
+        v(1, p) = 1.0;
+        v(2, p) = dx * r * x(1, p);
+      }
+
+      return {vdata, {v.extent(0), v.extent(1)}};
+    };
+  };
+  auto f = std::make_shared<fem::Function<T>>(V);
+  f->interpolate(load(multirhs::centre(0)));
 
   t0b.stop();
-  t0b.flush();
 
-  common::Timer t0c("ZZZ Create forms");
+  Phase t0c("ZZZ Create forms");
 
   // Define variational forms
   std::vector form_elasticity_L
@@ -190,73 +350,288 @@ elastic::problem(std::shared_ptr<mesh::Mesh<double>> mesh, int order)
   auto a = std::make_shared<const fem::Form<T, double>>(fem::create_form<T>(
       *form_elasticity_a.at(order - 1), {V, V}, {}, {}, {}, {}));
   t0c.stop();
-  t0c.flush();
 
-  // Create matrices and vector, and assemble system
+  // Create matrices and vector, and assemble system. The coarse
+  // multigrid operators below are AIJ whatever the fine matrix type.
+  Phase tp("ZZZ Create sparsity pattern");
   std::shared_ptr<la::petsc::Matrix> A = std::make_shared<la::petsc::Matrix>(
-      fem::petsc::create_matrix(*a), false);
-
-  common::Timer t2("ZZZ Assemble matrix");
+      matrix::create_matrix(*a, matrix_type), false);
+  tp.stop();
+
+  // Colour cells for thread-parallel assembly
+  Phase tc("ZZZ Colour cells");
+  std::vector<std::int32_t> cells(
+      mesh->topology()->index_map(tdim)->size_local());
+  std::iota(cells.begin(), cells.end(), 0);
+  reorder::order_cells(cells, *V->dofmap(), dof_ordering);
+  auto dofmap = V->dofmap()->map();
+  const std::vector<std::vector<std::int32_t>> colours
+      = threaded::colour_cells(
+          cells, std::span(dofmap.data_handle(), dofmap.size()),
+          dofmap.extent(1));
+  tc.stop();
+
+  const bool use_threads = omp_get_max_threads() > 1;
+  std::vector<double> thread_times;
+
+  // Add the cell matrices to A and finalise it. With --reassemble this
+  // is repeated into the same storage.
+  Phase t2("ZZZ Assemble matrix");
   const std::vector constants_a = fem::pack_constants(*a);
   auto coeffs_a = fem::allocate_coefficient_storage(*a);
   fem::pack_coefficients(*a, coeffs_a);
-  fem::assemble_matrix(la::petsc::Matrix::set_block_fn(A->mat(), ADD_VALUES),
-                       *a, std::span(constants_a),
-                       fem::make_coefficients_span(coeffs_a), {*bc});
-  MatAssemblyBegin(A->mat(), MAT_FLUSH_ASSEMBLY);
-  MatAssemblyEnd(A->mat(), MAT_FLUSH_ASSEMBLY);
-  fem::set_diagonal<T>(la::petsc::Matrix::set_fn(A->mat(), INSERT_VALUES), *V,
-                       {*bc});
-  MatAssemblyBegin(A->mat(), MAT_FINAL_ASSEMBLY);
-  MatAssemblyEnd(A->mat(), MAT_FINAL_ASSEMBLY);
+  auto assemble_matrix = [&]()
+  {
+    threaded::MatrixTimes times;
+    if (use_threads)
+    {
+      times = threaded::assemble_matrix<T>(
+          la::petsc::Matrix::set_block_fn(A->mat(), ADD_VALUES), *a,
+          std::span(constants_a), fem::make_coefficients_span(coeffs_a),
+          {*bc}, colours);
+    }
+    else
+    {
+      fem::assemble_matrix(
+          la::petsc::Matrix::set_block_fn(A->mat(), ADD_VALUES), *a,
+          std::span(constants_a), fem::make_coefficients_span(coeffs_a),
+          {*bc});
+    }
+    MatAssemblyBegin(A->mat(), MAT_FLUSH_ASSEMBLY);
+    MatAssemblyEnd(A->mat(), MAT_FLUSH_ASSEMBLY);
+    fem::set_diagonal<T>(la::petsc::Matrix::set_fn(A->mat(), INSERT_VALUES),
+                         *V, {*bc});
+    MatAssemblyBegin(A->mat(), MAT_FINAL_ASSEMBLY);
+    MatAssemblyEnd(A->mat(), MAT_FINAL_ASSEMBLY);
+    return times;
+  };
+  const threaded::MatrixTimes matrix_times = assemble_matrix();
   t2.stop();
-  t2.flush();
+  if (use_threads)
+  {
+    threaded::print_matrix_times(mesh->comm(), "ZZZ Assemble matrix",
+                                 matrix_times);
+  }
+  if (num_matmult > 0)
+    matrix::time_matmult(A->mat(), num_matmult);
+
+  // Multigrid: operators rediscretised on the coarse levels, which
+  // are the coarse meshes of the hierarchy (gmg) or the lower degree
+  // spaces on the same mesh (pmg)
+  const bool pmg = multigrid_type == "pmg";
+  std::vector<std::shared_ptr<la::petsc::Matrix>> mg_operators;
+  std::vector<std::shared_ptr<const multigrid::Transfer>> mg_transfers;
+  std::vector<std::shared_ptr<fem::FunctionSpace<double>>> mg_spaces;
+  if (multigrid_type != "none")
+  {
+    Phase tmg("ZZZ Create multigrid levels");
+    if (pmg)
+    {
+      mg_spaces = multigrid::create_p_spaces(V, order, {3});
+      mg_transfers = multigrid::create_p_transfers(mg_spaces);
+    }
+    else
+    {
+      mg_spaces = multigrid::create_spaces(*hierarchy, dolfinx_element, V);
+      mg_transfers
+          = multigrid::create_transfers(mg_spaces, element, *hierarchy);
+    }
+    for (std::size_t l = 0; l + 1 < mg_spaces.size(); ++l)
+    {
+      auto Vl = mg_spaces[l];
+      const int order_l = pmg ? l + 1 : order;
+      mg_operators.push_back(multigrid::assemble_level_operator(
+          *form_elasticity_a.at(order_l - 1), Vl,
+          topology::locate_boundary_dofs(*Vl, boundary)));
+    }
+    mg_operators.push_back(A);
+  }
 
   // Wrap la::Vector with Petsc Vec
   la::Vector<T> b(L->function_spaces()[0]->dofmap()->index_map,
                   L->function_spaces()[0]->dofmap()->index_map_bs());
   b.set(0);
-  common::Timer t3("ZZZ Assemble vector");
+  Phase t3("ZZZ Assemble vector");
   const std::vector constants_L = fem::pack_constants(*L);
   auto coeffs_L = fem::allocate_coefficient_storage(*L);
   fem::pack_coefficients(*L, coeffs_L);
-  fem::assemble_vector<T>(b.mutable_array(), *L, constants_L,
-                          fem::make_coefficients_span(coeffs_L));
-  fem::apply_lifting<T, double>(b.mutable_array(), {*a}, {constants_L},
-                                {fem::make_coefficients_span(coeffs_L)},
-                                {{*bc}}, {}, 1.0);
-  b.scatter_rev(std::plus<>());
-  bc->set(b.mutable_array(), std::nullopt);
+  auto assemble_vector = [&]()
+  {
+    std::vector<double> times;
+    b.set(0);
+    if (use_threads)
+    {
+      times = threaded::assemble_vector<T>(
+          b.mutable_array(), *L, constants_L,
+          fem::make_coefficients_span(coeffs_L), colours);
+    }
+    else
+    {
+      fem::assemble_vector<T>(b.mutable_array(), *L, constants_L,
+                              fem::make_coefficients_span(coeffs_L));
+    }
+    fem::apply_lifting<T, double>(b.mutable_array(), {*a}, {constants_L},
+                                  {fem::make_coefficients_span(coeffs_L)},
+                                  {{*bc}}, {}, 1.0);
+    b.scatter_rev(std::plus<>());
+    bc->set(b.mutable_array(), std::nullopt);
+    return times;
+  };
+  thread_times = assemble_vector();
   t3.stop();
-  t3.flush();
+  if (use_threads)
+  {
+    threaded::print_thread_balance(mesh->comm(), "ZZZ Assemble vector",
+                                   thread_times);
+  }
+
+  if (num_reassemble > 0)
+  {
+    const std::int64_t num_cells
+        = mesh->topology()->index_map(tdim)->size_global();
+    const std::int64_t cell_dofs
+        = V->dofmap()->map().extent(1) * V->dofmap()->bs();
+    matrix::time_reassembly(
+        A->mat(), [&]() { assemble_matrix(); }, [&]() { assemble_vector(); },
+        num_cells, cell_dofs * cell_dofs, tp.elapsed().count(),
+        t2.elapsed().count(), num_reassemble);
+  }
+
+  // Further load cases, solved together with b on the first call to
+  // the solver function
+  auto rhs = std::make_shared<std::vector<la::Vector<T>>>();
+  if (num_rhs > 1)
+  {
+    Phase t5("ZZZ Assemble RHS block");
+    rhs->push_back(b);
+    for (int k = 1; k < num_rhs; ++k)
+    {
+      auto f_k = std::make_shared<fem::Function<T>>(V);
+      f_k->interpolate(load(multirhs::centre(k)));
+      const fem::Form<T, double> L_k = fem::create_form<T>(
+          *form_elasticity_L.at(order - 1), {V}, {{"w0", f_k}}, {}, {}, {});
+      la::Vector<T>& b_k = rhs->emplace_back(b.index_map(), b.bs());
+      b_k.set(0);
+      const std::vector constants_k = fem::pack_constants(L_k);
+      auto coeffs_k = fem::allocate_coefficient_storage(L_k);
+      fem::pack_coefficients(L_k, coeffs_k);
+      fem::assemble_vector<T>(b_k.mutable_array(), L_k, constants_k,
+                              fem::make_coefficients_span(coeffs_k));
+      fem::apply_lifting<T, double>(b_k.mutable_array(), {*a}, {constants_k},
+                                    {fem::make_coefficients_span(coeffs_k)},
+                                    {{*bc}}, {}, 1.0);
+      b_k.scatter_rev(std::plus<>());
+      bc->set(b_k.mutable_array(), std::nullopt);
+    }
+  }
 
-  common::Timer t4("ZZZ Create near-nullspace");
+  if (near_nullspace != "streamed" and near_nullspace != "reference")
+    throw std::runtime_error("Unknown near-nullspace construction: "
+                             + near_nullspace);
+  auto create_near_nullspace = [&near_nullspace](const auto& V)
+  {
+    return near_nullspace == "streamed" ? build_near_nullspace(V)
+                                        : build_near_nullspace_reference(V);
+  };
 
   // Create Function to hold solution
   auto u = std::make_shared<fem::Function<T>>(V);
 
+  MPI_Barrier(mesh->comm());
+  Phase t4("ZZZ Create near-nullspace");
+
   // Build near-nullspace and attach to matrix
-  MatNullSpace ns = build_near_nullspace(*V);
+  MatNullSpace ns = create_near_nullspace(*V);
   MatSetNearNullSpace(A->mat(), ns);
   MatNullSpaceDestroy(&ns);
 
+  // The P1 coarse level of p-multigrid is solved by smoothed
+  // aggregation, which needs the rigid body modes of the coarse space
+  if (pmg)
+  {
+    MatNullSpace ns_c = create_near_nullspace(*mg_spaces.front());
+    MatSetNearNullSpace(mg_operators.front()->mat(), ns_c);
+    MatNullSpaceDestroy(&ns_c);
+  }
+
   t4.stop();
-  t4.flush();
+
+  // Construction time and the measured growth of the resident set
+  // size in the construction phase (with --memory_profiling), summed
+  // over processes. Runs with each construction give the saving.
+  {
+    double time = t4.elapsed().count();
+    MPI_Allreduce(MPI_IN_PLACE, &time, 1, MPI_DOUBLE, MPI_MAX, mesh->comm());
+    double bytes = memory_phase_growth("ZZZ Create near-nullspace");
+    MPI_Allreduce(MPI_IN_PLACE, &bytes, 1, MPI_DOUBLE, MPI_SUM,
+                  mesh->comm());
+    if (dolfinx::MPI::rank(mesh->comm()) == 0)
+    {
+      std::cout << "Near-nullspace (" << near_nullspace << "): " << time
+                << " s";
+      if (bytes > 0)
+        std::cout << ", peak memory growth " << bytes / 1e6 << " MB";
+      std::cout << std::endl;
+      metrics::record("near_nullspace", near_nullspace);
+      metrics::record("near_nullspace_time", time);
+      if (bytes > 0)
+        metrics::record("near_nullspace_peak_bytes", bytes);
+    }
+  }
+
+  // Create solver. It is kept alive across calls to the solver
+  // function, and the preconditioner is set up on the first call only.
+  // PETSc options are applied after the multigrid setup and the
+  // tolerances, so that they can override them.
+  auto solver = std::make_shared<la::petsc::KrylovSolver>(mesh->comm());
+  if (multigrid_type != "none")
+  {
+    std::vector<Mat> mats;
+    for (auto& A_l : mg_operators)
+      mats.push_back(A_l->mat());
+    multigrid::set_pcmg(solver->ksp(), mats, mg_transfers,
+                        pmg ? PCGAMG : "");
+  }
+  KSPSetTolerances(solver->ksp(), rtol, PETSC_DEFAULT, PETSC_DEFAULT,
+                   max_it);
+  solver->set_from_options();
+  solver->set_operator(A->mat());
 
   std::function<int(fem::Function<T>&, const la::Vector<T>&)> solver_function
-      = [A](fem::Function<T>& u, const la::Vector<T>& b)
+      = [A, solver, rhs, setup = false](fem::Function<T>& u,
+                                        const la::Vector<T>& b) mutable
   {
-    // Create solver
-    la::petsc::KrylovSolver solver(MPI_COMM_WORLD);
-    solver.set_from_options();
-    solver.set_operator(A->mat());
+    const bool first_call = !setup;
+    if (!setup)
+    {
+      Phase t("ZZZ PC setup");
+      KSPSetUp(solver->ksp());
+      PC pc;
+      KSPGetPC(solver->ksp(), &pc);
+      PCSetUp(pc);
+      KSPSetReusePreconditioner(solver->ksp(), PETSC_TRUE);
+      t.stop();
+      setup = true;
+    }
 
     // Wrap la::Vector
     la::petsc::Vector _b(la::petsc::create_vector_wrap(b), false);
     la::petsc::Vector x(la::petsc::create_vector_wrap(*u.x()), false);
 
     // Solve
-    int num_iter = solver.solve(x.vec(), _b.vec());
+    int num_iter = solver->solve(x.vec(), _b.vec());
+
+    if (first_call)
+    {
+      PetscInt num_dofs;
+      MatGetSize(A->mat(), &num_dofs, nullptr);
+      print_memory_per_dof(u.function_space()->mesh()->comm(),
+                           "Assembled matrix memory", matrix::bytes(A->mat()),
+                           num_dofs);
+      if (!rhs->empty())
+        multirhs::compare_petsc(solver->ksp(), *rhs);
+    }
+
     return num_iter;
   };
 
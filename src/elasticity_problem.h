@@ -6,6 +6,7 @@
 
 #pragma once
 
+#include "mesh.h"
 #include <dolfinx/fem/Function.h>
 #include <dolfinx/la/Vector.h>
 #include <memory>
@@ -25,6 +26,10 @@ std::tuple<std::shared_ptr<dolfinx::la::Vector<PetscScalar>>,
            std::shared_ptr<dolfinx::fem::Function<PetscScalar>>,
            std::function<int(dolfinx::fem::Function<PetscScalar>&,
                              const dolfinx::la::Vector<PetscScalar>&)>>
-problem(std::shared_ptr<dolfinx::mesh::Mesh<double>> mesh, int order);
+problem(std::shared_ptr<dolfinx::mesh::Mesh<double>> mesh, int order,
+        std::string dof_ordering, std::string multigrid_type,
+        std::shared_ptr<const MeshHierarchy> hierarchy,
+        std::string matrix_type, std::string near_nullspace, double rtol,
+        int max_it, int num_rhs, int num_reassemble, int num_matmult);
 
 } // namespace elastic
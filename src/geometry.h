@@ -0,0 +1,60 @@
+// Copyright (C) 2026 The FEniCS Project
+//
+// This file is part of FEniCS-miniapp (https://www.fenicsproject.org)
+//
+// SPDX-License-Identifier:    MIT
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <utility>
+
+namespace matfree
+{
+/// Compute the inverse K = J^{-1} and the determinant of a Jacobian
+/// @param[in] J Jacobian (row-major, J_ia = dx_i/dX_a)
+/// @return K (row-major, K_ai = dX_a/dx_i) and det J
+inline std::pair<std::array<double, 9>, double>
+jacobian_inverse(const std::array<double, 9>& J)
+{
+  const double detJ = J[0] * (J[4] * J[8] - J[5] * J[7])
+                      - J[1] * (J[3] * J[8] - J[5] * J[6])
+                      + J[2] * (J[3] * J[7] - J[4] * J[6]);
+
+  // K = J^{-1} = adj(J) / det(J)
+  std::array<double, 9> K
+      = {J[4] * J[8] - J[5] * J[7], J[2] * J[7] - J[1] * J[8],
+         J[1] * J[5] - J[2] * J[4], J[5] * J[6] - J[3] * J[8],
+         J[0] * J[8] - J[2] * J[6], J[2] * J[3] - J[0] * J[5],
+         J[3] * J[7] - J[4] * J[6], J[1] * J[6] - J[0] * J[7],
+         J[0] * J[4] - J[1] * J[3]};
+  for (auto& k : K)
+    k /= detJ;
+
+  return {K, detJ};
+}
+
+/// Compute the inverse Jacobian K = J^{-1} and the Jacobian determinant
+/// of an affine tetrahedron
+/// @param[in] x Mesh geometry coordinates, shape (num_nodes, 3)
+/// @param[in] nodes Geometry nodes of the cell (the four vertices)
+/// @return K (row-major, K_ai = dX_a/dx_i) and det J
+template <typename Nodes>
+std::pair<std::array<double, 9>, double>
+affine_jacobian_inverse(std::span<const double> x, const Nodes& nodes)
+{
+  // Jacobian J_ia = x_{a+1, i} - x_{0, i}
+  std::array<double, 9> J;
+  const double* x0 = x.data() + 3 * nodes[0];
+  for (int a = 0; a < 3; ++a)
+  {
+    const double* xa = x.data() + 3 * nodes[a + 1];
+    for (int i = 0; i < 3; ++i)
+      J[3 * i + a] = xa[i] - x0[i];
+  }
+
+  return jacobian_inverse(J);
+}
+} // namespace matfree
@@ -0,0 +1,208 @@
+// Copyright (C) 2026 The FEniCS Project
+//
+// This file is part of FEniCS-miniapp (https://www.fenicsproject.org)
+//
+// SPDX-License-Identifier:    MIT
+
+#pragma once
+
+#if defined(USE_HIP)
+#include <hip/hip_runtime.h>
+#elif defined(USE_CUDA)
+#include <cuda_runtime.h>
+#else
+#error "gpu.h requires USE_CUDA or USE_HIP"
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <dolfinx/common/IndexMap.h>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+/// Device memory management for the GPU problems, over the CUDA or HIP
+/// runtime (selected by USE_CUDA or USE_HIP). Only host code is in this
+/// header, so that it can be included in translation units compiled by
+/// the C++ compiler; the kernels are in gpu_kernels.cu.
+namespace gpu
+{
+#if defined(USE_HIP)
+using error_t = hipError_t;
+inline constexpr error_t success = hipSuccess;
+inline const char* error_string(error_t e) { return hipGetErrorString(e); }
+inline error_t device_malloc(void** p, std::size_t n)
+{
+  return hipMalloc(p, n);
+}
+inline error_t device_free(void* p) { return hipFree(p); }
+inline error_t copy(void* dst, const void* src, std::size_t n)
+{
+  return hipMemcpy(dst, src, n, hipMemcpyDefault);
+}
+inline error_t device_synchronize() { return hipDeviceSynchronize(); }
+inline error_t set_device(int d) { return hipSetDevice(d); }
+inline error_t device_count(int* n) { return hipGetDeviceCount(n); }
+inline constexpr const char* backend = "hip";
+#else
+using error_t = cudaError_t;
+inline constexpr error_t success = cudaSuccess;
+inline const char* error_string(error_t e) { return cudaGetErrorString(e); }
+inline error_t device_malloc(void** p, std::size_t n)
+{
+  return cudaMalloc(p, n);
+}
+inline error_t device_free(void* p) { return cudaFree(p); }
+inline error_t copy(void* dst, const void* src, std::size_t n)
+{
+  return cudaMemcpy(dst, src, n, cudaMemcpyDefault);
+}
+inline error_t device_synchronize() { return cudaDeviceSynchronize(); }
+inline error_t set_device(int d) { return cudaSetDevice(d); }
+inline error_t device_count(int* n) { return cudaGetDeviceCount(n); }
+inline constexpr const char* backend = "cuda";
+#endif
+
+/// Throw if a runtime call failed
+/// @param[in] e Return value of the runtime call
+inline void check(error_t e)
+{
+  if (e != success)
+    throw std::runtime_error(std::string("GPU runtime error: ")
+                             + error_string(e));
+}
+
+/// Wait for all kernels and copies on the device to complete
+inline void synchronize() { check(device_synchronize()); }
+
+/// Array in device memory
+template <typename T>
+class Array
+{
+public:
+  /// Create an empty array
+  Array() = default;
+
+  /// Allocate an (uninitialised) array
+  /// @param[in] size Number of entries
+  explicit Array(std::size_t size) : _size(size)
+  {
+    if (_size > 0)
+      check(device_malloc(reinterpret_cast<void**>(&_data), _size * sizeof(T)));
+  }
+
+  /// Allocate an array and copy host data to it
+  /// @param[in] x Host data
+  explicit Array(std::span<const T> x) : Array(x.size()) { copy_from(x); }
+
+  Array(const Array&) = delete;
+  Array& operator=(const Array&) = delete;
+
+  /// Move constructor
+  Array(Array&& other) noexcept
+      : _data(std::exchange(other._data, nullptr)),
+        _size(std::exchange(other._size, 0))
+  {
+  }
+
+  /// Move assignment
+  Array& operator=(Array&& other) noexcept
+  {
+    std::swap(_data, other._data);
+    std::swap(_size, other._size);
+    return *this;
+  }
+
+  /// Destructor
+  ~Array()
+  {
+    if (_data)
+      device_free(_data);
+  }
+
+  /// Copy host data to the array
+  /// @param[in] x Host data, of the size of the array
+  void copy_from(std::span<const T> x)
+  {
+    check(copy(_data, x.data(), x.size() * sizeof(T)));
+  }
+
+  /// Copy the array to host memory
+  /// @param[out] x Host data, of the size of the array
+  void copy_to(std::span<T> x) const
+  {
+    check(copy(x.data(), _data, x.size() * sizeof(T)));
+  }
+
+  /// Device pointer
+  T* data() { return _data; }
+
+  /// Device pointer
+  const T* data() const { return _data; }
+
+  /// Number of entries
+  std::size_t size() const { return _size; }
+
+private:
+  T* _data = nullptr;
+  std::size_t _size = 0;
+};
+
+/// Distributed vector in device memory, with the layout of a
+/// dolfinx::la::Vector (owned entries followed by ghosts)
+template <typename T>
+class Vector
+{
+public:
+  /// Create a vector
+  /// @param[in] map Index map
+  /// @param[in] bs Block size
+  Vector(std::shared_ptr<const dolfinx::common::IndexMap> map, int bs)
+      : _map(map), _bs(bs),
+        _x(bs * (map->size_local() + map->num_ghosts()))
+  {
+  }
+
+  /// Copy constructor (device to device copy)
+  Vector(const Vector& x) : _map(x._map), _bs(x._bs), _x(x._x.size())
+  {
+    check(copy(_x.data(), x._x.data(), _x.size() * sizeof(T)));
+  }
+
+  /// Index map
+  std::shared_ptr<const dolfinx::common::IndexMap> index_map() const
+  {
+    return _map;
+  }
+
+  /// Block size
+  int bs() const { return _bs; }
+
+  /// Number of owned entries
+  std::int32_t local_size() const { return _bs * _map->size_local(); }
+
+  /// Number of (owned and ghost) entries
+  std::int32_t size() const { return _x.size(); }
+
+  /// Device pointer to the (owned and ghost) entries
+  T* data() { return _x.data(); }
+
+  /// Device pointer to the (owned and ghost) entries
+  const T* data() const { return _x.data(); }
+
+  /// Copy host data to the vector
+  /// @param[in] x Host array of a la::Vector with the same layout
+  void copy_from(std::span<const T> x) { _x.copy_from(x); }
+
+  /// Copy the vector to host memory
+  /// @param[out] x Host array of a la::Vector with the same layout
+  void copy_to(std::span<T> x) const { _x.copy_to(x); }
+
+private:
+  std::shared_ptr<const dolfinx::common::IndexMap> _map;
+  int _bs;
+  Array<T> _x;
+};
+} // namespace gpu
@@ -0,0 +1,277 @@
+// Copyright (C) 2026 The FEniCS Project
+//
+// This file is part of FEniCS-miniapp (https://www.fenicsproject.org)
+//
+// SPDX-License-Identifier:    MIT
+
+// Compiled as CUDA (USE_CUDA) or as HIP (USE_HIP). The DOLFINx headers
+// are not included here, so that the device compiler only sees this
+// file and gpu_kernels.h.
+
+#if defined(USE_HIP)
+#include <hip/hip_runtime.h>
+#define GPU_GET_LAST_ERROR hipGetLastError
+#define GPU_GET_ERROR_STRING hipGetErrorString
+#define GPU_MEMCPY_TO_HOST(dst, src, n)                                        \
+  hipMemcpy(dst, src, n, hipMemcpyDeviceToHost)
+#define GPU_SUCCESS hipSuccess
+#else
+#include <cuda_runtime.h>
+#define GPU_GET_LAST_ERROR cudaGetLastError
+#define GPU_GET_ERROR_STRING cudaGetErrorString
+#define GPU_MEMCPY_TO_HOST(dst, src, n)                                        \
+  cudaMemcpy(dst, src, n, cudaMemcpyDeviceToHost)
+#define GPU_SUCCESS cudaSuccess
+#endif
+
+#include "gpu_kernels.h"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+constexpr int block_size = 128;
+
+// Number of blocks to cover n entries with one thread per entry
+unsigned int num_blocks(std::int32_t n)
+{
+  return (n + block_size - 1) / block_size;
+}
+
+// Throw if the last kernel launch failed
+void check_launch()
+{
+  auto e = GPU_GET_LAST_ERROR();
+  if (e != GPU_SUCCESS)
+  {
+    throw std::runtime_error(std::string("GPU kernel launch failed: ")
+                             + GPU_GET_ERROR_STRING(e));
+  }
+}
+
+// Laplace operator action over a list of cells, one thread per cell.
+// Follows matfree::PoissonOperator::apply, with the cell data read
+// component-major.
+template <int ND>
+__global__ void poisson_kernel(gpu::PoissonData op,
+                               const double* __restrict__ x,
+                               double* __restrict__ y,
+                               const std::int32_t* __restrict__ cells,
+                               std::int32_t num_cells)
+{
+  const std::int32_t i = blockIdx.x * blockDim.x + threadIdx.x;
+  if (i >= num_cells)
+    return;
+  const std::int32_t c = cells[i];
+  const std::int32_t nc = op.num_cells;
+  const int nq = op.nq;
+
+  std::int32_t dofs[ND];
+  double xe[ND], ye[ND];
+  for (int j = 0; j < ND; ++j)
+  {
+    dofs[j] = op.dofs[j * nc + c];
+    xe[j] = x[dofs[j]];
+    ye[j] = 0;
+  }
+
+  double G[6];
+  for (int k = 0; k < 6; ++k)
+    G[k] = op.G[k * nc + c];
+
+  for (int q = 0; q < nq; ++q)
+  {
+    const double* d0 = op.dphi + (0 * nq + q) * ND;
+    const double* d1 = op.dphi + (1 * nq + q) * ND;
+    const double* d2 = op.dphi + (2 * nq + q) * ND;
+
+    // Reference gradient at quadrature point
+    double g0 = 0, g1 = 0, g2 = 0;
+    for (int j = 0; j < ND; ++j)
+    {
+      g0 += d0[j] * xe[j];
+      g1 += d1[j] * xe[j];
+      g2 += d2[j] * xe[j];
+    }
+
+    // Apply geometric factor and quadrature weight
+    const double w = op.weights[q];
+    const double f0 = w * (G[0] * g0 + G[1] * g1 + G[2] * g2);
+    const double f1 = w * (G[1] * g0 + G[3] * g1 + G[4] * g2);
+    const double f2 = w * (G[2] * g0 + G[4] * g1 + G[5] * g2);
+
+    for (int j = 0; j < ND; ++j)
+      ye[j] += d0[j] * f0 + d1[j] * f1 + d2[j] * f2;
+  }
+
+  for (int j = 0; j < ND; ++j)
+    atomicAdd(&y[dofs[j]], ye[j]);
+}
+
+__global__ void fill_kernel(double* x, std::int32_t n, double value)
+{
+  const std::int32_t i = blockIdx.x * blockDim.x + threadIdx.x;
+  if (i < n)
+    x[i] = value;
+}
+
+__global__ void fill_indices_kernel(double* x, const std::int32_t* idx,
+                                    std::int32_t n, double value)
+{
+  const std::int32_t i = blockIdx.x * blockDim.x + threadIdx.x;
+  if (i < n)
+    x[idx[i]] = value;
+}
+
+__global__ void pack_kernel(const double* in, const std::int32_t* idx,
+                            std::int32_t n, double* out)
+{
+  const std::int32_t i = blockIdx.x * blockDim.x + threadIdx.x;
+  if (i < n)
+    out[i] = in[idx[i]];
+}
+
+__global__ void unpack_add_kernel(const double* in, const std::int32_t* idx,
+                                  std::int32_t n, double* out)
+{
+  const std::int32_t i = blockIdx.x * blockDim.x + threadIdx.x;
+  if (i < n)
+    atomicAdd(&out[idx[i]], in[i]);
+}
+
+__global__ void unpack_set_kernel(const double* in, const std::int32_t* idx,
+                                  std::int32_t n, double* out)
+{
+  const std::int32_t i = blockIdx.x * blockDim.x + threadIdx.x;
+  if (i < n)
+    out[idx[i]] = in[i];
+}
+
+__global__ void axpy_kernel(std::int32_t n, double alpha, const double* x,
+                            const double* y, double* r)
+{
+  const std::int32_t i = blockIdx.x * blockDim.x + threadIdx.x;
+  if (i < n)
+    r[i] = alpha * x[i] + y[i];
+}
+
+// Partial inner products: each block reduces a grid-strided range into
+// one entry of work
+__global__ void dot_kernel(std::int32_t n, const double* a, const double* b,
+                           double* work)
+{
+  __shared__ double s[block_size];
+  double v = 0;
+  for (std::int32_t i = blockIdx.x * blockDim.x + threadIdx.x; i < n;
+       i += blockDim.x * gridDim.x)
+  {
+    v += a[i] * b[i];
+  }
+  s[threadIdx.x] = v;
+  __syncthreads();
+  for (int k = blockDim.x / 2; k > 0; k /= 2)
+  {
+    if (threadIdx.x < k)
+      s[threadIdx.x] += s[threadIdx.x + k];
+    __syncthreads();
+  }
+  if (threadIdx.x == 0)
+    work[blockIdx.x] = s[0];
+}
+} // namespace
+
+//-----------------------------------------------------------------------------
+void gpu::poisson_apply(const PoissonData& op, const double* x, double* y,
+                        const std::int32_t* cells, std::int32_t num_cells)
+{
+  if (num_cells == 0)
+    return;
+  const unsigned int nb = num_blocks(num_cells);
+  switch (op.ndofs)
+  {
+  case 4:
+    poisson_kernel<4><<<nb, block_size>>>(op, x, y, cells, num_cells);
+    break;
+  case 10:
+    poisson_kernel<10><<<nb, block_size>>>(op, x, y, cells, num_cells);
+    break;
+  case 20:
+    poisson_kernel<20><<<nb, block_size>>>(op, x, y, cells, num_cells);
+    break;
+  default:
+    throw std::runtime_error("GPU operator supports orders 1 to 3 only");
+  }
+  check_launch();
+}
+//-----------------------------------------------------------------------------
+void gpu::fill(double* x, std::int32_t n, double value)
+{
+  if (n == 0)
+    return;
+  fill_kernel<<<num_blocks(n), block_size>>>(x, n, value);
+  check_launch();
+}
+//-----------------------------------------------------------------------------
+void gpu::fill_indices(double* x, const std::int32_t* idx, std::int32_t n,
+                       double value)
+{
+  if (n == 0)
+    return;
+  fill_indices_kernel<<<num_blocks(n), block_size>>>(x, idx, n, value);
+  check_launch();
+}
+//-----------------------------------------------------------------------------
+void gpu::pack(const double* in, const std::int32_t* idx, std::int32_t n,
+               double* out)
+{
+  if (n == 0)
+    return;
+  pack_kernel<<<num_blocks(n), block_size>>>(in, idx, n, out);
+  check_launch();
+}
+//-----------------------------------------------------------------------------
+void gpu::unpack_add(const double* in, const std::int32_t* idx,
+                     std::int32_t n, double* out)
+{
+  if (n == 0)
+    return;
+  unpack_add_kernel<<<num_blocks(n), block_size>>>(in, idx, n, out);
+  check_launch();
+}
+//-----------------------------------------------------------------------------
+void gpu::unpack_set(const double* in, const std::int32_t* idx,
+                     std::int32_t n, double* out)
+{
+  if (n == 0)
+    return;
+  unpack_set_kernel<<<num_blocks(n), block_size>>>(in, idx, n, out);
+  check_launch();
+}
+//-----------------------------------------------------------------------------
+void gpu::axpy(std::int32_t n, double alpha, const double* x,
+               const double* y, double* r)
+{
+  if (n == 0)
+    return;
+  axpy_kernel<<<num_blocks(n), block_size>>>(n, alpha, x, y, r);
+  check_launch();
+}
+//-----------------------------------------------------------------------------
+double gpu::dot(std::int32_t n, const double* a, const double* b,
+                double* work)
+{
+  if (n == 0)
+    return 0;
+  const unsigned int nb = std::min<unsigned int>(num_blocks(n), dot_work_size);
+  dot_kernel<<<nb, block_size>>>(n, a, b, work);
+  check_launch();
+
+  double partial[dot_work_size];
+  if (GPU_MEMCPY_TO_HOST(partial, work, nb * sizeof(double)) != GPU_SUCCESS)
+    throw std::runtime_error("GPU copy of partial inner products failed");
+  double v = 0;
+  for (unsigned int i = 0; i < nb; ++i)
+    v += partial[i];
+  return v;
+}
@@ -0,0 +1,86 @@
+// Copyright (C) 2026 The FEniCS Project
+//
+// This file is part of FEniCS-miniapp (https://www.fenicsproject.org)
+//
+// SPDX-License-Identifier:    MIT
+
+#pragma once
+
+#include <cstdint>
+
+/// Kernel launchers for the GPU problems. The kernels are compiled by
+/// the device compiler (gpu_kernels.cu); this header has host
+/// declarations only. All pointers are device pointers, and all
+/// launches are asynchronous on the default stream.
+namespace gpu
+{
+/// Device data of a matrix-free Poisson operator on affine tetrahedra
+/// (see matfree::PoissonOperator). Cell data is stored component-major
+/// so that neighbouring threads read neighbouring entries.
+struct PoissonData
+{
+  /// Number of dofs per cell (4, 10 or 20)
+  int ndofs;
+
+  /// Number of quadrature points
+  int nq;
+
+  /// Number of cells with cached data
+  std::int32_t num_cells;
+
+  /// Reference basis derivatives, [3][nq][ndofs]
+  const double* dphi;
+
+  /// Quadrature weights, [nq]
+  const double* weights;
+
+  /// Geometric factors, [6][num_cells]
+  const double* G;
+
+  /// Cell dofs, [ndofs][num_cells]
+  const std::int32_t* dofs;
+};
+
+/// Compute y += A x over a list of cells, one thread per cell.
+/// Contributions to shared dofs are added atomically.
+/// @param[in] op Operator data
+/// @param[in] x Input, including up-to-date ghost entries
+/// @param[in,out] y Output (contributions are added)
+/// @param[in] cells Cells to compute
+/// @param[in] num_cells Number of cells
+void poisson_apply(const PoissonData& op, const double* x, double* y,
+                   const std::int32_t* cells, std::int32_t num_cells);
+
+/// Set x[i] = value for 0 <= i < n
+void fill(double* x, std::int32_t n, double value);
+
+/// Set x[idx[i]] = value for 0 <= i < n
+void fill_indices(double* x, const std::int32_t* idx, std::int32_t n,
+                  double value);
+
+/// Pack out[i] = in[idx[i]] for 0 <= i < n
+void pack(const double* in, const std::int32_t* idx, std::int32_t n,
+          double* out);
+
+/// Unpack out[idx[i]] += in[i] for 0 <= i < n (atomically, idx may
+/// have repeated entries)
+void unpack_add(const double* in, const std::int32_t* idx, std::int32_t n,
+                double* out);
+
+/// Unpack out[idx[i]] = in[i] for 0 <= i < n
+void unpack_set(const double* in, const std::int32_t* idx, std::int32_t n,
+                double* out);
+
+/// Compute r = alpha x + y for the first n entries
+void axpy(std::int32_t n, double alpha, const double* x, const double* y,
+          double* r);
+
+/// Number of entries of the work array of `dot`
+constexpr int dot_work_size = 1024;
+
+/// Compute the inner product of the first n entries of a and b on this
+/// process (synchronous)
+/// @param[in] work Work array of `dot_work_size` entries
+/// @return sum_i a[i] b[i]
+double dot(std::int32_t n, const double* a, const double* b, double* work);
+} // namespace gpu
@@ -0,0 +1,390 @@
+// Copyright (C) 2026 The FEniCS Project
+//
+// This file is part of FEniCS-miniapp (https://www.fenicsproject.org)
+//
+// SPDX-License-Identifier:    MIT
+
+#include "gpupoisson_problem.h"
+#include "cgpoisson_problem.h"
+#include "gpu.h"
+#include "gpu_kernels.h"
+#include "mem.h"
+#include "metrics.h"
+#include "phase.h"
+#include "poisson_operator.h"
+#include "reorder.h"
+#include <chrono>
+#include <cmath>
+#include <dolfinx/common/MPI.h>
+#include <dolfinx/common/Scatterer.h>
+#include <dolfinx/common/Timer.h>
+#include <dolfinx/fem/DirichletBC.h>
+#include <dolfinx/fem/Function.h>
+#include <dolfinx/fem/FunctionSpace.h>
+#include <dolfinx/mesh/Mesh.h>
+#include <iostream>
+#include <memory>
+#include <petscsys.h>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+using namespace dolfinx;
+using T = PetscScalar;
+static_assert(std::is_same_v<T, double>,
+              "gpupoisson requires a real double precision PETSc build");
+
+namespace
+{
+/// Device copy of the cached data of a matrix-free Poisson operator.
+/// Cell data is transposed to component-major order for coalesced
+/// access.
+struct DeviceOperator
+{
+  explicit DeviceOperator(const matfree::PoissonOperator<T>& op)
+      : ndofs(op.num_cell_dofs()), nq(op.num_quadrature_points()),
+        num_cells(op.cells().size()), dphi(op.dphi()),
+        weights(op.weights()), boundary_cells(op.boundary_cells()),
+        interior_cells(op.interior_cells())
+  {
+    std::span<const T> G_h = op.geometry_factors();
+    std::vector<T> Gt(G_h.size());
+    for (std::int32_t c = 0; c < num_cells; ++c)
+      for (int k = 0; k < 6; ++k)
+        Gt[k * num_cells + c] = G_h[6 * c + k];
+    G = gpu::Array<T>(std::span<const T>(Gt));
+
+    std::span<const std::int32_t> dofs_h = op.cell_dofs();
+    std::vector<std::int32_t> dofs_t(dofs_h.size());
+    for (std::int32_t c = 0; c < num_cells; ++c)
+      for (int j = 0; j < ndofs; ++j)
+        dofs_t[j * num_cells + c] = dofs_h[ndofs * c + j];
+    dofs = gpu::Array<std::int32_t>(std::span<const std::int32_t>(dofs_t));
+  }
+
+  /// View of the data for the kernels
+  gpu::PoissonData view() const
+  {
+    return {ndofs,    nq,         num_cells, dphi.data(), weights.data(),
+            G.data(), dofs.data()};
+  }
+
+  /// Bytes of device memory
+  std::size_t bytes() const
+  {
+    return sizeof(T) * (dphi.size() + weights.size() + G.size())
+           + sizeof(std::int32_t)
+                 * (dofs.size() + boundary_cells.size()
+                    + interior_cells.size());
+  }
+
+  int ndofs, nq;
+  std::int32_t num_cells;
+  gpu::Array<T> dphi, weights, G;
+  gpu::Array<std::int32_t> dofs, boundary_cells, interior_cells;
+};
+
+/// Ghost exchange of device vectors. The buffers are packed and
+/// unpacked by device kernels (replacing the host pack_fn/unpack_fn of
+/// cgpoisson). With GPU-aware MPI the device buffers are passed to MPI
+/// directly, otherwise they are staged through host buffers.
+class DeviceScatterer
+{
+public:
+  DeviceScatterer(const common::IndexMap& map, int bs,
+                  common::Scatterer<>::type type, bool gpu_aware_mpi)
+      : _sct(map, bs), _type(type), _gpu_aware(gpu_aware_mpi),
+        _local_indices(std::span<const std::int32_t>(_sct.local_indices())),
+        _remote_indices(
+            std::span<const std::int32_t>(_sct.remote_indices())),
+        _local_buffer(_sct.local_buffer_size()),
+        _remote_buffer(_sct.remote_buffer_size()),
+        _request(_sct.create_request_vector(type))
+  {
+    if (!_gpu_aware)
+    {
+      _local_buffer_h.resize(_local_buffer.size());
+      _remote_buffer_h.resize(_remote_buffer.size());
+    }
+  }
+
+  /// Start sending the ghost entries of y to their owners
+  void scatter_rev_begin(const gpu::Vector<T>& y)
+  {
+    gpu::pack(y.data() + y.local_size(), _remote_indices.data(),
+              _remote_indices.size(), _remote_buffer.data());
+    gpu::synchronize();
+    if (_gpu_aware)
+    {
+      _sct.scatter_rev_begin<T>(
+          std::span<const T>(_remote_buffer.data(), _remote_buffer.size()),
+          std::span<T>(_local_buffer.data(), _local_buffer.size()), _request,
+          _type);
+    }
+    else
+    {
+      _remote_buffer.copy_to(_remote_buffer_h);
+      _sct.scatter_rev_begin<T>(std::span<const T>(_remote_buffer_h),
+                                std::span<T>(_local_buffer_h), _request,
+                                _type);
+    }
+  }
+
+  /// Complete the reverse scatter, adding the received ghost
+  /// contributions to the owned entries of y
+  void scatter_rev_end(gpu::Vector<T>& y)
+  {
+    _sct.scatter_rev_end(_request);
+    if (!_gpu_aware)
+      _local_buffer.copy_from(_local_buffer_h);
+    gpu::unpack_add(_local_buffer.data(), _local_indices.data(),
+                    _local_indices.size(), y.data());
+  }
+
+  /// Update the ghost entries of x from their owners
+  void scatter_fwd(gpu::Vector<T>& x)
+  {
+    gpu::pack(x.data(), _local_indices.data(), _local_indices.size(),
+              _local_buffer.data());
+    gpu::synchronize();
+    if (_gpu_aware)
+    {
+      _sct.scatter_fwd_begin<T>(
+          std::span<const T>(_local_buffer.data(), _local_buffer.size()),
+          std::span<T>(_remote_buffer.data(), _remote_buffer.size()),
+          _request, _type);
+      _sct.scatter_fwd_end(_request);
+    }
+    else
+    {
+      _local_buffer.copy_to(_local_buffer_h);
+      _sct.scatter_fwd_begin<T>(std::span<const T>(_local_buffer_h),
+                                std::span<T>(_remote_buffer_h), _request,
+                                _type);
+      _sct.scatter_fwd_end(_request);
+      _remote_buffer.copy_from(_remote_buffer_h);
+    }
+    gpu::unpack_set(_remote_buffer.data(), _remote_indices.data(),
+                    _remote_indices.size(), x.data() + x.local_size());
+  }
+
+private:
+  common::Scatterer<> _sct;
+  common::Scatterer<>::type _type;
+  bool _gpu_aware;
+  gpu::Array<std::int32_t> _local_indices, _remote_indices;
+  gpu::Array<T> _local_buffer, _remote_buffer;
+  std::vector<T> _local_buffer_h, _remote_buffer_h;
+  std::vector<MPI_Request> _request;
+};
+
+/// Global inner product of the owned entries of two device vectors
+T inner_product(const gpu::Vector<T>& a, const gpu::Vector<T>& b,
+                gpu::Array<T>& work)
+{
+  T v = gpu::dot(a.local_size(), a.data(), b.data(), work.data());
+  MPI_Allreduce(MPI_IN_PLACE, &v, 1, MPI_DOUBLE, MPI_SUM,
+                a.index_map()->comm());
+  return v;
+}
+
+/// Compute r = alpha x + y over all (owned and ghost) entries
+void axpy(gpu::Vector<T>& r, T alpha, const gpu::Vector<T>& x,
+          const gpu::Vector<T>& y)
+{
+  gpu::axpy(r.size(), alpha, x.data(), y.data(), r.data());
+}
+
+/// Conjugate gradient method of linalg::cg with all vectors in device
+/// memory. Scalars are reduced on the host.
+template <typename ApplyFunction>
+int cg(gpu::Vector<T>& x, const gpu::Vector<T>& b, ApplyFunction&& action,
+       int kmax, double rtol)
+{
+  gpu::Array<T> work(gpu::dot_work_size);
+
+  // Create working vectors
+  gpu::Vector<T> r(b), y(b);
+
+  // Compute initial residual r0 = b - Ax0
+  action(x, y);
+  axpy(r, T(-1), y, b);
+
+  // Create p work vector
+  gpu::Vector<T> p(r);
+
+  // Iterations of CG
+  auto rnorm0 = inner_product(r, r, work);
+  const auto rtol2 = rtol * rtol;
+  auto rnorm = rnorm0;
+  int k = 0;
+  while (k < kmax)
+  {
+    ++k;
+
+    // Compute y = A p
+    action(p, y);
+
+    // Compute alpha = r.r/p.y
+    const T alpha = rnorm / inner_product(p, y, work);
+
+    // Update x (x <- x + alpha*p)
+    axpy(x, alpha, p, x);
+
+    // Update r (r <- r - alpha*y)
+    axpy(r, -alpha, y, r);
+
+    // Update residual norm
+    const auto rnorm_new = inner_product(r, r, work);
+    const T beta = rnorm_new / rnorm;
+    rnorm = rnorm_new;
+
+    if (rnorm / rnorm0 < rtol2)
+      break;
+
+    // Update p (p <- beta*p + r)
+    axpy(p, beta, p, r);
+  }
+
+  return k;
+}
+} // namespace
+
+std::tuple<std::shared_ptr<la::Vector<T>>, std::shared_ptr<fem::Function<T>>,
+           std::function<int(fem::Function<T>&, const la::Vector<T>&)>>
+gpupoisson::problem(std::shared_ptr<mesh::Mesh<double>> mesh, int order,
+                    std::string dof_ordering, std::string scatterer,
+                    bool gpu_aware_mpi, double rtol, int max_it)
+{
+  // One device per process, assigned round-robin over the processes of
+  // a node
+  {
+    MPI_Comm node_comm;
+    MPI_Comm_split_type(mesh->comm(), MPI_COMM_TYPE_SHARED, 0,
+                        MPI_INFO_NULL, &node_comm);
+    const int node_rank = dolfinx::MPI::rank(node_comm);
+    MPI_Comm_free(&node_comm);
+    int num_devices = 0;
+    gpu::check(gpu::device_count(&num_devices));
+    if (num_devices == 0)
+      throw std::runtime_error("No GPU devices found");
+    gpu::check(gpu::set_device(node_rank % num_devices));
+  }
+
+  Phase t0("ZZZ FunctionSpace");
+
+  auto element = basix::create_element<double>(
+      basix::element::family::P, basix::cell::type::tetrahedron, order,
+      basix::element::lagrange_variant::gll_warped,
+      basix::element::dpc_variant::unset, false);
+
+  auto dolfinx_element
+      = std::make_shared<const fem::FiniteElement<double>>(element);
+
+  auto V = std::make_shared<fem::FunctionSpace<double>>(
+      reorder::create_functionspace(mesh, dolfinx_element, dof_ordering));
+
+  t0.stop();
+
+  Phase t1("ZZZ Assemble");
+
+  cgpoisson::System system = cgpoisson::create_system(V, order);
+  std::shared_ptr<const fem::DirichletBC<T>> bc = system.bc;
+  la::Vector<T> b = std::move(system.b.front());
+
+  t1.stop();
+
+  // Create Function to hold solution
+  auto u = std::make_shared<fem::Function<T>>(V);
+
+  // Create the matrix-free operator on the host, and copy its cached
+  // geometry, dofmap and basis data to the device
+  Phase t6("ZZZ Create GPU operator");
+  auto op = std::make_shared<const DeviceOperator>(
+      matfree::PoissonOperator<T>(*V, element, order));
+  std::span<const std::int32_t> bc_dofs_h = bc->dof_indices().first;
+  auto bc_dofs = std::make_shared<const gpu::Array<std::int32_t>>(bc_dofs_h);
+  t6.stop();
+  if (dolfinx::MPI::rank(mesh->comm()) == 0)
+  {
+    std::cout << "GPU backend: " << gpu::backend
+              << (gpu_aware_mpi ? " (GPU-aware MPI)" : " (host-staged MPI)")
+              << std::endl;
+  }
+
+  common::Scatterer<>::type type;
+  if (scatterer == "neighbor")
+    type = common::Scatterer<>::type::neighbor;
+  else if (scatterer == "p2p")
+    type = common::Scatterer<>::type::p2p;
+  else
+    throw std::runtime_error("Unknown scatterer: " + scatterer);
+
+  std::function<int(fem::Function<T>&, const la::Vector<T>&)> solver_function
+      = [V, op, bc_dofs, type, gpu_aware_mpi, rtol,
+         max_it](fem::Function<T>& u, const la::Vector<T>& b)
+  {
+    auto idx_map = V->dofmap()->index_map;
+    int bs = V->dofmap()->bs();
+    DeviceScatterer sct(*idx_map, bs, type, gpu_aware_mpi);
+    const gpu::PoissonData data = op->view();
+
+    // Create function for computing the action of A on x (y = Ax),
+    // overlapping the reverse scatter with the interior cells
+    auto action = [&](gpu::Vector<T>& x, gpu::Vector<T>& y)
+    {
+      gpu::fill(y.data(), y.size(), 0);
+      gpu::poisson_apply(data, x.data(), y.data(), op->boundary_cells.data(),
+                         op->boundary_cells.size());
+      sct.scatter_rev_begin(y);
+      gpu::poisson_apply(data, x.data(), y.data(), op->interior_cells.data(),
+                         op->interior_cells.size());
+      sct.scatter_rev_end(y);
+
+      // Set BC dofs to zero (effectively zeroes rows of A)
+      gpu::fill_indices(y.data(), bc_dofs->data(), bc_dofs->size(), 0);
+
+      // Update ghost values
+      sct.scatter_fwd(y);
+    };
+
+    // Copy the right-hand side and initial guess to the device
+    gpu::Vector<T> b_d(idx_map, bs), x_d(idx_map, bs);
+    b_d.copy_from(b.array());
+    x_d.copy_from(u.x()->array());
+
+    common::Timer tcg;
+    int num_it = cg(x_d, b_d, action, max_it, rtol);
+    gpu::synchronize();
+    tcg.stop();
+    tcg.flush();
+    double time = std::chrono::duration<double>(tcg.elapsed()).count();
+    double ndofs_global
+        = static_cast<double>(V->dofmap()->index_map->size_global());
+    double gdofs = (num_it * ndofs_global) / time / 1e9;
+
+    std::cout << "CG matrix-free action processed: " << gdofs << " Gdof/s\n";
+    metrics::record("gdofs_per_second", gdofs);
+
+    // Relative residual of the solution
+    gpu::Vector<T> r_d(b_d);
+    action(x_d, r_d);
+    axpy(r_d, T(-1), r_d, b_d);
+    gpu::Array<T> work(gpu::dot_work_size);
+    const double rnorm = std::sqrt(inner_product(r_d, r_d, work)
+                                   / inner_product(b_d, b_d, work));
+    if (dolfinx::MPI::rank(V->mesh()->comm()) == 0)
+      std::cout << "CG relative residual: " << rnorm << "\n";
+    metrics::record("relative_residual", rnorm);
+
+    x_d.copy_to(u.x()->mutable_array());
+
+    return num_it;
+  };
+
+  print_memory_per_dof(mesh->comm(), "GPU operator device memory",
+                       op->bytes(), V->dofmap()->index_map->size_global());
+  metrics::record("gpu_backend", std::string(gpu::backend));
+
+  return {std::make_shared<la::Vector<T>>(std::move(b)), u, solver_function};
+}
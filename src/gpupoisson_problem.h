@@ -0,0 +1,31 @@
+// Copyright (C) 2026 The FEniCS Project
+//
+// This file is part of FEniCS-miniapp (https://www.fenicsproject.org)
+//
+// SPDX-License-Identifier:    MIT
+
+#pragma once
+
+#include <dolfinx/fem/Function.h>
+#include <dolfinx/la/Vector.h>
+#include <dolfinx/mesh/Mesh.h>
+#include <memory>
+#include <petscsys.h>
+#include <utility>
+
+/// Matrix-free Poisson solver on the GPU (CUDA or HIP). The matrix-free
+/// operator data, the CG vectors and the ghost exchange buffers are
+/// kept in device memory; only the right-hand side and the solution are
+/// copied between host and device, outside the timed CG solve.
+namespace gpupoisson
+{
+
+std::tuple<std::shared_ptr<dolfinx::la::Vector<PetscScalar>>,
+           std::shared_ptr<dolfinx::fem::Function<PetscScalar>>,
+           std::function<int(dolfinx::fem::Function<PetscScalar>&,
+                             const dolfinx::la::Vector<PetscScalar>&)>>
+problem(std::shared_ptr<dolfinx::mesh::Mesh<double>> mesh, int order,
+        std::string dof_ordering, std::string scatterer, bool gpu_aware_mpi,
+        double rtol, int max_it);
+
+} // namespace gpupoisson
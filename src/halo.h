@@ -0,0 +1,304 @@
+// Copyright (C) 2026 The FEniCS Project
+//
+// This file is part of FEniCS-miniapp (https://www.fenicsproject.org)
+//
+// SPDX-License-Identifier:    MIT
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <dolfinx/common/IndexMap.h>
+#include <dolfinx/common/MPI.h>
+#include <dolfinx/common/Scatterer.h>
+#include <functional>
+#include <mpi.h>
+#include <numeric>
+#include <span>
+#include <vector>
+
+/// Ghost exchange of distributed arrays, with non-blocking or
+/// persistent MPI requests. The exchange classes share an interface
+/// (scatter_fwd_begin/end and scatter_rev_begin/end on the owned and
+/// ghost parts of an array), so that a solver can be written for
+/// either.
+namespace halo
+{
+/// Ghost exchange with a common::Scatterer, which starts new
+/// non-blocking communication (neighbourhood collectives or
+/// point-to-point, depending on `type`) on each scatter
+template <typename T>
+struct ScattererExchange
+{
+  const dolfinx::common::Scatterer<>& sct;
+  dolfinx::common::Scatterer<>::type type;
+  std::vector<MPI_Request>& request;
+  std::vector<T> local_buffer, remote_buffer;
+
+  /// Start sending owned values to the ranks that ghost them
+  void scatter_fwd_begin(std::span<const T> local_data)
+  {
+    sct.scatter_fwd_begin<T>(local_data, local_buffer, remote_buffer,
+                             pack_fn, request, type);
+  }
+
+  /// Complete a forward scatter, setting the ghost values
+  void scatter_fwd_end(std::span<T> remote_data)
+  {
+    sct.scatter_fwd_end<T>(remote_buffer, remote_data, unpack_fn, request);
+  }
+
+  /// Start sending ghost values to their owners
+  void scatter_rev_begin(std::span<const T> remote_data)
+  {
+    sct.scatter_rev_begin<T>(remote_data, remote_buffer, local_buffer,
+                             pack_fn, request, type);
+  }
+
+  /// Complete a reverse scatter, adding the ghost values to the owned
+  /// entries
+  void scatter_rev_end(std::span<T> local_data)
+  {
+    sct.scatter_rev_end<T>(local_buffer, local_data, unpack_fn,
+                           std::plus<T>(), request);
+  }
+
+private:
+  static void pack_fn(std::span<const T> in, std::span<const std::int32_t> idx,
+                      std::span<T> out)
+  {
+    for (std::size_t i = 0; i < idx.size(); ++i)
+      out[i] = in[idx[i]];
+  }
+
+  static void unpack_fn(std::span<const T> in,
+                        std::span<const std::int32_t> idx, std::span<T> out,
+                        std::function<T(T, T)> op)
+  {
+    for (std::size_t i = 0; i < idx.size(); ++i)
+      out[idx[i]] = op(out[idx[i]], in[i]);
+  }
+};
+
+/// Forward (owner to ghost) and reverse (ghost to owner) scatters of a
+/// distributed array with the layout of a la::Vector. Unlike
+/// common::Scatterer, which starts new non-blocking communication on
+/// every call, the communication is set up once as persistent requests
+/// on fixed buffers, and each scatter only restarts the requests. With
+/// MPI-4 the requests are persistent neighbourhood collectives
+/// (MPI_Neighbor_alltoallv_init), otherwise one persistent send and
+/// receive per neighbour (MPI_Send_init/MPI_Recv_init).
+template <typename T>
+class PersistentScatterer
+{
+public:
+  /// Create the scatterer. This is collective on the communicator of
+  /// the index map.
+  /// @param[in] map Index map of the array
+  /// @param[in] bs Block size of the array
+  PersistentScatterer(const dolfinx::common::IndexMap& map, int bs)
+  {
+    std::span<const int> src = map.src();
+    std::span<const int> dest = map.dest();
+    _src.assign(src.begin(), src.end());
+    _dest.assign(dest.begin(), dest.end());
+
+    // Forward scatters go from the owners (src) to the ranks that ghost
+    // the owned indices (dest), and reverse scatters the other way
+    MPI_Dist_graph_create_adjacent(map.comm(), _src.size(), _src.data(),
+                                   MPI_UNWEIGHTED, _dest.size(), _dest.data(),
+                                   MPI_UNWEIGHTED, MPI_INFO_NULL, false,
+                                   &_comm_fwd);
+    MPI_Dist_graph_create_adjacent(map.comm(), _dest.size(), _dest.data(),
+                                   MPI_UNWEIGHTED, _src.size(), _src.data(),
+                                   MPI_UNWEIGHTED, MPI_INFO_NULL, false,
+                                   &_comm_rev);
+
+    // Group the ghosts by owner, in the order of src
+    std::span<const std::int64_t> ghosts = map.ghosts();
+    std::span<const int> owners = map.owners();
+    std::vector<std::int32_t> ghost_pos(ghosts.size());
+    std::iota(ghost_pos.begin(), ghost_pos.end(), 0);
+    std::ranges::stable_sort(ghost_pos, std::less<>(), [&owners](auto i)
+                             { return owners[i]; });
+    std::vector<int> num_remote(_src.size(), 0);
+    std::vector<std::int64_t> ghosts_sorted(ghosts.size());
+    for (std::size_t i = 0; i < ghost_pos.size(); ++i)
+    {
+      ghosts_sorted[i] = ghosts[ghost_pos[i]];
+      auto it = std::ranges::lower_bound(_src, owners[ghost_pos[i]]);
+      num_remote[std::distance(_src.begin(), it)] += 1;
+    }
+
+    // Send the ghost global indices to their owners
+    std::vector<int> num_local(_dest.size());
+    MPI_Neighbor_alltoall(num_remote.data(), 1, MPI_INT, num_local.data(), 1,
+                          MPI_INT, _comm_rev);
+    std::vector<int> displs_remote = offsets(num_remote);
+    std::vector<int> displs_local = offsets(num_local);
+    std::vector<std::int64_t> requested(displs_local.back());
+    MPI_Neighbor_alltoallv(ghosts_sorted.data(), num_remote.data(),
+                           displs_remote.data(), MPI_INT64_T,
+                           requested.data(), num_local.data(),
+                           displs_local.data(), MPI_INT64_T, _comm_rev);
+
+    // Expand the (blocked) indices
+    const std::int64_t offset = map.local_range()[0];
+    for (std::int64_t g : requested)
+      for (int k = 0; k < bs; ++k)
+        _local_indices.push_back(bs * (g - offset) + k);
+    for (std::int32_t i : ghost_pos)
+      for (int k = 0; k < bs; ++k)
+        _remote_indices.push_back(bs * i + k);
+    for (auto& n : num_local)
+      n *= bs;
+    for (auto& n : num_remote)
+      n *= bs;
+    _sizes_local = num_local;
+    _sizes_remote = num_remote;
+    _displs_local = offsets(num_local);
+    _displs_remote = offsets(num_remote);
+
+    _local_buffer.resize(_local_indices.size());
+    _remote_buffer.resize(_remote_indices.size());
+
+    create_requests();
+  }
+
+  PersistentScatterer(const PersistentScatterer&) = delete;
+  PersistentScatterer& operator=(const PersistentScatterer&) = delete;
+
+  /// Destructor
+  ~PersistentScatterer()
+  {
+    for (auto& r : _requests_fwd)
+      MPI_Request_free(&r);
+    for (auto& r : _requests_rev)
+      MPI_Request_free(&r);
+    MPI_Comm_free(&_comm_fwd);
+    MPI_Comm_free(&_comm_rev);
+  }
+
+  /// Start sending owned values to the ranks that ghost them
+  /// @param[in] local_data Owned entries of the array
+  void scatter_fwd_begin(std::span<const T> local_data)
+  {
+    for (std::size_t i = 0; i < _local_indices.size(); ++i)
+      _local_buffer[i] = local_data[_local_indices[i]];
+    MPI_Startall(_requests_fwd.size(), _requests_fwd.data());
+  }
+
+  /// Complete a forward scatter, setting the ghost values
+  /// @param[in,out] remote_data Ghost entries of the array
+  void scatter_fwd_end(std::span<T> remote_data)
+  {
+    MPI_Waitall(_requests_fwd.size(), _requests_fwd.data(),
+                MPI_STATUSES_IGNORE);
+    for (std::size_t i = 0; i < _remote_indices.size(); ++i)
+      remote_data[_remote_indices[i]] = _remote_buffer[i];
+  }
+
+  /// Start sending ghost values to their owners
+  /// @param[in] remote_data Ghost entries of the array
+  void scatter_rev_begin(std::span<const T> remote_data)
+  {
+    for (std::size_t i = 0; i < _remote_indices.size(); ++i)
+      _remote_buffer[i] = remote_data[_remote_indices[i]];
+    MPI_Startall(_requests_rev.size(), _requests_rev.data());
+  }
+
+  /// Complete a reverse scatter, adding the ghost values to the owned
+  /// entries
+  /// @param[in,out] local_data Owned entries of the array
+  void scatter_rev_end(std::span<T> local_data)
+  {
+    MPI_Waitall(_requests_rev.size(), _requests_rev.data(),
+                MPI_STATUSES_IGNORE);
+    for (std::size_t i = 0; i < _local_indices.size(); ++i)
+      local_data[_local_indices[i]] += _local_buffer[i];
+  }
+
+  /// Number of owned entries sent to (forward) or received from
+  /// (reverse) other ranks
+  std::size_t local_buffer_size() const { return _local_buffer.size(); }
+
+  /// Number of ghost entries received (forward) or sent (reverse)
+  std::size_t remote_buffer_size() const { return _remote_buffer.size(); }
+
+  /// Number of neighbour ranks that this rank sends to in a forward
+  /// scatter
+  std::size_t num_destinations() const { return _dest.size(); }
+
+private:
+  // Offsets of consecutive blocks of the given sizes
+  static std::vector<int> offsets(const std::vector<int>& sizes)
+  {
+    std::vector<int> displs(sizes.size() + 1, 0);
+    std::partial_sum(sizes.begin(), sizes.end(), std::next(displs.begin()));
+    return displs;
+  }
+
+  void create_requests()
+  {
+    MPI_Datatype type = dolfinx::MPI::mpi_type<T>();
+#if MPI_VERSION >= 4
+    _requests_fwd.resize(1);
+    MPI_Neighbor_alltoallv_init(
+        _local_buffer.data(), _sizes_local.data(), _displs_local.data(), type,
+        _remote_buffer.data(), _sizes_remote.data(), _displs_remote.data(),
+        type, _comm_fwd, MPI_INFO_NULL, &_requests_fwd[0]);
+    _requests_rev.resize(1);
+    MPI_Neighbor_alltoallv_init(
+        _remote_buffer.data(), _sizes_remote.data(), _displs_remote.data(),
+        type, _local_buffer.data(), _sizes_local.data(), _displs_local.data(),
+        type, _comm_rev, MPI_INFO_NULL, &_requests_rev[0]);
+#else
+    // The dist graph communicators keep the rank numbering of the
+    // parent (no reordering), so the neighbour ranks can be used for
+    // point-to-point communication on them
+    const int nd = _dest.size(), ns = _src.size();
+    _requests_fwd.resize(nd + ns);
+    _requests_rev.resize(nd + ns);
+    for (int i = 0; i < ns; ++i)
+    {
+      MPI_Recv_init(_remote_buffer.data() + _displs_remote[i],
+                    _sizes_remote[i], type, _src[i], 0, _comm_fwd,
+                    &_requests_fwd[i]);
+      MPI_Send_init(_remote_buffer.data() + _displs_remote[i],
+                    _sizes_remote[i], type, _src[i], 0, _comm_rev,
+                    &_requests_rev[i]);
+    }
+    for (int i = 0; i < nd; ++i)
+    {
+      MPI_Send_init(_local_buffer.data() + _displs_local[i], _sizes_local[i],
+                    type, _dest[i], 0, _comm_fwd, &_requests_fwd[ns + i]);
+      MPI_Recv_init(_local_buffer.data() + _displs_local[i], _sizes_local[i],
+                    type, _dest[i], 0, _comm_rev, &_requests_rev[ns + i]);
+    }
+#endif
+  }
+
+  // Neighbour ranks: owners of the ghosts (src) and ranks that ghost
+  // owned indices (dest), sorted
+  std::vector<int> _src, _dest;
+
+  // Neighbourhood communicators for the forward and reverse scatters
+  MPI_Comm _comm_fwd = MPI_COMM_NULL, _comm_rev = MPI_COMM_NULL;
+
+  // Owned entries to send in a forward scatter, grouped by
+  // destination, and their sizes and offsets
+  std::vector<std::int32_t> _local_indices;
+  std::vector<int> _sizes_local, _displs_local;
+
+  // Ghost entries (relative to the first ghost) received in a forward
+  // scatter, grouped by owner, and their sizes and offsets
+  std::vector<std::int32_t> _remote_indices;
+  std::vector<int> _sizes_remote, _displs_remote;
+
+  // Communication buffers. The persistent requests refer to these, so
+  // they are not resized after the requests are created.
+  std::vector<T> _local_buffer, _remote_buffer;
+
+  std::vector<MPI_Request> _requests_fwd, _requests_rev;
+};
+} // namespace halo
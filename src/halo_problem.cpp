@@ -0,0 +1,220 @@
+// Copyright (C) 2026 The FEniCS Project
+//
+// This file is part of FEniCS-miniapp (https://www.fenicsproject.org)
+//
+// SPDX-License-Identifier:    MIT
+
+#include "halo_problem.h"
+#include "halo.h"
+#include "metrics.h"
+#include "phase.h"
+#include "reorder.h"
+#include <algorithm>
+#include <array>
+#include <basix/finite-element.h>
+#include <cmath>
+#include <dolfinx/common/MPI.h>
+#include <dolfinx/common/Scatterer.h>
+#include <dolfinx/fem/FiniteElement.h>
+#include <dolfinx/fem/Function.h>
+#include <dolfinx/fem/FunctionSpace.h>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <petscsys.h>
+#include <stdexcept>
+#include <utility>
+
+using namespace dolfinx;
+using T = PetscScalar;
+
+namespace
+{
+/// Print a histogram of positive values with bins of a factor of two
+void print_histogram(const std::string& name, const std::string& unit,
+                     std::vector<double> values)
+{
+  std::ranges::sort(values);
+  const int k0 = std::floor(std::log2(values.front()));
+  const int k1 = std::floor(std::log2(values.back()));
+  std::vector<std::size_t> counts(k1 - k0 + 1, 0);
+  for (double v : values)
+    counts[std::clamp<int>(std::floor(std::log2(v)) - k0, 0, k1 - k0)] += 1;
+
+  std::cout << name << " (" << unit << "): min " << values.front()
+            << ", median " << values[values.size() / 2] << ", max "
+            << values.back() << std::endl;
+  constexpr int max_width = 50;
+  const std::size_t max_count = *std::ranges::max_element(counts);
+  for (int k = k0; k <= k1; ++k)
+  {
+    const std::size_t n = counts[k - k0];
+    std::cout << "  [" << std::setw(10) << std::ldexp(1.0, k) << ", "
+              << std::setw(10) << std::ldexp(1.0, k + 1) << ") "
+              << std::setw(8) << n << " "
+              << std::string(max_width * n / max_count, '#') << std::endl;
+  }
+}
+
+/// Time forward and reverse scatters of x, one at a time. The time of
+/// each scatter is the maximum over processes.
+/// @return Times (seconds) of the forward and reverse scatters
+template <typename Exchange>
+std::pair<std::vector<double>, std::vector<double>>
+time_scatters(Exchange& ex, la::Vector<T>& x, int num_exchanges)
+{
+  MPI_Comm comm = x.index_map()->comm();
+  const std::int32_t local_size = x.bs() * x.index_map()->size_local();
+  std::span<T> local_data = x.mutable_array().first(local_size);
+  std::span<T> remote_data = x.mutable_array().subspan(local_size);
+
+  std::vector<double> t_fwd(num_exchanges), t_rev(num_exchanges);
+  for (int i = 0; i < num_exchanges; ++i)
+  {
+    MPI_Barrier(comm);
+    double t0 = MPI_Wtime();
+    ex.scatter_fwd_begin(local_data);
+    ex.scatter_fwd_end(remote_data);
+    t_fwd[i] = MPI_Wtime() - t0;
+
+    MPI_Barrier(comm);
+    t0 = MPI_Wtime();
+    ex.scatter_rev_begin(remote_data);
+    ex.scatter_rev_end(local_data);
+    t_rev[i] = MPI_Wtime() - t0;
+  }
+
+  MPI_Allreduce(MPI_IN_PLACE, t_fwd.data(), t_fwd.size(), MPI_DOUBLE, MPI_MAX,
+                comm);
+  MPI_Allreduce(MPI_IN_PLACE, t_rev.data(), t_rev.size(), MPI_DOUBLE, MPI_MAX,
+                comm);
+  return {std::move(t_fwd), std::move(t_rev)};
+}
+
+/// Report the latency and bandwidth distributions of a scatter, given
+/// the time of each scatter and the (global) number of bytes moved.
+/// There is no bandwidth without ghosts (e.g. on one process).
+void report(const std::string& name, const std::string& key,
+            std::vector<double> times, double bytes)
+{
+  // Times are bounded below by the timer resolution
+  const double tmin = MPI_Wtick();
+  std::ranges::transform(times, times.begin(),
+                         [tmin](double t) { return std::max(t, tmin); });
+  std::ranges::sort(times);
+
+  std::vector<double> latency(times.size());
+  std::ranges::transform(times, latency.begin(),
+                         [](double t) { return 1e6 * t; });
+  print_histogram(name + " latency", "us", latency);
+  metrics::record(key + "_latency_min", latency.front());
+  metrics::record(key + "_latency_median", latency[latency.size() / 2]);
+  metrics::record(key + "_latency_max", latency.back());
+
+  if (bytes > 0)
+  {
+    std::vector<double> bandwidth(times.size());
+    std::ranges::transform(times, bandwidth.begin(),
+                           [bytes](double t) { return bytes / t / 1e9; });
+    print_histogram(name + " bandwidth", "GB/s", bandwidth);
+    metrics::record(key + "_bandwidth_median",
+                    bytes / times[times.size() / 2] / 1e9);
+  }
+}
+} // namespace
+
+std::tuple<std::shared_ptr<la::Vector<T>>, std::shared_ptr<fem::Function<T>>,
+           std::function<int(fem::Function<T>&, const la::Vector<T>&)>>
+halo::problem(std::shared_ptr<mesh::Mesh<double>> mesh, int order,
+              std::string dof_ordering, std::string scatterer,
+              int num_exchanges)
+{
+  if (scatterer != "neighbor" and scatterer != "p2p"
+      and scatterer != "persistent")
+  {
+    throw std::runtime_error("Unknown scatterer: " + scatterer);
+  }
+  if (num_exchanges < 1)
+    throw std::runtime_error("Number of halo exchanges must be at least 1");
+
+  Phase t0("ZZZ FunctionSpace");
+
+  auto element = basix::create_element<double>(
+      basix::element::family::P, basix::cell::type::tetrahedron, order,
+      basix::element::lagrange_variant::gll_warped,
+      basix::element::dpc_variant::unset, false);
+
+  auto dolfinx_element
+      = std::make_shared<const fem::FiniteElement<double>>(element);
+
+  auto V = std::make_shared<fem::FunctionSpace<double>>(
+      reorder::create_functionspace(mesh, dolfinx_element, dof_ordering));
+
+  t0.stop();
+
+  auto idx_map = V->dofmap()->index_map;
+  const int bs = V->dofmap()->index_map_bs();
+  la::Vector<T> b(idx_map, bs);
+  b.set(0);
+  auto u = std::make_shared<fem::Function<T>>(V);
+
+  // Size of the halo: ghost entries and neighbours per process
+  MPI_Comm comm = idx_map->comm();
+  const int size = dolfinx::MPI::size(comm);
+  std::array<std::int64_t, 2> local
+      = {bs * idx_map->num_ghosts(),
+         static_cast<std::int64_t>(idx_map->dest().size())};
+  std::array<std::int64_t, 2> sum, max;
+  MPI_Allreduce(local.data(), sum.data(), 2, MPI_INT64_T, MPI_SUM, comm);
+  MPI_Allreduce(local.data(), max.data(), 2, MPI_INT64_T, MPI_MAX, comm);
+  const double bytes = sum[0] * sizeof(T);
+  if (dolfinx::MPI::rank(comm) == 0)
+  {
+    std::cout << "Halo: ghost entries per process: mean " << sum[0] / size
+              << ", max " << max[0] << "; neighbours per process: mean "
+              << static_cast<double>(sum[1]) / size << ", max " << max[1]
+              << std::endl;
+  }
+  metrics::record("halo_bytes", bytes);
+  metrics::record("halo_neighbours_max", max[1]);
+
+  std::function<int(fem::Function<T>&, const la::Vector<T>&)> solver_function
+      = [scatterer, num_exchanges, bytes](fem::Function<T>& u,
+                                          const la::Vector<T>&)
+  {
+    la::Vector<T>& x = *u.x();
+    auto idx_map = x.index_map();
+
+    std::vector<double> t_fwd, t_rev;
+    if (scatterer == "persistent")
+    {
+      halo::PersistentScatterer<T> ex(*idx_map, x.bs());
+      std::tie(t_fwd, t_rev) = time_scatters(ex, x, num_exchanges);
+    }
+    else
+    {
+      common::Scatterer sct(*idx_map, x.bs());
+      common::Scatterer<>::type type = common::Scatterer<>::type::neighbor;
+      if (scatterer == "p2p")
+        type = common::Scatterer<>::type::p2p;
+      std::vector<MPI_Request> request = sct.create_request_vector(type);
+      halo::ScattererExchange<T> ex{
+          sct, type, request, std::vector<T>(sct.local_buffer_size(), 0),
+          std::vector<T>(sct.remote_buffer_size(), 0)};
+      std::tie(t_fwd, t_rev) = time_scatters(ex, x, num_exchanges);
+    }
+
+    if (dolfinx::MPI::rank(idx_map->comm()) == 0)
+    {
+      std::cout << "Halo exchange (" << scatterer << "): " << num_exchanges
+                << " forward and reverse scatters of " << bytes / 1e6
+                << " MB" << std::endl;
+      report("Forward scatter", "halo_fwd", t_fwd, bytes);
+      report("Reverse scatter", "halo_rev", t_rev, bytes);
+    }
+
+    return num_exchanges;
+  };
+
+  return {std::make_shared<la::Vector<T>>(std::move(b)), u, solver_function};
+}
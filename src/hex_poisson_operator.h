@@ -0,0 +1,453 @@
+// Copyright (C) 2026 The FEniCS Project
+//
+// This file is part of FEniCS-miniapp (https://www.fenicsproject.org)
+//
+// SPDX-License-Identifier:    MIT
+
+#pragma once
+
+#include "geometry.h"
+#include <algorithm>
+#include <array>
+#include <basix/finite-element.h>
+#include <basix/quadrature.h>
+#include <cmath>
+#include <concepts>
+#include <cstdint>
+#include <dolfinx/fem/DofMap.h>
+#include <dolfinx/fem/FunctionSpace.h>
+#include <dolfinx/mesh/Geometry.h>
+#include <dolfinx/mesh/Mesh.h>
+#include <dolfinx/mesh/Topology.h>
+#include <numeric>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace matfree
+{
+/// Matrix-free action of the Laplace operator (grad u, grad v) on
+/// hexahedral meshes, using sum factorisation.
+///
+/// The element is the tensor product of 1D Lagrange elements of order
+/// p, and the quadrature is the tensor product of (p + 2)-point 1D
+/// Gauss rules, so that the action costs O(p^4) per cell rather than
+/// the O(p^6) of a dense element matrix. Cell dofs are stored in
+/// lexicographic (tensor-product) order. For parallelepiped cells the
+/// geometric factor G = |det J| K K^T (K = J^{-1}) is constant and one
+/// is cached per cell; otherwise G is cached, scaled by the quadrature
+/// weight, at every quadrature point. Owned cells are split into
+/// boundary and interior cells in the same way as for PoissonOperator.
+/// @tparam T Scalar type of the cached data and of the kernel arithmetic
+template <std::floating_point T>
+class HexPoissonOperator
+{
+public:
+  /// Create operator
+  /// @param[in] V Scalar Lagrange function space on a hexahedral mesh
+  /// with trilinear geometry
+  /// @param[in] element The basix element used to create `V`
+  /// @param[in] order Polynomial order of `element`
+  HexPoissonOperator(const dolfinx::fem::FunctionSpace<double>& V,
+                     const basix::FiniteElement<double>& element, int order)
+      : _n(order + 1), _nq(order + 2)
+  {
+    auto mesh = V.mesh();
+    const int tdim = mesh->topology()->dim();
+    const std::int32_t num_cells
+        = mesh->topology()->index_map(tdim)->size_local();
+    const int n = _n;
+    const int nq = _nq;
+    const int nd = n * n * n;
+
+    // 1D nodes: the distinct x-coordinates of the interpolation points
+    const auto& [pts, pshape] = element.points();
+    if (static_cast<int>(pshape[0]) != nd)
+      throw std::runtime_error("Element is not a tensor-product element");
+    std::vector<double> nodes;
+    for (std::size_t i = 0; i < pshape[0]; ++i)
+      nodes.push_back(pts[3 * i]);
+    std::ranges::sort(nodes);
+    auto last = std::unique(nodes.begin(), nodes.end(), [](auto a, auto b)
+                            { return std::abs(a - b) < 1e-10; });
+    nodes.erase(last, nodes.end());
+    if (static_cast<int>(nodes.size()) != n)
+      throw std::runtime_error("Element is not a tensor-product element");
+
+    // Position in the element of each lexicographic dof
+    auto index = [&nodes](double x)
+    {
+      auto it = std::ranges::min_element(
+          nodes, [x](auto a, auto b) { return std::abs(a - x) < std::abs(b - x); });
+      return static_cast<int>(std::distance(nodes.begin(), it));
+    };
+    std::vector<int> perm(nd);
+    for (int i = 0; i < nd; ++i)
+    {
+      const double* p = pts.data() + 3 * i;
+      perm[index(p[0]) + n * (index(p[1]) + n * index(p[2]))] = i;
+    }
+
+    // 1D Gauss quadrature and 1D basis functions (B) and derivatives (D)
+    // at the quadrature points, stored as [nq][n]
+    auto [qpts, qwts] = basix::quadrature::make_quadrature<double>(
+        basix::quadrature::type::gauss_jacobi, basix::cell::type::interval,
+        basix::polyset::type::standard, 2 * nq - 1);
+    if (static_cast<int>(qwts.size()) != nq)
+      throw std::runtime_error("Unexpected number of quadrature points");
+    _B.resize(nq * n);
+    _D.resize(nq * n);
+    for (int q = 0; q < nq; ++q)
+    {
+      const double x = qpts[q];
+      for (int i = 0; i < n; ++i)
+      {
+        double l = 1, dl = 0;
+        for (int m = 0; m < n; ++m)
+        {
+          if (m == i)
+            continue;
+          double dp = 1 / (nodes[i] - nodes[m]);
+          for (int k = 0; k < n; ++k)
+          {
+            if (k != i and k != m)
+              dp *= (x - nodes[k]) / (nodes[i] - nodes[k]);
+          }
+          dl += dp;
+          l *= (x - nodes[m]) / (nodes[i] - nodes[m]);
+        }
+        _B[q * n + i] = l;
+        _D[q * n + i] = dl;
+      }
+    }
+
+    // 3D quadrature weights, x fastest
+    std::vector<double> w(nq * nq * nq);
+    for (int k = 0; k < nq; ++k)
+      for (int j = 0; j < nq; ++j)
+        for (int i = 0; i < nq; ++i)
+          w[i + nq * (j + nq * k)] = qwts[i] * qwts[j] * qwts[k];
+    _weights.assign(w.begin(), w.end());
+
+    // Copy cell dofs of owned cells, in lexicographic order
+    auto dofmap = V.dofmap()->map();
+    if (static_cast<int>(dofmap.extent(1)) != nd)
+      throw std::runtime_error("Dofmap and element size do not match");
+    _dofs.resize(num_cells * nd);
+    for (std::int32_t c = 0; c < num_cells; ++c)
+      for (int i = 0; i < nd; ++i)
+        _dofs[c * nd + i] = dofmap(c, perm[i]);
+
+    // Geometry: trilinear cells, nodes in tensor-product order
+    auto x_dofmap = mesh->geometry().dofmap();
+    if (x_dofmap.extent(1) != 8)
+      throw std::runtime_error("Hexahedral operator requires trilinear cells");
+    std::span<const double> x = mesh->geometry().x();
+
+    // Cells are parallelepipeds if x_v = x_0 + sum of edge vectors
+    _affine = true;
+    for (std::int32_t c = 0; c < num_cells and _affine; ++c)
+    {
+      const std::int32_t* v = x_dofmap.data_handle() + 8 * c;
+      auto X = [&x, v](int a, int i) { return x[3 * v[a] + i]; };
+      for (int i = 0; i < 3; ++i)
+      {
+        const double h = std::abs(X(1, i) - X(0, i))
+                         + std::abs(X(2, i) - X(0, i))
+                         + std::abs(X(4, i) - X(0, i));
+        const double e = std::abs(X(3, i) - X(1, i) - X(2, i) + X(0, i))
+                         + std::abs(X(5, i) - X(1, i) - X(4, i) + X(0, i))
+                         + std::abs(X(6, i) - X(2, i) - X(4, i) + X(0, i))
+                         + std::abs(X(7, i) - X(3, i) - X(4, i) + X(0, i));
+        if (e > 1e-12 * h)
+          _affine = false;
+      }
+    }
+
+    // Geometric factor at a reference point (upper triangle: 00, 01,
+    // 02, 11, 12, 22)
+    auto factor = [&x, &x_dofmap](std::int32_t c, std::array<double, 3> X,
+                                  double scale, T* G)
+    {
+      const std::int32_t* v = x_dofmap.data_handle() + 8 * c;
+      std::array<double, 9> J = {};
+      for (int node = 0; node < 8; ++node)
+      {
+        const std::array<int, 3> b = {node & 1, (node >> 1) & 1, node >> 2};
+        std::array<double, 3> phi, dphi;
+        for (int a = 0; a < 3; ++a)
+        {
+          phi[a] = b[a] ? X[a] : 1 - X[a];
+          dphi[a] = b[a] ? 1 : -1;
+        }
+        const std::array<double, 3> dN = {dphi[0] * phi[1] * phi[2],
+                                          phi[0] * dphi[1] * phi[2],
+                                          phi[0] * phi[1] * dphi[2]};
+        for (int i = 0; i < 3; ++i)
+          for (int a = 0; a < 3; ++a)
+            J[3 * i + a] += x[3 * v[node] + i] * dN[a];
+      }
+
+      auto [K, detJ] = jacobian_inverse(J);
+      int m = 0;
+      for (int a = 0; a < 3; ++a)
+      {
+        for (int b = a; b < 3; ++b)
+        {
+          double g = 0;
+          for (int i = 0; i < 3; ++i)
+            g += K[3 * a + i] * K[3 * b + i];
+          G[m++] = scale * std::abs(detJ) * g;
+        }
+      }
+    };
+
+    if (_affine)
+    {
+      _G.resize(6 * num_cells);
+      for (std::int32_t c = 0; c < num_cells; ++c)
+        factor(c, {0.5, 0.5, 0.5}, 1.0, _G.data() + 6 * c);
+    }
+    else
+    {
+      const int nq3 = nq * nq * nq;
+      _G.resize(6 * nq3 * num_cells);
+      for (std::int32_t c = 0; c < num_cells; ++c)
+        for (int k = 0; k < nq; ++k)
+          for (int j = 0; j < nq; ++j)
+            for (int i = 0; i < nq; ++i)
+            {
+              const int q = i + nq * (j + nq * k);
+              factor(c, {qpts[i], qpts[j], qpts[k]}, w[q],
+                     _G.data() + 6 * (nq3 * c + q));
+            }
+    }
+
+    _cells.resize(num_cells);
+    std::iota(_cells.begin(), _cells.end(), 0);
+
+    // Split cells into those that touch ghost dofs and those that do not
+    const std::int32_t local_size = V.dofmap()->index_map->size_local();
+    for (std::int32_t c = 0; c < num_cells; ++c)
+    {
+      auto dofs = std::span(_dofs.data() + c * nd, nd);
+      if (std::ranges::any_of(dofs, [local_size](auto d)
+                              { return d >= local_size; }))
+      {
+        _boundary_cells.push_back(c);
+      }
+      else
+        _interior_cells.push_back(c);
+    }
+  }
+
+  /// Compute y += A x over all owned cells
+  /// @param[in] x Input array, including up-to-date ghost entries
+  /// @param[in,out] y Output array (contributions are added)
+  void apply(std::span<const T> x, std::span<T> y) const
+  {
+    apply(x, y, _cells);
+  }
+
+  /// Compute y += A x restricted to a list of cells
+  /// @param[in] x Input array, including up-to-date ghost entries
+  /// @param[in,out] y Output array (contributions are added)
+  /// @param[in] cells Local indices of the cells to compute
+  void apply(std::span<const T> x, std::span<T> y,
+             std::span<const std::int32_t> cells) const
+  {
+    const int n = _n;
+    const int nq = _nq;
+    const int nd = n * n * n;
+    const int nq3 = nq * nq * nq;
+    const T* B = _B.data();
+    const T* D = _D.data();
+
+    // Work arrays, indexed with x fastest. Sizes: [n][n][nq] after the
+    // x-sweep, [n][nq][nq] after the y-sweep and [nq][nq][nq] at the
+    // quadrature points.
+    std::vector<T> xe(nd), ye(nd);
+    std::vector<T> tB(nq * n * n), tD(nq * n * n);
+    std::vector<T> tBB(nq * nq * n), tBD(nq * nq * n), tDB(nq * nq * n);
+    std::vector<T> g0(nq3), g1(nq3), g2(nq3);
+    for (std::int32_t c : cells)
+    {
+      const std::int32_t* dofs = _dofs.data() + c * nd;
+      for (int i = 0; i < nd; ++i)
+        xe[i] = x[dofs[i]];
+
+      // Reference gradient at the quadrature points:
+      // g0 = (B x B x D) u, g1 = (B x D x B) u, g2 = (D x B x B) u
+      for (int jk = 0; jk < n * n; ++jk)
+      {
+        for (int qx = 0; qx < nq; ++qx)
+        {
+          T b = 0, d = 0;
+          for (int i = 0; i < n; ++i)
+          {
+            b += B[qx * n + i] * xe[i + n * jk];
+            d += D[qx * n + i] * xe[i + n * jk];
+          }
+          tB[qx + nq * jk] = b;
+          tD[qx + nq * jk] = d;
+        }
+      }
+      for (int k = 0; k < n; ++k)
+      {
+        for (int qy = 0; qy < nq; ++qy)
+        {
+          for (int qx = 0; qx < nq; ++qx)
+          {
+            T bb = 0, bd = 0, db = 0;
+            for (int j = 0; j < n; ++j)
+            {
+              const int s = qx + nq * (j + n * k);
+              bb += B[qy * n + j] * tB[s];
+              bd += D[qy * n + j] * tB[s];
+              db += B[qy * n + j] * tD[s];
+            }
+            const int t = qx + nq * (qy + nq * k);
+            tBB[t] = bb;
+            tBD[t] = bd;
+            tDB[t] = db;
+          }
+        }
+      }
+      for (int qz = 0; qz < nq; ++qz)
+      {
+        for (int qxy = 0; qxy < nq * nq; ++qxy)
+        {
+          T d0 = 0, d1 = 0, d2 = 0;
+          for (int k = 0; k < n; ++k)
+          {
+            const int t = qxy + nq * nq * k;
+            d0 += B[qz * n + k] * tDB[t];
+            d1 += B[qz * n + k] * tBD[t];
+            d2 += D[qz * n + k] * tBB[t];
+          }
+          g0[qxy + nq * nq * qz] = d0;
+          g1[qxy + nq * nq * qz] = d1;
+          g2[qxy + nq * nq * qz] = d2;
+        }
+      }
+
+      // Apply geometric factor and quadrature weight
+      for (int q = 0; q < nq3; ++q)
+      {
+        const T* G = _affine ? _G.data() + 6 * c : _G.data() + 6 * (nq3 * c + q);
+        const T w = _affine ? _weights[q] : 1;
+        const T f0 = w * (G[0] * g0[q] + G[1] * g1[q] + G[2] * g2[q]);
+        const T f1 = w * (G[1] * g0[q] + G[3] * g1[q] + G[4] * g2[q]);
+        const T f2 = w * (G[2] * g0[q] + G[4] * g1[q] + G[5] * g2[q]);
+        g0[q] = f0;
+        g1[q] = f1;
+        g2[q] = f2;
+      }
+
+      // Apply the transposed interpolation:
+      // ye = (B x B x D)^T f0 + (B x D x B)^T f1 + (D x B x B)^T f2
+      for (int k = 0; k < n; ++k)
+      {
+        for (int qxy = 0; qxy < nq * nq; ++qxy)
+        {
+          T s0 = 0, s1 = 0, s2 = 0;
+          for (int qz = 0; qz < nq; ++qz)
+          {
+            const int q = qxy + nq * nq * qz;
+            s0 += B[qz * n + k] * g0[q];
+            s1 += B[qz * n + k] * g1[q];
+            s2 += D[qz * n + k] * g2[q];
+          }
+          const int t = qxy + nq * nq * k;
+          tDB[t] = s0;
+          tBD[t] = s1;
+          tBB[t] = s2;
+        }
+      }
+      for (int k = 0; k < n; ++k)
+      {
+        for (int j = 0; j < n; ++j)
+        {
+          for (int qx = 0; qx < nq; ++qx)
+          {
+            T d = 0, b = 0;
+            for (int qy = 0; qy < nq; ++qy)
+            {
+              const int t = qx + nq * (qy + nq * k);
+              d += B[qy * n + j] * tDB[t];
+              b += D[qy * n + j] * tBD[t] + B[qy * n + j] * tBB[t];
+            }
+            const int s = qx + nq * (j + n * k);
+            tD[s] = d;
+            tB[s] = b;
+          }
+        }
+      }
+      for (int jk = 0; jk < n * n; ++jk)
+      {
+        for (int i = 0; i < n; ++i)
+        {
+          T v = 0;
+          for (int qx = 0; qx < nq; ++qx)
+          {
+            v += D[qx * n + i] * tD[qx + nq * jk]
+                 + B[qx * n + i] * tB[qx + nq * jk];
+          }
+          ye[i + n * jk] = v;
+        }
+      }
+
+      for (int i = 0; i < nd; ++i)
+        y[dofs[i]] += ye[i];
+    }
+  }
+
+  /// Local indices of the cells the operator is computed over
+  std::span<const std::int32_t> cells() const { return _cells; }
+
+  /// Local indices of owned cells that have at least one ghost dof
+  std::span<const std::int32_t> boundary_cells() const
+  {
+    return _boundary_cells;
+  }
+
+  /// Local indices of owned cells that have only owned dofs
+  std::span<const std::int32_t> interior_cells() const
+  {
+    return _interior_cells;
+  }
+
+  /// Number of dofs per cell
+  int num_cell_dofs() const { return _n * _n * _n; }
+
+  /// Bytes of cached data (geometry, dofmap and basis tables)
+  std::size_t bytes() const
+  {
+    return sizeof(T) * (_G.size() + _B.size() + _D.size() + _weights.size())
+           + sizeof(std::int32_t)
+                 * (_dofs.size() + _cells.size() + _boundary_cells.size()
+                    + _interior_cells.size());
+  }
+
+private:
+  // Number of 1D dofs and 1D quadrature points
+  int _n, _nq;
+
+  // Whether all cells are parallelepipeds
+  bool _affine;
+
+  // 1D basis functions and derivatives at the quadrature points
+  // [nq][n], and 3D quadrature weights
+  std::vector<T> _B, _D, _weights;
+
+  // Geometric factor, 6 entries per cell (affine) or per cell and
+  // quadrature point (scaled by the quadrature weight)
+  std::vector<T> _G;
+
+  // Cell dofs [num_cells][n^3], in lexicographic order
+  std::vector<std::int32_t> _dofs;
+
+  // Owned cells, and owned cells split by whether they touch ghost dofs
+  std::vector<std::int32_t> _cells, _boundary_cells, _interior_cells;
+};
+} // namespace matfree
@@ -4,12 +4,28 @@
 //
 // SPDX-License-Identifier:    MIT
 
+#include "cgelasticity_problem.h"
 #include "cgpoisson_problem.h"
+#include "counters.h"
+#include "csrpoisson_problem.h"
 #include "elasticity_problem.h"
+#ifdef HAS_GPU
+#include "gpupoisson_problem.h"
+#endif
+#include "halo_problem.h"
 #include "mem.h"
+#include "metrics.h"
 #include "mesh.h"
+#include "phase.h"
+#include "output.h"
+#include "partition.h"
 #include "poisson_problem.h"
+#include "reorder.h"
+#include "topology.h"
+#include <algorithm>
+#include <array>
 #include <boost/program_options.hpp>
+#include <chrono>
 #include <dolfinx/common/Timer.h>
 #include <dolfinx/common/log.h>
 #include <dolfinx/common/timing.h>
@@ -18,13 +34,16 @@
 #include <dolfinx/fem/Function.h>
 #include <dolfinx/fem/FunctionSpace.h>
 #include <dolfinx/fem/utils.h>
-#include <dolfinx/io/XDMFFile.h>
 #include <dolfinx/la/Vector.h>
+#include <filesystem>
+#include <future>
 #include <iomanip>
+#include <omp.h>
 #include <petscsys.h>
 #include <string>
 #include <thread>
 #include <utility>
+#include <vector>
 
 namespace po = boost::program_options;
 
@@ -49,61 +68,146 @@ std::string int64_to_human(std::int64_t n)
   return s.str();
 }
 
-void solve(int argc, char* argv[])
+/// Summary of a run, for the scaling table of a sweep
+struct RunResult
 {
-  po::options_description desc("Allowed options");
-  bool mem_profile;
-  bool use_subcomm;
-  desc.add_options()("help,h", "print usage message")(
-      "problem_type", po::value<std::string>()->default_value("poisson"),
-      "problem (poisson, cgpoisson, or elasticity)")(
-      "mesh_type", po::value<std::string>()->default_value("cube"),
-      "mesh (cube or unstructured)")(
-      "memory_profiling", po::bool_switch(&mem_profile)->default_value(false),
-      "turn on memory logging")(
-      "subcomm_partition", po::bool_switch(&use_subcomm)->default_value(false),
-      "Use sub-communicator for partitioning")(
-      "scaling_type", po::value<std::string>()->default_value("weak"),
-      "scaling (weak or strong)")(
-      "output", po::value<std::string>()->default_value(""),
-      "output directory (no output unless this is set)")(
-      "ndofs", po::value<std::size_t>()->default_value(50000),
-      "number of degrees of freedom")(
-      "order", po::value<std::size_t>()->default_value(1), "polynomial order")(
-      "scatterer", po::value<std::string>()->default_value("neighbor"),
-      "scatterer for CG (neighbor or p2p)");
+  std::size_t num_processes;
+  std::size_t ndofs;
+  std::int64_t num_dofs;
+  int num_iter;
+  double solve_time;
+};
 
-  po::variables_map vm;
-  po::store(po::command_line_parser(argc, argv)
-                .options(desc)
-                .allow_unregistered()
-                .run(),
-            vm);
-  po::notify(vm);
+/// Wait until all processes of a communicator have arrived. The wait
+/// sleeps instead of polling MPI continuously, so that processes parked
+/// during a sweep take no cycles from the processes that are running.
+/// @param[in] comm Communicator
+void park(MPI_Comm comm)
+{
+  MPI_Request request;
+  MPI_Ibarrier(comm, &request);
+  int done = 0;
+  MPI_Test(&request, &done, MPI_STATUS_IGNORE);
+  while (!done)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    MPI_Test(&request, &done, MPI_STATUS_IGNORE);
+  }
+}
 
-  if (vm.count("help"))
+/// Print the scaling table of a sweep, with the parallel efficiency of
+/// each run relative to the run with the fewest processes and the same
+/// ndofs
+/// @param[in] results Runs of the sweep
+/// @param[in] strong_scaling True for strong scaling (fixed total
+/// size), false for weak scaling (fixed size per process)
+void print_scaling_table(const std::vector<RunResult>& results,
+                         bool strong_scaling)
+{
+  std::cout
+      << "----------------------------------------------------------------"
+      << std::endl;
+  std::cout << "Scaling sweep (" << (strong_scaling ? "strong" : "weak")
+            << " scaling, median solve time)" << std::endl;
+  std::cout << std::setw(8) << "Procs" << std::setw(14) << "Total dofs"
+            << std::setw(12) << "Dofs/proc" << std::setw(8) << "Iters"
+            << std::setw(12) << "Solve (s)" << std::setw(12) << "Efficiency"
+            << std::endl;
+  for (const RunResult& r : results)
   {
-    std::cout << desc << std::endl;
-    ;
-    return;
+    auto base = std::ranges::find(results, r.ndofs, &RunResult::ndofs);
+    double efficiency = base->solve_time / r.solve_time;
+    if (strong_scaling)
+      efficiency *= static_cast<double>(base->num_processes) / r.num_processes;
+    std::cout << std::setw(8) << r.num_processes << std::setw(14)
+              << r.num_dofs << std::setw(12) << r.num_dofs / r.num_processes
+              << std::setw(8) << r.num_iter << std::setw(12) << r.solve_time
+              << std::setw(12) << efficiency << std::endl;
   }
+  std::cout
+      << "----------------------------------------------------------------"
+      << std::endl;
+}
 
+/// Run the test on a communicator
+/// @param[in] comm Communicator of the processes that run the test
+/// @param[in] vm Program options
+/// @param[in] ndofs Number of dofs, total (strong scaling) or per
+/// process (weak scaling)
+/// @param[in] sweep True if the run is a point of a scaling sweep, in
+/// which case the timings table is not printed and the metrics are
+/// stored as a sweep point rather than written
+/// @return Summary of the run
+RunResult solve(MPI_Comm comm, const po::variables_map& vm,
+                std::size_t ndofs, bool sweep)
+{
   const std::string problem_type = vm["problem_type"].as<std::string>();
+  const bool mem_profile = vm["memory_profiling"].as<bool>();
+  const bool use_subcomm = vm["subcomm_partition"].as<bool>();
+  bool output_async = vm["output_async"].as<bool>();
+  const bool gpu_aware_mpi = vm["gpu_aware_mpi"].as<bool>();
   const std::string mesh_type = vm["mesh_type"].as<std::string>();
+  const std::string mesh_cache = vm["mesh_cache"].as<std::string>();
+  const bool lean_topology = vm["lean_topology"].as<bool>();
+  const std::string partitioner = vm["partitioner"].as<std::string>();
+  const std::string cell_type_name = vm["cell_type"].as<std::string>();
   const std::string scaling_type = vm["scaling_type"].as<std::string>();
-  const std::size_t ndofs = vm["ndofs"].as<std::size_t>();
+  const std::string dof_ordering = vm["reorder"].as<std::string>();
+  const std::string multigrid_type = vm["multigrid"].as<std::string>();
+  const std::string matrix_type = vm["matrix_type"].as<std::string>();
+  const std::string near_nullspace = vm["near_nullspace"].as<std::string>();
   const int order = vm["order"].as<std::size_t>();
   const std::string scatterer = vm["scatterer"].as<std::string>();
+  const int halo_exchanges = vm["halo_exchanges"].as<int>();
+  const std::string cg_variant = vm["cg_variant"].as<std::string>();
+  const std::string precision = vm["precision"].as<std::string>();
+  const std::string cg_preconditioner
+      = vm["cg_preconditioner"].as<std::string>();
+  const double rtol = vm["rtol"].as<double>();
+  const int max_it = vm["max_it"].as<int>();
+  // The PETSc solvers (poisson, elasticity) keep the KSP defaults for
+  // the tolerances that are not given
+  const bool ksp_solver
+      = problem_type == "poisson" or problem_type == "elasticity";
+  auto ksp_default = [&](const std::string& name)
+  { return ksp_solver and vm[name].defaulted(); };
+  const double ksp_rtol = ksp_default("rtol") ? PETSC_DEFAULT : rtol;
+  const int ksp_max_it = ksp_default("max_it") ? PETSC_DEFAULT : max_it;
+  const int num_rhs = vm["num_rhs"].as<int>();
+  const int num_reassemble = vm["reassemble"].as<int>();
+  const int num_matmult = vm["matmult"].as<int>();
+  const int num_threads = vm["threads"].as<int>();
+  const std::string assembly = vm["assembly"].as<std::string>();
+  const int batch_width = vm["batch_width"].as<int>();
   const std::string output_dir = vm["output"].as<std::string>();
-  const bool output = (output_dir.size() > 0);
-  const int mpi_rank = dolfinx::MPI::rank(MPI_COMM_WORLD);
+  const std::string output_format = vm["output_format"].as<std::string>();
+  const std::string metrics_file = vm["metrics_file"].as<std::string>();
+  const int num_repeat = vm["repeat"].as<int>();
+  const int num_warmup = vm["warmup"].as<int>();
+  const bool write_output = (output_dir.size() > 0);
+  const int mpi_rank = dolfinx::MPI::rank(comm);
 
-  bool quit_flag = false;
-  std::thread mem_thread;
+  if (mem_profile)
+  {
+    start_memory_profiler(
+        std::chrono::milliseconds(vm["memory_interval"].as<int>()));
+  }
+
+  // Hardware counters of the phases (if built with a counter library).
+  // In a sweep the regions would accumulate over the points.
+  if (!sweep)
+    counters::start();
 
-  if (mem_profile and mpi_rank == 0)
+  const std::vector<std::string> partitioners = graph_partitioners();
+  if (partitioner != "default"
+      and std::ranges::find(partitioners, partitioner) == partitioners.end())
   {
-    mem_thread = std::thread(process_mem_usage, std::ref(quit_flag));
+    std::string names;
+    for (auto& p : partitioners)
+      names += " " + p;
+    throw std::runtime_error("Graph partitioner '" + partitioner
+                             + "' is not available (available:" + names
+                             + ")");
   }
 
   bool strong_scaling;
@@ -114,63 +218,322 @@ void solve(int argc, char* argv[])
   else
     throw std::runtime_error("Scaling type '" + scaling_type + "` unknown");
 
+  dolfinx::mesh::CellType cell_type;
+  if (cell_type_name == "tetrahedron")
+    cell_type = dolfinx::mesh::CellType::tetrahedron;
+  else if (cell_type_name == "hexahedron")
+  {
+    cell_type = dolfinx::mesh::CellType::hexahedron;
+    if (problem_type != "cgpoisson" or mesh_type != "cube")
+    {
+      throw std::runtime_error(
+          "Hexahedral cells are only supported by cgpoisson on the cube mesh");
+    }
+  }
+  else
+    throw std::runtime_error("Unknown cell type: " + cell_type_name);
+
+  // Geometric multigrid needs the refinement hierarchy of the cube mesh
+  const bool gmg = multigrid_type == "gmg";
+  if (gmg)
+  {
+    if (problem_type != "poisson" and problem_type != "elasticity"
+        and problem_type != "cgpoisson")
+    {
+      throw std::runtime_error("Geometric multigrid is only supported by "
+                               "poisson, elasticity and cgpoisson");
+    }
+    if (mesh_type != "cube"
+        or cell_type != dolfinx::mesh::CellType::tetrahedron)
+    {
+      throw std::runtime_error(
+          "Geometric multigrid requires the tetrahedral cube mesh");
+    }
+    if (!mesh_cache.empty())
+      throw std::runtime_error("Mesh cache does not store mesh hierarchies");
+  }
+  else if (multigrid_type == "pmg")
+  {
+    // p-multigrid coarsens the degree on the same mesh
+    if (problem_type != "poisson" and problem_type != "elasticity"
+        and problem_type != "cgpoisson")
+    {
+      throw std::runtime_error("p-multigrid is only supported by poisson, "
+                               "elasticity and cgpoisson");
+    }
+    if (cell_type != dolfinx::mesh::CellType::tetrahedron)
+      throw std::runtime_error("p-multigrid requires a tetrahedral mesh");
+    if (order < 2)
+      throw std::runtime_error("p-multigrid requires order > 1");
+  }
+  else if (multigrid_type != "none")
+    throw std::runtime_error("Unknown multigrid type: " + multigrid_type);
+
+  if (matrix_type != "aij" and matrix_type != "baij"
+      and matrix_type != "sbaij")
+  {
+    throw std::runtime_error("Unknown matrix type: " + matrix_type);
+  }
+  if (matrix_type != "aij" and problem_type != "poisson"
+      and problem_type != "elasticity")
+  {
+    throw std::runtime_error(
+        "Matrix type is only supported by poisson and elasticity");
+  }
+
+  if (near_nullspace != "streamed" and near_nullspace != "reference")
+  {
+    throw std::runtime_error("Unknown near-nullspace construction: "
+                             + near_nullspace);
+  }
+  if (near_nullspace != "streamed" and problem_type != "elasticity")
+  {
+    throw std::runtime_error(
+        "Near-nullspace construction is only supported by elasticity");
+  }
+
+  if (num_threads < 1)
+    throw std::runtime_error("Number of threads must be at least 1");
+  if (num_matmult < 0)
+    throw std::runtime_error("Number of timed products must be nonnegative");
+  if (rtol <= 0 or max_it < 1)
+    throw std::runtime_error("Invalid solver tolerance or iteration limit");
+  if (num_rhs < 1)
+    throw std::runtime_error("Number of right-hand sides must be at least 1");
+  if (num_rhs > 1 and problem_type != "poisson"
+      and problem_type != "elasticity" and problem_type != "cgpoisson")
+  {
+    throw std::runtime_error("Multiple right-hand sides are only supported "
+                             "by poisson, elasticity and cgpoisson");
+  }
+  if (num_reassemble < 0)
+    throw std::runtime_error("Number of reassemblies must not be negative");
+  if (num_reassemble > 0 and problem_type != "poisson"
+      and problem_type != "elasticity")
+  {
+    throw std::runtime_error(
+        "Reassembly is only supported by poisson and elasticity");
+  }
+  if (cg_preconditioner != "none" and problem_type != "cgpoisson")
+  {
+    throw std::runtime_error(
+        "CG preconditioner is only supported by cgpoisson");
+  }
+  if (scatterer == "persistent")
+  {
+    if (problem_type != "cgpoisson" and problem_type != "halo")
+    {
+      throw std::runtime_error(
+          "Persistent scatterer is only supported by cgpoisson and halo");
+    }
+  }
+  else if (scatterer != "neighbor" and scatterer != "p2p")
+    throw std::runtime_error("Unknown scatterer: " + scatterer);
+  if (assembly == "batched")
+  {
+    if (problem_type != "poisson")
+      throw std::runtime_error("Batched assembly is only supported by poisson");
+    if (batch_width != 4 and batch_width != 8)
+      throw std::runtime_error("Batch width must be 4 or 8");
+  }
+  else if (assembly != "scalar")
+    throw std::runtime_error("Unknown assembly mode: " + assembly);
+  if (num_repeat < 1 or num_warmup < 0)
+    throw std::runtime_error("Invalid number of repeated/warmup solves");
+  omp_set_num_threads(num_threads);
+
   // Get number of processes
-  const std::size_t num_processes = dolfinx::MPI::size(MPI_COMM_WORLD);
+  const std::size_t num_processes = dolfinx::MPI::size(comm);
 
   // Assemble problem
   std::shared_ptr<dolfinx::mesh::Mesh<double>> mesh;
+  std::shared_ptr<MeshHierarchy> hierarchy;
   std::shared_ptr<dolfinx::la::Vector<PetscScalar>> b;
   std::shared_ptr<dolfinx::fem::Function<PetscScalar>> u;
   std::function<int(dolfinx::fem::Function<PetscScalar>&,
                     const dolfinx::la::Vector<PetscScalar>&)>
       solver_function;
 
-  const int ndofs_per_node = (problem_type == "elasticity") ? 3 : 1;
+  const int ndofs_per_node
+      = (problem_type == "elasticity" or problem_type == "cgelasticity") ? 3
+                                                                         : 1;
+
+  // The cache file name is a key on the mesh generation parameters and
+  // the number of processes
+  std::string cache_file;
+  bool cache_hit = false;
+  if (!mesh_cache.empty())
+  {
+    cache_file = mesh_cache + "/mesh_" + mesh_type + "_" + cell_type_name
+                 + "_" + scaling_type + "_n" + std::to_string(ndofs) + "_b"
+                 + std::to_string(ndofs_per_node) + "_p" + std::to_string(order)
+                 + "_" + partitioner
+                 + "_np" + std::to_string(num_processes)
+                 + (use_subcomm ? "_subcomm" : "") + ".bin";
+    int exists = mpi_rank == 0 ? std::filesystem::exists(cache_file) : 0;
+    MPI_Bcast(&exists, 1, MPI_INT, 0, comm);
+    cache_hit = exists;
+  }
 
-  dolfinx::common::Timer t0("ZZZ Create Mesh");
-  if (mesh_type == "cube")
+  if (cache_hit)
   {
+    Phase t0("ZZZ Load cached mesh");
+    if (mpi_rank == 0)
+      std::cout << "Reading cached mesh: " << cache_file << std::endl;
     mesh = std::make_shared<dolfinx::mesh::Mesh<double>>(
-        create_cube_mesh(MPI_COMM_WORLD, ndofs, strong_scaling, ndofs_per_node,
-                         order, use_subcomm));
+        read_mesh_cache(comm, cache_file));
   }
   else
   {
-    mesh = create_spoke_mesh(MPI_COMM_WORLD, ndofs, strong_scaling,
-                             ndofs_per_node);
+    Phase t0("ZZZ Create Mesh");
+    if (gmg)
+    {
+      hierarchy = std::make_shared<MeshHierarchy>(create_cube_mesh_hierarchy(
+          comm, ndofs, strong_scaling, ndofs_per_node, order,
+          use_subcomm, partitioner));
+      mesh = hierarchy->meshes.back();
+    }
+    else if (mesh_type == "cube")
+    {
+      mesh = std::make_shared<dolfinx::mesh::Mesh<double>>(
+          create_cube_mesh(comm, ndofs, strong_scaling,
+                           ndofs_per_node, order, use_subcomm, cell_type,
+                           partitioner));
+    }
+    else if (mesh_type == "cube_direct")
+    {
+      mesh = std::make_shared<dolfinx::mesh::Mesh<double>>(
+          create_cube_mesh_direct(comm, ndofs, strong_scaling,
+                                  ndofs_per_node, order));
+    }
+    else
+    {
+      mesh = create_spoke_mesh(comm, ndofs, strong_scaling,
+                               ndofs_per_node, partitioner);
+    }
+    t0.stop();
+
+    if (!cache_file.empty())
+    {
+      Phase t1("ZZZ Write mesh cache");
+      if (mpi_rank == 0)
+      {
+        std::filesystem::create_directories(mesh_cache);
+        std::cout << "Writing cached mesh: " << cache_file << std::endl;
+      }
+      MPI_Barrier(comm);
+      write_mesh_cache(*mesh, cache_file);
+    }
   }
-  t0.stop();
-  t0.flush();
 
-  dolfinx::common::Timer t_ent(
-      "ZZZ Create facets and facet->cell connectivity");
-  mesh->topology_mutable()->create_entities(2);
-  mesh->topology_mutable()->create_connectivity(2, 3);
-  t_ent.stop();
-  t_ent.flush();
+  // All mesh levels (the finest is the mesh of the problem)
+  std::vector<std::shared_ptr<dolfinx::mesh::Mesh<double>>> meshes
+      = {mesh};
+  if (hierarchy)
+    meshes = hierarchy->meshes;
+
+  // With a lean topology the facets are only created if a form has
+  // facet integrals, boundary dofs are located geometrically, and for
+  // P1 (no edge dofs) the edges left by refinement are dropped
+  std::size_t topology_reclaimed = 0;
+  if (lean_topology)
+  {
+    Phase t_ent("ZZZ Drop intermediate connectivity");
+    if (order == 1)
+    {
+      for (auto& m : meshes)
+      {
+        topology_reclaimed
+            += topology::drop_entities(*m->topology_mutable(), 1);
+      }
+    }
+  }
+  else
+  {
+    Phase t_ent("ZZZ Create facets and facet->cell connectivity");
+    for (auto& m : meshes)
+    {
+      m->topology_mutable()->create_entities(2);
+      m->topology_mutable()->create_connectivity(2, 3);
+    }
+  }
 
   if (problem_type == "poisson")
   {
     // Create Poisson problem
-    std::tie(b, u, solver_function) = poisson::problem(mesh, order);
+    std::tie(b, u, solver_function)
+        = poisson::problem(mesh, order, dof_ordering, multigrid_type, hierarchy,
+                           assembly, batch_width, matrix_type, ksp_rtol,
+                           ksp_max_it, num_rhs, num_reassemble, num_matmult);
   }
   else if (problem_type == "cgpoisson")
   {
     // Create Poisson problem
     std::tie(b, u, solver_function)
-        = cgpoisson::problem(mesh, order, scatterer);
+        = cgpoisson::problem(mesh, order, dof_ordering, scatterer, cg_variant,
+                             precision, multigrid_type, hierarchy,
+                             cg_preconditioner, rtol, max_it, num_rhs);
+  }
+  else if (problem_type == "csrpoisson")
+  {
+    // Create Poisson problem with native CSR matrix
+    std::tie(b, u, solver_function)
+        = csrpoisson::problem(mesh, order, dof_ordering, scatterer, cg_variant);
   }
   else if (problem_type == "elasticity")
   {
     // Create elasticity problem. Near-nullspace will be attached to the
     // linear operator (matrix).
-    std::tie(b, u, solver_function) = elastic::problem(mesh, order);
+    std::tie(b, u, solver_function)
+        = elastic::problem(mesh, order, dof_ordering, multigrid_type, hierarchy,
+                           matrix_type, near_nullspace, ksp_rtol, ksp_max_it,
+                           num_rhs, num_reassemble, num_matmult);
+  }
+  else if (problem_type == "cgelasticity")
+  {
+    // Create matrix-free elasticity problem, solved by CG with a Jacobi
+    // preconditioner
+    std::tie(b, u, solver_function)
+        = cgelastic::problem(mesh, order, dof_ordering, scatterer);
+  }
+  else if (problem_type == "gpupoisson")
+  {
+#ifdef HAS_GPU
+    // Create matrix-free Poisson problem solved on the GPU
+    std::tie(b, u, solver_function) = gpupoisson::problem(
+        mesh, order, dof_ordering, scatterer, gpu_aware_mpi, rtol, max_it);
+#else
+    throw std::runtime_error(
+        "gpupoisson requires a build with GPU_BACKEND=cuda or hip");
+#endif
+  }
+  else if (problem_type == "halo")
+  {
+    // Halo exchange benchmark on the dof map of the Poisson problem
+    std::tie(b, u, solver_function) = halo::problem(
+        mesh, order, dof_ordering, scatterer, halo_exchanges);
   }
   else
     throw std::runtime_error("Unknown problem type: " + problem_type);
 
+  // Locality of the dof ordering
+  const reorder::Statistics ordering
+      = reorder::statistics(*u->function_space());
+
+  // Quality of the partition
+  const partition::Statistics parts
+      = partition::statistics(*u->function_space());
+
+  // Topology memory of all mesh levels, after the problem has created
+  // the entities it needs
+  std::array<std::uint64_t, 2> topology_memory = {0, topology_reclaimed};
+  for (auto& m : meshes)
+    topology_memory[0] += topology::bytes(*m->topology());
+  MPI_Allreduce(MPI_IN_PLACE, topology_memory.data(), 2, MPI_UINT64_T,
+                MPI_SUM, comm);
+
   // Print simulation summary
-  if (dolfinx::MPI::rank(MPI_COMM_WORLD) == 0)
+  if (dolfinx::MPI::rank(comm) == 0)
   {
     char petsc_version[256];
     PetscGetVersion(petsc_version, 256);
@@ -192,58 +555,504 @@ void solve(int argc, char* argv[])
     std::cout << "  ufl hash:        " << UFCX_SIGNATURE << std::endl;
     std::cout << "  petsc version:   " << petsc_version << std::endl;
     std::cout << "  Problem type:    " << problem_type << std::endl;
+    std::cout << "  Cell type:       " << cell_type_name << std::endl;
     std::cout << "  Scaling type:    " << scaling_type << std::endl;
     std::cout << "  Num processes:   " << num_processes << std::endl;
+    if (std::string(counters::backend()) != "none")
+      std::cout << "  HW counters:     " << counters::backend() << std::endl;
     std::cout << "  Num cells:       " << num_cells << num_cells_human
               << std::endl;
     std::cout << "  Total degrees of freedom:               " << num_dofs
               << num_dofs_human << std::endl;
     std::cout << "  Average degrees of freedom per process: "
-              << num_dofs / dolfinx::MPI::size(MPI_COMM_WORLD) << std::endl;
+              << num_dofs / dolfinx::MPI::size(comm) << std::endl;
+    std::cout << "  Dof ordering:    " << dof_ordering << std::endl;
+    std::cout << "  Multigrid:       " << multigrid_type;
+    if (hierarchy)
+      std::cout << " (" << hierarchy->meshes.size() << " mesh levels)";
+    std::cout << std::endl;
+    if (problem_type == "poisson" or problem_type == "elasticity")
+      std::cout << "  Matrix type:     " << matrix_type << std::endl;
+    std::cout << "  Solver tolerance: rtol ";
+    if (ksp_default("rtol"))
+      std::cout << "PETSc default";
+    else
+      std::cout << rtol;
+    std::cout << ", max_it ";
+    if (ksp_default("max_it"))
+      std::cout << "PETSc default";
+    else
+      std::cout << max_it;
+    std::cout << std::endl;
+    if (num_rhs > 1)
+      std::cout << "  Right-hand sides: " << num_rhs << std::endl;
+    if (num_reassemble > 0)
+      std::cout << "  Reassemblies:    " << num_reassemble << std::endl;
+    std::cout << "  Topology:        " << (lean_topology ? "lean" : "full")
+              << ", " << topology_memory[0] / (1024.0 * 1024.0) << " MB";
+    if (lean_topology)
+    {
+      std::cout << " (reclaimed " << topology_memory[1] / (1024.0 * 1024.0)
+                << " MB)";
+    }
+    std::cout << std::endl;
+    if (problem_type == "cgpoisson")
+    {
+      std::cout << "  CG preconditioner: " << cg_preconditioner
+                << std::endl;
+    }
+    if (assembly == "batched")
+    {
+      std::cout << "  Assembly:        batched (" << batch_width
+                << " cells per batch)" << std::endl;
+    }
+    std::cout << "  Matrix bandwidth (owned block, in blocks): max "
+              << ordering.max_bandwidth << ", mean "
+              << ordering.mean_bandwidth << std::endl;
+    std::cout << "  Owned dofs coupled to ghosts: "
+              << 100 * ordering.ghost_coupled_fraction << "%, spanning "
+              << 100 * ordering.ghost_coupled_span << "% of the owned range"
+              << std::endl;
+    std::cout << "  Partitioner:     "
+              << (partitioner == "default" ? graph_partitioners().front()
+                                           : partitioner)
+              << std::endl;
+    std::cout << "  Partition (per process: min / mean / max, imbalance "
+                 "max/mean):"
+              << std::endl;
+    auto print_summary = [](const std::string& name, partition::Summary s)
+    {
+      std::cout << "    " << std::left << std::setw(14) << name << std::right
+                << s.min << " / " << s.mean << " / " << s.max << ", "
+                << s.imbalance() << std::endl;
+    };
+    print_summary("Owned cells:", parts.owned_cells);
+    print_summary("Owned dofs:", parts.owned_dofs);
+    print_summary("Ghost dofs:", parts.ghost_dofs);
+    print_summary("Neighbours:", parts.neighbours);
+    print_summary("Halo bytes:", parts.halo_bytes);
+    if (parts.edge_cut >= 0)
+      std::cout << "    Edge cut (facets): " << parts.edge_cut << std::endl;
     std::cout
         << "----------------------------------------------------------------"
         << std::endl;
+
+    metrics::record("dolfinx_version", DOLFINX_VERSION_STRING);
+    metrics::record("dolfinx_hash", DOLFINX_VERSION_GIT);
+    metrics::record("ufl_hash", UFCX_SIGNATURE);
+    metrics::record("petsc_version", petsc_version);
+    metrics::record("problem_type", problem_type);
+    metrics::record("mesh_type", mesh_type);
+    metrics::record("cell_type", cell_type_name);
+    metrics::record("scaling_type", scaling_type);
+    metrics::record("reorder", dof_ordering);
+    metrics::record("multigrid", multigrid_type);
+    if (problem_type == "poisson" or problem_type == "elasticity")
+      metrics::record("matrix_type", matrix_type);
+    if (hierarchy)
+      metrics::record("multigrid_levels", hierarchy->meshes.size());
+    metrics::record("assembly", assembly);
+    if (assembly == "batched")
+      metrics::record("batch_width", batch_width);
+    metrics::record("partitioner", partitioner);
+    auto record_summary = [](const std::string& key, partition::Summary s)
+    {
+      metrics::record(key + "_min", s.min);
+      metrics::record(key + "_mean", s.mean);
+      metrics::record(key + "_max", s.max);
+      metrics::record(key + "_imbalance", s.imbalance());
+    };
+    record_summary("owned_cells", parts.owned_cells);
+    record_summary("owned_dofs", parts.owned_dofs);
+    record_summary("ghost_dofs", parts.ghost_dofs);
+    record_summary("neighbours", parts.neighbours);
+    record_summary("halo_bytes", parts.halo_bytes);
+    if (parts.edge_cut >= 0)
+      metrics::record("edge_cut", parts.edge_cut);
+    metrics::record("max_bandwidth", ordering.max_bandwidth);
+    metrics::record("mean_bandwidth", ordering.mean_bandwidth);
+    metrics::record("ghost_coupled_fraction", ordering.ghost_coupled_fraction);
+    metrics::record("ghost_coupled_span", ordering.ghost_coupled_span);
+    if (ksp_default("rtol"))
+      metrics::record("rtol", "petsc_default");
+    else
+      metrics::record("rtol", rtol);
+    if (ksp_default("max_it"))
+      metrics::record("max_it", "petsc_default");
+    else
+      metrics::record("max_it", max_it);
+    metrics::record("num_rhs", num_rhs);
+    metrics::record("num_reassemble", num_reassemble);
+    metrics::record("topology", lean_topology ? "lean" : "full");
+    metrics::record("topology_bytes", topology_memory[0]);
+    metrics::record("topology_bytes_reclaimed", topology_memory[1]);
+    if (problem_type == "cgpoisson")
+      metrics::record("cg_preconditioner", cg_preconditioner);
+    metrics::record("order", order);
+    metrics::record("num_processes", num_processes);
+    metrics::record("num_threads", num_threads);
+    metrics::record("hw_counters", counters::backend());
+    metrics::record("num_cells", num_cells);
+    metrics::record("num_dofs", num_dofs);
+    metrics::record("num_dofs_per_process",
+                    num_dofs / dolfinx::MPI::size(comm));
   }
+  metrics::record_rank(
+      "owned_dofs",
+      u->function_space()->dofmap()->index_map->size_local()
+          * u->function_space()->dofmap()->index_map_bs());
 
-  dolfinx::common::Timer t5("ZZZ Solve");
-  int num_iter = solver_function(*u, *b);
-  t5.stop();
-  t5.flush();
+  // Untimed solves, e.g. to set up the preconditioner and warm caches
+  for (int i = 0; i < num_warmup; ++i)
+  {
+    u->x()->set(0);
+    solver_function(*u, *b);
+  }
 
-  if (output)
+  // Timed solves. The time of each solve is the maximum over processes.
+  int num_iter = 0;
+  std::vector<double> solve_times;
+  for (int i = 0; i < num_repeat; ++i)
   {
-    dolfinx::common::Timer t6("ZZZ Output");
-    std::string filename
-        = output_dir + "/solution-" + std::to_string(num_processes) + ".xdmf";
-    dolfinx::io::XDMFFile file(MPI_COMM_WORLD, filename, "w");
-    file.write_mesh(*mesh);
-    file.write_function(*u, 0.0);
-    t6.stop();
-    t6.flush();
+    u->x()->set(0);
+    Phase t5("ZZZ Solve");
+    num_iter = solver_function(*u, *b);
+    t5.stop();
+
+    double t = std::chrono::duration<double>(t5.elapsed()).count();
+    MPI_Allreduce(MPI_IN_PLACE, &t, 1, MPI_DOUBLE, MPI_MAX, comm);
+    solve_times.push_back(t);
   }
 
-  // Display timings
-  dolfinx::list_timings(MPI_COMM_WORLD);
+  std::ranges::sort(solve_times);
+  const double tmedian
+      = (solve_times[(num_repeat - 1) / 2] + solve_times[num_repeat / 2]) / 2;
+  if (num_repeat > 1)
+  {
+    const double spread = (solve_times.back() - solve_times.front()) / tmedian;
+    if (mpi_rank == 0)
+    {
+      std::cout << "*** Solve time over " << num_repeat
+                << " repeats: median " << tmedian << " s, min "
+                << solve_times.front() << " s, max " << solve_times.back()
+                << " s, spread (max-min)/median " << spread << std::endl;
+    }
+    metrics::record("solve_time_median", tmedian);
+    metrics::record("solve_time_min", solve_times.front());
+    metrics::record("solve_time_max", solve_times.back());
+    metrics::record("solve_time_spread", spread);
+  }
 
-  // Report number of Krylov iterations
+  // Solution norm. This is computed before the output is started, as
+  // a background write may use the communicators of the solution.
   double norm = dolfinx::la::norm(*(u->x()));
-  if (dolfinx::MPI::rank(MPI_COMM_WORLD) == 0)
+
+  // Write output, either now or in a background thread that overlaps
+  // the write with the timing report. The background write uses a
+  // duplicate of comm, and the main thread uses only comm until the
+  // write has finished.
+  output::Result output_result{0, 0};
+  std::future<output::Result> pending_output;
+  std::filesystem::path output_file;
+  MPI_Comm output_comm = MPI_COMM_NULL;
+  if (write_output)
+  {
+    output_file = std::filesystem::path(output_dir)
+                  / ("solution-" + std::to_string(num_processes)
+                     + (output_format == "vtx" ? ".bp" : ".xdmf"));
+    int thread_level;
+    MPI_Query_thread(&thread_level);
+    if (output_async and thread_level < MPI_THREAD_MULTIPLE)
+    {
+      if (mpi_rank == 0)
+      {
+        std::cout << "MPI does not support MPI_THREAD_MULTIPLE, writing "
+                     "output synchronously"
+                  << std::endl;
+      }
+      output_async = false;
+    }
+
+    MPI_Comm_dup(comm, &output_comm);
+    if (output_async)
+    {
+      pending_output = std::async(std::launch::async, output::write,
+                                  output_comm, u, output_file, output_format);
+    }
+    else
+    {
+      Phase t6("ZZZ Output");
+      output_result
+          = output::write(output_comm, u, output_file, output_format);
+    }
+  }
+
+  // Display timings and memory use. In a sweep the timers accumulate
+  // over the points, and the timers of each point are in the metrics.
+  if (!sweep)
+    dolfinx::list_timings(comm);
+  if (mem_profile)
+  {
+    stop_memory_profiler();
+    report_memory_phases(comm);
+  }
+  if (!sweep)
+  {
+    counters::report(comm, vm["peak_gflops"].as<double>(),
+                     vm["stream_bandwidth"].as<double>());
+    counters::stop();
+  }
+
+  // Report number of Krylov iterations
+  if (dolfinx::MPI::rank(comm) == 0)
   {
     std::cout << "*** Number of Krylov iterations: " << num_iter << std::endl;
     std::cout << "*** Solution norm:  " << norm << std::endl;
   }
 
-  if (mem_profile and mpi_rank == 0)
+  // Report output bandwidth: the bytes on disk over the slowest write
+  if (write_output)
+  {
+    if (pending_output.valid())
+      output_result = pending_output.get();
+    MPI_Comm_free(&output_comm);
+
+    double time = output_result.seconds;
+    MPI_Allreduce(MPI_IN_PLACE, &time, 1, MPI_DOUBLE, MPI_MAX, comm);
+    std::array<std::int64_t, 2> bytes
+        = {output_result.bytes, -output_result.bytes};
+    MPI_Allreduce(MPI_IN_PLACE, bytes.data(), 2, MPI_INT64_T, MPI_MAX,
+                  comm);
+    metrics::record_rank("output_bytes", output_result.bytes);
+    if (mpi_rank == 0)
+    {
+      const double disk_bytes = output::size_on_disk(output_file);
+      std::cout << "*** Output (" << output_format
+                << (output_async ? ", background" : "")
+                << "): " << disk_bytes / 1e9 << " GB in " << time << " s, "
+                << disk_bytes / 1e9 / time << " GB/s; data per process: min "
+                << -bytes[1] << " bytes, max " << bytes[0] << " bytes"
+                << std::endl;
+      metrics::record("output_format", output_format);
+      metrics::record("output_time", time);
+      metrics::record("output_bytes_on_disk", disk_bytes);
+      metrics::record("output_gbytes_per_second", disk_bytes / 1e9 / time);
+    }
+  }
+
+  metrics::record("krylov_iterations", num_iter);
+  metrics::record("num_repeat", num_repeat);
+  metrics::record("num_warmup", num_warmup);
+  metrics::record("solution_norm", norm);
+  if (!metrics_file.empty() and !sweep)
+    metrics::write(comm, metrics_file);
+
+  const std::int64_t num_dofs
+      = u->function_space()->dofmap()->index_map->size_global()
+        * u->function_space()->dofmap()->index_map_bs();
+  return {num_processes, ndofs, num_dofs, num_iter, tmedian};
+}
+
+void run(int argc, char* argv[])
+{
+  po::options_description desc("Allowed options");
+  std::string partitioner_names;
+  for (auto& p : graph_partitioners())
+    partitioner_names += " " + p;
+  const std::string partitioner_help
+      = "graph partitioner for the cube and unstructured meshes (default, "
+        "or one of:"
+        + partitioner_names + ")";
+  desc.add_options()("help,h", "print usage message")(
+      "problem_type", po::value<std::string>()->default_value("poisson"),
+      "problem (poisson, cgpoisson, csrpoisson, elasticity, cgelasticity, "
+      "gpupoisson, or halo for a halo exchange benchmark)")(
+      "mesh_type", po::value<std::string>()->default_value("cube"),
+      "mesh (cube, cube_direct or unstructured)")(
+      "cell_type", po::value<std::string>()->default_value("tetrahedron"),
+      "cell type (tetrahedron, or hexahedron for cgpoisson on the cube "
+      "mesh)")(
+      "mesh_cache", po::value<std::string>()->default_value(""),
+      "directory for cached (partitioned) meshes (no caching unless this "
+      "is set)")(
+      "lean_topology", po::bool_switch()->default_value(false),
+      "do not create facets up front, locate boundary dofs geometrically "
+      "and, for order 1, drop the mesh edges")(
+      "memory_profiling", po::bool_switch()->default_value(false),
+      "record the peak memory of each phase on all processes")(
+      "memory_interval", po::value<int>()->default_value(10),
+      "memory profiler sampling interval (ms)")(
+      "peak_gflops", po::value<double>()->default_value(0),
+      "peak floating point rate per process (GFLOP/s) for the hardware "
+      "counter roofline (0: not reported)")(
+      "stream_bandwidth", po::value<double>()->default_value(0),
+      "memory bandwidth per process (GB/s, e.g. from STREAM) for the "
+      "hardware counter roofline (0: not reported)")(
+      "subcomm_partition", po::bool_switch()->default_value(false),
+      "Use sub-communicator for partitioning")(
+      "partitioner", po::value<std::string>()->default_value("default"),
+      partitioner_help.c_str())(
+      "reorder", po::value<std::string>()->default_value("gps"),
+      "dof ordering (gps, none, rcm or hilbert)")(
+      "multigrid", po::value<std::string>()->default_value("none"),
+      "multigrid preconditioner (none, or gmg or pmg for poisson, "
+      "elasticity and cgpoisson)")(
+      "matrix_type", po::value<std::string>()->default_value("aij"),
+      "assembled matrix storage for poisson and elasticity (aij, baij or "
+      "sbaij)")(
+      "matmult", po::value<int>()->default_value(0),
+      "number of timed products with the assembled matrix for poisson and "
+      "elasticity (0 to skip)")(
+      "near_nullspace", po::value<std::string>()->default_value("streamed"),
+      "construction of the elasticity rigid body modes (streamed or "
+      "reference)")(
+      "scaling_type", po::value<std::string>()->default_value("weak"),
+      "scaling (weak or strong)")(
+      "output", po::value<std::string>()->default_value(""),
+      "output directory (no output unless this is set)")(
+      "output_format", po::value<std::string>()->default_value("xdmf"),
+      "output format (xdmf or vtx)")(
+      "output_async", po::bool_switch()->default_value(false),
+      "write output in a background thread, overlapped with the timing "
+      "report")(
+      "ndofs",
+      po::value<std::vector<std::size_t>>()->multitoken()->default_value(
+          std::vector<std::size_t>{50000}, "50000"),
+      "number of degrees of freedom (several values with --sweep)")(
+      "sweep", po::bool_switch()->default_value(false),
+      "run over sub-communicators of 1, 2, 4, ... processes and over the "
+      "values of ndofs, and print a combined scaling table")(
+      "order", po::value<std::size_t>()->default_value(1), "polynomial order")(
+      "scatterer", po::value<std::string>()->default_value("neighbor"),
+      "scatterer for CG and halo (neighbor or p2p, or persistent for "
+      "cgpoisson and halo)")(
+      "halo_exchanges", po::value<int>()->default_value(1000),
+      "number of timed forward and reverse scatters for halo")(
+      "cg_variant", po::value<std::string>()->default_value("classic"),
+      "CG algorithm for cgpoisson and csrpoisson (classic or pipelined)")(
+      "cg_preconditioner", po::value<std::string>()->default_value("none"),
+      "matrix-free preconditioner for cgpoisson (none, jacobi or "
+      "chebyshev)")(
+      "rtol", po::value<double>()->default_value(1e-6),
+      "relative residual tolerance of the solver")(
+      "max_it", po::value<int>()->default_value(100),
+      "maximum number of solver iterations")(
+      "num_rhs", po::value<int>()->default_value(1),
+      "number of right-hand sides for poisson, elasticity and cgpoisson, "
+      "solved together and one at a time on the first solve")(
+      "reassemble", po::value<int>()->default_value(0),
+      "number of timed reassemblies of the matrix and vector into the "
+      "same storage for poisson and elasticity")(
+      "precision", po::value<std::string>()->default_value("double"),
+      "matrix-free operator precision for cgpoisson (double or mixed)")(
+      "gpu_aware_mpi", po::bool_switch()->default_value(false),
+      "pass device buffers to MPI in the gpupoisson ghost exchange")(
+      "threads", po::value<int>()->default_value(1),
+      "number of OpenMP threads per process for assembly and operator "
+      "actions")(
+      "assembly", po::value<std::string>()->default_value("scalar"),
+      "poisson assembly mode (scalar: FFCx kernels cell by cell, or "
+      "batched: reference tensors over batches of cells)")(
+      "batch_width", po::value<int>()->default_value(8),
+      "number of cells per batch in batched assembly (4 or 8)")(
+      "metrics_file", po::value<std::string>()->default_value(""),
+      "JSON file for timings and metrics (not written unless this is set)")(
+      "repeat", po::value<int>()->default_value(1),
+      "number of timed solves")(
+      "warmup", po::value<int>()->default_value(0),
+      "number of untimed solves before the timed solves");
+
+  po::variables_map vm;
+  po::store(po::command_line_parser(argc, argv)
+                .options(desc)
+                .allow_unregistered()
+                .run(),
+            vm);
+  po::notify(vm);
+
+  if (vm.count("help"))
+  {
+    std::cout << desc << std::endl;
+    ;
+    return;
+  }
+
+  const std::vector<std::size_t> ndofs
+      = vm["ndofs"].as<std::vector<std::size_t>>();
+  if (!vm["sweep"].as<bool>())
+  {
+    if (ndofs.size() != 1)
+      throw std::runtime_error("Several values of ndofs require --sweep");
+    solve(MPI_COMM_WORLD, vm, ndofs.front(), false);
+    return;
+  }
+  if (vm["memory_profiling"].as<bool>())
+    throw std::runtime_error("Memory profiling is not supported with --sweep");
+
+  // Process counts 1, 2, 4, ... and the size of MPI_COMM_WORLD. The
+  // communicator of each count holds the lowest ranks, and the other
+  // ranks are parked until the points with that count are done.
+  const int size = dolfinx::MPI::size(MPI_COMM_WORLD);
+  const int rank = dolfinx::MPI::rank(MPI_COMM_WORLD);
+  std::vector<int> process_counts;
+  for (int p = 1; p < size; p *= 2)
+    process_counts.push_back(p);
+  process_counts.push_back(size);
+
+  std::vector<RunResult> results;
+  for (int p : process_counts)
+  {
+    MPI_Comm comm;
+    MPI_Comm_split(MPI_COMM_WORLD, rank < p ? 0 : MPI_UNDEFINED, rank, &comm);
+    for (std::size_t n : ndofs)
+    {
+      if (comm != MPI_COMM_NULL)
+      {
+        metrics::begin_point();
+        results.push_back(solve(comm, vm, n, true));
+        metrics::end_point(comm);
+      }
+      park(MPI_COMM_WORLD);
+    }
+    if (comm != MPI_COMM_NULL)
+      MPI_Comm_free(&comm);
+  }
+
+  const std::string scaling_type = vm["scaling_type"].as<std::string>();
+  if (rank == 0)
+    print_scaling_table(results, scaling_type == "strong");
+
+  const std::string metrics_file = vm["metrics_file"].as<std::string>();
+  if (!metrics_file.empty())
   {
-    quit_flag = true;
-    mem_thread.join();
+    std::string counts;
+    for (int p : process_counts)
+      counts += (counts.empty() ? "" : " ") + std::to_string(p);
+    metrics::record("problem_type", vm["problem_type"].as<std::string>());
+    metrics::record("scaling_type", scaling_type);
+    metrics::record("sweep_process_counts", counts);
+    metrics::record("sweep_points", results.size());
+    metrics::write(MPI_COMM_WORLD, metrics_file);
   }
 }
 
 int main(int argc, char* argv[])
 {
+  // Writing output in a background thread (--output_async) requires
+  // MPI_THREAD_MULTIPLE. MPI is initialised before the program options
+  // are parsed, so the command line is checked here.
+  const bool output_async
+      = std::any_of(argv, argv + argc, [](const char* arg)
+                    { return std::string(arg) == "--output_async"; });
+
   dolfinx::common::Timer t0("Init MPI");
-  MPI_Init(&argc, &argv);
+  if (output_async)
+  {
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
+  }
+  else
+    MPI_Init(&argc, &argv);
   t0.stop();
   t0.flush();
 
@@ -266,7 +1075,7 @@ int main(int argc, char* argv[])
   if (mpi_rank == 0)
     spdlog::set_level(spdlog::level::info);
 
-  solve(argc, argv);
+  run(argc, argv);
 
   PetscFinalize();
   MPI_Finalize();
@@ -0,0 +1,194 @@
+// Copyright (C) 2026 The FEniCS Project
+//
+// This file is part of FEniCS-miniapp (https://www.fenicsproject.org)
+//
+// SPDX-License-Identifier:    MIT
+
+#include "matrix.h"
+#include "metrics.h"
+#include "phase.h"
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <dolfinx/common/IndexMap.h>
+#include <dolfinx/common/MPI.h>
+#include <dolfinx/fem/petsc.h>
+#include <dolfinx/fem/utils.h>
+#include <dolfinx/la/SparsityPattern.h>
+#include <iostream>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+using namespace dolfinx;
+
+//-----------------------------------------------------------------------------
+Mat matrix::create_matrix(const fem::Form<PetscScalar, double>& a,
+                          const std::string& type)
+{
+  if (type == "aij" or type == "baij")
+    return fem::petsc::create_matrix(a, type);
+  else if (type != "sbaij")
+    throw std::runtime_error("Unknown matrix type: " + type);
+
+  la::SparsityPattern sp = fem::create_sparsity_pattern(a);
+  sp.finalize();
+  const int bs = sp.block_size(0);
+  if (sp.block_size(1) != bs)
+    throw std::runtime_error("sbaij requires a square block size");
+
+  // Count the blocks on and above the block diagonal of each block
+  // row. In the diagonal part a column is above the diagonal if its
+  // local index is not smaller than the row index; in the off-diagonal
+  // part the global indices are compared.
+  std::shared_ptr<const common::IndexMap> map = sp.index_map(0);
+  const std::int32_t num_rows = map->size_local();
+  const std::int64_t row0 = map->local_range()[0];
+  const std::vector<std::int64_t> columns
+      = sp.column_index_map().global_indices();
+  auto [cols, offsets] = sp.graph();
+  std::span<const std::int32_t> off_diag = sp.off_diagonal_offsets();
+  std::vector<PetscInt> nnz_diag(num_rows, 0), nnz_off_diag(num_rows, 0);
+  for (std::int32_t i = 0; i < num_rows; ++i)
+  {
+    for (std::int64_t k = offsets[i]; k < offsets[i] + off_diag[i]; ++k)
+      nnz_diag[i] += cols[k] >= i;
+    for (std::int64_t k = offsets[i] + off_diag[i]; k < offsets[i + 1]; ++k)
+      nnz_off_diag[i] += columns[cols[k]] > row0 + i;
+  }
+
+  Mat A;
+  MatCreate(map->comm(), &A);
+  MatSetSizes(A, bs * num_rows, bs * num_rows, bs * map->size_global(),
+              bs * map->size_global());
+  MatSetType(A, MATSBAIJ);
+  MatSetBlockSize(A, bs);
+  MatXAIJSetPreallocation(A, bs, nnz_diag.data(), nnz_off_diag.data(),
+                          nullptr, nullptr);
+
+  const std::vector<std::int64_t> rows = map->global_indices();
+  const std::vector<PetscInt> _rows(rows.begin(), rows.end());
+  ISLocalToGlobalMapping local_to_global;
+  ISLocalToGlobalMappingCreate(MPI_COMM_SELF, bs, _rows.size(), _rows.data(),
+                               PETSC_COPY_VALUES, &local_to_global);
+  MatSetLocalToGlobalMapping(A, local_to_global, local_to_global);
+  ISLocalToGlobalMappingDestroy(&local_to_global);
+
+  MatSetOption(A, MAT_IGNORE_LOWER_TRIANGULAR, PETSC_TRUE);
+  MatSetOption(A, MAT_NEW_NONZERO_ALLOCATION_ERR, PETSC_TRUE);
+  MatSetOption(A, MAT_KEEP_NONZERO_PATTERN, PETSC_TRUE);
+  return A;
+}
+//-----------------------------------------------------------------------------
+std::size_t matrix::bytes(Mat A)
+{
+  MatInfo info;
+  MatGetInfo(A, MAT_LOCAL, &info);
+  PetscInt num_rows;
+  MatGetLocalSize(A, &num_rows, nullptr);
+
+  PetscBool blocked;
+  PetscObjectTypeCompareAny(reinterpret_cast<PetscObject>(A), &blocked,
+                            MATSEQBAIJ, MATMPIBAIJ, MATSEQSBAIJ,
+                            MATMPISBAIJ, "");
+  PetscInt bs = 1;
+  if (blocked)
+    MatGetBlockSize(A, &bs);
+
+  const std::size_t nnz = info.nz_allocated;
+  return nnz * sizeof(PetscScalar) + nnz / (bs * bs) * sizeof(PetscInt)
+         + (num_rows / bs + 1) * sizeof(PetscInt);
+}
+//-----------------------------------------------------------------------------
+void matrix::time_matmult(Mat A, int num_products)
+{
+  Vec x, y;
+  MatCreateVecs(A, &x, &y);
+  VecSet(x, 1.0);
+
+  MPI_Comm comm = PetscObjectComm(reinterpret_cast<PetscObject>(A));
+  MPI_Barrier(comm);
+  Phase t("ZZZ MatMult");
+  for (int i = 0; i < num_products; ++i)
+    MatMult(A, x, y);
+  t.stop();
+
+  VecDestroy(&x);
+  VecDestroy(&y);
+
+  // Matrix storage streamed by one product, summed over processes
+  double time = t.elapsed().count() / num_products;
+  MPI_Allreduce(MPI_IN_PLACE, &time, 1, MPI_DOUBLE, MPI_MAX, comm);
+  double matrix_bytes = bytes(A);
+  MPI_Allreduce(MPI_IN_PLACE, &matrix_bytes, 1, MPI_DOUBLE, MPI_SUM, comm);
+  if (dolfinx::MPI::rank(comm) == 0)
+  {
+    std::cout << "MatMult: " << 1e3 * time << " ms per product, "
+              << matrix_bytes / time / 1e9 << " GB/s of matrix storage"
+              << std::endl;
+    metrics::record("matmult_time", time);
+    metrics::record("matmult_gbytes_per_second", matrix_bytes / time / 1e9);
+  }
+}
+//-----------------------------------------------------------------------------
+void matrix::time_reassembly(Mat A,
+                             const std::function<void()>& assemble_matrix,
+                             const std::function<void()>& assemble_vector,
+                             std::int64_t num_cells, std::int64_t cell_entries,
+                             double pattern_time, double first_time,
+                             int num_assemblies)
+{
+  MPI_Comm comm = PetscObjectComm(reinterpret_cast<PetscObject>(A));
+  MatInfo info0;
+  MatGetInfo(A, MAT_LOCAL, &info0);
+
+  MPI_Barrier(comm);
+  Phase tm("ZZZ Reassemble matrix");
+  for (int i = 0; i < num_assemblies; ++i)
+  {
+    MatZeroEntries(A);
+    assemble_matrix();
+  }
+  tm.stop();
+
+  MPI_Barrier(comm);
+  Phase tv("ZZZ Reassemble vector");
+  for (int i = 0; i < num_assemblies; ++i)
+    assemble_vector();
+  tv.stop();
+
+  MatInfo info1;
+  MatGetInfo(A, MAT_LOCAL, &info1);
+
+  std::array<double, 4> times
+      = {pattern_time, first_time, tm.elapsed().count() / num_assemblies,
+         tv.elapsed().count() / num_assemblies};
+  MPI_Allreduce(MPI_IN_PLACE, times.data(), times.size(), MPI_DOUBLE, MPI_MAX,
+                comm);
+  double mallocs = info1.mallocs - info0.mallocs;
+  MPI_Allreduce(MPI_IN_PLACE, &mallocs, 1, MPI_DOUBLE, MPI_SUM, comm);
+  if (dolfinx::MPI::rank(comm) == 0)
+  {
+    const auto [t_pattern, t_first, t_matrix, t_vector] = times;
+    const double cells_per_second = num_cells / t_matrix;
+    const double entries_per_second
+        = static_cast<double>(num_cells) * cell_entries / t_matrix;
+    std::cout << "Reassembly (" << num_assemblies << " times):" << std::endl;
+    std::cout << "  Sparsity pattern: " << t_pattern << " s" << std::endl;
+    std::cout << "  First assembly:   " << t_first << " s" << std::endl;
+    std::cout << "  Matrix:           " << t_matrix << " s, "
+              << cells_per_second << " cells/s, " << entries_per_second
+              << " entries/s" << std::endl;
+    std::cout << "  Vector:           " << t_vector << " s, "
+              << num_cells / t_vector << " cells/s" << std::endl;
+    std::cout << "  PETSc mallocs:    " << mallocs << std::endl;
+    metrics::record("sparsity_pattern_time", t_pattern);
+    metrics::record("first_assembly_time", t_first);
+    metrics::record("reassembly_matrix_time", t_matrix);
+    metrics::record("reassembly_vector_time", t_vector);
+    metrics::record("reassembly_cells_per_second", cells_per_second);
+    metrics::record("reassembly_entries_per_second", entries_per_second);
+    metrics::record("reassembly_mallocs", mallocs);
+  }
+}
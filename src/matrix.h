@@ -0,0 +1,70 @@
+// Copyright (C) 2026 The FEniCS Project
+//
+// This file is part of FEniCS-miniapp (https://www.fenicsproject.org)
+//
+// SPDX-License-Identifier:    MIT
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <dolfinx/fem/Form.h>
+#include <functional>
+#include <petscmat.h>
+#include <string>
+
+/// Storage formats of the assembled PETSc operators: scalar compressed
+/// rows (aij), compressed rows of dense blocks of the size of the dof
+/// block (baij), and the upper triangle of the block matrix of a
+/// symmetric operator (sbaij).
+namespace matrix
+{
+/// Create a PETSc matrix with the sparsity pattern of a bilinear form.
+/// Element matrices are added with `la::petsc::Matrix::set_block_fn`
+/// for all formats; for sbaij the blocks below the block diagonal are
+/// ignored, so the form must be symmetric.
+/// @param[in] a Bilinear form, on the same space for rows and columns
+/// @param[in] type Matrix type (aij, baij or sbaij)
+/// @return The matrix, preallocated and with a local-to-global map
+Mat create_matrix(const dolfinx::fem::Form<PetscScalar, double>& a,
+                  const std::string& type);
+
+/// Bytes allocated on this process for the values, column indices and
+/// row offsets of an assembled matrix. The block formats store one
+/// column index per block and one offset per block row.
+/// @param[in] A Assembled AIJ, BAIJ or SBAIJ matrix
+std::size_t bytes(Mat A);
+
+/// Time matrix-vector products in the "ZZZ MatMult" phase, then print
+/// (on rank 0) the mean time of a product and record it in the
+/// metrics. Collective.
+/// @param[in] A Assembled matrix
+/// @param[in] num_products Number of timed products
+void time_matmult(Mat A, int num_products);
+
+/// Reassemble a matrix and a vector into their existing storage, in
+/// the "ZZZ Reassemble matrix" and "ZZZ Reassemble vector" phases. The
+/// matrix is zeroed before each assembly. Then print (on rank 0) the
+/// time of creating the sparsity pattern, of the first assembly and
+/// the mean time of a reassembly, with the cells and matrix entries
+/// inserted per second and the number of PETSc mallocs during the
+/// reassemblies (zero if the pattern is reused), and record them in
+/// the metrics. Collective.
+/// @param[in] A Assembled matrix
+/// @param[in] assemble_matrix Function that adds the cell matrices to
+/// `A` and finalises it
+/// @param[in] assemble_vector Function that zeroes and assembles the
+/// vector
+/// @param[in] num_cells Number of cells (summed over processes)
+/// @param[in] cell_entries Number of matrix entries added per cell
+/// @param[in] pattern_time Time of creating the sparsity pattern and
+/// matrix on this process (s)
+/// @param[in] first_time Time of the first matrix assembly on this
+/// process (s)
+/// @param[in] num_assemblies Number of timed reassemblies
+void time_reassembly(Mat A, const std::function<void()>& assemble_matrix,
+                     const std::function<void()>& assemble_vector,
+                     std::int64_t num_cells, std::int64_t cell_entries,
+                     double pattern_time, double first_time,
+                     int num_assemblies);
+} // namespace matrix
@@ -4,35 +4,279 @@
 //
 // SPDX-License-Identifier:    MIT
 
+#include "mem.h"
+#include "metrics.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <chrono>
-#include <dolfinx/common/log.h>
+#include <dolfinx/common/MPI.h>
 #include <fstream>
+#include <iomanip>
 #include <ios>
 #include <iostream>
-#include <iterator>
+#include <map>
+#include <mutex>
+#include <sstream>
 #include <string>
+#include <sys/resource.h>
 #include <thread>
 #include <unistd.h>
+#include <utility>
 #include <vector>
 
-void process_mem_usage(bool& quit)
+namespace
 {
-  std::string fmt = "[%Y-%m-%d %H:%M:%S.%e] [MEM] [%l] %v";
-  spdlog::set_pattern(fmt);
+// Current resident set size in bytes
+std::size_t current_rss()
+{
+  std::ifstream f("/proc/self/statm", std::ios_base::in);
+  std::size_t vsize = 0, rss = 0;
+  f >> vsize >> rss;
+  return rss * sysconf(_SC_PAGE_SIZE);
+}
+
+// Kernel high-water mark of the resident set size (VmHWM) in bytes
+std::size_t hwm_rss()
+{
+  std::ifstream f("/proc/self/status", std::ios_base::in);
+  for (std::string line; std::getline(f, line);)
+  {
+    if (line.starts_with("VmHWM:"))
+      return std::stoull(line.substr(6)) * 1024;
+  }
+  return 0;
+}
+
+// Reset the kernel high-water mark to the current resident set size.
+// Returns false if this is not supported.
+bool reset_hwm()
+{
+  std::ofstream f("/proc/self/clear_refs");
+  f << "5";
+  f.close();
+  return f.good();
+}
+
+struct MemoryProfiler
+{
+  std::mutex mutex;
+  std::thread thread;
+  std::atomic<bool> quit = false;
+  bool running = false;
+
+  // True if the kernel high-water mark can be reset at phase boundaries
+  bool use_hwm = false;
+
+  // Active phases (innermost last) and their high-water mark so far
+  std::vector<std::pair<std::string, std::size_t>> active;
+
+  // Resident set size at the start of each active phase
+  std::vector<std::size_t> starts;
+
+  // High-water mark of each completed phase
+  std::map<std::string, std::size_t> peaks;
+
+  // Largest growth of each completed phase, from its start to its
+  // high-water mark
+  std::map<std::string, std::size_t> growths;
+
+  // High-water mark since the last phase boundary
+  std::size_t boundary_peak() const
+  {
+    return use_hwm ? std::max(hwm_rss(), current_rss()) : current_rss();
+  }
+};
+
+MemoryProfiler& profiler()
+{
+  static MemoryProfiler p;
+  return p;
+}
+} // namespace
+
+void start_memory_profiler(std::chrono::milliseconds interval)
+{
+  MemoryProfiler& p = profiler();
+  if (p.running)
+    return;
+  p.use_hwm = reset_hwm();
+  p.quit = false;
+  p.running = true;
+  p.thread = std::thread(
+      [&p, interval]()
+      {
+        while (!p.quit)
+        {
+          const std::size_t rss = current_rss();
+          {
+            std::lock_guard<std::mutex> lock(p.mutex);
+            if (!p.active.empty())
+            {
+              p.active.back().second
+                  = std::max(p.active.back().second, rss);
+            }
+          }
+          std::this_thread::sleep_for(interval);
+        }
+      });
+}
+
+void stop_memory_profiler()
+{
+  MemoryProfiler& p = profiler();
+  if (!p.running)
+    return;
+  p.quit = true;
+  p.thread.join();
+  p.running = false;
+}
+
+void begin_memory_phase(const std::string& name)
+{
+  MemoryProfiler& p = profiler();
+  if (!p.running)
+    return;
+
+  std::lock_guard<std::mutex> lock(p.mutex);
+
+  // Attribute the peak since the last boundary to the enclosing phase
+  const std::size_t peak = p.boundary_peak();
+  if (!p.active.empty())
+    p.active.back().second = std::max(p.active.back().second, peak);
+  if (p.use_hwm)
+    reset_hwm();
+  const std::size_t rss = current_rss();
+  p.active.push_back({name, rss});
+  p.starts.push_back(rss);
+}
+
+void end_memory_phase(const std::string& name)
+{
+  MemoryProfiler& p = profiler();
+  if (!p.running)
+    return;
+
+  std::lock_guard<std::mutex> lock(p.mutex);
+  auto it = std::find_if(p.active.rbegin(), p.active.rend(),
+                         [&name](auto& phase) { return phase.first == name; });
+  if (it == p.active.rend())
+    return;
+
+  // The peak since the last boundary belongs to the innermost phase.
+  // Phases still active inside the ending phase also count towards it.
+  p.active.back().second
+      = std::max(p.active.back().second, p.boundary_peak());
+  if (p.use_hwm)
+    reset_hwm();
+  std::size_t peak = it->second;
+  for (auto inner = p.active.rbegin(); inner != it; ++inner)
+    peak = std::max(peak, inner->second);
+
+  // Remove phase and pass its peak to the enclosing phase
+  const std::size_t i = std::distance(p.active.begin(), std::prev(it.base()));
+  const std::size_t start = p.starts[i];
+  p.starts.erase(std::next(p.starts.begin(), i));
+  auto pos = p.active.erase(std::next(p.active.begin(), i));
+  if (pos != p.active.begin())
+    std::prev(pos)->second = std::max(std::prev(pos)->second, peak);
+
+  std::size_t& recorded = p.peaks[name];
+  recorded = std::max(recorded, peak);
+  std::size_t& growth = p.growths[name];
+  growth = std::max(growth, peak > start ? peak - start : 0);
+}
+
+std::size_t memory_phase_growth(const std::string& name)
+{
+  MemoryProfiler& p = profiler();
+  std::lock_guard<std::mutex> lock(p.mutex);
+  auto it = p.growths.find(name);
+  return it == p.growths.end() ? 0 : it->second;
+}
+
+void report_memory_phases(MPI_Comm comm)
+{
+  MemoryProfiler& p = profiler();
+  const int rank = dolfinx::MPI::rank(comm);
+  const int size = dolfinx::MPI::size(comm);
+
+  // Names of the phases on rank 0
+  std::string packed;
+  {
+    std::lock_guard<std::mutex> lock(p.mutex);
+    for (auto& [name, peak] : p.peaks)
+      packed += name + '\n';
+  }
+  int n = packed.size();
+  MPI_Bcast(&n, 1, MPI_INT, 0, comm);
+  packed.resize(n);
+  MPI_Bcast(packed.data(), n, MPI_CHAR, 0, comm);
+  std::vector<std::string> names;
+  std::istringstream ss(packed);
+  for (std::string name; std::getline(ss, name);)
+    names.push_back(name);
+  if (names.empty())
+    return;
 
-  const int page_size_bytes = sysconf(_SC_PAGE_SIZE);
+  std::vector<double> local(names.size(), 0);
+  {
+    std::lock_guard<std::mutex> lock(p.mutex);
+    for (std::size_t i = 0; i < names.size(); ++i)
+    {
+      if (auto it = p.peaks.find(names[i]); it != p.peaks.end())
+        local[i] = it->second;
+    }
+  }
 
-  while (!quit)
+  std::vector<double> vmin(names.size()), vmax(names.size()),
+      vsum(names.size());
+  MPI_Reduce(local.data(), vmin.data(), local.size(), MPI_DOUBLE, MPI_MIN, 0,
+             comm);
+  MPI_Reduce(local.data(), vmax.data(), local.size(), MPI_DOUBLE, MPI_MAX, 0,
+             comm);
+  MPI_Reduce(local.data(), vsum.data(), local.size(), MPI_DOUBLE, MPI_SUM, 0,
+             comm);
+  for (std::size_t i = 0; i < names.size(); ++i)
+    metrics::record_rank("peak_rss_bytes " + names[i], local[i]);
+
+  if (rank == 0)
+  {
+    constexpr double mb = 1024.0 * 1024.0;
+    std::cout << "Peak RSS per phase (MB) [min, mean, max over " << size
+              << " processes]" << std::endl;
+    for (std::size_t i = 0; i < names.size(); ++i)
+    {
+      std::cout << "  " << std::left << std::setw(50) << names[i]
+                << std::right << std::fixed << std::setprecision(1)
+                << std::setw(10) << vmin[i] / mb << std::setw(10)
+                << vsum[i] / size / mb << std::setw(10) << vmax[i] / mb
+                << std::endl;
+    }
+    std::cout << std::defaultfloat;
+  }
+}
+
+std::size_t peak_rss()
+{
+  // ru_maxrss is in kilobytes on Linux
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return static_cast<std::size_t>(usage.ru_maxrss) * 1024;
+}
+
+void print_memory_per_dof(MPI_Comm comm, const std::string& label,
+                          std::size_t bytes, std::int64_t num_dofs)
+{
+  std::array<double, 2> local = {static_cast<double>(bytes),
+                                 static_cast<double>(peak_rss())};
+  std::array<double, 2> global;
+  MPI_Reduce(local.data(), global.data(), 2, MPI_DOUBLE, MPI_SUM, 0, comm);
+  if (dolfinx::MPI::rank(comm) == 0)
   {
-    std::ifstream f("/proc/self/stat", std::ios_base::in);
-    std::istream_iterator<std::string> it(f);
-    std::advance(it, 21);
-
-    std::size_t vsize, rss;
-    f >> vsize >> rss;
-    f.close();
-    spdlog::warn("VSIZE={}, RSS={}", vsize / 1024,
-                 rss * page_size_bytes / 1024);
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    std::cout << label << ": " << global[0] / num_dofs
+              << " bytes/dof, peak RSS: " << global[1] / num_dofs
+              << " bytes/dof" << std::endl;
+    metrics::record(label + " (bytes/dof)", global[0] / num_dofs);
   }
 }
@@ -4,5 +4,59 @@
 //
 // SPDX-License-Identifier:    MIT
 
-/// Thread to output memory usage to logger
-void process_mem_usage(bool& quit);
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mpi.h>
+#include <string>
+
+/// Start the memory profiler on this process. A thread samples the
+/// resident set size at the given interval and attributes the
+/// high-water mark to the innermost active phase. Where supported
+/// (Linux), the kernel high-water mark (VmHWM) is also reset at each
+/// phase boundary so that peaks shorter than the sampling interval
+/// are captured.
+/// @param[in] interval Sampling interval
+void start_memory_profiler(std::chrono::milliseconds interval);
+
+/// Stop the memory profiler thread
+void stop_memory_profiler();
+
+/// Start a phase for memory attribution. Phases may be nested; the
+/// high-water mark of a phase includes that of its inner phases. Does
+/// nothing if the profiler is not running.
+/// @param[in] name Name of the phase
+void begin_memory_phase(const std::string& name);
+
+/// End a phase for memory attribution. If a phase runs more than once,
+/// the largest high-water mark is kept.
+/// @param[in] name Name of the phase
+void end_memory_phase(const std::string& name);
+
+/// Largest growth of the resident set size over a run of a completed
+/// phase on this process, from the start of the phase to its
+/// high-water mark
+/// @param[in] name Name of the phase
+/// @return Growth in bytes, or zero if the phase has not been profiled
+std::size_t memory_phase_growth(const std::string& name);
+
+/// Print (on rank 0) the min/max/mean over processes of the high-water
+/// resident set size of each phase, and record the values in the
+/// metrics. Collective.
+/// @param[in] comm Communicator
+void report_memory_phases(MPI_Comm comm);
+
+/// Peak resident set size (high-water mark) of this process in bytes
+std::size_t peak_rss();
+
+/// Print (on rank 0) the memory used for a linear operator and the
+/// peak resident set size, both summed over all processes and divided
+/// by the global number of degrees of freedom
+/// @param[in] comm Communicator
+/// @param[in] label Description of the operator storage
+/// @param[in] bytes Bytes used by the operator on this process
+/// @param[in] num_dofs Global number of degrees of freedom
+void print_memory_per_dof(MPI_Comm comm, const std::string& label,
+                          std::size_t bytes, std::int64_t num_dofs);
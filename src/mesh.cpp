@@ -13,13 +13,66 @@
 #include <dolfinx/mesh/MeshTags.h>
 #include <dolfinx/mesh/cell_types.h>
 #include <dolfinx/mesh/generation.h>
+#include <dolfinx/mesh/utils.h>
 #include <dolfinx/refinement/refine.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
 #include <memory>
 #include <numbers>
+#include <string>
+#include <stdexcept>
 #include <span>
+#include <tuple>
+#include <vector>
 
 namespace
 {
+// Graph partitioner of a given name, or the first available for
+// "default"
+dolfinx::graph::partition_fn graph_partitioner(const std::string& name)
+{
+  const std::vector<std::string> names = graph_partitioners();
+  const std::string p = name == "default" ? names.front() : name;
+  if (std::ranges::find(names, p) == names.end())
+  {
+    throw std::runtime_error("Graph partitioner '" + name
+                             + "' is not available in this build");
+  }
+#ifdef HAS_PARMETIS
+  if (p == "parmetis")
+    return dolfinx::graph::parmetis::partitioner();
+#endif
+#ifdef HAS_PTSCOTCH
+  if (p == "scotch")
+  {
+    return dolfinx::graph::scotch::partitioner(
+        dolfinx::graph::scotch::strategy::scalability);
+  }
+#endif
+#ifdef HAS_KAHIP
+  if (p == "kahip")
+    return dolfinx::graph::kahip::partitioner();
+#endif
+  throw std::runtime_error("Unknown graph partitioner: " + name);
+}
+
+// Cell partitioner of refined meshes, with a shared_facet ghost layer.
+// With "default" this is the DOLFINx default, so that refined meshes
+// are only repartitioned with a named partitioner if one is requested.
+dolfinx::mesh::CellPartitionFunction
+refinement_partitioner(const std::string& name)
+{
+  if (name == "default")
+  {
+    return dolfinx::mesh::create_cell_partitioner(
+        dolfinx::mesh::GhostMode::shared_facet);
+  }
+  return dolfinx::mesh::create_cell_partitioner(
+      dolfinx::mesh::GhostMode::shared_facet, graph_partitioner(name));
+}
+
 // The numbers of lower-dimensional cells of the CW complex of the right prism.
 //
 // The right prism with dimensions i x j x k is uniformly decomposed
@@ -54,8 +107,21 @@ num_entities(std::int64_t i, std::int64_t j, std::int64_t k, int nrefine) {
 }
 
 std::int64_t num_pdofs(std::int64_t i, std::int64_t j, std::int64_t k,
-                       int nrefine, int order)
+                       int nrefine, int order,
+                       dolfinx::mesh::CellType cell_type
+                       = dolfinx::mesh::CellType::tetrahedron)
 {
+  if (cell_type == dolfinx::mesh::CellType::hexahedron)
+  {
+    // Tensor-product Lagrange dofs on an i x j x k box of hexahedra
+    if (order < 1)
+      throw std::runtime_error("Order not supported");
+    i <<= nrefine;
+    j <<= nrefine;
+    k <<= nrefine;
+    return (order * i + 1) * (order * j + 1) * (order * k + 1);
+  }
+
   auto [nv, ne, nf, nc] = num_entities(i, j, k, nrefine);
 
   switch (order)
@@ -73,11 +139,53 @@ std::int64_t num_pdofs(std::int64_t i, std::int64_t j, std::int64_t k,
   }
 }
 
-} // namespace
+// Optimise number of dofs by trying nearby mesh sizes +/- 5 or 10 in
+// each dimension
+std::tuple<std::int64_t, std::int64_t, std::int64_t>
+optimise_box_size(std::int64_t Nx, int r, int order, std::int64_t N,
+                  dolfinx::mesh::CellType cell_type
+                  = dolfinx::mesh::CellType::tetrahedron)
+{
+  std::int64_t Ny = Nx;
+  std::int64_t Nz = Nx;
+  std::size_t mindiff = 1000000;
+  for (std::int64_t i = Nx - 10; i < Nx + 10; ++i)
+  {
+    for (std::int64_t j = i - 5; j < i + 5; ++j)
+    {
+      for (std::int64_t k = i - 5; k < i + 5; ++k)
+      {
+        if (i < 1 or j < 1 or k < 1)
+          continue;
+        std::size_t diff
+            = std::abs(num_pdofs(i, j, k, r, order, cell_type) - N);
+        if (diff < mindiff)
+        {
+          mindiff = diff;
+          Nx = i;
+          Ny = j;
+          Nz = k;
+        }
+      }
+    }
+  }
 
-dolfinx::mesh::Mesh<double>
-create_cube_mesh(MPI_Comm comm, std::size_t target_dofs, bool target_dofs_total,
-                 std::size_t dofs_per_node, int order, bool use_subcomm)
+  return {Nx, Ny, Nz};
+}
+
+// Create a unit cube mesh from a coarse partitioned box, uniformly
+// refined. With `keep_levels` every level of the hierarchy is kept,
+// the base mesh is kept small enough to be a cheap multigrid coarse
+// level, and refined cells stay on the process of their parent (so
+// that the parent cell maps are process-local). Otherwise only the
+// finest mesh is returned.
+MeshHierarchy create_cube_hierarchy(MPI_Comm comm, std::size_t target_dofs,
+                                    bool target_dofs_total,
+                                    std::size_t dofs_per_node, int order,
+                                    bool use_subcomm,
+                                    dolfinx::mesh::CellType cell_type,
+                                    bool keep_levels,
+                                    const std::string& partitioner)
 {
   // Get number of processes
   const std::size_t num_processes = dolfinx::MPI::size(comm);
@@ -94,8 +202,17 @@ create_cube_mesh(MPI_Comm comm, std::size_t target_dofs, bool target_dofs_total,
 
   // Choose Nx_max carefully. If too large, the base mesh may become too
   // large for the partitioner; likewise, if too small, it will fail on
-  // large numbers of processes.
-  const std::int64_t Nx_max = 200;
+  // large numbers of processes. Hexahedral meshes cannot be refined, so
+  // the base mesh is always created at full size. For a multigrid
+  // hierarchy the base mesh (the coarse level) is limited to a few tens
+  // of cells per process.
+  const bool hex = cell_type == dolfinx::mesh::CellType::hexahedron;
+  std::int64_t Nx_max = hex ? std::numeric_limits<std::int64_t>::max() : 200;
+  if (keep_levels)
+  {
+    Nx_max = std::max<std::int64_t>(
+        8, std::ceil(std::cbrt(32.0 * num_processes / 6)));
+  }
 
   // Get initial guess for Nx, Ny, Nz, r
   Nx = 1;
@@ -113,53 +230,21 @@ create_cube_mesh(MPI_Comm comm, std::size_t target_dofs, bool target_dofs_total,
       {
         // Keep on refining until we have overshot
         ++r;
-        ndofs = num_pdofs(Nx, Nx, Nx, r, order);
+        ndofs = num_pdofs(Nx, Nx, Nx, r, order, cell_type);
       }
       while (ndofs > N)
       {
         // Shrink base mesh until dofs are back on target
         --Nx;
-        ndofs = num_pdofs(Nx, Nx, Nx, r, order);
+        ndofs = num_pdofs(Nx, Nx, Nx, r, order, cell_type);
       }
     }
-    ndofs = num_pdofs(Nx, Nx, Nx, r, order);
+    ndofs = num_pdofs(Nx, Nx, Nx, r, order, cell_type);
   }
 
-  Ny = Nx;
-  Nz = Nx;
-
-  // Optimise number of dofs by trying nearby mesh sizes +/- 5 or 10 in
-  // each dimension
+  std::tie(Nx, Ny, Nz) = optimise_box_size(Nx, r, order, N, cell_type);
 
-  std::size_t mindiff = 1000000;
-  for (std::int64_t i = Nx - 10; i < Nx + 10; ++i)
-  {
-    for (std::int64_t j = i - 5; j < i + 5; ++j)
-    {
-      for (std::int64_t k = i - 5; k < i + 5; ++k)
-      {
-        std::size_t diff = std::abs(num_pdofs(i, j, k, r, order) - N);
-        if (diff < mindiff)
-        {
-          mindiff = diff;
-          Nx = i;
-          Ny = j;
-          Nz = k;
-        }
-      }
-    }
-  }
-
-#ifdef HAS_PARMETIS
-  auto graph_part = dolfinx::graph::parmetis::partitioner();
-#elif HAS_PTSCOTCH
-  auto graph_part = dolfinx::graph::scotch::partitioner(
-      dolfinx::graph::scotch::strategy::scalability);
-#elif HAS_KAHIP
-  auto graph_part = dolfinx::graph::kahip::partitioner();
-#else
-#error "No mesh partitioner has been selected"
-#endif
+  auto graph_part = graph_partitioner(partitioner);
 
   MPI_Comm sub_comm;
 
@@ -181,34 +266,284 @@ create_cube_mesh(MPI_Comm comm, std::size_t target_dofs, bool target_dofs_total,
 
   auto cell_part = dolfinx::mesh::create_cell_partitioner(
       dolfinx::mesh::GhostMode::none, graph_part);
-  auto mesh = dolfinx::mesh::create_box(
-      comm, sub_comm, {{{0.0, 0.0, 0.0}, {1.0, 1.0, 1.0}}}, {Nx, Ny, Nz},
-      dolfinx::mesh::CellType::tetrahedron, cell_part);
+  MeshHierarchy hierarchy;
+  hierarchy.meshes.push_back(std::make_shared<dolfinx::mesh::Mesh<double>>(
+      dolfinx::mesh::create_box(comm, sub_comm,
+                                {{{0.0, 0.0, 0.0}, {1.0, 1.0, 1.0}}},
+                                {Nx, Ny, Nz}, cell_type, cell_part)));
 
   MPI_Comm_free(&sub_comm);
 
-  if (dolfinx::MPI::rank(mesh.comm()) == 0)
+  if (dolfinx::MPI::rank(comm) == 0)
   {
     std::cout << "UnitCube (" << Nx << "x" << Ny << "x" << Nz
               << ") to be refined " << r << " times" << std::endl;
   }
 
+  // Refined meshes are repartitioned, unless the levels are kept
+  dolfinx::mesh::CellPartitionFunction refined_part = nullptr;
+  if (!keep_levels)
+    refined_part = refinement_partitioner(partitioner);
+
   for (int i = 0; i < r; ++i)
   {
-    mesh.topology_mutable()->create_connectivity(3, 1);
-    auto [new_mesh, _parent_edges, _parent_facet] = dolfinx::refinement::refine(
-      mesh, std::nullopt,
-      dolfinx::mesh::create_cell_partitioner(dolfinx::mesh::GhostMode::shared_facet),
-      dolfinx::refinement::Option::parent_cell_and_facet);
-    mesh = std::move(new_mesh);
+    auto mesh = hierarchy.meshes.back();
+    mesh->topology_mutable()->create_connectivity(3, 1);
+    auto [new_mesh, parent_cell, _parent_facet] = dolfinx::refinement::refine(
+        *mesh, std::nullopt, refined_part,
+        dolfinx::refinement::Option::parent_cell_and_facet);
+    auto fine = std::make_shared<dolfinx::mesh::Mesh<double>>(
+        std::move(new_mesh));
+    if (keep_levels)
+    {
+      hierarchy.meshes.push_back(fine);
+      hierarchy.parent_cells.push_back(std::move(parent_cell.value()));
+    }
+    else
+      hierarchy.meshes.back() = fine;
+  }
+
+  return hierarchy;
+}
+} // namespace
+//-----------------------------------------------------------------------------
+std::vector<std::string> graph_partitioners()
+{
+  std::vector<std::string> names;
+#ifdef HAS_PARMETIS
+  names.push_back("parmetis");
+#endif
+#ifdef HAS_PTSCOTCH
+  names.push_back("scotch");
+#endif
+#ifdef HAS_KAHIP
+  names.push_back("kahip");
+#endif
+#if !defined(HAS_PARMETIS) && !defined(HAS_PTSCOTCH) && !defined(HAS_KAHIP)
+#error "No mesh partitioner has been selected"
+#endif
+  return names;
+}
+//-----------------------------------------------------------------------------
+dolfinx::mesh::Mesh<double>
+create_cube_mesh(MPI_Comm comm, std::size_t target_dofs, bool target_dofs_total,
+                 std::size_t dofs_per_node, int order, bool use_subcomm,
+                 dolfinx::mesh::CellType cell_type,
+                 const std::string& partitioner)
+{
+  MeshHierarchy hierarchy
+      = create_cube_hierarchy(comm, target_dofs, target_dofs_total,
+                              dofs_per_node, order, use_subcomm, cell_type,
+                              false, partitioner);
+  return std::move(*hierarchy.meshes.back());
+}
+//-----------------------------------------------------------------------------
+MeshHierarchy create_cube_mesh_hierarchy(MPI_Comm comm,
+                                         std::size_t target_dofs,
+                                         bool target_dofs_total,
+                                         std::size_t dofs_per_node, int order,
+                                         bool use_subcomm,
+                                         const std::string& partitioner)
+{
+  return create_cube_hierarchy(comm, target_dofs, target_dofs_total,
+                               dofs_per_node, order, use_subcomm,
+                               dolfinx::mesh::CellType::tetrahedron, true,
+                               partitioner);
+}
+//-----------------------------------------------------------------------------
+dolfinx::mesh::Mesh<double>
+create_cube_mesh_direct(MPI_Comm comm, std::size_t target_dofs,
+                        bool target_dofs_total, std::size_t dofs_per_node,
+                        int order)
+{
+  const int num_processes = dolfinx::MPI::size(comm);
+  const int rank = dolfinx::MPI::rank(comm);
+
+  // Target total dofs
+  std::int64_t N = 0;
+  if (target_dofs_total == true)
+    N = target_dofs / dofs_per_node;
+  else
+    N = target_dofs * num_processes / dofs_per_node;
+
+  // Find global mesh size without refinement
+  std::int64_t Nx = 1;
+  while (num_pdofs(Nx, Nx, Nx, 0, order) < N)
+    ++Nx;
+  std::int64_t Ny, Nz;
+  std::tie(Nx, Ny, Nz) = optimise_box_size(Nx, 0, order, N);
+
+  // Cartesian process grid. The brick of process (p0, p1, p2) holds the
+  // cubes [c0, c1) in each direction, and owns the vertices [c0, c1),
+  // or [c0, c1] for the last brick in a direction.
+  std::array<int, 3> dims = {0, 0, 0};
+  MPI_Dims_create(num_processes, 3, dims.data());
+  if (dims[0] > Nx or dims[1] > Ny or dims[2] > Nz)
+    throw std::runtime_error("Too few cells for the process grid");
+  const std::array<std::int64_t, 3> n = {Nx, Ny, Nz};
+  auto brick = [&dims](int r) -> std::array<int, 3>
+  { return {r % dims[0], (r / dims[0]) % dims[1], r / (dims[0] * dims[1])}; };
+  auto brick_rank = [&dims](const std::array<int, 3>& q)
+  { return q[0] + dims[0] * (q[1] + dims[1] * q[2]); };
+  // First cube, and one past the last cube, of brick q in direction d
+  auto lo = [&](int d, int q) { return n[d] * q / dims[d]; };
+  auto hi = [&](int d, int q) { return n[d] * (q + 1) / dims[d]; };
+  auto num_owned = [&](int d, int q)
+  { return hi(d, q) - lo(d, q) + (q == dims[d] - 1 ? 1 : 0); };
+
+  // Brick coordinate of the owner of each vertex position, in each
+  // direction
+  std::array<std::vector<int>, 3> owner;
+  for (int d = 0; d < 3; ++d)
+  {
+    owner[d].resize(n[d] + 1);
+    for (int q = 0; q < dims[d]; ++q)
+    {
+      std::fill(std::next(owner[d].begin(), lo(d, q)),
+                std::next(owner[d].begin(), lo(d, q) + num_owned(d, q)),
+                q);
+    }
+  }
+
+  // The vertices are numbered brick by brick, so that each process
+  // provides the coordinates of its own vertices
+  std::vector<std::int64_t> vertex_offset(num_processes + 1, 0);
+  for (int r = 0; r < num_processes; ++r)
+  {
+    const std::array<int, 3> q = brick(r);
+    vertex_offset[r + 1] = vertex_offset[r]
+                           + num_owned(0, q[0]) * num_owned(1, q[1])
+                                 * num_owned(2, q[2]);
+  }
+  auto vertex = [&](std::int64_t i, std::int64_t j, std::int64_t k)
+  {
+    const std::array<int, 3> q = {owner[0][i], owner[1][j], owner[2][k]};
+    return vertex_offset[brick_rank(q)] + (i - lo(0, q[0]))
+           + num_owned(0, q[0])
+                 * ((j - lo(1, q[1]))
+                    + num_owned(1, q[1]) * (k - lo(2, q[2])));
+  };
+
+  const std::array<int, 3> p = brick(rank);
+  std::array<std::int64_t, 3> c0, c1;
+  for (int d = 0; d < 3; ++d)
+  {
+    c0[d] = lo(d, p[d]);
+    c1[d] = hi(d, p[d]);
+  }
+
+  // Split each cube into 6 tetrahedra, which share the diagonal from
+  // corner 0 to corner 7 (same as dolfinx::mesh::create_box). Bit d of
+  // a corner number is its offset in direction d.
+  constexpr int tets[6][4] = {{0, 1, 3, 7}, {0, 1, 7, 5}, {0, 5, 7, 4},
+                              {0, 3, 2, 7}, {0, 6, 4, 7}, {0, 2, 6, 7}};
+
+  // Each cell is owned by this process and ghosted on the processes
+  // of the bricks across its facets on the brick boundary (the
+  // shared_facet ghost layer of the refined cube meshes)
+  std::vector<std::int64_t> cells;
+  std::vector<std::int32_t> dest, dest_offsets = {0};
+  const std::size_t num_cells
+      = 6 * (c1[0] - c0[0]) * (c1[1] - c0[1]) * (c1[2] - c0[2]);
+  cells.reserve(4 * num_cells);
+  dest.reserve(num_cells);
+  dest_offsets.reserve(num_cells + 1);
+  for (std::int64_t k = c0[2]; k < c1[2]; ++k)
+  {
+    for (std::int64_t j = c0[1]; j < c1[1]; ++j)
+    {
+      for (std::int64_t i = c0[0]; i < c1[0]; ++i)
+      {
+        const std::array<std::int64_t, 3> cube = {i, j, k};
+        for (auto& tet : tets)
+        {
+          for (int corner : tet)
+          {
+            cells.push_back(vertex(i + (corner & 1), j + ((corner >> 1) & 1),
+                                   k + ((corner >> 2) & 1)));
+          }
+
+          dest.push_back(rank);
+          for (int f = 0; f < 4; ++f)
+          {
+            // Facet opposite vertex f, and the direction (if any) in
+            // which its three corners have the same offset
+            std::array<int, 3> facet;
+            for (int v = 0, m = 0; v < 4; ++v)
+              if (v != f)
+                facet[m++] = tet[v];
+            for (int d = 0; d < 3; ++d)
+            {
+              const int b = (facet[0] >> d) & 1;
+              if (((facet[1] >> d) & 1) != b or ((facet[2] >> d) & 1) != b)
+                continue;
+              const std::int64_t plane = cube[d] + b;
+              std::array<int, 3> q = p;
+              if (plane == c0[d] and c0[d] > 0)
+                --q[d];
+              else if (plane == c1[d] and c1[d] < n[d])
+                ++q[d];
+              else
+                continue;
+              const int r = brick_rank(q);
+              if (std::find(std::next(dest.begin(), dest_offsets.back()),
+                            dest.end(), r)
+                  == dest.end())
+              {
+                dest.push_back(r);
+              }
+            }
+          }
+          dest_offsets.push_back(dest.size());
+        }
+      }
+    }
+  }
+
+  // Coordinates of the vertices owned by this process, in the order of
+  // their global numbers
+  std::vector<double> x;
+  x.reserve(3 * (vertex_offset[rank + 1] - vertex_offset[rank]));
+  for (std::int64_t k = c0[2]; k < c0[2] + num_owned(2, p[2]); ++k)
+  {
+    for (std::int64_t j = c0[1]; j < c0[1] + num_owned(1, p[1]); ++j)
+    {
+      for (std::int64_t i = c0[0]; i < c0[0] + num_owned(0, p[0]); ++i)
+      {
+        x.insert(x.end(), {static_cast<double>(i) / Nx,
+                           static_cast<double>(j) / Ny,
+                           static_cast<double>(k) / Nz});
+      }
+    }
+  }
+
+  if (rank == 0)
+  {
+    std::cout << "UnitCube (" << Nx << "x" << Ny << "x" << Nz
+              << ") generated on a " << dims[0] << "x" << dims[1] << "x"
+              << dims[2] << " process grid" << std::endl;
   }
 
-  return mesh;
+  // The 'partitioner' returns the destinations computed above, so that
+  // cells stay on the process that created them, with no graph
+  // partitioning
+  dolfinx::mesh::CellPartitionFunction partitioner
+      = [dest = dolfinx::graph::AdjacencyList<std::int32_t>(
+             std::move(dest), std::move(dest_offsets))](
+            MPI_Comm, int, const std::vector<dolfinx::mesh::CellType>&,
+            const std::vector<std::span<const std::int64_t>>&)
+  { return dest; };
+
+  dolfinx::fem::CoordinateElement<double> element(
+      dolfinx::mesh::CellType::tetrahedron, 1);
+  return dolfinx::mesh::create_mesh(comm, comm, cells, element, comm, x,
+                                    {x.size() / 3, 3}, partitioner);
 }
 //-----------------------------------------------------------------------------
 std::shared_ptr<dolfinx::mesh::Mesh<double>>
 create_spoke_mesh(MPI_Comm comm, std::size_t target_dofs,
-                  bool target_dofs_total, std::size_t dofs_per_node)
+                  bool target_dofs_total, std::size_t dofs_per_node,
+                  const std::string& partitioner)
 {
   int target = target_dofs / dofs_per_node;
   int mpi_size = dolfinx::MPI::size(comm);
@@ -363,9 +698,12 @@ create_spoke_mesh(MPI_Comm comm, std::size_t target_dofs,
   dolfinx::fem::CoordinateElement<double> element(
       dolfinx::mesh::CellType::tetrahedron, 1);
 
+  auto graph_part = graph_partitioner(partitioner);
   auto mesh = std::make_shared<dolfinx::mesh::Mesh<double>>(
-      dolfinx::mesh::create_mesh(comm, topo, element, x, {x.size() / 3, 3},
-                                 dolfinx::mesh::GhostMode::none));
+      dolfinx::mesh::create_mesh(
+          comm, comm, topo, element, comm, x, {x.size() / 3, 3},
+          dolfinx::mesh::create_cell_partitioner(
+              dolfinx::mesh::GhostMode::none, graph_part)));
 
   mesh->topology_mutable()->create_entities(1);
 
@@ -375,7 +713,7 @@ create_spoke_mesh(MPI_Comm comm, std::size_t target_dofs,
   {
     auto [new_mesh, _parent_edges, _parent_facet] = dolfinx::refinement::refine(
       *mesh, std::nullopt,
-      dolfinx::mesh::create_cell_partitioner(dolfinx::mesh::GhostMode::shared_facet),
+      refinement_partitioner(partitioner),
       dolfinx::refinement::Option::parent_cell_and_facet);
     mesh = std::make_shared<dolfinx::mesh::Mesh<double>>(new_mesh);
     mesh->topology_mutable()->create_entities(1);
@@ -413,7 +751,7 @@ create_spoke_mesh(MPI_Comm comm, std::size_t target_dofs,
 
     auto [new_mesh, _parent_edges, _parent_facet] = dolfinx::refinement::refine(
       *mesh, marked_edges,
-      dolfinx::mesh::create_cell_partitioner(dolfinx::mesh::GhostMode::shared_facet),
+      refinement_partitioner(partitioner),
       dolfinx::refinement::Option::parent_cell_and_facet);
     meshi = std::make_shared<dolfinx::mesh::Mesh<double>>(new_mesh);
 
@@ -451,3 +789,181 @@ create_spoke_mesh(MPI_Comm comm, std::size_t target_dofs,
 
   return meshi;
 }
+//-----------------------------------------------------------------------------
+namespace
+{
+// Identifies mesh cache files (and their layout version)
+constexpr std::int64_t mesh_cache_magic = 0x4d455348434143;
+constexpr std::int64_t mesh_cache_version = 1;
+
+// Number of bytes of the data of one process in a mesh cache file
+std::int64_t cache_segment_bytes(std::int64_t num_cells,
+                                 std::int64_t num_dest,
+                                 std::int64_t num_nodes, int nodes_per_cell)
+{
+  return num_cells * nodes_per_cell * sizeof(std::int64_t)
+         + (num_cells + 1 + num_dest) * sizeof(std::int32_t)
+         + 3 * num_nodes * sizeof(double);
+}
+} // namespace
+//-----------------------------------------------------------------------------
+void write_mesh_cache(const dolfinx::mesh::Mesh<double>& mesh,
+                      const std::string& filename)
+{
+  MPI_Comm comm = mesh.comm();
+  const int rank = dolfinx::MPI::rank(comm);
+  const int size = dolfinx::MPI::size(comm);
+
+  // Owned cells, as global geometry node indices
+  const int tdim = mesh.topology()->dim();
+  auto cell_map = mesh.topology()->index_map(tdim);
+  const std::int32_t num_cells = cell_map->size_local();
+  auto x_dofmap = mesh.geometry().dofmap();
+  const int nodes_per_cell = x_dofmap.extent(1);
+  std::vector<std::int32_t> cells_local(
+      x_dofmap.data_handle(),
+      x_dofmap.data_handle() + num_cells * nodes_per_cell);
+  std::vector<std::int64_t> cells(cells_local.size());
+  auto x_map = mesh.geometry().index_map();
+  x_map->local_to_global(cells_local, cells);
+
+  // Destination of each owned cell: this process, then the processes
+  // that have the cell as a ghost
+  const dolfinx::graph::AdjacencyList<int> ghost_ranks
+      = cell_map->index_to_dest_ranks();
+  std::vector<std::int32_t> dest_offsets(num_cells + 1, 0), dest;
+  for (std::int32_t c = 0; c < num_cells; ++c)
+  {
+    dest.push_back(rank);
+    if (c < ghost_ranks.num_nodes())
+    {
+      auto r = ghost_ranks.links(c);
+      dest.insert(dest.end(), r.begin(), r.end());
+    }
+    dest_offsets[c + 1] = dest.size();
+  }
+
+  // Coordinates of owned nodes
+  const std::int32_t num_nodes = x_map->size_local();
+  std::span<const double> x = mesh.geometry().x().subspan(0, 3 * num_nodes);
+
+  // Sizes of the data on each process
+  std::array<std::int64_t, 3> local_sizes
+      = {num_cells, static_cast<std::int64_t>(dest.size()), num_nodes};
+  std::vector<std::int64_t> sizes(3 * size);
+  MPI_Allgather(local_sizes.data(), 3, MPI_INT64_T, sizes.data(), 3,
+                MPI_INT64_T, comm);
+  const std::array<std::int64_t, 4> header
+      = {mesh_cache_magic, mesh_cache_version, size, nodes_per_cell};
+  std::int64_t offset = (header.size() + sizes.size()) * sizeof(std::int64_t);
+  for (int r = 0; r < rank; ++r)
+  {
+    offset += cache_segment_bytes(sizes[3 * r], sizes[3 * r + 1],
+                                  sizes[3 * r + 2], nodes_per_cell);
+  }
+
+  MPI_File fh;
+  if (MPI_File_open(comm, filename.c_str(), MPI_MODE_CREATE | MPI_MODE_WRONLY,
+                    MPI_INFO_NULL, &fh)
+      != MPI_SUCCESS)
+  {
+    throw std::runtime_error("Unable to open mesh cache file: " + filename);
+  }
+  MPI_File_set_size(fh, 0);
+  if (rank == 0)
+  {
+    MPI_File_write_at(fh, 0, header.data(), header.size(), MPI_INT64_T,
+                      MPI_STATUS_IGNORE);
+    MPI_File_write_at(fh, header.size() * sizeof(std::int64_t), sizes.data(),
+                      sizes.size(), MPI_INT64_T, MPI_STATUS_IGNORE);
+  }
+  MPI_File_write_at_all(fh, offset, cells.data(), cells.size(), MPI_INT64_T,
+                        MPI_STATUS_IGNORE);
+  offset += cells.size() * sizeof(std::int64_t);
+  MPI_File_write_at_all(fh, offset, dest_offsets.data(), dest_offsets.size(),
+                        MPI_INT32_T, MPI_STATUS_IGNORE);
+  offset += dest_offsets.size() * sizeof(std::int32_t);
+  MPI_File_write_at_all(fh, offset, dest.data(), dest.size(), MPI_INT32_T,
+                        MPI_STATUS_IGNORE);
+  offset += dest.size() * sizeof(std::int32_t);
+  MPI_File_write_at_all(fh, offset, x.data(), x.size(), MPI_DOUBLE,
+                        MPI_STATUS_IGNORE);
+  MPI_File_close(&fh);
+}
+//-----------------------------------------------------------------------------
+dolfinx::mesh::Mesh<double> read_mesh_cache(MPI_Comm comm,
+                                            const std::string& filename)
+{
+  const int rank = dolfinx::MPI::rank(comm);
+  const int size = dolfinx::MPI::size(comm);
+
+  MPI_File fh;
+  if (MPI_File_open(comm, filename.c_str(), MPI_MODE_RDONLY, MPI_INFO_NULL,
+                    &fh)
+      != MPI_SUCCESS)
+  {
+    throw std::runtime_error("Unable to open mesh cache file: " + filename);
+  }
+
+  std::array<std::int64_t, 4> header;
+  MPI_File_read_at_all(fh, 0, header.data(), header.size(), MPI_INT64_T,
+                       MPI_STATUS_IGNORE);
+  if (header[0] != mesh_cache_magic or header[1] != mesh_cache_version)
+    throw std::runtime_error("Not a mesh cache file: " + filename);
+  if (header[2] != size)
+  {
+    throw std::runtime_error("Mesh cache was written on a different number "
+                             "of processes: "
+                             + filename);
+  }
+  const int nodes_per_cell = header[3];
+
+  std::vector<std::int64_t> sizes(3 * size);
+  MPI_File_read_at_all(fh, header.size() * sizeof(std::int64_t), sizes.data(),
+                       sizes.size(), MPI_INT64_T, MPI_STATUS_IGNORE);
+  std::int64_t offset = (header.size() + sizes.size()) * sizeof(std::int64_t);
+  for (int r = 0; r < rank; ++r)
+  {
+    offset += cache_segment_bytes(sizes[3 * r], sizes[3 * r + 1],
+                                  sizes[3 * r + 2], nodes_per_cell);
+  }
+
+  const std::int64_t num_cells = sizes[3 * rank];
+  const std::int64_t num_dest = sizes[3 * rank + 1];
+  const std::int64_t num_nodes = sizes[3 * rank + 2];
+  std::vector<std::int64_t> cells(num_cells * nodes_per_cell);
+  std::vector<std::int32_t> dest_offsets(num_cells + 1), dest(num_dest);
+  std::vector<double> x(3 * num_nodes);
+  MPI_File_read_at_all(fh, offset, cells.data(), cells.size(), MPI_INT64_T,
+                       MPI_STATUS_IGNORE);
+  offset += cells.size() * sizeof(std::int64_t);
+  MPI_File_read_at_all(fh, offset, dest_offsets.data(), dest_offsets.size(),
+                       MPI_INT32_T, MPI_STATUS_IGNORE);
+  offset += dest_offsets.size() * sizeof(std::int32_t);
+  MPI_File_read_at_all(fh, offset, dest.data(), dest.size(), MPI_INT32_T,
+                       MPI_STATUS_IGNORE);
+  offset += dest.size() * sizeof(std::int32_t);
+  MPI_File_read_at_all(fh, offset, x.data(), x.size(), MPI_DOUBLE,
+                       MPI_STATUS_IGNORE);
+  MPI_File_close(&fh);
+
+  // The 'partitioner' returns the stored destinations (owner and ghost
+  // processes) of the cells, so cells are not redistributed
+  dolfinx::mesh::CellPartitionFunction partitioner
+      = [dest = dolfinx::graph::AdjacencyList<std::int32_t>(
+             std::move(dest), std::move(dest_offsets))](
+            MPI_Comm, int, const std::vector<dolfinx::mesh::CellType>&,
+            const std::vector<std::span<const std::int64_t>>&)
+  { return dest; };
+
+  dolfinx::mesh::CellType cell_type;
+  if (nodes_per_cell == 4)
+    cell_type = dolfinx::mesh::CellType::tetrahedron;
+  else if (nodes_per_cell == 8)
+    cell_type = dolfinx::mesh::CellType::hexahedron;
+  else
+    throw std::runtime_error("Unsupported cell in mesh cache: " + filename);
+  dolfinx::fem::CoordinateElement<double> element(cell_type, 1);
+  return dolfinx::mesh::create_mesh(comm, comm, cells, element, comm, x,
+                                    {x.size() / 3, 3}, partitioner);
+}
@@ -4,8 +4,12 @@
 
 #pragma once
 
+#include <cstdint>
+#include <dolfinx/mesh/cell_types.h>
 #include <memory>
 #include <mpi.h>
+#include <string>
+#include <vector>
 
 namespace dolfinx::fem
 {
@@ -19,10 +23,73 @@ template <std::floating_point T>
 class Mesh;
 }
 
+/// Names of the graph partitioners available in this build (parmetis,
+/// scotch and kahip), the default first
+std::vector<std::string> graph_partitioners();
+
+/// Create a unit cube mesh, partitioned with a graph partitioner.
+/// Tetrahedral meshes are created coarse and then uniformly refined;
+/// hexahedral meshes are created at full size.
+/// @param[in] partitioner Graph partitioner, one of
+/// `graph_partitioners()` or `default`
 dolfinx::mesh::Mesh<double>
 create_cube_mesh(MPI_Comm comm, std::size_t target_dofs, bool target_dofs_total,
-                 std::size_t dofs_per_node, int order, bool use_subcomm);
+                 std::size_t dofs_per_node, int order, bool use_subcomm,
+                 dolfinx::mesh::CellType cell_type
+                 = dolfinx::mesh::CellType::tetrahedron,
+                 const std::string& partitioner = "default");
+
+/// A nested sequence of meshes created by uniform refinement
+struct MeshHierarchy
+{
+  /// Meshes, coarsest first. The last mesh is the finest.
+  std::vector<std::shared_ptr<dolfinx::mesh::Mesh<double>>> meshes;
+
+  /// parent_cells[i][c] is the local index of the cell of meshes[i]
+  /// that contains cell c of meshes[i + 1]
+  std::vector<std::vector<std::int32_t>> parent_cells;
+};
+
+/// Create a unit cube mesh of tetrahedra like `create_cube_mesh`,
+/// keeping every level of the refinement. The base mesh is smaller than
+/// for `create_cube_mesh`, so that there are more levels, and refined
+/// cells are not redistributed, so each cell is on the same process as
+/// its parent.
+MeshHierarchy create_cube_mesh_hierarchy(MPI_Comm comm,
+                                         std::size_t target_dofs,
+                                         bool target_dofs_total,
+                                         std::size_t dofs_per_node, int order,
+                                         bool use_subcomm,
+                                         const std::string& partitioner
+                                         = "default");
+
+/// Create a unit cube mesh of tetrahedra directly in parallel, without
+/// graph partitioning or refinement. The processes are arranged in a
+/// Cartesian grid and each process generates the cells of its own
+/// brick of the box.
+dolfinx::mesh::Mesh<double>
+create_cube_mesh_direct(MPI_Comm comm, std::size_t target_dofs,
+                        bool target_dofs_total, std::size_t dofs_per_node,
+                        int order);
 
 std::shared_ptr<dolfinx::mesh::Mesh<double>>
 create_spoke_mesh(MPI_Comm comm, std::size_t target_dofs,
-                  bool target_dofs_total, std::size_t dofs_per_node);
+                  bool target_dofs_total, std::size_t dofs_per_node,
+                  const std::string& partitioner = "default");
+
+/// Write a distributed mesh (cells, ghosting and coordinates) to a
+/// binary cache file with MPI-IO. Collective.
+/// @param[in] mesh Mesh to write
+/// @param[in] filename Name of the cache file
+void write_mesh_cache(const dolfinx::mesh::Mesh<double>& mesh,
+                      const std::string& filename);
+
+/// Read a mesh written by `write_mesh_cache`. The mesh must be read on
+/// the same number of processes as it was written on. Each process gets
+/// the cells (and ghost cells) it owned when the cache was written, so
+/// no graph partitioning is performed. Collective.
+/// @param[in] comm Communicator
+/// @param[in] filename Name of the cache file
+/// @return The mesh
+dolfinx::mesh::Mesh<double> read_mesh_cache(MPI_Comm comm,
+                                            const std::string& filename);
@@ -0,0 +1,347 @@
+// Copyright (C) 2026 The FEniCS Project
+//
+// This file is part of FEniCS-miniapp (https://www.fenicsproject.org)
+//
+// SPDX-License-Identifier:    MIT
+
+#include "metrics.h"
+#include "mem.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <dolfinx/common/MPI.h>
+#include <dolfinx/common/timing.h>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+// Recorded values, stored as JSON text
+std::map<std::string, std::string>& values()
+{
+  static std::map<std::string, std::string> v;
+  return v;
+}
+
+// Recorded per-rank values
+std::map<std::string, double>& rank_values()
+{
+  static std::map<std::string, double> v;
+  return v;
+}
+
+// Completed points of a scaling sweep, as JSON objects
+std::vector<std::string>& points()
+{
+  static std::vector<std::string> p;
+  return p;
+}
+
+// Values of the ZZZ timers on this process at the start of the current
+// sweep point
+std::map<std::string, double>& point_origin()
+{
+  static std::map<std::string, double> t;
+  return t;
+}
+
+std::string json_string(const std::string& s)
+{
+  std::string out = "\"";
+  for (char c : s)
+  {
+    if (c == '"' or c == '\\')
+    {
+      out += '\\';
+      out += c;
+    }
+    else if (static_cast<unsigned char>(c) < 0x20)
+    {
+      char buf[8];
+      std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+      out += buf;
+    }
+    else
+      out += c;
+  }
+  return out + "\"";
+}
+
+std::string json_number(double x)
+{
+  if (!std::isfinite(x))
+    return "null";
+  std::ostringstream s;
+  s << std::setprecision(17) << x;
+  return s.str();
+}
+
+// Broadcast a list of names from rank 0
+std::vector<std::string> bcast_names(MPI_Comm comm,
+                                     std::vector<std::string> names)
+{
+  std::string packed;
+  for (auto& n : names)
+    packed += n + '\n';
+  int size = packed.size();
+  MPI_Bcast(&size, 1, MPI_INT, 0, comm);
+  packed.resize(size);
+  MPI_Bcast(packed.data(), size, MPI_CHAR, 0, comm);
+
+  names.clear();
+  std::istringstream s(packed);
+  for (std::string n; std::getline(s, n);)
+    names.push_back(n);
+  return names;
+}
+
+// Gather one value per name from each rank to rank 0 and return JSON
+// objects with the values and their statistics. Entries are indexed
+// [name][rank].
+std::vector<std::string> rank_statistics(MPI_Comm comm,
+                                         const std::vector<double>& local,
+                                         bool include_values)
+{
+  const int size = dolfinx::MPI::size(comm);
+  const int rank = dolfinx::MPI::rank(comm);
+  std::vector<double> all(rank == 0 ? local.size() * size : 0);
+  MPI_Gather(local.data(), local.size(), MPI_DOUBLE, all.data(),
+             local.size(), MPI_DOUBLE, 0, comm);
+
+  std::vector<std::string> objects;
+  if (rank != 0)
+    return objects;
+
+  for (std::size_t i = 0; i < local.size(); ++i)
+  {
+    std::vector<double> v(size);
+    for (int r = 0; r < size; ++r)
+      v[r] = all[r * local.size() + i];
+
+    const auto [vmin, vmax] = std::ranges::minmax(v);
+    const double mean = std::accumulate(v.begin(), v.end(), 0.0) / size;
+    double var = 0;
+    for (double x : v)
+      var += (x - mean) * (x - mean);
+    const double stddev = std::sqrt(var / size);
+
+    std::string obj = "{\"min\": " + json_number(vmin)
+                      + ", \"max\": " + json_number(vmax)
+                      + ", \"mean\": " + json_number(mean)
+                      + ", \"stddev\": " + json_number(stddev)
+                      + ", \"imbalance\": "
+                      + json_number(mean != 0.0 ? vmax / mean : 1.0);
+    if (include_values)
+    {
+      obj += ", \"values\": [";
+      for (int r = 0; r < size; ++r)
+        obj += (r > 0 ? ", " : "") + json_number(v[r]);
+      obj += "]";
+    }
+    objects.push_back(obj + "}");
+  }
+
+  return objects;
+}
+
+// JSON object with the given members, one per line, closed at the
+// given indentation
+std::string json_object(const std::vector<std::string>& names,
+                        const std::vector<std::string>& values,
+                        const std::string& indent)
+{
+  std::string obj = "{";
+  for (std::size_t i = 0; i < names.size(); ++i)
+  {
+    obj += (i == 0 ? "\n" : ",\n") + indent + "  " + json_string(names[i])
+           + ": " + values[i];
+  }
+  return obj + "\n" + indent + "}";
+}
+} // namespace
+
+void metrics::record(const std::string& key, const std::string& value)
+{
+  values()[key] = json_string(value);
+}
+
+void metrics::record(const std::string& key, double value)
+{
+  values()[key] = json_number(value);
+}
+
+void metrics::record_integer(const std::string& key, long long value)
+{
+  values()[key] = std::to_string(value);
+}
+
+void metrics::record_rank(const std::string& key, double value)
+{
+  rank_values()[key] = value;
+}
+
+void metrics::begin_point()
+{
+  values().clear();
+  rank_values().clear();
+  point_origin().clear();
+  for (auto& [name, t] : dolfinx::timings())
+  {
+    if (name.starts_with("ZZZ"))
+      point_origin()[name] = t.second.count();
+  }
+}
+
+void metrics::end_point(MPI_Comm comm)
+{
+  // Timer increments since the start of the point, using the timer
+  // names on rank 0
+  auto timings = dolfinx::timings();
+  std::vector<std::string> timer_names;
+  for (auto& [name, t] : timings)
+  {
+    if (name.starts_with("ZZZ"))
+      timer_names.push_back(name);
+  }
+  timer_names = bcast_names(comm, timer_names);
+  std::vector<double> timer_local(timer_names.size(), 0);
+  for (std::size_t i = 0; i < timer_names.size(); ++i)
+  {
+    if (auto it = timings.find(timer_names[i]); it != timings.end())
+    {
+      timer_local[i] = it->second.second.count();
+      if (auto it0 = point_origin().find(timer_names[i]);
+          it0 != point_origin().end())
+      {
+        timer_local[i] -= it0->second;
+      }
+    }
+  }
+  const std::vector<std::string> timer_stats
+      = rank_statistics(comm, timer_local, false);
+
+  std::vector<std::string> rank_names;
+  for (auto& [name, v] : rank_values())
+    rank_names.push_back(name);
+  rank_names = bcast_names(comm, rank_names);
+  std::vector<double> rank_local(rank_names.size(), 0);
+  for (std::size_t i = 0; i < rank_names.size(); ++i)
+  {
+    if (auto it = rank_values().find(rank_names[i]);
+        it != rank_values().end())
+    {
+      rank_local[i] = it->second;
+    }
+  }
+  const std::vector<std::string> rank_stats
+      = rank_statistics(comm, rank_local, false);
+
+  if (dolfinx::MPI::rank(comm) == 0)
+  {
+    std::vector<std::string> run_names, run_values;
+    for (auto& [name, v] : values())
+    {
+      run_names.push_back(name);
+      run_values.push_back(v);
+    }
+    const std::string indent = "      ";
+    points().push_back(json_object(
+        {"run", "ranks", "timers"},
+        {json_object(run_names, run_values, indent),
+         json_object(rank_names, rank_stats, indent),
+         json_object(timer_names, timer_stats, indent)},
+        "    "));
+  }
+
+  values().clear();
+  rank_values().clear();
+}
+
+void metrics::write(MPI_Comm comm, const std::string& filename)
+{
+  const int rank = dolfinx::MPI::rank(comm);
+  record_rank("peak_rss_bytes", peak_rss());
+
+  // Timers (wall time) from this process, using the timer names on
+  // rank 0
+  auto timings = dolfinx::timings();
+  std::vector<std::string> timer_names;
+  for (auto& [name, t] : timings)
+  {
+    if (name.starts_with("ZZZ"))
+      timer_names.push_back(name);
+  }
+  timer_names = bcast_names(comm, timer_names);
+  std::vector<double> timer_local(timer_names.size(), 0);
+  std::vector<double> count_local(timer_names.size(), 0);
+  for (std::size_t i = 0; i < timer_names.size(); ++i)
+  {
+    if (auto it = timings.find(timer_names[i]); it != timings.end())
+    {
+      count_local[i] = it->second.first;
+      timer_local[i] = it->second.second.count();
+    }
+  }
+  const std::vector<std::string> timer_stats
+      = rank_statistics(comm, timer_local, false);
+
+  std::vector<std::string> rank_names;
+  for (auto& [name, v] : rank_values())
+    rank_names.push_back(name);
+  rank_names = bcast_names(comm, rank_names);
+  std::vector<double> rank_local(rank_names.size(), 0);
+  for (std::size_t i = 0; i < rank_names.size(); ++i)
+  {
+    if (auto it = rank_values().find(rank_names[i]);
+        it != rank_values().end())
+    {
+      rank_local[i] = it->second;
+    }
+  }
+  const std::vector<std::string> rank_stats
+      = rank_statistics(comm, rank_local, true);
+
+  if (rank != 0)
+    return;
+
+  std::ofstream file(filename);
+  if (!file)
+    throw std::runtime_error("Unable to open metrics file: " + filename);
+
+  file << "{\n  \"run\": {";
+  for (auto it = values().begin(); it != values().end(); ++it)
+  {
+    file << (it == values().begin() ? "\n" : ",\n") << "    "
+         << json_string(it->first) << ": " << it->second;
+  }
+  file << "\n  },\n  \"ranks\": {";
+  for (std::size_t i = 0; i < rank_names.size(); ++i)
+  {
+    file << (i == 0 ? "\n" : ",\n") << "    " << json_string(rank_names[i])
+         << ": " << rank_stats[i];
+  }
+  file << "\n  },\n  \"timers\": {";
+  for (std::size_t i = 0; i < timer_names.size(); ++i)
+  {
+    // Append the call count to the statistics object
+    std::string stats = timer_stats[i];
+    stats.insert(stats.size() - 1,
+                 ", \"count\": " + json_number(count_local[i]));
+    file << (i == 0 ? "\n" : ",\n") << "    " << json_string(timer_names[i])
+         << ": " << stats;
+  }
+  file << "\n  }";
+  if (!points().empty())
+  {
+    file << ",\n  \"sweep\": [";
+    for (std::size_t i = 0; i < points().size(); ++i)
+      file << (i == 0 ? "\n    " : ",\n    ") << points()[i];
+    file << "\n  ]";
+  }
+  file << "\n}\n";
+}
@@ -0,0 +1,57 @@
+// Copyright (C) 2026 The FEniCS Project
+//
+// This file is part of FEniCS-miniapp (https://www.fenicsproject.org)
+//
+// SPDX-License-Identifier:    MIT
+
+#pragma once
+
+#include <concepts>
+#include <mpi.h>
+#include <string>
+
+/// Collection of run metadata and results, written together with the
+/// statistics of all `ZZZ` timers over processes to a JSON file. Values
+/// are stored per process; the file contains the values recorded on
+/// rank 0 and, for per-rank values, the values from all ranks.
+namespace metrics
+{
+/// Record a value (overwrites an existing value with the same key)
+void record(const std::string& key, const std::string& value);
+
+/// Record a floating point value
+void record(const std::string& key, double value);
+
+/// Record an integer value
+void record_integer(const std::string& key, long long value);
+
+/// Record an integer value
+template <std::integral I>
+void record(const std::string& key, I value)
+{
+  record_integer(key, value);
+}
+
+/// Record a value that differs between processes. The file contains
+/// the values from all ranks, with their min/max/mean/stddev and load
+/// imbalance (max/mean).
+void record_rank(const std::string& key, double value);
+
+/// Start a point of a scaling sweep: clear the recorded values and
+/// take the current values of the `ZZZ` timers as the origin of the
+/// point's timers.
+void begin_point();
+
+/// End a point of a scaling sweep: store the recorded values, the
+/// statistics over the processes of `comm` of the per-rank values and
+/// of the `ZZZ` timer increments since `begin_point`, and clear the
+/// recorded values. The stored points are written to the metrics file
+/// as a "sweep" array. Collective on `comm`.
+/// @param[in] comm Communicator of the point
+void end_point(MPI_Comm comm);
+
+/// Write metrics to file from rank 0. Collective.
+/// @param[in] comm Communicator
+/// @param[in] filename Name of the JSON file
+void write(MPI_Comm comm, const std::string& filename);
+} // namespace metrics
@@ -0,0 +1,306 @@
+// Copyright (C) 2026 The FEniCS Project
+//
+// This file is part of FEniCS-miniapp (https://www.fenicsproject.org)
+//
+// SPDX-License-Identifier:    MIT
+
+#include "multigrid.h"
+#include "geometry.h"
+#include <algorithm>
+#include <cmath>
+#include <dolfinx/fem/DirichletBC.h>
+#include <dolfinx/fem/DofMap.h>
+#include <dolfinx/fem/Form.h>
+#include <dolfinx/fem/Function.h>
+#include <dolfinx/fem/assembler.h>
+#include <dolfinx/fem/petsc.h>
+#include <dolfinx/fem/utils.h>
+#include <dolfinx/mesh/Geometry.h>
+#include <dolfinx/mesh/Mesh.h>
+#include <numeric>
+#include <petscmat.h>
+#include <stdexcept>
+
+using namespace dolfinx;
+
+namespace
+{
+// Lagrange element of degree k with the variant used by the problems
+basix::FiniteElement<double> lagrange_element(int k)
+{
+  return basix::create_element<double>(
+      basix::element::family::P, basix::cell::type::tetrahedron, k,
+      basix::element::lagrange_variant::gll_warped,
+      basix::element::dpc_variant::unset, false);
+}
+} // namespace
+
+//-----------------------------------------------------------------------------
+multigrid::Transfer::Transfer(const fem::FunctionSpace<double>& Vc,
+                              const basix::FiniteElement<double>& element_c,
+                              const fem::FunctionSpace<double>& Vf,
+                              std::span<const std::int32_t> parent_cells)
+    : _map_c(Vc.dofmap()->index_map), _map_f(Vf.dofmap()->index_map),
+      _bs(Vf.dofmap()->index_map_bs())
+{
+  if (Vc.dofmap()->index_map_bs() != _bs)
+    throw std::runtime_error("Transfer requires spaces of equal block size");
+  const std::int32_t num_rows = _map_f->size_local();
+
+  // Coarse cell containing each owned fine dof
+  auto dofs_f = Vf.dofmap()->map();
+  const std::size_t nf = dofs_f.extent(1);
+  std::vector<std::int32_t> parent(num_rows, -1);
+  for (std::size_t c = 0; c < parent_cells.size(); ++c)
+  {
+    for (std::size_t i = 0; i < nf; ++i)
+    {
+      const std::int32_t d = dofs_f.data_handle()[c * nf + i];
+      if (d < num_rows and parent[d] < 0)
+        parent[d] = parent_cells[c];
+    }
+  }
+
+  // Reference coordinates of the owned fine dofs in their coarse cells
+  auto x_dofmap = Vc.mesh()->geometry().dofmap();
+  if (x_dofmap.extent(1) != 4)
+    throw std::runtime_error("Transfer requires affine tetrahedral cells");
+  std::span<const double> x_g = Vc.mesh()->geometry().x();
+  const std::vector<double> x = Vf.tabulate_dof_coordinates(false);
+  std::vector<double> X(3 * num_rows);
+  for (std::int32_t i = 0; i < num_rows; ++i)
+  {
+    if (parent[i] < 0)
+      throw std::runtime_error("Owned dof is not in any local cell");
+    auto nodes = std::span(x_dofmap.data_handle() + 4 * parent[i], 4);
+    auto [K, detJ] = matfree::affine_jacobian_inverse(x_g, nodes);
+    const double* x0 = x_g.data() + 3 * nodes[0];
+    for (int a = 0; a < 3; ++a)
+    {
+      X[3 * i + a] = 0;
+      for (int j = 0; j < 3; ++j)
+        X[3 * i + a] += K[3 * a + j] * (x[3 * i + j] - x0[j]);
+    }
+  }
+
+  // Tabulate the coarse basis at the fine dofs, in chunks of points to
+  // bound the size of the table. Values that vanish (the coarse dofs on
+  // cell entities that do not contain the point) are dropped.
+  auto dofs_c = Vc.dofmap()->map();
+  const std::size_t nc = dofs_c.extent(1);
+  constexpr std::int32_t chunk = 4096;
+  _offsets.reserve(num_rows + 1);
+  _offsets.push_back(0);
+  for (std::int32_t i0 = 0; i0 < num_rows; i0 += chunk)
+  {
+    const std::size_t n = std::min(chunk, num_rows - i0);
+    auto [phi, shape] = element_c.tabulate(
+        0, std::span<const double>(X.data() + 3 * i0, 3 * n), {n, 3});
+    if (shape[2] != nc)
+      throw std::runtime_error("Dofmap and element size do not match");
+    for (std::size_t i = 0; i < n; ++i)
+    {
+      const std::int32_t* cell_dofs
+          = dofs_c.data_handle() + parent[i0 + i] * nc;
+      for (std::size_t j = 0; j < nc; ++j)
+      {
+        const double v = phi[i * nc + j];
+        if (std::abs(v) > 1e-12)
+        {
+          _columns.push_back(cell_dofs[j]);
+          _values.push_back(v);
+        }
+      }
+      _offsets.push_back(_columns.size());
+    }
+  }
+}
+//-----------------------------------------------------------------------------
+Mat multigrid::Transfer::create_petsc_matrix() const
+{
+  const std::int32_t num_rows = _offsets.size() - 1;
+  std::int32_t max_row = 0;
+  for (std::int32_t i = 0; i < num_rows; ++i)
+    max_row = std::max(max_row, _offsets[i + 1] - _offsets[i]);
+
+  // Global indices of the coarse (owned and ghost) dofs
+  std::vector<std::int32_t> local(_map_c->size_local()
+                                  + _map_c->num_ghosts());
+  std::iota(local.begin(), local.end(), 0);
+  std::vector<std::int64_t> global(local.size());
+  _map_c->local_to_global(local, global);
+  const std::int64_t row0 = _map_f->local_range()[0];
+
+  Mat P;
+  MatCreate(_map_f->comm(), &P);
+  MatSetSizes(P, _bs * num_rows, _bs * _map_c->size_local(), PETSC_DETERMINE,
+              PETSC_DETERMINE);
+  MatSetBlockSizes(P, _bs, _bs);
+  MatSetType(P, MATAIJ);
+  MatSeqAIJSetPreallocation(P, max_row, nullptr);
+  MatMPIAIJSetPreallocation(P, max_row, nullptr, max_row, nullptr);
+
+  std::vector<PetscInt> cols;
+  std::vector<PetscScalar> vals;
+  for (std::int32_t i = 0; i < num_rows; ++i)
+  {
+    for (int k = 0; k < _bs; ++k)
+    {
+      const PetscInt row = _bs * (row0 + i) + k;
+      cols.clear();
+      vals.clear();
+      for (std::int32_t j = _offsets[i]; j < _offsets[i + 1]; ++j)
+      {
+        cols.push_back(_bs * global[_columns[j]] + k);
+        vals.push_back(_values[j]);
+      }
+      MatSetValues(P, 1, &row, cols.size(), cols.data(), vals.data(),
+                   INSERT_VALUES);
+    }
+  }
+  MatAssemblyBegin(P, MAT_FINAL_ASSEMBLY);
+  MatAssemblyEnd(P, MAT_FINAL_ASSEMBLY);
+
+  return P;
+}
+//-----------------------------------------------------------------------------
+std::vector<std::shared_ptr<fem::FunctionSpace<double>>>
+multigrid::create_spaces(
+    const MeshHierarchy& hierarchy,
+    std::shared_ptr<const fem::FiniteElement<double>> element,
+    std::shared_ptr<fem::FunctionSpace<double>> V)
+{
+  std::vector<std::shared_ptr<fem::FunctionSpace<double>>> spaces;
+  for (std::size_t l = 0; l + 1 < hierarchy.meshes.size(); ++l)
+  {
+    spaces.push_back(std::make_shared<fem::FunctionSpace<double>>(
+        fem::create_functionspace(hierarchy.meshes[l], element)));
+  }
+  spaces.push_back(V);
+  return spaces;
+}
+//-----------------------------------------------------------------------------
+std::vector<std::shared_ptr<const multigrid::Transfer>>
+multigrid::create_transfers(
+    const std::vector<std::shared_ptr<fem::FunctionSpace<double>>>& spaces,
+    const basix::FiniteElement<double>& element,
+    const MeshHierarchy& hierarchy)
+{
+  std::vector<std::shared_ptr<const Transfer>> transfers;
+  for (std::size_t l = 0; l + 1 < spaces.size(); ++l)
+  {
+    transfers.push_back(std::make_shared<const Transfer>(
+        *spaces[l], element, *spaces[l + 1], hierarchy.parent_cells[l]));
+  }
+  return transfers;
+}
+//-----------------------------------------------------------------------------
+std::vector<std::shared_ptr<fem::FunctionSpace<double>>>
+multigrid::create_p_spaces(std::shared_ptr<fem::FunctionSpace<double>> V,
+                           int order,
+                           const std::vector<std::size_t>& value_shape)
+{
+  std::vector<std::shared_ptr<fem::FunctionSpace<double>>> spaces;
+  for (int k = 1; k < order; ++k)
+  {
+    auto element = std::make_shared<const fem::FiniteElement<double>>(
+        lagrange_element(k), value_shape);
+    spaces.push_back(std::make_shared<fem::FunctionSpace<double>>(
+        fem::create_functionspace(V->mesh(), element)));
+  }
+  spaces.push_back(V);
+  return spaces;
+}
+//-----------------------------------------------------------------------------
+std::vector<std::shared_ptr<const multigrid::Transfer>>
+multigrid::create_p_transfers(
+    const std::vector<std::shared_ptr<fem::FunctionSpace<double>>>& spaces)
+{
+  // All levels share the mesh, so each cell is its own parent
+  auto topology = spaces.front()->mesh()->topology();
+  auto cell_map = topology->index_map(topology->dim());
+  std::vector<std::int32_t> cells(cell_map->size_local()
+                                  + cell_map->num_ghosts());
+  std::iota(cells.begin(), cells.end(), 0);
+
+  std::vector<std::shared_ptr<const Transfer>> transfers;
+  for (std::size_t l = 0; l + 1 < spaces.size(); ++l)
+  {
+    transfers.push_back(std::make_shared<const Transfer>(
+        *spaces[l], lagrange_element(l + 1), *spaces[l + 1], cells));
+  }
+  return transfers;
+}
+//-----------------------------------------------------------------------------
+std::shared_ptr<la::petsc::Matrix> multigrid::assemble_level_operator(
+    const ufcx_form& form, std::shared_ptr<fem::FunctionSpace<double>> V,
+    std::vector<std::int32_t> bc_dofs)
+{
+  auto u0 = std::make_shared<fem::Function<PetscScalar>>(V);
+  u0->x()->set(0);
+  auto bc = std::make_shared<const fem::DirichletBC<PetscScalar>>(
+      u0, std::move(bc_dofs));
+  const fem::Form<PetscScalar, double> a
+      = fem::create_form<PetscScalar>(form, {V, V}, {}, {}, {}, {});
+
+  auto A = std::make_shared<la::petsc::Matrix>(fem::petsc::create_matrix(a),
+                                               false);
+  fem::assemble_matrix<PetscScalar>(
+      la::petsc::Matrix::set_block_fn(A->mat(), ADD_VALUES), a, {*bc});
+  MatAssemblyBegin(A->mat(), MAT_FLUSH_ASSEMBLY);
+  MatAssemblyEnd(A->mat(), MAT_FLUSH_ASSEMBLY);
+  fem::set_diagonal<PetscScalar>(
+      la::petsc::Matrix::set_fn(A->mat(), INSERT_VALUES), *V, {*bc});
+  MatAssemblyBegin(A->mat(), MAT_FINAL_ASSEMBLY);
+  MatAssemblyEnd(A->mat(), MAT_FINAL_ASSEMBLY);
+  return A;
+}
+//-----------------------------------------------------------------------------
+void multigrid::set_pcmg(
+    KSP ksp, const std::vector<Mat>& operators,
+    const std::vector<std::shared_ptr<const Transfer>>& transfers,
+    const std::string& coarse_pc_type)
+{
+  PC pc;
+  KSPGetPC(ksp, &pc);
+  PCSetType(pc, PCMG);
+  const int num_levels = operators.size();
+  PCMGSetLevels(pc, num_levels, nullptr);
+  PCMGSetType(pc, PC_MG_MULTIPLICATIVE);
+  PCMGSetCycleType(pc, PC_MG_CYCLE_V);
+  PCMGSetGalerkin(pc, PC_MG_GALERKIN_NONE);
+
+  // Restriction is the transpose of the interpolation
+  for (int l = 1; l < num_levels; ++l)
+  {
+    Mat P = transfers[l - 1]->create_petsc_matrix();
+    PCMGSetInterpolation(pc, l, P);
+    MatDestroy(&P);
+  }
+
+  for (int l = 0; l < num_levels; ++l)
+  {
+    KSP smoother;
+    PCMGGetSmoother(pc, l, &smoother);
+    KSPSetOperators(smoother, operators[l], operators[l]);
+    if (l == 0)
+    {
+      if (!coarse_pc_type.empty())
+      {
+        KSPSetType(smoother, KSPPREONLY);
+        PC coarse_pc;
+        KSPGetPC(smoother, &coarse_pc);
+        PCSetType(coarse_pc, coarse_pc_type.c_str());
+      }
+      continue;
+    }
+
+    KSPSetType(smoother, KSPCHEBYSHEV);
+    KSPChebyshevEstEigSet(smoother, 0, 0.1, 0, 1.1);
+    KSPSetTolerances(smoother, PETSC_DEFAULT, PETSC_DEFAULT, PETSC_DEFAULT, 2);
+    KSPSetNormType(smoother, KSP_NORM_NONE);
+    PC smoother_pc;
+    KSPGetPC(smoother, &smoother_pc);
+    PCSetType(smoother_pc, PCJACOBI);
+  }
+}
@@ -0,0 +1,495 @@
+// Copyright (C) 2026 The FEniCS Project
+//
+// This file is part of FEniCS-miniapp (https://www.fenicsproject.org)
+//
+// SPDX-License-Identifier:    MIT
+
+#pragma once
+
+#include "cg.h"
+#include "mesh.h"
+#include <algorithm>
+#include <array>
+#include <basix/finite-element.h>
+#include <cmath>
+#include <cstdint>
+#include <dolfinx/common/IndexMap.h>
+#include <dolfinx/fem/FiniteElement.h>
+#include <dolfinx/fem/FunctionSpace.h>
+#include <dolfinx/la/Vector.h>
+#include <dolfinx/la/petsc.h>
+#include <functional>
+#include <memory>
+#include <petscksp.h>
+#include <span>
+#include <string>
+#include <ufcx.h>
+#include <vector>
+
+/// Multigrid preconditioners: geometric multigrid on a hierarchy of
+/// nested meshes, with transfer operators built from the parent cell
+/// maps of the refinement, and p-multigrid on Lagrange spaces of
+/// decreasing degree on one mesh. The transfers drive either a PETSc
+/// PCMG preconditioner (assembled operators) or a matrix-free V-cycle
+/// with Chebyshev smoothing.
+namespace multigrid
+{
+/// Interpolation from a coarse Lagrange space to a fine Lagrange space
+/// whose mesh is nested in (or equal to) the coarse mesh. Row i holds
+/// the values of the coarse basis functions at the coordinate of fine
+/// dof i; restriction is the transpose. Rows are stored for the owned
+/// fine dofs only, with columns indexed by local (owned and ghost)
+/// coarse dofs. For blocked spaces the interpolation acts on each
+/// component.
+class Transfer
+{
+public:
+  /// Create the interpolation operator
+  /// @param[in] Vc Coarse space, on an affine mesh
+  /// @param[in] element_c The basix element used to create `Vc`
+  /// @param[in] Vf Fine space, with the same block size as `Vc`
+  /// @param[in] parent_cells Local index of the coarse cell containing
+  /// each (owned and ghost) cell of the fine mesh
+  Transfer(const dolfinx::fem::FunctionSpace<double>& Vc,
+           const basix::FiniteElement<double>& element_c,
+           const dolfinx::fem::FunctionSpace<double>& Vf,
+           std::span<const std::int32_t> parent_cells);
+
+  /// Prolongation xf = P xc
+  /// @param[in] xc Coarse vector, including up-to-date ghost entries
+  /// @param[out] xf Fine vector. Ghost entries are updated.
+  template <typename U>
+  void prolong(const dolfinx::la::Vector<U>& xc,
+               dolfinx::la::Vector<U>& xf) const
+  {
+    std::span<const U> x = xc.array();
+    std::span<U> y = xf.mutable_array();
+    const std::int32_t num_rows = _offsets.size() - 1;
+    for (std::int32_t i = 0; i < num_rows; ++i)
+    {
+      for (int k = 0; k < _bs; ++k)
+      {
+        U v = 0;
+        for (std::int32_t j = _offsets[i]; j < _offsets[i + 1]; ++j)
+          v += _values[j] * x[_bs * _columns[j] + k];
+        y[_bs * i + k] = v;
+      }
+    }
+    xf.scatter_fwd();
+  }
+
+  /// Restriction xc = P^T xf
+  /// @param[in] xf Fine vector (owned entries are used)
+  /// @param[out] xc Coarse vector. Ghost entries are updated.
+  template <typename U>
+  void restrict_transpose(const dolfinx::la::Vector<U>& xf,
+                          dolfinx::la::Vector<U>& xc) const
+  {
+    xc.set(0);
+    std::span<const U> x = xf.array();
+    std::span<U> y = xc.mutable_array();
+    const std::int32_t num_rows = _offsets.size() - 1;
+    for (std::int32_t i = 0; i < num_rows; ++i)
+    {
+      for (std::int32_t j = _offsets[i]; j < _offsets[i + 1]; ++j)
+      {
+        for (int k = 0; k < _bs; ++k)
+          y[_bs * _columns[j] + k] += _values[j] * x[_bs * i + k];
+      }
+    }
+    xc.scatter_rev(std::plus<U>());
+    xc.scatter_fwd();
+  }
+
+  /// Create the interpolation operator as a PETSc AIJ matrix, with the
+  /// row and column layouts of the fine and coarse spaces. The caller
+  /// is responsible for destroying the matrix.
+  Mat create_petsc_matrix() const;
+
+private:
+  std::shared_ptr<const dolfinx::common::IndexMap> _map_c, _map_f;
+  int _bs;
+
+  // Interpolation matrix (CSR) of the blocks of owned fine dofs
+  std::vector<std::int32_t> _offsets, _columns;
+  std::vector<double> _values;
+};
+
+/// Create the function spaces on the levels of a mesh hierarchy
+/// @param[in] hierarchy Mesh hierarchy
+/// @param[in] element Finite element
+/// @param[in] V Space on the finest mesh of the hierarchy, used as the
+/// finest level
+/// @return Spaces, coarsest first
+std::vector<std::shared_ptr<dolfinx::fem::FunctionSpace<double>>>
+create_spaces(
+    const MeshHierarchy& hierarchy,
+    std::shared_ptr<const dolfinx::fem::FiniteElement<double>> element,
+    std::shared_ptr<dolfinx::fem::FunctionSpace<double>> V);
+
+/// Create the transfer operators between consecutive levels
+/// @param[in] spaces Spaces from `create_spaces`, coarsest first
+/// @param[in] element The basix element used to create the spaces
+/// @param[in] hierarchy Mesh hierarchy of the spaces
+/// @return Transfer operators, where entry i interpolates from level i
+/// to level i + 1
+std::vector<std::shared_ptr<const Transfer>> create_transfers(
+    const std::vector<std::shared_ptr<dolfinx::fem::FunctionSpace<double>>>&
+        spaces,
+    const basix::FiniteElement<double>& element,
+    const MeshHierarchy& hierarchy);
+
+/// Create the function spaces of a p-multigrid hierarchy: Lagrange
+/// spaces of degree 1, ..., order - 1 on the mesh of V, followed by V.
+/// The elements use the same variant as the problems (GLL warped).
+/// @param[in] V Space of degree `order`, used as the finest level
+/// @param[in] order Degree of `V`
+/// @param[in] value_shape Value shape of the elements (empty for
+/// scalar spaces)
+/// @return Spaces, coarsest first
+std::vector<std::shared_ptr<dolfinx::fem::FunctionSpace<double>>>
+create_p_spaces(std::shared_ptr<dolfinx::fem::FunctionSpace<double>> V,
+                int order, const std::vector<std::size_t>& value_shape);
+
+/// Create the transfer operators between consecutive levels of a
+/// p-multigrid hierarchy. These are the interpolation matrices of the
+/// degree k Lagrange basis into the degree k + 1 basis, applied cell by
+/// cell.
+/// @param[in] spaces Spaces from `create_p_spaces`, coarsest first
+/// @return Transfer operators, where entry i interpolates from level i
+/// to level i + 1
+std::vector<std::shared_ptr<const Transfer>> create_p_transfers(
+    const std::vector<std::shared_ptr<dolfinx::fem::FunctionSpace<double>>>&
+        spaces);
+
+/// Assemble the rediscretised operator of a multigrid level, with
+/// homogeneous Dirichlet conditions: the rows and columns of the
+/// Dirichlet dofs are zero, with a unit diagonal
+/// @param[in] form Bilinear form (generated by FFCx), without
+/// coefficients or constants
+/// @param[in] V Space of the level, for both arguments of `form`
+/// @param[in] bc_dofs Local indices of the Dirichlet dofs (blocks for
+/// a blocked space)
+/// @return The assembled matrix
+std::shared_ptr<dolfinx::la::petsc::Matrix>
+assemble_level_operator(const ufcx_form& form,
+                        std::shared_ptr<dolfinx::fem::FunctionSpace<double>> V,
+                        std::vector<std::int32_t> bc_dofs);
+
+/// Set the preconditioner of a Krylov solver to a PETSc PCMG V-cycle.
+/// The level operators are the rediscretised (not Galerkin) matrices.
+/// The smoothers are two iterations of Jacobi-preconditioned Chebyshev,
+/// over [0.1, 1.1] times the estimated largest eigenvalue, and the
+/// coarse level uses the PETSc default (redundant direct) solver. All
+/// settings can be overridden by PETSc options (-mg_levels_*,
+/// -mg_coarse_*) if they are applied after this call.
+/// @param[in] ksp Krylov solver
+/// @param[in] operators Level matrices, coarsest first. The last is
+/// the operator of the solver.
+/// @param[in] transfers Transfer operators from `create_transfers` or
+/// `create_p_transfers`
+/// @param[in] coarse_pc_type If not empty, the coarse level is solved
+/// by one application of this preconditioner (e.g. `hypre` or `gamg`)
+void set_pcmg(KSP ksp, const std::vector<Mat>& operators,
+              const std::vector<std::shared_ptr<const Transfer>>& transfers,
+              const std::string& coarse_pc_type = "");
+
+/// Estimate the largest eigenvalue of D^{-1} A from the Lanczos
+/// tridiagonal matrix of a few Jacobi-preconditioned CG iterations, as
+/// for the PETSc Chebyshev estimate with `-esteig_ksp_type cg`. The
+/// estimate is a lower bound that converges quickly from below.
+/// @param[in] action Function that computes y = A x, called as
+/// `action(x, y)`
+/// @param[in] diag_inv Inverse of the diagonal D, including ghost
+/// entries
+/// @param[in] bc_dofs Dirichlet dofs (zero rows of A), which are
+/// excluded from the Krylov space
+/// @param[in] num_iterations Number of CG iterations
+/// @return The estimate
+template <typename U, typename ApplyFunction>
+double estimate_max_eigenvalue(ApplyFunction&& action,
+                               const dolfinx::la::Vector<U>& diag_inv,
+                               std::span<const std::int32_t> bc_dofs,
+                               int num_iterations = 10)
+{
+  // Start vector, zero on the Dirichlet dofs
+  dolfinx::la::Vector<U> r(diag_inv), z(diag_inv), p(diag_inv), y(diag_inv);
+  const std::int64_t offset = r.bs() * r.index_map()->local_range()[0];
+  std::span<U> _r = r.mutable_array();
+  for (std::size_t i = 0; i < _r.size(); ++i)
+    _r[i] = 1 + 0.5 * std::sin(offset + i);
+  r.scatter_fwd();
+  for (std::int32_t dof : bc_dofs)
+    _r[dof] = 0;
+
+  auto precondition = [&]()
+  {
+    std::ranges::transform(r.array(), diag_inv.array(),
+                           z.mutable_array().begin(), std::multiplies<U>());
+  };
+
+  // CG iterations, recording the coefficients
+  precondition();
+  std::ranges::copy(z.array(), p.mutable_array().begin());
+  double rz = dolfinx::la::inner_product(r, z);
+  std::vector<double> alpha, beta;
+  for (int k = 0; k < num_iterations and rz > 0; ++k)
+  {
+    action(p, y);
+    alpha.push_back(rz / dolfinx::la::inner_product(p, y));
+    linalg::axpy(r, U(-alpha.back()), y, r);
+    precondition();
+    const double rz_new = dolfinx::la::inner_product(r, z);
+    beta.push_back(rz_new / rz);
+    rz = rz_new;
+    linalg::axpy(p, U(beta.back()), p, z);
+  }
+
+  // Lanczos tridiagonal matrix
+  const std::size_t n = alpha.size();
+  std::vector<double> diag(n), off(n);
+  for (std::size_t j = 0; j < n; ++j)
+  {
+    diag[j] = 1 / alpha[j] + (j > 0 ? beta[j - 1] / alpha[j - 1] : 0);
+    off[j] = std::sqrt(beta[j]) / alpha[j];
+  }
+
+  // Largest eigenvalue by bisection on the Sturm sequence count,
+  // starting from the Gershgorin bound
+  double lo = 0, hi = 0;
+  for (std::size_t j = 0; j < n; ++j)
+  {
+    hi = std::max(hi, diag[j] + (j > 0 ? std::abs(off[j - 1]) : 0)
+                          + (j + 1 < n ? std::abs(off[j]) : 0));
+  }
+  auto num_below = [&](double lambda)
+  {
+    std::size_t count = 0;
+    double q = 1;
+    for (std::size_t j = 0; j < n; ++j)
+    {
+      q = diag[j] - lambda - (j > 0 ? off[j - 1] * off[j - 1] / q : 0);
+      if (q == 0)
+        q = 1e-300;
+      if (q < 0)
+        ++count;
+    }
+    return count;
+  };
+  for (int it = 0; it < 100; ++it)
+  {
+    const double mid = (lo + hi) / 2;
+    if (num_below(mid) < n)
+      lo = mid;
+    else
+      hi = mid;
+  }
+
+  return hi;
+}
+
+/// Apply `degree` iterations of Jacobi-preconditioned Chebyshev
+/// iteration to A x = b, for eigenvalues of D^{-1} A in [lmin, lmax]
+/// (Y. Saad, Iterative Methods for Sparse Linear Systems, Alg. 12.1).
+/// All vectors, including ghost entries, are kept consistent.
+/// @param[in,out] x Solution, updated from its initial value
+/// @param[in] b Right-hand side
+/// @param[in] action Function that computes y = A x
+/// @param[in] diag_inv Inverse of the diagonal of A
+/// @param[in] lmin Lower end of the eigenvalue interval
+/// @param[in] lmax Upper end of the eigenvalue interval
+/// @param[in] degree Number of iterations
+/// @param[in,out] r, d, y Work vectors
+template <typename U, typename ApplyFunction>
+void chebyshev(dolfinx::la::Vector<U>& x, const dolfinx::la::Vector<U>& b,
+               ApplyFunction&& action, const dolfinx::la::Vector<U>& diag_inv,
+               double lmin, double lmax, int degree,
+               dolfinx::la::Vector<U>& r, dolfinx::la::Vector<U>& d,
+               dolfinx::la::Vector<U>& y)
+{
+  const double theta = (lmax + lmin) / 2;
+  const double delta = (lmax - lmin) / 2;
+  const double sigma = theta / delta;
+  double rho = 1 / sigma;
+
+  // r = b - A x, d = D^{-1} r / theta
+  action(x, y);
+  linalg::axpy(r, U(-1), y, b);
+  std::span<U> _d = d.mutable_array();
+  std::span<const U> _r = r.array();
+  std::span<const U> _D = diag_inv.array();
+  for (std::size_t i = 0; i < _d.size(); ++i)
+    _d[i] = _D[i] * _r[i] / theta;
+
+  for (int k = 0; k < degree; ++k)
+  {
+    linalg::axpy(x, U(1), d, x);
+    if (k == degree - 1)
+      break;
+
+    // r <- r - A d
+    action(d, y);
+    linalg::axpy(r, U(-1), y, r);
+
+    const double rho_new = 1 / (2 * sigma - rho);
+    for (std::size_t i = 0; i < _d.size(); ++i)
+      _d[i] = rho_new * rho * _d[i] + 2 * rho_new / delta * _D[i] * _r[i];
+    rho = rho_new;
+  }
+}
+
+/// Multigrid V-cycle for matrix-free operators, for use as the
+/// preconditioner of `linalg::pcg`. Each level above the coarsest is
+/// smoothed by Chebyshev iteration before and after the coarse grid
+/// correction. The coarsest level is solved by a given coarse solver
+/// or, by default, by Jacobi-preconditioned CG to a tight tolerance, so
+/// that the cycle is a fixed symmetric operator.
+template <typename U>
+class VCycle
+{
+public:
+  /// Function that computes y = A x on a level. The rows of Dirichlet
+  /// dofs are zero and ghost entries of y are updated.
+  using Action
+      = std::function<void(dolfinx::la::Vector<U>&, dolfinx::la::Vector<U>&)>;
+
+  /// Function that computes an approximate solution x of A x = b on the
+  /// coarsest level, called as `solve(b, x)`. Ghost entries of x must
+  /// be updated.
+  using CoarseSolve = std::function<void(const dolfinx::la::Vector<U>&,
+                                         dolfinx::la::Vector<U>&)>;
+
+  /// Operator of one level
+  struct Level
+  {
+    /// Action of the operator
+    Action action;
+
+    /// Inverse of the diagonal, including ghost entries. Dirichlet dofs
+    /// have a unit diagonal.
+    std::shared_ptr<const dolfinx::la::Vector<U>> diag_inv;
+
+    /// Local indices of the Dirichlet dofs
+    std::vector<std::int32_t> bc_dofs;
+  };
+
+  /// Create the V-cycle and estimate the eigenvalues for the smoothers
+  /// @param[in] levels Level operators, coarsest first
+  /// @param[in] transfers Transfer operators, entry i from level i to
+  /// level i + 1
+  /// @param[in] degree Number of Chebyshev iterations of each smoothing
+  /// @param[in] coarse_solve Solver for the coarsest level. If not set,
+  /// Jacobi-preconditioned CG is used.
+  VCycle(std::vector<Level> levels,
+         std::vector<std::shared_ptr<const Transfer>> transfers,
+         int degree = 2, CoarseSolve coarse_solve = nullptr)
+      : _levels(std::move(levels)), _transfers(std::move(transfers)),
+        _degree(degree), _coarse_solve(std::move(coarse_solve))
+  {
+    for (auto& level : _levels)
+    {
+      std::array<dolfinx::la::Vector<U>, 5> w
+          = {*level.diag_inv, *level.diag_inv, *level.diag_inv,
+             *level.diag_inv, *level.diag_inv};
+      _work.push_back(std::move(w));
+    }
+
+    // Smoothers target the upper part of the spectrum, [0.1, 1.1]
+    // times the estimated largest eigenvalue, as the PETSc defaults
+    _lmax.resize(_levels.size(), 0);
+    for (std::size_t l = 1; l < _levels.size(); ++l)
+    {
+      _lmax[l] = estimate_max_eigenvalue(
+          _levels[l].action, *_levels[l].diag_inv, _levels[l].bc_dofs);
+    }
+  }
+
+  /// Apply one V-cycle, z = M^{-1} r
+  /// @param[in] r Residual on the finest level
+  /// @param[out] z Preconditioned residual
+  void operator()(const dolfinx::la::Vector<U>& r, dolfinx::la::Vector<U>& z)
+  {
+    const std::size_t l = _levels.size() - 1;
+    std::ranges::copy(r.array(), _work[l][0].mutable_array().begin());
+    cycle(l);
+    std::ranges::copy(_work[l][1].array(), z.mutable_array().begin());
+  }
+
+  /// Number of levels
+  int num_levels() const { return _levels.size(); }
+
+  /// Number of CG iterations of the coarse solves, summed over cycles
+  /// (zero with a given coarse solver)
+  int coarse_iterations() const { return _coarse_iterations; }
+
+private:
+  // Solve approximately on level l for the right-hand side in work
+  // vector 0, with the result in work vector 1
+  void cycle(std::size_t l)
+  {
+    auto& [b, x, r, d, y] = _work[l];
+    const Level& level = _levels[l];
+    x.set(0);
+
+    if (l == 0 and _coarse_solve)
+    {
+      _coarse_solve(b, x);
+      return;
+    }
+    if (l == 0)
+    {
+      auto jacobi = [&level](const dolfinx::la::Vector<U>& res,
+                             dolfinx::la::Vector<U>& z)
+      {
+        std::ranges::transform(res.array(), level.diag_inv->array(),
+                               z.mutable_array().begin(),
+                               std::multiplies<U>());
+      };
+      _coarse_iterations
+          += linalg::pcg(x, b, level.action, jacobi, 1000, 1e-10);
+      return;
+    }
+
+    const double lmin = 0.1 * _lmax[l], lmax = 1.1 * _lmax[l];
+
+    // Pre-smoothing
+    chebyshev(x, b, level.action, *level.diag_inv, lmin, lmax, _degree, r, d,
+              y);
+
+    // Restrict residual r = b - A x to the coarse level
+    level.action(x, y);
+    linalg::axpy(r, U(-1), y, b);
+    auto& bc = _work[l - 1][0];
+    _transfers[l - 1]->restrict_transpose(r, bc);
+    std::span<U> _bc = bc.mutable_array();
+    for (std::int32_t dof : _levels[l - 1].bc_dofs)
+      _bc[dof] = 0;
+
+    // Coarse grid correction
+    cycle(l - 1);
+    _transfers[l - 1]->prolong(_work[l - 1][1], d);
+    std::span<U> _d = d.mutable_array();
+    for (std::int32_t dof : level.bc_dofs)
+      _d[dof] = 0;
+    linalg::axpy(x, U(1), d, x);
+
+    // Post-smoothing
+    chebyshev(x, b, level.action, *level.diag_inv, lmin, lmax, _degree, r, d,
+              y);
+  }
+
+  std::vector<Level> _levels;
+  std::vector<std::shared_ptr<const Transfer>> _transfers;
+  int _degree;
+  CoarseSolve _coarse_solve;
+
+  // Largest eigenvalue estimate of D^{-1} A on each level
+  std::vector<double> _lmax;
+
+  // Work vectors of each level: right-hand side, solution, residual
+  // and two temporaries
+  std::vector<std::array<dolfinx::la::Vector<U>, 5>> _work;
+
+  int _coarse_iterations = 0;
+};
+} // namespace multigrid
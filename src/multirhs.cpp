@@ -0,0 +1,103 @@
+// Copyright (C) 2026 The FEniCS Project
+//
+// This file is part of FEniCS-miniapp (https://www.fenicsproject.org)
+//
+// SPDX-License-Identifier:    MIT
+
+#include "multirhs.h"
+#include "metrics.h"
+#include "phase.h"
+#include <algorithm>
+#include <cmath>
+#include <dolfinx/common/MPI.h>
+#include <dolfinx/la/petsc.h>
+#include <iostream>
+#include <petscmat.h>
+
+using namespace dolfinx;
+
+//-----------------------------------------------------------------------------
+std::array<double, 2> multirhs::centre(int k)
+{
+  return {0.5 + 0.2 * std::sin(k), 0.5 + 0.2 * (1 - std::cos(k))};
+}
+//-----------------------------------------------------------------------------
+void multirhs::compare_petsc(KSP ksp,
+                             std::span<const la::Vector<PetscScalar>> rhs)
+{
+  Mat A;
+  KSPGetOperators(ksp, &A, nullptr);
+  MPI_Comm comm = PetscObjectComm(reinterpret_cast<PetscObject>(A));
+  PetscInt m, N;
+  MatGetLocalSize(A, &m, nullptr);
+  MatGetSize(A, &N, nullptr);
+  const PetscInt num_rhs = rhs.size();
+
+  // Copy the owned entries of the right-hand sides into the columns of
+  // a dense matrix
+  Mat B, X;
+  MatCreateDense(comm, m, PETSC_DECIDE, N, num_rhs, nullptr, &B);
+  PetscScalar* _B;
+  PetscInt lda;
+  MatDenseGetLDA(B, &lda);
+  MatDenseGetArrayWrite(B, &_B);
+  for (PetscInt k = 0; k < num_rhs; ++k)
+    std::copy_n(rhs[k].array().begin(), m, _B + k * lda);
+  MatDenseRestoreArrayWrite(B, &_B);
+  MatAssemblyBegin(B, MAT_FINAL_ASSEMBLY);
+  MatAssemblyEnd(B, MAT_FINAL_ASSEMBLY);
+  MatDuplicate(B, MAT_DO_NOT_COPY_VALUES, &X);
+
+  MPI_Barrier(comm);
+  Phase t0("ZZZ Block solve");
+  KSPMatSolve(ksp, B, X);
+  t0.stop();
+  PetscInt block_iter;
+  KSPGetIterationNumber(ksp, &block_iter);
+
+  Vec x;
+  MatCreateVecs(A, &x, nullptr);
+  int sequential_iter = 0;
+  MPI_Barrier(comm);
+  Phase t1("ZZZ Sequential solves");
+  for (auto& b : rhs)
+  {
+    la::petsc::Vector _b(la::petsc::create_vector_wrap(b), false);
+    KSPSolve(ksp, _b.vec(), x);
+    PetscInt num_iter;
+    KSPGetIterationNumber(ksp, &num_iter);
+    sequential_iter += num_iter;
+  }
+  t1.stop();
+
+  VecDestroy(&x);
+  MatDestroy(&X);
+  MatDestroy(&B);
+
+  report(comm, num_rhs, t0.elapsed().count(), block_iter,
+         t1.elapsed().count(), sequential_iter);
+}
+//-----------------------------------------------------------------------------
+void multirhs::report(MPI_Comm comm, int num_rhs, double block_time,
+                      int block_iter, double sequential_time,
+                      int sequential_iter)
+{
+  double times[2] = {block_time, sequential_time};
+  MPI_Allreduce(MPI_IN_PLACE, times, 2, MPI_DOUBLE, MPI_MAX, comm);
+  if (dolfinx::MPI::rank(comm) != 0)
+    return;
+
+  std::cout << "Multiple right-hand sides (" << num_rhs << "):" << std::endl;
+  std::cout << "  Together:   " << times[0] / num_rhs
+            << " s per right-hand side, " << block_iter << " iterations"
+            << std::endl;
+  std::cout << "  One by one: " << times[1] / num_rhs
+            << " s per right-hand side, " << sequential_iter
+            << " iterations in total" << std::endl;
+  std::cout << "  Speedup:    " << times[1] / times[0] << std::endl;
+  metrics::record("block_solve_time_per_rhs", times[0] / num_rhs);
+  metrics::record("block_solve_iterations", block_iter);
+  metrics::record("sequential_solve_time_per_rhs", times[1] / num_rhs);
+  metrics::record("sequential_solve_iterations", sequential_iter);
+  metrics::record("multi_rhs_speedup", times[1] / times[0]);
+}
@@ -0,0 +1,54 @@
+// Copyright (C) 2026 The FEniCS Project
+//
+// This file is part of FEniCS-miniapp (https://www.fenicsproject.org)
+//
+// SPDX-License-Identifier:    MIT
+
+#pragma once
+
+#include <array>
+#include <dolfinx/la/Vector.h>
+#include <mpi.h>
+#include <petscksp.h>
+#include <span>
+
+/// Several right-hand sides of one operator (load cases), solved
+/// together so that the operator data and the preconditioner are
+/// reused across them, and compared with one solve per right-hand side.
+namespace multirhs
+{
+/// Centre of the source of right-hand side k. The centres lie on a
+/// circle through the centre (0.5, 0.5) of the single right-hand side
+/// (k = 0), so that the right-hand sides are linearly independent.
+/// @param[in] k Index of the right-hand side
+std::array<double, 2> centre(int k);
+
+/// Solve A X = B for all right-hand sides together with KSPMatSolve,
+/// then with one KSPSolve per right-hand side, and report both (see
+/// `report`). The block method is set by the PETSc options, e.g.
+/// `-ksp_type hpddm -ksp_hpddm_type bcg` for block CG; other Krylov
+/// methods solve the columns one after the other inside KSPMatSolve,
+/// sharing only the setup. Collective.
+/// @param[in] ksp Krylov solver with the operator and the
+/// preconditioner set up
+/// @param[in] rhs Right-hand sides (owned entries are used)
+void compare_petsc(KSP ksp,
+                   std::span<const dolfinx::la::Vector<PetscScalar>> rhs);
+
+/// Print (on rank 0) and record in the metrics the time per
+/// right-hand side of solving all right-hand sides together and one
+/// at a time, and the speedup of the former. Times are the slowest
+/// process. Collective.
+/// @param[in] comm Communicator
+/// @param[in] num_rhs Number of right-hand sides
+/// @param[in] block_time Time of the solve of all right-hand sides
+/// together on this process (s)
+/// @param[in] block_iter Iterations of the solve of all right-hand
+/// sides together
+/// @param[in] sequential_time Time of the solves of one right-hand side
+/// at a time on this process (s)
+/// @param[in] sequential_iter Iterations of the solves of one
+/// right-hand side at a time, summed over the right-hand sides
+void report(MPI_Comm comm, int num_rhs, double block_time, int block_iter,
+            double sequential_time, int sequential_iter);
+} // namespace multirhs
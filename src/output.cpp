@@ -0,0 +1,83 @@
+// Copyright (C) 2026 The FEniCS Project
+//
+// This file is part of FEniCS-miniapp (https://www.fenicsproject.org)
+//
+// SPDX-License-Identifier:    MIT
+
+#include "output.h"
+#include <chrono>
+#include <dolfinx/io/XDMFFile.h>
+#include <dolfinx/mesh/Geometry.h>
+#include <dolfinx/mesh/Mesh.h>
+#include <dolfinx/mesh/Topology.h>
+#include <stdexcept>
+
+#ifdef HAS_ADIOS2
+#include <dolfinx/io/ADIOS2Writers.h>
+#endif
+
+using namespace dolfinx;
+
+//-----------------------------------------------------------------------------
+output::Result
+output::write(MPI_Comm comm,
+              std::shared_ptr<const fem::Function<PetscScalar>> u,
+              const std::filesystem::path& filename, const std::string& format)
+{
+  auto t0 = std::chrono::steady_clock::now();
+  auto mesh = u->function_space()->mesh();
+  if (format == "xdmf")
+  {
+    io::XDMFFile file(comm, filename, "w");
+    file.write_mesh(*mesh);
+    file.write_function(*u, 0.0);
+  }
+  else if (format == "vtx")
+  {
+#ifdef HAS_ADIOS2
+    io::VTXWriter<double> file(comm, filename, {u}, "BP5");
+    file.write(0.0);
+    file.close();
+#else
+    throw std::runtime_error("VTX output requires DOLFINx with ADIOS2");
+#endif
+  }
+  else
+    throw std::runtime_error("Unknown output format: " + format);
+  auto t1 = std::chrono::steady_clock::now();
+
+  // Owned geometry, topology and solution data
+  const int tdim = mesh->topology()->dim();
+  const std::int64_t num_nodes = mesh->geometry().index_map()->size_local();
+  const std::int64_t num_cells
+      = mesh->topology()->index_map(tdim)->size_local();
+  const std::int64_t nodes_per_cell = mesh->geometry().dofmap().extent(1);
+  auto dofmap = u->function_space()->dofmap();
+  const std::int64_t num_dofs
+      = dofmap->index_map->size_local() * dofmap->index_map_bs();
+  const std::int64_t bytes = 3 * num_nodes * sizeof(double)
+                             + num_cells * nodes_per_cell * sizeof(std::int64_t)
+                             + num_dofs * sizeof(PetscScalar);
+
+  return {std::chrono::duration<double>(t1 - t0).count(), bytes};
+}
+//-----------------------------------------------------------------------------
+std::uintmax_t output::size_on_disk(const std::filesystem::path& path)
+{
+  if (path.extension() == ".xdmf")
+  {
+    std::filesystem::path h5 = path;
+    h5.replace_extension(".h5");
+    return std::filesystem::file_size(path) + std::filesystem::file_size(h5);
+  }
+  else if (!std::filesystem::is_directory(path))
+    return std::filesystem::file_size(path);
+
+  std::uintmax_t size = 0;
+  for (auto& entry : std::filesystem::recursive_directory_iterator(path))
+  {
+    if (entry.is_regular_file())
+      size += entry.file_size();
+  }
+  return size;
+}
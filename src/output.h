@@ -0,0 +1,47 @@
+// Copyright (C) 2026 The FEniCS Project
+//
+// This file is part of FEniCS-miniapp (https://www.fenicsproject.org)
+//
+// SPDX-License-Identifier:    MIT
+
+#pragma once
+
+#include <cstdint>
+#include <dolfinx/fem/Function.h>
+#include <filesystem>
+#include <memory>
+#include <mpi.h>
+#include <petscsys.h>
+#include <string>
+
+namespace output
+{
+/// Outcome of writing the solution on one process
+struct Result
+{
+  /// Wall time of the write on this process (s)
+  double seconds;
+
+  /// Bytes of mesh and solution data owned by this process
+  std::int64_t bytes;
+};
+
+/// Write the mesh and solution. Collective on `comm`. If called from a
+/// background thread, `comm` must not be used concurrently by other
+/// threads, and no other thread may use the communicators of the mesh
+/// and function space.
+/// @param[in] comm Communicator for the file
+/// @param[in] u Solution
+/// @param[in] filename Name of the file (a directory for `vtx`)
+/// @param[in] format Output format (xdmf or vtx)
+/// @return Time and bytes written by this process
+Result write(MPI_Comm comm,
+             std::shared_ptr<const dolfinx::fem::Function<PetscScalar>> u,
+             const std::filesystem::path& filename, const std::string& format);
+
+/// Size of a file, or of all files under a directory. The HDF5 data
+/// file of an XDMF file is included.
+/// @param[in] path File or directory
+/// @return Size in bytes
+std::uintmax_t size_on_disk(const std::filesystem::path& path);
+} // namespace output
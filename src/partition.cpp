@@ -0,0 +1,99 @@
+// Copyright (C) 2026 The FEniCS Project
+//
+// This file is part of FEniCS-miniapp (https://www.fenicsproject.org)
+//
+// SPDX-License-Identifier:    MIT
+
+#include "partition.h"
+#include <algorithm>
+#include <array>
+#include <dolfinx/common/IndexMap.h>
+#include <dolfinx/common/MPI.h>
+#include <dolfinx/fem/DofMap.h>
+#include <dolfinx/mesh/Mesh.h>
+#include <dolfinx/mesh/Topology.h>
+#include <dolfinx/mesh/utils.h>
+#include <iterator>
+#include <petscsys.h>
+#include <vector>
+
+using namespace dolfinx;
+
+namespace
+{
+// Number of owned facets between an owned cell and a cell owned by
+// another process. Without ghost cells such a facet has one local cell
+// but is not on the boundary of the domain; with ghost cells one of its
+// cells is owned and the other is a ghost (an owned facet between two
+// ghost cells is not cut by this process).
+std::int64_t num_cut_facets(const mesh::Topology& topology)
+{
+  const int tdim = topology.dim();
+  auto f_to_c = topology.connectivity(tdim - 1, tdim);
+  const std::int32_t num_facets = topology.index_map(tdim - 1)->size_local();
+  const std::int32_t num_cells = topology.index_map(tdim)->size_local();
+
+  std::vector<std::int8_t> exterior(num_facets, false);
+  for (std::int32_t f : mesh::exterior_facet_indices(topology))
+  {
+    if (f < num_facets)
+      exterior[f] = true;
+  }
+
+  std::int64_t cut = 0;
+  for (std::int32_t f = 0; f < num_facets; ++f)
+  {
+    auto cells = f_to_c->links(f);
+    if (cells.size() == 1 and !exterior[f])
+      ++cut;
+    else if (cells.size() == 2
+             and (cells[0] < num_cells) != (cells[1] < num_cells))
+    {
+      ++cut;
+    }
+  }
+  return cut;
+}
+} // namespace
+
+//-----------------------------------------------------------------------------
+partition::Statistics
+partition::statistics(const fem::FunctionSpace<double>& V)
+{
+  auto map = V.dofmap()->index_map;
+  const int bs = V.dofmap()->index_map_bs();
+  MPI_Comm comm = map->comm();
+  auto topology = V.mesh()->topology();
+  const int tdim = topology->dim();
+
+  // Neighbours: owners of ghosts and processes that ghost owned dofs
+  std::vector<int> neighbours;
+  std::ranges::set_union(map->src(), map->dest(),
+                         std::back_inserter(neighbours));
+
+  constexpr std::size_t n = 5;
+  const std::array<double, n> local
+      = {static_cast<double>(topology->index_map(tdim)->size_local()),
+         static_cast<double>(bs * map->size_local()),
+         static_cast<double>(bs * map->num_ghosts()),
+         static_cast<double>(neighbours.size()),
+         static_cast<double>(bs * map->num_ghosts() * sizeof(PetscScalar))};
+
+  std::array<double, n> min, max, sum;
+  MPI_Allreduce(local.data(), min.data(), n, MPI_DOUBLE, MPI_MIN, comm);
+  MPI_Allreduce(local.data(), max.data(), n, MPI_DOUBLE, MPI_MAX, comm);
+  MPI_Allreduce(local.data(), sum.data(), n, MPI_DOUBLE, MPI_SUM, comm);
+  const int size = dolfinx::MPI::size(comm);
+  std::array<Summary, n> s;
+  for (std::size_t i = 0; i < n; ++i)
+    s[i] = {min[i], max[i], sum[i] / size};
+
+  std::int64_t edge_cut = -1;
+  if (topology->connectivity(tdim - 1, tdim))
+  {
+    edge_cut = num_cut_facets(*topology);
+    MPI_Allreduce(MPI_IN_PLACE, &edge_cut, 1, MPI_INT64_T, MPI_SUM, comm);
+  }
+
+  return {s[0], s[1], s[2], s[3], s[4], edge_cut};
+}
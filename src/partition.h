@@ -0,0 +1,54 @@
+// Copyright (C) 2026 The FEniCS Project
+//
+// This file is part of FEniCS-miniapp (https://www.fenicsproject.org)
+//
+// SPDX-License-Identifier:    MIT
+
+#pragma once
+
+#include <cstdint>
+#include <dolfinx/fem/FunctionSpace.h>
+
+/// Quality of the mesh partition: the distribution of work and of
+/// communication over the processes.
+namespace partition
+{
+/// Distribution of a per-process quantity over the processes
+struct Summary
+{
+  double min, max, mean;
+
+  /// Load imbalance, max / mean (1 when balanced)
+  double imbalance() const { return mean > 0 ? max / mean : 1; }
+};
+
+/// Partition statistics of a function space
+struct Statistics
+{
+  /// Owned cells per process
+  Summary owned_cells;
+
+  /// Owned dofs per process (including the block size)
+  Summary owned_dofs;
+
+  /// Ghost dofs per process (including the block size)
+  Summary ghost_dofs;
+
+  /// Neighbour processes (ghost owners and ghosting processes)
+  Summary neighbours;
+
+  /// Bytes received by a process in a forward scatter of a PETSc
+  /// scalar vector
+  Summary halo_bytes;
+
+  /// Number of facets between cells owned by different processes, the
+  /// edge cut of the dual graph, or -1 if the facet-to-cell
+  /// connectivity has not been computed
+  std::int64_t edge_cut;
+};
+
+/// Compute the partition statistics of a function space. Collective.
+/// @param[in] V Function space
+/// @return Statistics
+Statistics statistics(const dolfinx::fem::FunctionSpace<double>& V);
+} // namespace partition
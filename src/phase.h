@@ -0,0 +1,61 @@
+// Copyright (C) 2026 The FEniCS Project
+//
+// This file is part of FEniCS-miniapp (https://www.fenicsproject.org)
+//
+// SPDX-License-Identifier:    MIT
+
+#pragma once
+
+#include "counters.h"
+#include "mem.h"
+#include <chrono>
+#include <dolfinx/common/Timer.h>
+#include <string>
+
+/// A named phase of the test. It is timed with a DOLFINx Timer (and so
+/// appears in the timings table), its peak memory use is recorded by
+/// the memory profiler, if the profiler is running, and it is a
+/// hardware counter region (see counters.h). The phase starts on
+/// construction and ends on `stop()` or destruction.
+class Phase
+{
+public:
+  /// Start phase
+  /// @param[in] name Name of the phase (and of the timer)
+  explicit Phase(const std::string& name) : _name(name), _timer(name)
+  {
+    begin_memory_phase(_name);
+    counters::begin_region(_name);
+  }
+
+  Phase(const Phase&) = delete;
+  Phase& operator=(const Phase&) = delete;
+
+  /// End phase if still running
+  ~Phase()
+  {
+    if (_running)
+      stop();
+  }
+
+  /// End phase: stop the timer, register the time and record the peak
+  /// memory
+  void stop()
+  {
+    _timer.stop();
+    _elapsed = _timer.elapsed();
+    _timer.flush();
+    counters::end_region(_name);
+    end_memory_phase(_name);
+    _running = false;
+  }
+
+  /// Elapsed (wall) time of the phase, available after `stop()`
+  std::chrono::duration<double> elapsed() const { return _elapsed; }
+
+private:
+  std::string _name;
+  dolfinx::common::Timer<> _timer;
+  std::chrono::duration<double> _elapsed{0};
+  bool _running = true;
+};
@@ -0,0 +1,337 @@
+// Copyright (C) 2026 The FEniCS Project
+//
+// This file is part of FEniCS-miniapp (https://www.fenicsproject.org)
+//
+// SPDX-License-Identifier:    MIT
+
+#pragma once
+
+#include "geometry.h"
+#include <algorithm>
+#include <array>
+#include <basix/finite-element.h>
+#include <basix/quadrature.h>
+#include <cmath>
+#include <concepts>
+#include <cstdint>
+#include <dolfinx/fem/DofMap.h>
+#include <dolfinx/fem/FunctionSpace.h>
+#include <dolfinx/mesh/Geometry.h>
+#include <dolfinx/mesh/Mesh.h>
+#include <dolfinx/mesh/Topology.h>
+#include <numeric>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace matfree
+{
+/// Matrix-free action of the Laplace operator (grad u, grad v) on
+/// affine tetrahedral meshes.
+///
+/// The geometric factor G = |det J| K K^T (K = J^{-1}) is computed
+/// once per cell and cached, along with the reference basis function
+/// derivatives at the quadrature points. The action gathers directly
+/// from the input array through the dofmap and scatters directly into
+/// the output array. Owned cells are split into boundary cells (cells
+/// with at least one ghost dof) and interior cells, so that the
+/// communication of ghost contributions can be overlapped with
+/// computation on the interior cells.
+/// @tparam T Scalar type of the cached data and of the kernel arithmetic
+template <std::floating_point T>
+class PoissonOperator
+{
+public:
+  /// Create operator
+  /// @param[in] V Scalar Lagrange function space on an affine mesh
+  /// @param[in] element The basix element used to create `V`
+  /// @param[in] order Polynomial order of `element`
+  PoissonOperator(const dolfinx::fem::FunctionSpace<double>& V,
+                  const basix::FiniteElement<double>& element, int order)
+  {
+    auto mesh = V.mesh();
+    const int tdim = mesh->topology()->dim();
+    const std::int32_t num_cells
+        = mesh->topology()->index_map(tdim)->size_local();
+
+    // Quadrature that integrates grad(u).grad(v) exactly on affine cells
+    auto [pts, wts] = basix::quadrature::make_quadrature<double>(
+        basix::quadrature::type::Default, basix::cell::type::tetrahedron,
+        basix::polyset::type::standard, std::max(2 * (order - 1), 1));
+    _nq = wts.size();
+    _weights.assign(wts.begin(), wts.end());
+
+    // Tabulate reference derivatives, stored as [3][nq][ndofs]
+    auto [table, shape] = element.tabulate(1, pts, {wts.size(), 3});
+    _ndofs = shape[2];
+    _dphi.resize(3 * _nq * _ndofs);
+    for (int a = 0; a < 3; ++a)
+      for (int q = 0; q < _nq; ++q)
+        for (int i = 0; i < _ndofs; ++i)
+          _dphi[(a * _nq + q) * _ndofs + i]
+              = table[((a + 1) * _nq + q) * _ndofs + i];
+
+    // Copy cell dofs of owned cells
+    auto dofmap = V.dofmap()->map();
+    if (static_cast<int>(dofmap.extent(1)) != _ndofs)
+      throw std::runtime_error("Dofmap and element size do not match");
+    _dofs.assign(dofmap.data_handle(),
+                 dofmap.data_handle() + num_cells * _ndofs);
+
+    // Compute geometric factor for each cell
+    auto x_dofmap = mesh->geometry().dofmap();
+    if (x_dofmap.extent(1) != 4)
+      throw std::runtime_error("Matrix-free operator requires affine cells");
+    std::span<const double> x = mesh->geometry().x();
+    _G.resize(6 * num_cells);
+    for (std::int32_t c = 0; c < num_cells; ++c)
+    {
+      auto nodes = std::span(x_dofmap.data_handle() + 4 * c, 4);
+      auto [K, detJ] = affine_jacobian_inverse(x, nodes);
+
+      // G = |det J| K K^T (upper triangle: 00, 01, 02, 11, 12, 22)
+      T* G = _G.data() + 6 * c;
+      int m = 0;
+      for (int a = 0; a < 3; ++a)
+      {
+        for (int b = a; b < 3; ++b)
+        {
+          double g = 0;
+          for (int i = 0; i < 3; ++i)
+            g += K[3 * a + i] * K[3 * b + i];
+          G[m++] = std::abs(detJ) * g;
+        }
+      }
+    }
+
+    _cells.resize(num_cells);
+    std::iota(_cells.begin(), _cells.end(), 0);
+
+    // Split cells into those that touch ghost dofs and those that do not
+    const std::int32_t local_size = V.dofmap()->index_map->size_local();
+    for (std::int32_t c = 0; c < num_cells; ++c)
+    {
+      auto dofs = std::span(_dofs.data() + c * _ndofs, _ndofs);
+      if (std::ranges::any_of(dofs, [local_size](auto d)
+                              { return d >= local_size; }))
+      {
+        _boundary_cells.push_back(c);
+      }
+      else
+        _interior_cells.push_back(c);
+    }
+  }
+
+  /// Compute y += A x over all owned cells
+  /// @param[in] x Input array, including up-to-date ghost entries
+  /// @param[in,out] y Output array (contributions are added)
+  void apply(std::span<const T> x, std::span<T> y) const
+  {
+    apply(x, y, _cells);
+  }
+
+  /// Compute y += A x restricted to a list of cells
+  /// @param[in] x Input array, including up-to-date ghost entries
+  /// @param[in,out] y Output array (contributions are added)
+  /// @param[in] cells Local indices of the cells to compute
+  void apply(std::span<const T> x, std::span<T> y,
+             std::span<const std::int32_t> cells) const
+  {
+    const int nd = _ndofs;
+    const int nq = _nq;
+    std::vector<T> xe(nd), ye(nd);
+    for (std::int32_t c : cells)
+    {
+      const std::int32_t* dofs = _dofs.data() + c * nd;
+      for (int i = 0; i < nd; ++i)
+        xe[i] = x[dofs[i]];
+      std::fill(ye.begin(), ye.end(), 0);
+
+      const T* G = _G.data() + 6 * c;
+      for (int q = 0; q < nq; ++q)
+      {
+        const T* d0 = _dphi.data() + (0 * nq + q) * nd;
+        const T* d1 = _dphi.data() + (1 * nq + q) * nd;
+        const T* d2 = _dphi.data() + (2 * nq + q) * nd;
+
+        // Reference gradient at quadrature point
+        T g0 = 0, g1 = 0, g2 = 0;
+        for (int i = 0; i < nd; ++i)
+        {
+          g0 += d0[i] * xe[i];
+          g1 += d1[i] * xe[i];
+          g2 += d2[i] * xe[i];
+        }
+
+        // Apply geometric factor and quadrature weight
+        const T w = _weights[q];
+        const T f0 = w * (G[0] * g0 + G[1] * g1 + G[2] * g2);
+        const T f1 = w * (G[1] * g0 + G[3] * g1 + G[4] * g2);
+        const T f2 = w * (G[2] * g0 + G[4] * g1 + G[5] * g2);
+
+        for (int i = 0; i < nd; ++i)
+          ye[i] += d0[i] * f0 + d1[i] * f1 + d2[i] * f2;
+      }
+
+      for (int i = 0; i < nd; ++i)
+        y[dofs[i]] += ye[i];
+    }
+  }
+
+  /// Compute Y += A X for several vectors, restricted to a list of
+  /// cells. The vectors are interleaved (entry j of dof i is at
+  /// i * num_vectors + j), so that the geometric factor and the basis
+  /// derivatives are loaded once per cell and quadrature point for all
+  /// vectors.
+  /// @param[in] x Input array, including up-to-date ghost entries
+  /// @param[in,out] y Output array (contributions are added)
+  /// @param[in] cells Local indices of the cells to compute
+  /// @param[in] num_vectors Number of interleaved vectors
+  void apply(std::span<const T> x, std::span<T> y,
+             std::span<const std::int32_t> cells, int num_vectors) const
+  {
+    const int nd = _ndofs;
+    const int nq = _nq;
+    const int nv = num_vectors;
+    std::vector<T> xe(nd * nv), ye(nd * nv), g(3 * nv), f(3 * nv);
+    for (std::int32_t c : cells)
+    {
+      const std::int32_t* dofs = _dofs.data() + c * nd;
+      for (int i = 0; i < nd; ++i)
+        for (int j = 0; j < nv; ++j)
+          xe[i * nv + j] = x[dofs[i] * nv + j];
+      std::fill(ye.begin(), ye.end(), 0);
+
+      const T* G = _G.data() + 6 * c;
+      for (int q = 0; q < nq; ++q)
+      {
+        const T* d0 = _dphi.data() + (0 * nq + q) * nd;
+        const T* d1 = _dphi.data() + (1 * nq + q) * nd;
+        const T* d2 = _dphi.data() + (2 * nq + q) * nd;
+
+        // Reference gradients at quadrature point, [3][nv]
+        std::fill(g.begin(), g.end(), 0);
+        for (int i = 0; i < nd; ++i)
+        {
+          for (int j = 0; j < nv; ++j)
+          {
+            g[j] += d0[i] * xe[i * nv + j];
+            g[nv + j] += d1[i] * xe[i * nv + j];
+            g[2 * nv + j] += d2[i] * xe[i * nv + j];
+          }
+        }
+
+        // Apply geometric factor and quadrature weight
+        const T w = _weights[q];
+        for (int j = 0; j < nv; ++j)
+        {
+          const T g0 = g[j], g1 = g[nv + j], g2 = g[2 * nv + j];
+          f[j] = w * (G[0] * g0 + G[1] * g1 + G[2] * g2);
+          f[nv + j] = w * (G[1] * g0 + G[3] * g1 + G[4] * g2);
+          f[2 * nv + j] = w * (G[2] * g0 + G[4] * g1 + G[5] * g2);
+        }
+
+        for (int i = 0; i < nd; ++i)
+        {
+          for (int j = 0; j < nv; ++j)
+          {
+            ye[i * nv + j]
+                += d0[i] * f[j] + d1[i] * f[nv + j] + d2[i] * f[2 * nv + j];
+          }
+        }
+      }
+
+      for (int i = 0; i < nd; ++i)
+        for (int j = 0; j < nv; ++j)
+          y[dofs[i] * nv + j] += ye[i * nv + j];
+    }
+  }
+
+  /// Add the cell contributions to the diagonal of the operator,
+  /// computed without assembling the element matrices
+  /// @param[in,out] diag Diagonal (contributions are added)
+  void diagonal(std::span<T> diag) const
+  {
+    const int nd = _ndofs;
+    const int nq = _nq;
+    for (std::int32_t c : _cells)
+    {
+      const std::int32_t* dofs = _dofs.data() + c * nd;
+      const T* G = _G.data() + 6 * c;
+      for (int q = 0; q < nq; ++q)
+      {
+        const T w = _weights[q];
+        for (int i = 0; i < nd; ++i)
+        {
+          // grad(phi_i)^T G grad(phi_i) in reference coordinates
+          const T d0 = _dphi[(0 * nq + q) * nd + i];
+          const T d1 = _dphi[(1 * nq + q) * nd + i];
+          const T d2 = _dphi[(2 * nq + q) * nd + i];
+          diag[dofs[i]] += w
+                           * (G[0] * d0 * d0 + G[3] * d1 * d1 + G[5] * d2 * d2
+                              + 2 * (G[1] * d0 * d1 + G[2] * d0 * d2
+                                     + G[4] * d1 * d2));
+        }
+      }
+    }
+  }
+
+  /// Local indices of the cells the operator is computed over
+  std::span<const std::int32_t> cells() const { return _cells; }
+
+  /// Local indices of owned cells that have at least one ghost dof
+  std::span<const std::int32_t> boundary_cells() const
+  {
+    return _boundary_cells;
+  }
+
+  /// Local indices of owned cells that have only owned dofs
+  std::span<const std::int32_t> interior_cells() const
+  {
+    return _interior_cells;
+  }
+
+  /// Number of dofs per cell
+  int num_cell_dofs() const { return _ndofs; }
+
+  /// Number of quadrature points
+  int num_quadrature_points() const { return _nq; }
+
+  /// Reference basis derivatives, [3][nq][ndofs]
+  std::span<const T> dphi() const { return _dphi; }
+
+  /// Quadrature weights
+  std::span<const T> weights() const { return _weights; }
+
+  /// Geometric factor of each cell (upper triangle of G), [num_cells][6]
+  std::span<const T> geometry_factors() const { return _G; }
+
+  /// Dofs of each cell, [num_cells][ndofs]
+  std::span<const std::int32_t> cell_dofs() const { return _dofs; }
+
+  /// Bytes of cached data (geometry, dofmap and basis tables)
+  std::size_t bytes() const
+  {
+    return sizeof(T) * (_G.size() + _dphi.size() + _weights.size())
+           + sizeof(std::int32_t)
+                 * (_dofs.size() + _cells.size() + _boundary_cells.size()
+                    + _interior_cells.size());
+  }
+
+private:
+  // Number of dofs per cell and number of quadrature points
+  int _ndofs, _nq;
+
+  // Reference basis derivatives [3][nq][ndofs] and quadrature weights
+  std::vector<T> _dphi, _weights;
+
+  // Geometric factor, 6 entries per cell
+  std::vector<T> _G;
+
+  // Cell dofs [num_cells][ndofs]
+  std::vector<std::int32_t> _dofs;
+
+  // Owned cells, and owned cells split by whether they touch ghost dofs
+  std::vector<std::int32_t> _cells, _boundary_cells, _interior_cells;
+};
+} // namespace matfree
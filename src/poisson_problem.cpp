@@ -6,13 +6,21 @@
 
 #include "poisson_problem.h"
 #include "Poisson.h"
+#include "batched_assembler.h"
+#include "matrix.h"
+#include "mem.h"
+#include "multigrid.h"
+#include "multirhs.h"
+#include "phase.h"
+#include "reorder.h"
+#include "threaded_assembler.h"
+#include "topology.h"
+#include <array>
 #include <cfloat>
 #include <cmath>
-#include <dolfinx/common/Timer.h>
 #include <dolfinx/fem/DirichletBC.h>
 #include <dolfinx/fem/Function.h>
 #include <dolfinx/fem/FunctionSpace.h>
-#
 #include <dolfinx/fem/assembler.h>
 #include <dolfinx/fem/petsc.h>
 #include <dolfinx/fem/utils.h>
@@ -20,7 +28,10 @@
 #include <dolfinx/mesh/Mesh.h>
 #include <dolfinx/mesh/utils.h>
 #include <memory>
+#include <numeric>
+#include <omp.h>
 #include <petscsys.h>
+#include <stdexcept>
 #include <utility>
 
 using namespace dolfinx;
@@ -28,9 +39,28 @@ using T = PetscScalar;
 
 std::tuple<std::shared_ptr<la::Vector<T>>, std::shared_ptr<fem::Function<T>>,
            std::function<int(fem::Function<T>&, const la::Vector<T>&)>>
-poisson::problem(std::shared_ptr<mesh::Mesh<double>> mesh, int order)
+poisson::problem(std::shared_ptr<mesh::Mesh<double>> mesh, int order,
+                 std::string dof_ordering, std::string multigrid_type,
+                 std::shared_ptr<const MeshHierarchy> hierarchy,
+                 std::string assembly, int batch_width,
+                 std::string matrix_type, double rtol, int max_it,
+                 int num_rhs, int num_reassemble, int num_matmult)
 {
-  common::Timer t0("ZZZ FunctionSpace");
+  if (assembly != "scalar" and assembly != "batched")
+    throw std::runtime_error("Unknown assembly mode: " + assembly);
+  if (assembly == "batched" and batch_width != 4 and batch_width != 8)
+    throw std::runtime_error("Batch width must be 4 or 8");
+  if (multigrid_type != "none" and multigrid_type != "gmg"
+      and multigrid_type != "pmg")
+  {
+    throw std::runtime_error("Unknown multigrid type: " + multigrid_type);
+  }
+  if (multigrid_type == "gmg" and !hierarchy)
+    throw std::runtime_error("Geometric multigrid requires a mesh hierarchy");
+  if (multigrid_type == "pmg" and order < 2)
+    throw std::runtime_error("p-multigrid requires order > 1");
+
+  Phase t0("ZZZ FunctionSpace");
 
   auto element = basix::create_element<double>(
       basix::element::family::P, basix::cell::type::tetrahedron, order,
@@ -41,61 +71,59 @@ poisson::problem(std::shared_ptr<mesh::Mesh<double>> mesh, int order)
       = std::make_shared<const fem::FiniteElement<double>>(element);
 
   auto V = std::make_shared<fem::FunctionSpace<double>>(
-      fem::create_functionspace(mesh, dolfinx_element));
+      reorder::create_functionspace(mesh, dolfinx_element, dof_ordering));
 
   t0.stop();
-  t0.flush();
 
-  common::Timer t1("ZZZ Assemble");
+  Phase t1("ZZZ Assemble");
 
-  common::Timer t2("ZZZ Create boundary conditions");
+  Phase t2("ZZZ Create boundary conditions");
   // Define boundary condition
   auto u0 = std::make_shared<fem::Function<T>>(V);
   u0->x()->set(0);
 
-  // Find facets with bc applied
-  const int tdim = mesh->topology()->dim();
-  const std::vector<std::int32_t> bc_facets = mesh::locate_entities(
-      *mesh, tdim - 1,
-      [](auto x)
-      {
-        constexpr double eps = 1.0e-8;
-        std::vector<std::int8_t> marker(x.extent(1), false);
-        for (std::size_t p = 0; p < x.extent(1); ++p)
-        {
-          double x0 = x(0, p);
-          if (std::abs(x0) < eps or std::abs(x0 - 1) < eps)
-            marker[p] = true;
-        }
-        return marker;
-      });
-
   // Find constrained dofs
-  const std::vector<std::int32_t> bdofs = fem::locate_dofs_topological(
-      *V->mesh()->topology_mutable(), *V->dofmap(), tdim - 1, bc_facets);
+  const int tdim = mesh->topology()->dim();
+  auto boundary = [](auto x)
+  {
+    constexpr double eps = 1.0e-8;
+    std::vector<std::int8_t> marker(x.extent(1), false);
+    for (std::size_t p = 0; p < x.extent(1); ++p)
+    {
+      double x0 = x(0, p);
+      if (std::abs(x0) < eps or std::abs(x0 - 1) < eps)
+        marker[p] = true;
+    }
+    return marker;
+  };
+  const std::vector<std::int32_t> bdofs
+      = topology::locate_boundary_dofs(*V, boundary);
 
   auto bc = std::make_shared<fem::DirichletBC<T>>(u0, bdofs);
   t2.stop();
-  t2.flush();
 
-  // Define coefficients
-  common::Timer t3("ZZZ Create RHS function");
+  // Define coefficients. The source of right-hand side k is centred at
+  // multirhs::centre(k).
+  Phase t3("ZZZ Create RHS function");
+  auto source = [](std::array<double, 2> c)
+  {
+    return [c](auto x) -> std::pair<std::vector<T>, std::vector<std::size_t>>
+    {
+      std::vector<T> v(x.extent(1));
+      for (std::size_t p = 0; p < x.extent(1); ++p)
+      {
+        double dx = x(0, p) - c[0];
+        double dy = x(1, p) - c[1];
+        double dr = dx * dx + dy * dy;
+        v[p] = 10 * std::exp(-dr / 0.02);
+      }
+
+      return {std::move(v), {v.size()}};
+    };
+  };
   auto f = std::make_shared<fem::Function<T>>(V);
   auto g = std::make_shared<fem::Function<T>>(V);
-  f->interpolate(
-      [](auto x) -> std::pair<std::vector<T>, std::vector<std::size_t>>
-      {
-        std::vector<T> v(x.extent(1));
-        for (std::size_t p = 0; p < x.extent(1); ++p)
-        {
-          double dx = x(0, p) - 0.5;
-          double dy = x(1, p) - 0.5;
-          double dr = dx * dx + dy * dy;
-          v[p] = 10 * std::exp(-dr / 0.02);
-        }
-
-        return {std::move(v), {v.size()}};
-      });
+  f->interpolate(source(multirhs::centre(0)));
   g->interpolate(
       [](auto x) -> std::pair<std::vector<T>, std::vector<std::size_t>>
       {
@@ -105,7 +133,6 @@ poisson::problem(std::shared_ptr<mesh::Mesh<double>> mesh, int order)
         return {f, {f.size()}};
       });
   t3.stop();
-  t3.flush();
 
   std::vector form_poisson_L
       = {form_Poisson_L1, form_Poisson_L2, form_Poisson_L3};
@@ -118,63 +145,277 @@ poisson::problem(std::shared_ptr<mesh::Mesh<double>> mesh, int order)
   auto a = std::make_shared<fem::Form<T>>(fem::create_form<T>(
       *form_poisson_a.at(order - 1), {V, V}, {}, {}, {}, {}));
 
-  // Create matrices and vector, and assemble system
+  // Create matrices and vector, and assemble system. The coarse
+  // multigrid operators below are AIJ whatever the fine matrix type.
+  Phase tp("ZZZ Create sparsity pattern");
   std::shared_ptr<la::petsc::Matrix> A = std::make_shared<la::petsc::Matrix>(
-      fem::petsc::create_matrix(*a), false);
+      matrix::create_matrix(*a, matrix_type), false);
+  tp.stop();
+
+  // Colour cells for thread-parallel assembly
+  Phase tc("ZZZ Colour cells");
+  std::vector<std::int32_t> cells(
+      mesh->topology()->index_map(tdim)->size_local());
+  std::iota(cells.begin(), cells.end(), 0);
+  reorder::order_cells(cells, *V->dofmap(), dof_ordering);
+  auto dofmap = V->dofmap()->map();
+  const std::vector<std::vector<std::int32_t>> colours
+      = threaded::colour_cells(
+          cells, std::span(dofmap.data_handle(), dofmap.size()),
+          dofmap.extent(1));
+  tc.stop();
+
+  const bool use_threads = omp_get_max_threads() > 1;
+  std::vector<double> thread_times;
+
+  // Batched assembly contracts reference tensors over batches of cells
+  const bool batched_assembly = assembly == "batched";
+  batched::ReferenceTensors<T> ref;
+  if (batched_assembly)
+    ref = batched::reference_tensors<T>(element, order);
 
-  common::Timer t4("ZZZ Assemble matrix");
+  // Add the cell matrices to A and finalise it. With --reassemble this
+  // is repeated into the same storage.
+  Phase t4("ZZZ Assemble matrix");
   const std::vector constants_a = fem::pack_constants(*a);
   auto coeffs_a = fem::allocate_coefficient_storage(*a);
   fem::pack_coefficients(*a, coeffs_a);
-  fem::assemble_matrix<T>(la::petsc::Matrix::set_block_fn(A->mat(), ADD_VALUES),
-                          *a, constants_a,
-                          fem::make_coefficients_span(coeffs_a), {*bc});
-  MatAssemblyBegin(A->mat(), MAT_FLUSH_ASSEMBLY);
-  MatAssemblyEnd(A->mat(), MAT_FLUSH_ASSEMBLY);
-  fem::set_diagonal<T>(la::petsc::Matrix::set_fn(A->mat(), INSERT_VALUES), *V,
-                       {*bc});
-  MatAssemblyBegin(A->mat(), MAT_FINAL_ASSEMBLY);
-  MatAssemblyEnd(A->mat(), MAT_FINAL_ASSEMBLY);
+  auto assemble_matrix = [&]()
+  {
+    threaded::MatrixTimes times;
+    if (batched_assembly)
+    {
+      auto mat_add = la::petsc::Matrix::set_block_fn(A->mat(), ADD_VALUES);
+      if (batch_width == 4)
+      {
+        times = batched::assemble_matrix<4, T>(mat_add, *V, ref, {*bc},
+                                               colours);
+      }
+      else
+      {
+        times = batched::assemble_matrix<8, T>(mat_add, *V, ref, {*bc},
+                                               colours);
+      }
+    }
+    else if (use_threads)
+    {
+      times = threaded::assemble_matrix<T>(
+          la::petsc::Matrix::set_block_fn(A->mat(), ADD_VALUES), *a,
+          constants_a, fem::make_coefficients_span(coeffs_a), {*bc}, colours);
+    }
+    else
+    {
+      fem::assemble_matrix<T>(
+          la::petsc::Matrix::set_block_fn(A->mat(), ADD_VALUES), *a,
+          constants_a, fem::make_coefficients_span(coeffs_a), {*bc});
+    }
+    MatAssemblyBegin(A->mat(), MAT_FLUSH_ASSEMBLY);
+    MatAssemblyEnd(A->mat(), MAT_FLUSH_ASSEMBLY);
+    fem::set_diagonal<T>(la::petsc::Matrix::set_fn(A->mat(), INSERT_VALUES),
+                         *V, {*bc});
+    MatAssemblyBegin(A->mat(), MAT_FINAL_ASSEMBLY);
+    MatAssemblyEnd(A->mat(), MAT_FINAL_ASSEMBLY);
+    return times;
+  };
+  const threaded::MatrixTimes matrix_times = assemble_matrix();
   t4.stop();
-  t4.flush();
+  if (use_threads)
+  {
+    threaded::print_matrix_times(mesh->comm(), "ZZZ Assemble matrix",
+                                 matrix_times);
+  }
+
+  // Multigrid: operators rediscretised on the coarse levels, which
+  // are the coarse meshes of the hierarchy (gmg) or the lower degree
+  // spaces on the same mesh (pmg)
+  const bool pmg = multigrid_type == "pmg";
+  std::vector<std::shared_ptr<la::petsc::Matrix>> mg_operators;
+  std::vector<std::shared_ptr<const multigrid::Transfer>> mg_transfers;
+  std::vector<std::shared_ptr<fem::FunctionSpace<double>>> mg_spaces;
+  if (multigrid_type != "none")
+  {
+    Phase tmg("ZZZ Create multigrid levels");
+    if (pmg)
+    {
+      mg_spaces = multigrid::create_p_spaces(V, order, {});
+      mg_transfers = multigrid::create_p_transfers(mg_spaces);
+    }
+    else
+    {
+      mg_spaces = multigrid::create_spaces(*hierarchy, dolfinx_element, V);
+      mg_transfers
+          = multigrid::create_transfers(mg_spaces, element, *hierarchy);
+    }
+    for (std::size_t l = 0; l + 1 < mg_spaces.size(); ++l)
+    {
+      auto Vl = mg_spaces[l];
+      const int order_l = pmg ? l + 1 : order;
+      mg_operators.push_back(multigrid::assemble_level_operator(
+          *form_poisson_a.at(order_l - 1), Vl,
+          topology::locate_boundary_dofs(*Vl, boundary)));
+    }
+    mg_operators.push_back(A);
+  }
 
   // Create la::Vector
   la::Vector<T> b(L->function_spaces()[0]->dofmap()->index_map,
                   L->function_spaces()[0]->dofmap()->index_map_bs());
   b.set(0);
-  common::Timer t5("ZZZ Assemble vector");
+  Phase t5("ZZZ Assemble vector");
   const std::vector constants_L = fem::pack_constants(*L);
   auto coeffs_L = fem::allocate_coefficient_storage(*L);
   fem::pack_coefficients(*L, coeffs_L);
-  fem::assemble_vector<T>(b.mutable_array(), *L, constants_L,
-                          fem::make_coefficients_span(coeffs_L));
-  fem::apply_lifting<T, double>(b.mutable_array(), {*a}, {constants_L},
-                                {fem::make_coefficients_span(coeffs_L)},
-                                {{*bc}}, {}, 1.0);
-  b.scatter_rev(std::plus<>());
-  bc->set(b.mutable_array(), std::nullopt);
+  auto assemble_vector = [&]()
+  {
+    std::vector<double> times;
+    b.set(0);
+    if (batched_assembly)
+    {
+      std::span<const T> f_values = f->x()->array();
+      if (batch_width == 4)
+      {
+        times = batched::assemble_vector<4, T>(
+            b.mutable_array(), *L, constants_L,
+            fem::make_coefficients_span(coeffs_L), ref, f_values, colours);
+      }
+      else
+      {
+        times = batched::assemble_vector<8, T>(
+            b.mutable_array(), *L, constants_L,
+            fem::make_coefficients_span(coeffs_L), ref, f_values, colours);
+      }
+    }
+    else if (use_threads)
+    {
+      times = threaded::assemble_vector<T>(
+          b.mutable_array(), *L, constants_L,
+          fem::make_coefficients_span(coeffs_L), colours);
+    }
+    else
+    {
+      fem::assemble_vector<T>(b.mutable_array(), *L, constants_L,
+                              fem::make_coefficients_span(coeffs_L));
+    }
+    fem::apply_lifting<T, double>(b.mutable_array(), {*a}, {constants_L},
+                                  {fem::make_coefficients_span(coeffs_L)},
+                                  {{*bc}}, {}, 1.0);
+    b.scatter_rev(std::plus<>());
+    bc->set(b.mutable_array(), std::nullopt);
+    return times;
+  };
+  thread_times = assemble_vector();
   t5.stop();
-  t5.flush();
+  if (use_threads)
+  {
+    threaded::print_thread_balance(mesh->comm(), "ZZZ Assemble vector",
+                                   thread_times);
+  }
+
+  // Further right-hand sides with the source moved, solved together
+  // with b on the first call to the solver function
+  auto rhs = std::make_shared<std::vector<la::Vector<T>>>();
+  if (num_rhs > 1)
+  {
+    Phase t6("ZZZ Assemble RHS block");
+    rhs->push_back(b);
+    for (int k = 1; k < num_rhs; ++k)
+    {
+      auto f_k = std::make_shared<fem::Function<T>>(V);
+      f_k->interpolate(source(multirhs::centre(k)));
+      const fem::Form<T> L_k = fem::create_form<T>(
+          *form_poisson_L.at(order - 1), {V}, {{"w0", f_k}, {"w1", g}}, {},
+          {}, {});
+      la::Vector<T>& b_k = rhs->emplace_back(b.index_map(), b.bs());
+      b_k.set(0);
+      const std::vector constants_k = fem::pack_constants(L_k);
+      auto coeffs_k = fem::allocate_coefficient_storage(L_k);
+      fem::pack_coefficients(L_k, coeffs_k);
+      fem::assemble_vector<T>(b_k.mutable_array(), L_k, constants_k,
+                              fem::make_coefficients_span(coeffs_k));
+      fem::apply_lifting<T, double>(b_k.mutable_array(), {*a}, {constants_k},
+                                    {fem::make_coefficients_span(coeffs_k)},
+                                    {{*bc}}, {}, 1.0);
+      b_k.scatter_rev(std::plus<>());
+      bc->set(b_k.mutable_array(), std::nullopt);
+    }
+  }
 
   t1.stop();
-  t1.flush();
+
+  if (num_reassemble > 0)
+  {
+    const std::int64_t num_cells
+        = mesh->topology()->index_map(tdim)->size_global();
+    const std::int64_t cell_dofs = V->dofmap()->map().extent(1);
+    matrix::time_reassembly(
+        A->mat(), [&]() { assemble_matrix(); }, [&]() { assemble_vector(); },
+        num_cells, cell_dofs * cell_dofs, tp.elapsed().count(),
+        t4.elapsed().count(), num_reassemble);
+  }
+
+  if (num_matmult > 0)
+    matrix::time_matmult(A->mat(), num_matmult);
 
   // Create Function to hold solution
   auto u = std::make_shared<fem::Function<T>>(V);
+  // Create solver. It is kept alive across calls to the solver
+  // function, and the preconditioner is set up on the first call only.
+  // PETSc options are applied after the multigrid setup and the
+  // tolerances, so that they can override them.
+  auto solver = std::make_shared<la::petsc::KrylovSolver>(mesh->comm());
+  if (multigrid_type != "none")
+  {
+    // With pmg the P1 coarse level is solved by one AMG cycle
+#ifdef PETSC_HAVE_HYPRE
+    const std::string coarse_pc = pmg ? PCHYPRE : "";
+#else
+    const std::string coarse_pc = pmg ? PCGAMG : "";
+#endif
+    std::vector<Mat> mats;
+    for (auto& A_l : mg_operators)
+      mats.push_back(A_l->mat());
+    multigrid::set_pcmg(solver->ksp(), mats, mg_transfers, coarse_pc);
+  }
+  KSPSetTolerances(solver->ksp(), rtol, PETSC_DEFAULT, PETSC_DEFAULT,
+                   max_it);
+  solver->set_from_options();
+  solver->set_operator(A->mat());
+
   std::function<int(fem::Function<T>&, const la::Vector<T>&)> solver_function
-      = [A](fem::Function<T>& u, const la::Vector<T>& b)
+      = [A, solver, rhs, setup = false](fem::Function<T>& u,
+                                        const la::Vector<T>& b) mutable
   {
-    // Create solver
-    la::petsc::KrylovSolver solver(MPI_COMM_WORLD);
-    solver.set_from_options();
-    solver.set_operator(A->mat());
+    const bool first_call = !setup;
+    if (!setup)
+    {
+      Phase t("ZZZ PC setup");
+      KSPSetUp(solver->ksp());
+      PC pc;
+      KSPGetPC(solver->ksp(), &pc);
+      PCSetUp(pc);
+      KSPSetReusePreconditioner(solver->ksp(), PETSC_TRUE);
+      t.stop();
+      setup = true;
+    }
 
     // Wrap la::Vector
     la::petsc::Vector _b(la::petsc::create_vector_wrap(b), false);
     la::petsc::Vector x(la::petsc::create_vector_wrap(*u.x()), false);
 
     // Solve
-    int num_iter = solver.solve(x.vec(), _b.vec());
+    int num_iter = solver->solve(x.vec(), _b.vec());
+
+    if (first_call)
+    {
+      PetscInt num_dofs;
+      MatGetSize(A->mat(), &num_dofs, nullptr);
+      print_memory_per_dof(u.function_space()->mesh()->comm(),
+                           "Assembled matrix memory", matrix::bytes(A->mat()),
+                           num_dofs);
+      if (!rhs->empty())
+        multirhs::compare_petsc(solver->ksp(), *rhs);
+    }
+
     return num_iter;
   };
 
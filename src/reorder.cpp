@@ -0,0 +1,359 @@
+// Copyright (C) 2026 The FEniCS Project
+//
+// This file is part of FEniCS-miniapp (https://www.fenicsproject.org)
+//
+// SPDX-License-Identifier:    MIT
+
+#include "reorder.h"
+#include <algorithm>
+#include <array>
+#include <dolfinx/common/IndexMap.h>
+#include <dolfinx/common/MPI.h>
+#include <dolfinx/fem/utils.h>
+#include <dolfinx/la/Vector.h>
+#include <limits>
+#include <numeric>
+#include <span>
+#include <stdexcept>
+#include <utility>
+
+using namespace dolfinx;
+
+namespace
+{
+// Breadth-first search from `start` over the nodes that are not yet
+// numbered. Sets the level of each reached node in `level` (which must
+// be -1 for all unreached nodes on entry) and appends the reached nodes
+// to `reached`. Returns the nodes of the last level.
+std::vector<std::int32_t>
+last_level(const graph::AdjacencyList<std::int32_t>& graph,
+           std::int32_t start, const std::vector<std::int8_t>& numbered,
+           std::vector<std::int32_t>& level,
+           std::vector<std::int32_t>& reached)
+{
+  std::size_t front = reached.size();
+  reached.push_back(start);
+  level[start] = 0;
+  std::int32_t depth = 0;
+  while (front < reached.size())
+  {
+    const std::int32_t v = reached[front++];
+    depth = level[v];
+    for (std::int32_t w : graph.links(v))
+    {
+      if (!numbered[w] and level[w] == -1)
+      {
+        level[w] = level[v] + 1;
+        reached.push_back(w);
+      }
+    }
+  }
+
+  std::vector<std::int32_t> last;
+  for (std::int32_t v : reached)
+  {
+    if (level[v] == depth)
+      last.push_back(v);
+  }
+  return last;
+}
+
+// Index of the Hilbert curve cell containing a point with integer
+// coordinates in [0, 2^bits), following J. Skilling, "Programming the
+// Hilbert curve", AIP Conf. Proc. 707 (2004).
+std::uint64_t hilbert_index(std::array<std::uint32_t, 3> X, int bits)
+{
+  const std::uint32_t M = 1u << (bits - 1);
+
+  // Inverse undo excess work
+  for (std::uint32_t Q = M; Q > 1; Q >>= 1)
+  {
+    const std::uint32_t P = Q - 1;
+    for (int i = 0; i < 3; ++i)
+    {
+      if (X[i] & Q)
+        X[0] ^= P;
+      else
+      {
+        const std::uint32_t t = (X[0] ^ X[i]) & P;
+        X[0] ^= t;
+        X[i] ^= t;
+      }
+    }
+  }
+
+  // Gray encode
+  for (int i = 1; i < 3; ++i)
+    X[i] ^= X[i - 1];
+  std::uint32_t t = 0;
+  for (std::uint32_t Q = M; Q > 1; Q >>= 1)
+  {
+    if (X[2] & Q)
+      t ^= Q - 1;
+  }
+  for (int i = 0; i < 3; ++i)
+    X[i] ^= t;
+
+  // Interleave the bits of the transposed index
+  std::uint64_t key = 0;
+  for (int b = bits - 1; b >= 0; --b)
+    for (int i = 0; i < 3; ++i)
+      key = (key << 1) | ((X[i] >> b) & 1u);
+  return key;
+}
+
+// Renumber the owned dofs of a function space: owned dof i becomes
+// owned dof perm[i]. Ghosts keep their local position, and their new
+// global indices are fetched from the owning processes.
+fem::FunctionSpace<double> permute_owned(const fem::FunctionSpace<double>& V,
+                                         std::span<const std::int32_t> perm)
+{
+  auto dofmap0 = V.dofmap();
+  auto map0 = dofmap0->index_map;
+  const std::int32_t size_local = map0->size_local();
+  const std::int32_t num_ghosts = map0->num_ghosts();
+
+  la::Vector<std::int64_t> global(map0, 1);
+  std::span<std::int64_t> g = global.mutable_array();
+  const std::int64_t offset = map0->local_range()[0];
+  for (std::int32_t i = 0; i < size_local; ++i)
+    g[i] = offset + perm[i];
+  global.scatter_fwd();
+  const std::vector<std::int64_t> ghosts(g.begin() + size_local,
+                                         g.begin() + size_local + num_ghosts);
+  auto map = std::make_shared<const common::IndexMap>(
+      map0->comm(), size_local, ghosts, map0->owners());
+
+  auto dofs0 = dofmap0->map();
+  std::vector<std::int32_t> dofs(dofs0.data_handle(),
+                                 dofs0.data_handle() + dofs0.size());
+  for (std::int32_t& d : dofs)
+  {
+    if (d < size_local)
+      d = perm[d];
+  }
+
+  auto dofmap = std::make_shared<const fem::DofMap>(
+      dofmap0->element_dof_layout(), map, dofmap0->index_map_bs(),
+      std::move(dofs), dofmap0->bs());
+  return fem::FunctionSpace<double>(V.mesh(), V.element(), dofmap);
+}
+} // namespace
+
+//-----------------------------------------------------------------------------
+std::vector<int>
+reorder::reverse_cuthill_mckee(const graph::AdjacencyList<std::int32_t>& graph)
+{
+  const std::int32_t n = graph.num_nodes();
+  std::vector<std::int8_t> numbered(n, false);
+  std::vector<std::int32_t> level(n, -1);
+  std::vector<std::int32_t> order, reached;
+  order.reserve(n);
+
+  for (std::int32_t seed = 0; seed < n; ++seed)
+  {
+    if (numbered[seed])
+      continue;
+
+    // Find a pseudo-peripheral node of the component of `seed`: repeat
+    // the search from a lowest-degree node of the last level while the
+    // eccentricity increases
+    std::int32_t start = seed;
+    std::int32_t depth = -1;
+    for (int it = 0; it < 8; ++it)
+    {
+      for (std::int32_t v : reached)
+        level[v] = -1;
+      reached.clear();
+      std::vector<std::int32_t> last
+          = last_level(graph, start, numbered, level, reached);
+      if (level[last.front()] <= depth)
+        break;
+      depth = level[last.front()];
+      start = *std::ranges::min_element(last, [&graph](auto a, auto b)
+                                        { return graph.num_links(a)
+                                                 < graph.num_links(b); });
+    }
+    for (std::int32_t v : reached)
+      level[v] = -1;
+    reached.clear();
+
+    // Cuthill-McKee: number the neighbours of each node in order of
+    // increasing degree
+    std::size_t front = order.size();
+    order.push_back(start);
+    numbered[start] = true;
+    std::vector<std::int32_t> next;
+    while (front < order.size())
+    {
+      const std::int32_t v = order[front++];
+      next.clear();
+      for (std::int32_t w : graph.links(v))
+      {
+        if (!numbered[w])
+        {
+          numbered[w] = true;
+          next.push_back(w);
+        }
+      }
+      std::ranges::stable_sort(next, [&graph](auto a, auto b)
+                               { return graph.num_links(a)
+                                        < graph.num_links(b); });
+      order.insert(order.end(), next.begin(), next.end());
+    }
+  }
+
+  // Reverse
+  std::vector<int> map(n);
+  for (std::int32_t i = 0; i < n; ++i)
+    map[order[i]] = n - 1 - i;
+  return map;
+}
+//-----------------------------------------------------------------------------
+fem::FunctionSpace<double> reorder::create_functionspace(
+    std::shared_ptr<mesh::Mesh<double>> mesh,
+    std::shared_ptr<const fem::FiniteElement<double>> element,
+    const std::string& method)
+{
+  if (method == "gps")
+    return fem::create_functionspace(mesh, element);
+  else if (method == "none")
+  {
+    return fem::create_functionspace(
+        mesh, element,
+        [](const graph::AdjacencyList<std::int32_t>& graph)
+        {
+          std::vector<int> map(graph.num_nodes());
+          std::iota(map.begin(), map.end(), 0);
+          return map;
+        });
+  }
+  else if (method == "rcm")
+    return fem::create_functionspace(mesh, element, reverse_cuthill_mckee);
+  else if (method != "hilbert")
+    throw std::runtime_error("Unknown dof ordering: " + method);
+
+  // Sort owned dofs along a Hilbert curve through the bounding box of
+  // the owned dof coordinates
+  fem::FunctionSpace<double> V = fem::create_functionspace(mesh, element);
+  const std::int32_t size_local = V.dofmap()->index_map->size_local();
+  const std::vector<double> x = V.tabulate_dof_coordinates(false);
+
+  std::array<double, 3> lo, hi;
+  lo.fill(std::numeric_limits<double>::max());
+  hi.fill(std::numeric_limits<double>::lowest());
+  for (std::int32_t i = 0; i < size_local; ++i)
+  {
+    for (int j = 0; j < 3; ++j)
+    {
+      lo[j] = std::min(lo[j], x[3 * i + j]);
+      hi[j] = std::max(hi[j], x[3 * i + j]);
+    }
+  }
+
+  constexpr int bits = 21;
+  const double scale = (1u << bits) - 1;
+  std::vector<std::pair<std::uint64_t, std::int32_t>> keys(size_local);
+  for (std::int32_t i = 0; i < size_local; ++i)
+  {
+    std::array<std::uint32_t, 3> X;
+    for (int j = 0; j < 3; ++j)
+    {
+      const double h = hi[j] - lo[j];
+      X[j] = h > 0 ? (x[3 * i + j] - lo[j]) / h * scale : 0;
+    }
+    keys[i] = {hilbert_index(X, bits), i};
+  }
+  std::ranges::sort(keys);
+
+  std::vector<std::int32_t> perm(size_local);
+  for (std::int32_t i = 0; i < size_local; ++i)
+    perm[keys[i].second] = i;
+  return permute_owned(V, perm);
+}
+//-----------------------------------------------------------------------------
+void reorder::order_cells(std::vector<std::int32_t>& cells,
+                          const fem::DofMap& dofmap, const std::string& method)
+{
+  if (method != "rcm" and method != "hilbert")
+    return;
+
+  auto dofs = dofmap.map();
+  const std::size_t nd = dofs.extent(1);
+  std::vector<std::pair<std::int32_t, std::int32_t>> keys(cells.size());
+  for (std::size_t i = 0; i < cells.size(); ++i)
+  {
+    auto cell_dofs = std::span(dofs.data_handle() + cells[i] * nd, nd);
+    keys[i] = {std::ranges::min(cell_dofs), cells[i]};
+  }
+  std::ranges::sort(keys);
+  for (std::size_t i = 0; i < cells.size(); ++i)
+    cells[i] = keys[i].second;
+}
+//-----------------------------------------------------------------------------
+reorder::Statistics
+reorder::statistics(const fem::FunctionSpace<double>& V)
+{
+  auto map = V.dofmap()->index_map;
+  MPI_Comm comm = map->comm();
+  const std::int32_t size_local = map->size_local();
+
+  // Row bandwidth of the owned block, over all (owned and ghost) cells
+  auto dofs = V.dofmap()->map();
+  const std::size_t nd = dofs.extent(1);
+  std::vector<std::int32_t> bandwidth(size_local, 0);
+  std::vector<std::int8_t> ghost_coupled(size_local, false);
+  for (std::size_t c = 0; c < dofs.extent(0); ++c)
+  {
+    auto cell_dofs = std::span(dofs.data_handle() + c * nd, nd);
+    std::int32_t lo = size_local, hi = -1;
+    bool has_ghost = false;
+    for (std::int32_t d : cell_dofs)
+    {
+      if (d < size_local)
+      {
+        lo = std::min(lo, d);
+        hi = std::max(hi, d);
+      }
+      else
+        has_ghost = true;
+    }
+
+    for (std::int32_t d : cell_dofs)
+    {
+      if (d < size_local)
+      {
+        bandwidth[d] = std::max({bandwidth[d], d - lo, hi - d});
+        ghost_coupled[d] = ghost_coupled[d] or has_ghost;
+      }
+    }
+  }
+
+  std::int64_t max_bandwidth = 0;
+  double sum_bandwidth = 0;
+  std::int32_t num_coupled = 0, first = size_local, last = -1;
+  for (std::int32_t i = 0; i < size_local; ++i)
+  {
+    max_bandwidth = std::max<std::int64_t>(max_bandwidth, bandwidth[i]);
+    sum_bandwidth += bandwidth[i];
+    if (ghost_coupled[i])
+    {
+      ++num_coupled;
+      first = std::min(first, i);
+      last = std::max(last, i);
+    }
+  }
+
+  const double n = std::max(size_local, 1);
+  std::array<double, 3> local
+      = {sum_bandwidth / n, num_coupled / n,
+         num_coupled > 0 ? (last - first + 1) / n : 0.0};
+  std::array<double, 3> global;
+  MPI_Allreduce(local.data(), global.data(), local.size(), MPI_DOUBLE, MPI_SUM,
+                comm);
+  MPI_Allreduce(MPI_IN_PLACE, &max_bandwidth, 1, MPI_INT64_T, MPI_MAX, comm);
+
+  const int size = dolfinx::MPI::size(comm);
+  return {max_bandwidth, global[0] / size, global[1] / size,
+          global[2] / size};
+}
@@ -0,0 +1,87 @@
+// Copyright (C) 2026 The FEniCS Project
+//
+// This file is part of FEniCS-miniapp (https://www.fenicsproject.org)
+//
+// SPDX-License-Identifier:    MIT
+
+#pragma once
+
+#include <cstdint>
+#include <dolfinx/fem/DofMap.h>
+#include <dolfinx/fem/FiniteElement.h>
+#include <dolfinx/fem/FunctionSpace.h>
+#include <dolfinx/graph/AdjacencyList.h>
+#include <dolfinx/mesh/Mesh.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+/// Cache-locality orderings of the degrees of freedom and of the cell
+/// traversal. The orderings are:
+///
+/// - `gps`: the DOLFINx default (Gibbs-Poole-Stockmeyer) dof ordering
+/// - `none`: dofs numbered in the order in which they are met in the
+///   mesh, i.e. as produced by mesh generation and refinement
+/// - `rcm`: reverse Cuthill-McKee ordering of the owned dof graph
+/// - `hilbert`: owned dofs sorted along a Hilbert curve through their
+///   coordinates
+///
+/// For `rcm` and `hilbert` cells are also traversed in dof order. All
+/// orderings are process-local: the owned dofs of a process are
+/// renumbered within its range.
+namespace reorder
+{
+/// Reverse Cuthill-McKee ordering of a graph. Each connected component
+/// is started from a pseudo-peripheral node.
+/// @param[in] graph Graph
+/// @return Map from old to new node index
+std::vector<int>
+reverse_cuthill_mckee(const dolfinx::graph::AdjacencyList<std::int32_t>& graph);
+
+/// Create a function space with the owned dofs ordered by `method`
+/// @param[in] mesh Mesh
+/// @param[in] element Finite element
+/// @param[in] method Ordering (gps, none, rcm or hilbert)
+/// @return Function space
+dolfinx::fem::FunctionSpace<double> create_functionspace(
+    std::shared_ptr<dolfinx::mesh::Mesh<double>> mesh,
+    std::shared_ptr<const dolfinx::fem::FiniteElement<double>> element,
+    const std::string& method);
+
+/// Sort a list of cells by the lowest dof of each cell, so that cells
+/// are visited in dof order. Does nothing for the `gps` and `none`
+/// orderings.
+/// @param[in,out] cells Local cell indices
+/// @param[in] dofmap Dofmap
+/// @param[in] method Ordering (gps, none, rcm or hilbert)
+void order_cells(std::vector<std::int32_t>& cells,
+                 const dolfinx::fem::DofMap& dofmap,
+                 const std::string& method);
+
+/// Locality measures of a dof ordering, reduced over processes
+struct Statistics
+{
+  /// Largest distance |i - j| between owned dofs i and j that share a
+  /// cell, i.e. the bandwidth of the diagonal block of the matrix (in
+  /// blocks), max over processes
+  std::int64_t max_bandwidth;
+
+  /// Mean over rows of the row bandwidth, mean over processes
+  double mean_bandwidth;
+
+  /// Fraction of owned dofs that share a cell with a ghost dof, mean
+  /// over processes
+  double ghost_coupled_fraction;
+
+  /// Fraction of the owned index range spanned by the owned dofs that
+  /// share a cell with a ghost dof, mean over processes. Small values
+  /// mean that halo-adjacent dofs are stored contiguously.
+  double ghost_coupled_span;
+};
+
+/// Compute the locality measures of the dof ordering of a function
+/// space. Collective.
+/// @param[in] V Function space
+/// @return Statistics, valid on all processes
+Statistics statistics(const dolfinx::fem::FunctionSpace<double>& V);
+} // namespace reorder
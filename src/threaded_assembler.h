@@ -0,0 +1,500 @@
+// Copyright (C) 2026 The FEniCS Project
+//
+// This file is part of FEniCS-miniapp (https://www.fenicsproject.org)
+//
+// SPDX-License-Identifier:    MIT
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <dolfinx/common/MPI.h>
+#include <dolfinx/fem/DirichletBC.h>
+#include <dolfinx/fem/DofMap.h>
+#include <dolfinx/fem/Form.h>
+#include <dolfinx/fem/FunctionSpace.h>
+#include <dolfinx/mesh/Geometry.h>
+#include <dolfinx/mesh/Mesh.h>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <numeric>
+#include <omp.h>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+/// Thread-parallel assembly over owned cells. Cells are coloured such
+/// that no two cells of the same colour share a degree of freedom, and
+/// the cells of one colour are divided between threads. Threads can
+/// then add cell contributions to the same global array without
+/// atomics or locks; matrix insertion, which is not thread-safe, is
+/// done in bulk after each colour.
+namespace threaded
+{
+/// Colour cells with a greedy algorithm such that cells with the same
+/// colour share no degrees of freedom. If only a single OpenMP thread is
+/// available all cells are placed in one colour.
+/// @param[in] cells Cells to colour
+/// @param[in] dofs Cell dofs, flattened with `ndofs` entries per cell
+/// @param[in] ndofs Number of dofs per cell
+/// @return List of cells for each colour
+inline std::vector<std::vector<std::int32_t>>
+colour_cells(std::span<const std::int32_t> cells,
+             std::span<const std::int32_t> dofs, int ndofs)
+{
+  if (omp_get_max_threads() == 1)
+    return {std::vector<std::int32_t>(cells.begin(), cells.end())};
+
+  // Build dof-to-cell (position in `cells`) adjacency
+  std::int32_t num_dofs = 0;
+  for (std::int32_t c : cells)
+  {
+    for (int i = 0; i < ndofs; ++i)
+      num_dofs = std::max(num_dofs, dofs[c * ndofs + i] + 1);
+  }
+  std::vector<std::int32_t> offsets(num_dofs + 1, 0);
+  for (std::int32_t c : cells)
+    for (int i = 0; i < ndofs; ++i)
+      ++offsets[dofs[c * ndofs + i] + 1];
+  std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+  std::vector<std::int32_t> dof_cells(offsets.back());
+  {
+    std::vector<std::int32_t> pos(offsets.begin(), std::prev(offsets.end()));
+    for (std::size_t p = 0; p < cells.size(); ++p)
+      for (int i = 0; i < ndofs; ++i)
+        dof_cells[pos[dofs[cells[p] * ndofs + i]]++] = p;
+  }
+
+  // Give each cell the lowest colour not used by a neighbouring cell
+  std::vector<int> colour(cells.size(), -1);
+  std::vector<std::size_t> used;
+  std::vector<std::vector<std::int32_t>> colours;
+  for (std::size_t p = 0; p < cells.size(); ++p)
+  {
+    for (int i = 0; i < ndofs; ++i)
+    {
+      const std::int32_t dof = dofs[cells[p] * ndofs + i];
+      for (std::int32_t j = offsets[dof]; j < offsets[dof + 1]; ++j)
+      {
+        if (int cj = colour[dof_cells[j]]; cj >= 0)
+        {
+          if (cj >= static_cast<int>(used.size()))
+            used.resize(cj + 1, 0);
+          used[cj] = p + 1;
+        }
+      }
+    }
+
+    int c = 0;
+    while (c < static_cast<int>(used.size()) and used[c] == p + 1)
+      ++c;
+    colour[p] = c;
+    if (c == static_cast<int>(colours.size()))
+      colours.emplace_back();
+    colours[c].push_back(cells[p]);
+  }
+
+  return colours;
+}
+
+/// Divide the range [0, n) into contiguous blocks between the OpenMP
+/// threads and call `fn(c0, c1)` for the block [c0, c1) of each thread
+/// @param[in] n Size of the range
+/// @param[in] fn Function called from each thread
+/// @param[in,out] times Time (seconds) spent in `fn` is added to the
+/// entry of each thread
+template <typename Fn>
+void for_each_block(std::size_t n, Fn&& fn, std::span<double> times)
+{
+#pragma omp parallel
+  {
+    const std::size_t num_threads = omp_get_num_threads();
+    const std::size_t t = omp_get_thread_num();
+    const std::size_t c0 = n * t / num_threads;
+    const std::size_t c1 = n * (t + 1) / num_threads;
+    const double t0 = omp_get_wtime();
+    fn(c0, c1);
+    times[t] += omp_get_wtime() - t0;
+  }
+}
+
+/// Call `fn` on the cells of each colour in turn, with the cells of a
+/// colour divided into contiguous blocks between the OpenMP threads
+/// @param[in] colours Lists of cells, one for each colour
+/// @param[in] fn Function called as `fn(cells)` from each thread. It
+/// must be safe to call concurrently for cells of the same colour.
+/// @return Time (seconds) spent in `fn` by each thread
+template <typename Fn>
+std::vector<double>
+for_each_colour(const std::vector<std::vector<std::int32_t>>& colours,
+                Fn&& fn)
+{
+  std::vector<double> times(omp_get_max_threads(), 0);
+  for (auto& cells : colours)
+  {
+    for_each_block(
+        cells.size(), [&](std::size_t c0, std::size_t c1)
+        { fn(std::span(cells.data() + c0, c1 - c0)); }, times);
+  }
+
+  return times;
+}
+
+/// Times of a thread-parallel matrix assembly
+struct MatrixTimes
+{
+  /// Time (seconds) spent computing element matrices by each thread
+  std::vector<double> compute;
+
+  /// Time (seconds) spent adding the element matrices to the matrix
+  double insert = 0;
+};
+
+/// Compute the element matrices of the cells of each colour in
+/// parallel into a buffer, and then add the buffered matrices of the
+/// colour to the matrix from a single thread. The matrix insertion
+/// functions (e.g. PETSc) are not thread-safe, even for the disjoint
+/// rows of the cells of one colour (off-process entries are stashed in
+/// one buffer), so insertion is done in bulk with no lock rather than
+/// with a lock taken for every cell. The buffer holds the element
+/// matrices of one colour.
+/// @param[in] mat_add Function that adds a (blocked) element matrix
+/// @param[in] colours Colouring of the cells
+/// @param[in] dofmap Cell dofs, flattened with `ndofs` entries per cell
+/// @param[in] ndofs Number of (blocked) dofs per cell
+/// @param[in] size Number of entries of an element matrix
+/// @param[in] compute Function called as `compute(cells, Ae)` from each
+/// thread, that computes the element matrices of the cells of a block
+/// of a colour, one after the other, in `Ae`
+/// @return Times of the element matrix computation and of insertion
+template <typename T, typename MatAdd, typename Compute>
+MatrixTimes
+assemble_colours(MatAdd&& mat_add,
+                 const std::vector<std::vector<std::int32_t>>& colours,
+                 std::span<const std::int32_t> dofmap, int ndofs, int size,
+                 Compute&& compute)
+{
+  MatrixTimes times{std::vector<double>(omp_get_max_threads(), 0)};
+  std::vector<T> buffer;
+  for (auto& cells : colours)
+  {
+    buffer.resize(cells.size() * size);
+    for_each_block(
+        cells.size(),
+        [&](std::size_t c0, std::size_t c1)
+        {
+          compute(std::span(cells.data() + c0, c1 - c0),
+                  std::span(buffer.data() + c0 * size, (c1 - c0) * size));
+        },
+        times.compute);
+
+    const double t0 = omp_get_wtime();
+    for (std::size_t p = 0; p < cells.size(); ++p)
+    {
+      std::span<const std::int32_t> dofs(dofmap.data() + cells[p] * ndofs,
+                                         ndofs);
+      mat_add(dofs, dofs,
+              std::span<const T>(buffer.data() + p * size, size));
+    }
+    times.insert += omp_get_wtime() - t0;
+  }
+
+  return times;
+}
+
+/// Print the balance of work between threads, given the time spent by
+/// each thread, on rank 0. The imbalance is the largest ratio of the
+/// maximum to the mean thread time over all ranks.
+/// @param[in] comm Communicator
+/// @param[in] name Name of the operation
+/// @param[in] times Time (seconds) spent by each thread on this rank
+inline void print_thread_balance(MPI_Comm comm, const std::string& name,
+                                 std::span<const double> times)
+{
+  const auto [tmin, tmax] = std::ranges::minmax(times);
+  const double tmean
+      = std::accumulate(times.begin(), times.end(), 0.0) / times.size();
+  std::array<double, 3> local
+      = {-tmin, tmax, tmean > 0.0 ? tmax / tmean : 1.0};
+  std::array<double, 3> global;
+  MPI_Reduce(local.data(), global.data(), local.size(), MPI_DOUBLE, MPI_MAX,
+             0, comm);
+  if (dolfinx::MPI::rank(comm) == 0)
+  {
+    std::cout << name << " thread balance (" << times.size()
+              << " threads): min " << -global[0] << " s, max " << global[1]
+              << " s, imbalance (max/mean) " << global[2] << std::endl;
+  }
+}
+
+/// Print the balance of the element matrix computation between
+/// threads, as `print_thread_balance`, and the time of inserting the
+/// element matrices into the matrix, on rank 0. The thread speedup is
+/// estimated as the time on one thread (summed thread compute time plus
+/// insertion time) over the time on all threads (compute time of the
+/// slowest thread plus insertion time); the minimum over ranks is
+/// printed.
+/// @param[in] comm Communicator
+/// @param[in] name Name of the operation
+/// @param[in] times Times of the assembly on this rank
+inline void print_matrix_times(MPI_Comm comm, const std::string& name,
+                               const MatrixTimes& times)
+{
+  print_thread_balance(comm, name + " (element matrices)", times.compute);
+  const double serial = times.insert
+                        + std::accumulate(times.compute.begin(),
+                                          times.compute.end(), 0.0);
+  const double parallel = times.insert + std::ranges::max(times.compute);
+  const double speedup = parallel > 0.0 ? serial / parallel : 1.0;
+  double insert, min_speedup;
+  MPI_Reduce(&times.insert, &insert, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+  MPI_Reduce(&speedup, &min_speedup, 1, MPI_DOUBLE, MPI_MIN, 0, comm);
+  if (dolfinx::MPI::rank(comm) == 0)
+  {
+    std::cout << name << " insertion (one thread): max " << insert
+              << " s, estimated thread speedup " << min_speedup
+              << std::endl;
+  }
+}
+
+/// Mark entries of a (blocked) array that are constrained by a
+/// Dirichlet boundary condition
+template <typename T>
+std::vector<std::int8_t>
+bc_markers(const dolfinx::fem::FunctionSpace<double>& V,
+           const std::vector<std::reference_wrapper<
+               const dolfinx::fem::DirichletBC<T>>>& bcs)
+{
+  auto map = V.dofmap()->index_map;
+  const int bs = V.dofmap()->index_map_bs();
+  std::vector<std::int8_t> markers(bs * (map->size_local() + map->num_ghosts()),
+                                   false);
+  for (auto& bc : bcs)
+    bc.get().mark_dofs(markers);
+  return markers;
+}
+
+/// Assemble the cell integrals of a bilinear form into a matrix, in
+/// parallel over the cells of each colour. Rows and columns constrained
+/// by a Dirichlet condition are zeroed. Element matrices are computed
+/// concurrently and inserted in bulk after each colour (see
+/// `assemble_colours`).
+/// @param[in] mat_add Function that adds a (blocked) element matrix
+/// @param[in] a Bilinear form
+/// @param[in] constants Packed constants of `a`
+/// @param[in] coeffs Packed coefficients of `a`
+/// @param[in] bcs Dirichlet boundary conditions
+/// @param[in] colours Colouring of the owned cells, from `colour_cells`
+/// @return Times of the element matrix computation and of insertion
+template <typename T, typename MatAdd>
+MatrixTimes assemble_matrix(
+    MatAdd&& mat_add, const dolfinx::fem::Form<T, double>& a,
+    std::span<const T> constants,
+    const std::map<std::pair<dolfinx::fem::IntegralType, int>,
+                   std::pair<std::span<const T>, int>>& coeffs,
+    const std::vector<
+        std::reference_wrapper<const dolfinx::fem::DirichletBC<T>>>& bcs,
+    const std::vector<std::vector<std::int32_t>>& colours)
+{
+  using dolfinx::fem::IntegralType;
+
+  auto V = a.function_spaces()[0];
+  if (V->element()->needs_dof_transformations())
+    throw std::runtime_error("Threaded assembly requires an element "
+                             "without dof transformations");
+  if (!a.integral_ids(IntegralType::exterior_facet).empty()
+      or !a.integral_ids(IntegralType::interior_facet).empty())
+  {
+    throw std::runtime_error("Threaded matrix assembly supports cell "
+                             "integrals only");
+  }
+
+  auto mesh = a.mesh();
+  auto x_dofmap = mesh->geometry().dofmap();
+  std::span<const double> x = mesh->geometry().x();
+  const std::size_t num_xdofs = x_dofmap.extent(1);
+
+  auto dofmap = V->dofmap()->map();
+  const int bs = V->dofmap()->bs();
+  const int ndofs = dofmap.extent(1);
+  const int ndofs_bs = bs * ndofs;
+  const std::int32_t num_cells
+      = mesh->topology()->index_map(mesh->topology()->dim())->size_local();
+
+  const std::vector<std::int8_t> markers = bc_markers(*V, bcs);
+
+  MatrixTimes times{std::vector<double>(omp_get_max_threads(), 0)};
+  for (int id : a.integral_ids(IntegralType::cell))
+  {
+    auto kernel = a.kernel(IntegralType::cell, id);
+    if (a.domain(IntegralType::cell, id).size()
+        != static_cast<std::size_t>(num_cells))
+    {
+      throw std::runtime_error("Threaded assembly requires integrals over "
+                               "all owned cells");
+    }
+    auto& [coeffs_c, cstride] = coeffs.at({IntegralType::cell, id});
+
+    MatrixTimes t = assemble_colours<T>(
+        mat_add, colours, std::span(dofmap.data_handle(), dofmap.size()),
+        ndofs, ndofs_bs * ndofs_bs,
+        [&](std::span<const std::int32_t> cells, std::span<T> A)
+        {
+          std::vector<double> coordinate_dofs(3 * num_xdofs);
+          for (std::size_t p = 0; p < cells.size(); ++p)
+          {
+            const std::int32_t c = cells[p];
+            for (std::size_t i = 0; i < num_xdofs; ++i)
+            {
+              std::copy_n(std::next(x.begin(), 3 * x_dofmap(c, i)), 3,
+                          std::next(coordinate_dofs.begin(), 3 * i));
+            }
+
+            std::span<T> Ae = A.subspan(p * ndofs_bs * ndofs_bs,
+                                        ndofs_bs * ndofs_bs);
+            std::fill(Ae.begin(), Ae.end(), 0);
+            kernel(Ae.data(), coeffs_c.data() + c * cstride, constants.data(),
+                   coordinate_dofs.data(), nullptr, nullptr);
+
+            // Zero rows and columns of constrained dofs
+            std::span<const std::int32_t> dofs(
+                dofmap.data_handle() + c * ndofs, ndofs);
+            for (int i = 0; i < ndofs; ++i)
+            {
+              for (int k = 0; k < bs; ++k)
+              {
+                if (markers[bs * dofs[i] + k])
+                {
+                  const int r = bs * i + k;
+                  std::fill_n(std::next(Ae.begin(), r * ndofs_bs), ndofs_bs,
+                              0);
+                  for (int j = 0; j < ndofs_bs; ++j)
+                    Ae[j * ndofs_bs + r] = 0;
+                }
+              }
+            }
+          }
+        });
+    std::transform(times.compute.begin(), times.compute.end(),
+                   t.compute.begin(), times.compute.begin(), std::plus<>());
+    times.insert += t.insert;
+  }
+
+  return times;
+}
+
+/// Assemble a linear form into a vector. Cell integrals are computed in
+/// parallel over the cells of each colour and added directly into `b`.
+/// Exterior facet integrals are assembled serially.
+/// @param[in,out] b Array to add to (including ghost entries)
+/// @param[in] L Linear form
+/// @param[in] constants Packed constants of `L`
+/// @param[in] coeffs Packed coefficients of `L`
+/// @param[in] colours Colouring of the owned cells, from `colour_cells`
+/// @return Time (seconds) spent by each thread on cell integrals
+template <typename T>
+std::vector<double> assemble_vector(
+    std::span<T> b, const dolfinx::fem::Form<T, double>& L,
+    std::span<const T> constants,
+    const std::map<std::pair<dolfinx::fem::IntegralType, int>,
+                   std::pair<std::span<const T>, int>>& coeffs,
+    const std::vector<std::vector<std::int32_t>>& colours)
+{
+  using dolfinx::fem::IntegralType;
+
+  auto V = L.function_spaces()[0];
+  if (V->element()->needs_dof_transformations())
+    throw std::runtime_error("Threaded assembly requires an element "
+                             "without dof transformations");
+  if (!L.integral_ids(IntegralType::interior_facet).empty()
+      or (!L.integral_ids(IntegralType::exterior_facet).empty()
+          and L.needs_facet_permutations()))
+  {
+    throw std::runtime_error("Unsupported integral in threaded vector "
+                             "assembly");
+  }
+
+  auto mesh = L.mesh();
+  auto x_dofmap = mesh->geometry().dofmap();
+  std::span<const double> x = mesh->geometry().x();
+  const std::size_t num_xdofs = x_dofmap.extent(1);
+
+  auto dofmap = V->dofmap()->map();
+  const int bs = V->dofmap()->bs();
+  const int ndofs = dofmap.extent(1);
+  const std::int32_t num_cells
+      = mesh->topology()->index_map(mesh->topology()->dim())->size_local();
+
+  // Compute the element vector for cell c and add it to b
+  auto add_cell
+      = [&](const auto& kernel, std::int32_t c, const T* w,
+            const int* local_facet, std::vector<double>& coordinate_dofs,
+            std::vector<T>& be)
+  {
+    for (std::size_t i = 0; i < num_xdofs; ++i)
+    {
+      std::copy_n(std::next(x.begin(), 3 * x_dofmap(c, i)), 3,
+                  std::next(coordinate_dofs.begin(), 3 * i));
+    }
+    std::fill(be.begin(), be.end(), 0);
+    kernel(be.data(), w, constants.data(), coordinate_dofs.data(),
+           local_facet, nullptr);
+    const std::int32_t* dofs = dofmap.data_handle() + c * ndofs;
+    for (int i = 0; i < ndofs; ++i)
+      for (int k = 0; k < bs; ++k)
+        b[bs * dofs[i] + k] += be[bs * i + k];
+  };
+
+  std::vector<double> times(omp_get_max_threads(), 0);
+  for (int id : L.integral_ids(IntegralType::cell))
+  {
+    auto kernel = L.kernel(IntegralType::cell, id);
+    if (L.domain(IntegralType::cell, id).size()
+        != static_cast<std::size_t>(num_cells))
+    {
+      throw std::runtime_error("Threaded assembly requires integrals over "
+                               "all owned cells");
+    }
+    auto& [coeffs_c, cstride] = coeffs.at({IntegralType::cell, id});
+
+    auto t = for_each_colour(colours,
+                             [&](std::span<const std::int32_t> cells)
+                             {
+                               std::vector<double> coordinate_dofs(
+                                   3 * num_xdofs);
+                               std::vector<T> be(bs * ndofs);
+                               for (std::int32_t c : cells)
+                               {
+                                 add_cell(kernel, c,
+                                          coeffs_c.data() + c * cstride,
+                                          nullptr, coordinate_dofs, be);
+                               }
+                             });
+    std::transform(times.begin(), times.end(), t.begin(), times.begin(),
+                   std::plus<>());
+  }
+
+  // Exterior facets, stored as (cell, local facet) pairs
+  for (int id : L.integral_ids(IntegralType::exterior_facet))
+  {
+    auto kernel = L.kernel(IntegralType::exterior_facet, id);
+    std::span<const std::int32_t> facets
+        = L.domain(IntegralType::exterior_facet, id);
+    auto& [coeffs_f, cstride]
+        = coeffs.at({IntegralType::exterior_facet, id});
+    std::vector<double> coordinate_dofs(3 * num_xdofs);
+    std::vector<T> be(bs * ndofs);
+    for (std::size_t f = 0; f < facets.size(); f += 2)
+    {
+      add_cell(kernel, facets[f], coeffs_f.data() + (f / 2) * cstride,
+               &facets[f + 1], coordinate_dofs, be);
+    }
+  }
+
+  return times;
+}
+} // namespace threaded
@@ -0,0 +1,74 @@
+// Copyright (C) 2026 The FEniCS Project
+//
+// This file is part of FEniCS-miniapp (https://www.fenicsproject.org)
+//
+// SPDX-License-Identifier:    MIT
+
+#include "topology.h"
+#include <algorithm>
+#include <dolfinx/common/IndexMap.h>
+#include <dolfinx/graph/AdjacencyList.h>
+#include <memory>
+#include <stdexcept>
+
+using namespace dolfinx;
+
+namespace
+{
+// Bytes of a connectivity
+std::size_t bytes(const graph::AdjacencyList<std::int32_t>& c)
+{
+  return (c.array().size() + c.offsets().size()) * sizeof(std::int32_t);
+}
+
+// Bytes of the ghost indices and owners of an index map
+std::size_t bytes(const common::IndexMap& map)
+{
+  return map.num_ghosts() * (sizeof(std::int64_t) + sizeof(int));
+}
+} // namespace
+
+//-----------------------------------------------------------------------------
+std::size_t topology::bytes(const mesh::Topology& topology)
+{
+  const int tdim = topology.dim();
+  std::size_t total = 0;
+  std::vector<const graph::AdjacencyList<std::int32_t>*> counted;
+  for (int d0 = 0; d0 <= tdim; ++d0)
+  {
+    if (auto map = topology.index_map(d0))
+      total += ::bytes(*map);
+    for (int d1 = 0; d1 <= tdim; ++d1)
+    {
+      auto c = topology.connectivity(d0, d1);
+      if (c and std::ranges::find(counted, c.get()) == counted.end())
+      {
+        counted.push_back(c.get());
+        total += ::bytes(*c);
+      }
+    }
+  }
+  return total;
+}
+//-----------------------------------------------------------------------------
+std::size_t topology::drop_entities(mesh::Topology& topology, int dim)
+{
+  const int tdim = topology.dim();
+  if (dim <= 0 or dim >= tdim)
+    throw std::runtime_error("Only intermediate entities can be dropped");
+  if (!topology.index_map(dim))
+    return 0;
+
+  std::size_t released = ::bytes(*topology.index_map(dim));
+  for (int d = 0; d <= tdim; ++d)
+  {
+    if (auto c = topology.connectivity(dim, d))
+      released += ::bytes(*c);
+    if (auto c = topology.connectivity(d, dim); c and d != dim)
+      released += ::bytes(*c);
+    topology.set_connectivity(nullptr, dim, d);
+    topology.set_connectivity(nullptr, d, dim);
+  }
+  topology.set_index_map(dim, nullptr);
+  return released;
+}
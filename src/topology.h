@@ -0,0 +1,103 @@
+// Copyright (C) 2026 The FEniCS Project
+//
+// This file is part of FEniCS-miniapp (https://www.fenicsproject.org)
+//
+// SPDX-License-Identifier:    MIT
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <dolfinx/common/IndexMap.h>
+#include <dolfinx/fem/DirichletBC.h>
+#include <dolfinx/fem/DofMap.h>
+#include <dolfinx/fem/ElementDofLayout.h>
+#include <dolfinx/fem/FunctionSpace.h>
+#include <dolfinx/graph/AdjacencyList.h>
+#include <dolfinx/mesh/Mesh.h>
+#include <dolfinx/mesh/Topology.h>
+#include <dolfinx/mesh/cell_types.h>
+#include <dolfinx/mesh/utils.h>
+#include <vector>
+
+/// Mesh topology that is built only where it is needed. With the lean
+/// topology option the facets are not created up front, boundary dofs
+/// are located from the cell vertices, and edges left over from
+/// refinement are dropped.
+namespace topology
+{
+/// Locate the dofs of a space on a part of the boundary: the dofs in
+/// the closure of the facets at whose vertices `marker` is true. If the
+/// facets of the mesh exist they are used. Otherwise (lean topology)
+/// the cell facets are tested through the cell vertices, with the
+/// reference facet vertices, so that neither the mesh facets nor the
+/// dof coordinates (3 values per dof) are created; the extra memory is
+/// the vertex coordinates and a marker of each vertex.
+/// @param[in] V Function space
+/// @param[in] marker Function that marks points (columns of a 3 x n
+/// array) on the boundary part
+/// @return Local indices of the dofs (blocks for a blocked space),
+/// sorted
+template <typename Marker>
+std::vector<std::int32_t>
+locate_boundary_dofs(const dolfinx::fem::FunctionSpace<double>& V,
+                     Marker&& marker)
+{
+  auto mesh = V.mesh();
+  auto topology = mesh->topology();
+  const int tdim = topology->dim();
+  if (topology->index_map(tdim - 1))
+  {
+    const std::vector<std::int32_t> facets
+        = dolfinx::mesh::locate_entities(*mesh, tdim - 1, marker);
+    return dolfinx::fem::locate_dofs_topological(
+        *mesh->topology_mutable(), *V.dofmap(), tdim - 1, facets);
+  }
+
+  std::vector<std::int8_t> on_boundary(
+      topology->index_map(0)->size_local()
+          + topology->index_map(0)->num_ghosts(),
+      false);
+  for (std::int32_t v : dolfinx::mesh::locate_entities(*mesh, 0, marker))
+    on_boundary[v] = true;
+
+  const dolfinx::graph::AdjacencyList<int> facet_vertices
+      = dolfinx::mesh::get_entity_vertices(topology->cell_type(), tdim - 1);
+  const dolfinx::fem::ElementDofLayout& layout
+      = V.dofmap()->element_dof_layout();
+  auto c_to_v = topology->connectivity(tdim, 0);
+  std::vector<std::int32_t> dofs;
+  for (std::int32_t c = 0; c < c_to_v->num_nodes(); ++c)
+  {
+    auto vertices = c_to_v->links(c);
+    auto cell_dofs = V.dofmap()->cell_dofs(c);
+    for (int f = 0; f < facet_vertices.num_nodes(); ++f)
+    {
+      if (std::ranges::all_of(facet_vertices.links(f),
+                              [&](int v) { return on_boundary[vertices[v]]; }))
+      {
+        for (int i : layout.entity_closure_dofs(tdim - 1, f))
+          dofs.push_back(cell_dofs[i]);
+      }
+    }
+  }
+  std::ranges::sort(dofs);
+  dofs.erase(std::unique(dofs.begin(), dofs.end()), dofs.end());
+  return dofs;
+}
+
+/// Bytes of the connectivity and the entity index maps (ghost
+/// indices) of a topology on this process
+/// @param[in] topology Mesh topology
+std::size_t bytes(const dolfinx::mesh::Topology& topology);
+
+/// Drop the entities of a dimension and all connectivity to or from
+/// them. They are created again if a function space or form needs
+/// them later.
+/// @param[in,out] topology Mesh topology
+/// @param[in] dim Entity dimension, strictly between 0 and the cell
+/// dimension
+/// @return Bytes released on this process
+std::size_t drop_entities(dolfinx::mesh::Topology& topology, int dim);
+} // namespace topology